@@ -0,0 +1,250 @@
+/*
+ * GitCommitIndex.cpp
+ *
+ * Copyright (C) 2022 by RStudio, PBC
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/GitCommitIndex.hpp>
+
+#include <boost/algorithm/string/find.hpp>
+#include <boost/algorithm/string/join.hpp>
+#include <boost/algorithm/string/split.hpp>
+#include <boost/algorithm/string/classification.hpp>
+
+#include <shared_core/Error.hpp>
+#include <shared_core/FilePath.hpp>
+
+#include <core/FileSerializer.hpp>
+
+namespace rstudio {
+namespace core {
+namespace gitgraph {
+
+// fields are separated by US (unit separator), and commits terminated by
+// RS (record separator); neither should appear in commit messages. (the
+// commit's time zone is taken from the end of its ISO date, %ci)
+const char* const kCommitIndexLogFormat =
+      "%H%x1f%P%x1f%an <%ae>%x1f%ct%x1f%ci%x1f%B%x1e";
+
+namespace {
+
+const char kFieldSeparator = '\x1f';
+const char kRecordSeparator = '\x1e';
+
+// identifies (and versions) the format of index files
+const char* const kIndexFileHeader = "rstudio-git-commit-index 1";
+
+// the number of commits between saved graph states
+const std::size_t kCheckpointInterval = 1000;
+
+Error parseLog(const std::string& logOutput, std::vector<IndexedCommit>* pCommits)
+{
+   std::size_t pos = 0;
+   while (pos < logOutput.size())
+   {
+      std::size_t end = logOutput.find(kRecordSeparator, pos);
+      if (end == std::string::npos)
+      {
+         // allow trailing whitespace after the last commit
+         if (logOutput.find_first_not_of("\r\n", pos) == std::string::npos)
+            break;
+         return systemError(boost::system::errc::protocol_error,
+                            "Unterminated commit in git log output",
+                            ERROR_LOCATION);
+      }
+
+      // (each commit after the first begins with a newline)
+      std::size_t begin = logOutput.find_first_not_of("\r\n", pos);
+      std::vector<std::string> fields;
+      if (begin < end)
+      {
+         std::string record = logOutput.substr(begin, end - begin);
+         boost::algorithm::split(fields, record,
+                                 [](char c) { return c == kFieldSeparator; });
+      }
+      if (fields.size() != 6)
+      {
+         return systemError(boost::system::errc::protocol_error,
+                            "Unexpected git log output",
+                            ERROR_LOCATION);
+      }
+
+      IndexedCommit commit;
+      commit.id = fields[0];
+      if (!fields[1].empty())
+         boost::algorithm::split(commit.parents, fields[1], boost::algorithm::is_any_of(" "));
+      commit.author = fields[2];
+      commit.time = fields[3];
+      commit.timeZone = fields[4].substr(fields[4].find_last_of(' ') + 1);
+      commit.message = fields[5];
+
+      std::size_t messageEnd = commit.message.find_last_not_of("\r\n");
+      commit.message.resize(messageEnd == std::string::npos ? 0 : messageEnd + 1);
+
+      pCommits->push_back(std::move(commit));
+      pos = end + 1;
+   }
+
+   return Success();
+}
+
+} // anonymous namespace
+
+Error CommitIndex::prepend(const std::string& logOutput,
+                           const std::vector<std::string>& tips)
+{
+   std::vector<IndexedCommit> commits;
+   Error error = parseLog(logOutput, &commits);
+   if (error)
+      return error;
+
+   commits_.insert(commits_.begin(),
+                   std::make_move_iterator(commits.begin()),
+                   std::make_move_iterator(commits.end()));
+   tips_ = tips;
+
+   // every line of the graph may have changed
+   checkpoints_.clear();
+   return Success();
+}
+
+void CommitIndex::clear()
+{
+   tips_.clear();
+   commits_.clear();
+   checkpoints_.clear();
+}
+
+std::vector<std::string> CommitIndex::graphLines(std::size_t start, std::size_t count)
+{
+   std::vector<std::string> lines;
+   std::size_t end = std::min(start + count, commits_.size());
+   if (start >= end)
+      return lines;
+
+   // resume the graph from the last checkpoint before the first line,
+   // making checkpoints along the way if we don't yet have it
+   GitGraph graph;
+   if (checkpoints_.empty())
+      checkpoints_.push_back(graph.state());
+
+   std::size_t checkpoint = std::min(start / kCheckpointInterval, checkpoints_.size() - 1);
+   graph.restoreState(checkpoints_[checkpoint]);
+
+   for (std::size_t i = checkpoint * kCheckpointInterval; i < end; i++)
+   {
+      if (i % kCheckpointInterval == 0 && i / kCheckpointInterval == checkpoints_.size())
+         checkpoints_.push_back(graph.state());
+
+      Line line = graph.addCommit(commits_[i].id, commits_[i].parents);
+      if (i >= start)
+         lines.push_back(line.string());
+   }
+
+   return lines;
+}
+
+std::vector<std::size_t> CommitIndex::search(const std::vector<std::string>& patterns) const
+{
+   std::vector<std::size_t> matches;
+   for (std::size_t i = 0; i < commits_.size(); i++)
+   {
+      const IndexedCommit& commit = commits_[i];
+
+      bool isMatch = true;
+      for (const std::string& pattern : patterns)
+      {
+         if (!boost::algorithm::ifind_first(commit.author, pattern)
+             && !boost::algorithm::ifind_first(commit.message, pattern)
+             && !boost::algorithm::ifind_first(commit.id, pattern))
+         {
+            isMatch = false;
+            break;
+         }
+      }
+
+      if (isMatch)
+         matches.push_back(i);
+   }
+
+   return matches;
+}
+
+Error CommitIndex::readFromFile(const FilePath& filePath)
+{
+   clear();
+
+   std::string contents;
+   Error error = readStringFromFile(filePath, &contents);
+   if (error)
+      return error;
+
+   // the header, then the tips, then the commits (as git log output)
+   std::size_t headerEnd = contents.find('\n');
+   std::size_t tipsEnd = headerEnd == std::string::npos ?
+            std::string::npos : contents.find('\n', headerEnd + 1);
+   if (tipsEnd == std::string::npos ||
+       contents.compare(0, headerEnd, kIndexFileHeader) != 0)
+   {
+      error = systemError(boost::system::errc::protocol_error,
+                          "Unexpected git commit index format",
+                          ERROR_LOCATION);
+      error.addProperty("path", filePath);
+      return error;
+   }
+
+   std::vector<std::string> tips;
+   std::string tipsLine = contents.substr(headerEnd + 1, tipsEnd - headerEnd - 1);
+   if (!tipsLine.empty())
+      boost::algorithm::split(tips, tipsLine, boost::algorithm::is_any_of(" "));
+
+   error = prepend(contents.substr(tipsEnd + 1), tips);
+   if (error)
+   {
+      clear();
+      error.addProperty("path", filePath);
+      return error;
+   }
+
+   return Success();
+}
+
+Error CommitIndex::writeToFile(const FilePath& filePath) const
+{
+   std::string contents = kIndexFileHeader;
+   contents.push_back('\n');
+   contents.append(boost::algorithm::join(tips_, " "));
+   contents.push_back('\n');
+
+   for (const IndexedCommit& commit : commits_)
+   {
+      contents.append(commit.id);
+      contents.push_back(kFieldSeparator);
+      contents.append(boost::algorithm::join(commit.parents, " "));
+      contents.push_back(kFieldSeparator);
+      contents.append(commit.author);
+      contents.push_back(kFieldSeparator);
+      contents.append(commit.time);
+      contents.push_back(kFieldSeparator);
+      contents.append(commit.timeZone);
+      contents.push_back(kFieldSeparator);
+      contents.append(commit.message);
+      contents.push_back(kRecordSeparator);
+      contents.push_back('\n');
+   }
+
+   return writeStringToFile(filePath, contents);
+}
+
+} // namespace gitgraph
+} // namespace core
+} // namespace rstudio
@@ -0,0 +1,204 @@
+/*
+ * GitCommitIndexTests.cpp
+ *
+ * Copyright (C) 2022 by RStudio, PBC
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <tests/TestThat.hpp>
+
+#include <chrono>
+#include <iostream>
+
+#include <shared_core/FilePath.hpp>
+
+#include <core/GitCommitIndex.hpp>
+
+namespace rstudio {
+namespace core {
+namespace gitgraph {
+namespace tests {
+
+namespace {
+
+std::string commitId(std::size_t n)
+{
+   return "c" + std::to_string(n);
+}
+
+// git log output for a history of count commits, numbered from newest to
+// oldest (and offset by first). every tenth commit merges in a side branch
+// of two commits.
+std::string logOutput(std::size_t first, std::size_t count)
+{
+   std::string output;
+   for (std::size_t i = first; i < first + count; i++)
+   {
+      std::string parents;
+      if (i + 1 < first + count)
+         parents = commitId(i + 1);
+      if (i % 10 == 0 && i + 3 < first + count)
+         parents += " " + commitId(i + 2);
+
+      output += commitId(i) + "\x1f" + parents + "\x1f" +
+                "Author " + std::to_string(i % 3) + " <author@example.com>\x1f" +
+                std::to_string(1600000000 + i) + "\x1f" "2020-09-13 13:26:40 +0100\x1f" +
+                "Commit " + std::to_string(i) + "\n\nDetails of change " +
+                std::to_string(i) + "\n\x1e\n";
+   }
+   return output;
+}
+
+// the graph lines for the whole history, built in one pass
+std::vector<std::string> allGraphLines(const CommitIndex& index)
+{
+   GitGraph graph;
+   std::vector<std::string> lines;
+   for (std::size_t i = 0; i < index.size(); i++)
+      lines.push_back(graph.addCommit(index.at(i).id, index.at(i).parents).string());
+   return lines;
+}
+
+} // anonymous namespace
+
+test_context("Git commit index")
+{
+   test_that("Commits are read from git log output")
+   {
+      CommitIndex index;
+      expect_false(index.prepend(logOutput(0, 5), { commitId(0) }));
+
+      expect_true(index.size() == 5);
+      expect_true(index.tips() == std::vector<std::string>({ commitId(0) }));
+      expect_true(index.at(0).id == "c0");
+      expect_true(index.at(0).parents == std::vector<std::string>({ "c1", "c2" }));
+      expect_true(index.at(4).parents.empty());
+      expect_true(index.at(1).parents == std::vector<std::string>({ "c2" }));
+      expect_true(index.at(1).author == "Author 1 <author@example.com>");
+      expect_true(index.at(1).time == "1600000001");
+      expect_true(index.at(1).timeZone == "+0100");
+      expect_true(index.at(1).message == "Commit 1\n\nDetails of change 1");
+   }
+
+   test_that("Malformed output is rejected")
+   {
+      CommitIndex index;
+      expect_true(index.prepend("c0\x1f\x1f" "author\x1e\n", {}));
+      expect_true(index.prepend(logOutput(0, 2) + "c3\x1f", {}));
+   }
+
+   test_that("Graph lines can be read from any point in the history")
+   {
+      CommitIndex index;
+      expect_false(index.prepend(logOutput(0, 3500), { commitId(0) }));
+      std::vector<std::string> expected = allGraphLines(index);
+
+      // (read out of order, so some pages start from checkpoints)
+      for (std::size_t start : { 2990, 10, 0, 1995, 3400, 999, 1000 })
+      {
+         std::vector<std::string> lines = index.graphLines(start, 100);
+         std::size_t count = std::min<std::size_t>(100, 3500 - start);
+         expect_true(lines.size() == count);
+         expect_true(std::equal(lines.begin(), lines.end(), expected.begin() + start));
+      }
+
+      expect_true(index.graphLines(3500, 100).empty());
+   }
+
+   test_that("New commits are added ahead of existing ones")
+   {
+      CommitIndex index;
+      expect_false(index.prepend(logOutput(5, 2000), { commitId(5) }));
+      index.graphLines(1500, 10);
+
+      expect_false(index.prepend(logOutput(0, 5), { commitId(0) }));
+      expect_true(index.size() == 2005);
+      expect_true(index.at(0).id == "c0");
+      expect_true(index.at(5).id == "c5");
+      expect_true(index.tips() == std::vector<std::string>({ commitId(0) }));
+
+      std::vector<std::string> expected = allGraphLines(index);
+      std::vector<std::string> lines = index.graphLines(1500, 10);
+      expect_true(std::equal(lines.begin(), lines.end(), expected.begin() + 1500));
+   }
+
+   test_that("Commits are searched by id, author and message")
+   {
+      CommitIndex index;
+      expect_false(index.prepend(logOutput(0, 30), { commitId(0) }));
+
+      expect_true(index.search({ "c12" }) == std::vector<std::size_t>({ 12 }));
+      expect_true(index.search({ "details OF change 2" }).size() == 11);
+      expect_true(index.search({ "author 1", "change 1" }) ==
+                  std::vector<std::size_t>({ 1, 10, 13, 16, 19 }));
+      expect_true(index.search({ "nothing" }).empty());
+   }
+
+   test_that("Indexes can be saved and restored")
+   {
+      CommitIndex index;
+      expect_false(index.prepend(logOutput(0, 50), { commitId(0), commitId(1) }));
+
+      FilePath indexPath;
+      expect_false(FilePath::tempFilePath(indexPath));
+      expect_false(index.writeToFile(indexPath));
+
+      CommitIndex restored;
+      expect_false(restored.readFromFile(indexPath));
+      expect_true(restored.tips() == index.tips());
+      expect_true(restored.size() == 50);
+      for (std::size_t i = 0; i < index.size(); i++)
+      {
+         expect_true(restored.at(i).id == index.at(i).id);
+         expect_true(restored.at(i).parents == index.at(i).parents);
+         expect_true(restored.at(i).message == index.at(i).message);
+      }
+
+      indexPath.removeIfExists();
+   }
+}
+
+TEST_CASE("Git commit index benchmark", "[.benchmark]")
+{
+   // a 200k commit history
+   CommitIndex index;
+   std::string output = logOutput(0, 200000);
+
+   auto start = std::chrono::steady_clock::now();
+   REQUIRE_FALSE(index.prepend(output, { commitId(0) }));
+   double parseSeconds = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start).count();
+
+   // the time to read a page, once checkpoints have been made, by how far
+   // into the history it is
+   index.graphLines(199900, 100);
+   for (std::size_t page : { 0, 1000, 100000, 199900 })
+   {
+      start = std::chrono::steady_clock::now();
+      std::vector<std::string> lines = index.graphLines(page, 100);
+      double seconds = std::chrono::duration<double>(
+               std::chrono::steady_clock::now() - start).count();
+      std::cout << "page at " << page << ": " << seconds * 1000 << "ms" << std::endl;
+   }
+
+   start = std::chrono::steady_clock::now();
+   std::size_t matches = index.search({ "change 12345" }).size();
+   double searchSeconds = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start).count();
+
+   std::cout << "parsed 200000 commits in " << parseSeconds << "s, searched in "
+             << searchSeconds << "s (" << matches << " matches)" << std::endl;
+}
+
+} // namespace tests
+} // namespace gitgraph
+} // namespace core
+} // namespace rstudio
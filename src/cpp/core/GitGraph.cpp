@@ -157,6 +157,20 @@ Line GitGraph::addCommit(const std::string& commit,
    return result;
 }
 
+GitGraph::State GitGraph::state() const
+{
+   State state;
+   state.nextColumnId = nextColumnId_;
+   state.pendingLine = pendingLine_;
+   return state;
+}
+
+void GitGraph::restoreState(const State& state)
+{
+   nextColumnId_ = state.nextColumnId;
+   pendingLine_ = state.pendingLine;
+}
+
 } // namespace gitgraph
 } // namespace core
 } // namespace rstudio
@@ -36,6 +36,7 @@ namespace log {
 #define kLogDir            "log-dir"
 #define kLogFileMode       "log-file-mode"
 #define kLogFileIncludePid "log-file-include-pid"
+#define kLogFileAsync      "log-file-async"
 #define kRotate            "rotate"
 #define kMaxSizeMb         "max-size-mb"
 #define kRotateDays        "rotate-days"
@@ -200,7 +201,8 @@ struct LoggerOptionsVisitor : boost::static_visitor<>
          kRotateDays, defaultOptions.getRotationDays(),
          kMaxRotations, defaultOptions.getMaxRotations(),
          kDeleteDays, defaultOptions.getDeletionDays(),
-         kWarnSyslog, defaultOptions.warnSyslog());
+         kWarnSyslog, defaultOptions.warnSyslog(),
+         kLogFileAsync, defaultOptions.asyncWrite());
    }
 
    void operator()(const StdErrLogOptions& options)
@@ -225,7 +227,8 @@ struct LoggerOptionsVisitor : boost::static_visitor<>
          kRotateDays, options.getRotationDays(),
          kMaxRotations, options.getMaxRotations(),
          kDeleteDays, options.getDeletionDays(),
-         kWarnSyslog, options.warnSyslog());
+         kWarnSyslog, options.warnSyslog(),
+         kLogFileAsync, options.asyncWrite());
    }
 
    ConfigProfile& profile_;
@@ -463,7 +466,7 @@ LoggerOptions LogOptions::loggerOptions(const std::string& loggerName) const
          std::vector<ConfigProfile::Level> levels = getLevels(loggerName);
 
          std::string logDir, fileMode, messageFormatStr;
-         bool rotate, includePid, warnSyslog;
+         bool rotate, includePid, warnSyslog, asyncWrite;
          double maxSizeMb;
          int rotateDays, maxRotations, deleteDays;
 
@@ -475,6 +478,7 @@ LoggerOptions LogOptions::loggerOptions(const std::string& loggerName) const
          profile_.getParam(kMaxRotations, &maxRotations, levels);
          profile_.getParam(kDeleteDays, &deleteDays, levels);
          profile_.getParam(kWarnSyslog, &warnSyslog, levels);
+         profile_.getParam(kLogFileAsync, &asyncWrite, levels);
 
          profile_.getParam(kLogDir, &logDir, levels);
          FilePath loggingDir(logDir);
@@ -495,7 +499,7 @@ LoggerOptions LogOptions::loggerOptions(const std::string& loggerName) const
          if (!logDirOverride.empty())
             loggingDir = FilePath(logDirOverride);
 
-         return FileLogOptions(loggingDir, fileMode, maxSizeMb, rotateDays, maxRotations, deleteDays, rotate, includePid, warnSyslog, forceLogDir);
+         return FileLogOptions(loggingDir, fileMode, maxSizeMb, rotateDays, maxRotations, deleteDays, rotate, includePid, warnSyslog, forceLogDir, asyncWrite);
       }
 
       case LoggerType::kStdErr:
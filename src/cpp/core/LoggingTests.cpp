@@ -15,6 +15,12 @@
 
 #include <tests/TestThat.hpp>
 
+#ifndef _WIN32
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
 #include <core/Log.hpp>
 #include <core/LogOptions.hpp>
 
@@ -23,11 +29,13 @@
 #include <core/system/System.hpp>
 
 #include <shared_core/DateTime.hpp>
+#include <shared_core/FileLogDestination.hpp>
 #include <shared_core/FilePath.hpp>
 #include <shared_core/json/Json.hpp>
 #include <shared_core/SafeConvert.hpp>
 
 #include <boost/algorithm/string.hpp>
+#include <boost/make_shared.hpp>
 
 namespace rstudio {
 namespace core {
@@ -1036,7 +1044,198 @@ test_context("Logging")
       // only newline should be at the end of the log file, signifying the end of the log line
       REQUIRE(logFileContents.find("\n") == logFileContents.size() - 1);
    }
+
+#ifndef _WIN32
+   test_that("File logs can be written asynchronously")
+   {
+      FilePath tmpConfPath;
+      REQUIRE_FALSE(FilePath::tempFilePath(".conf", tmpConfPath));
+
+      std::string confFileContents =
+            "[*]\n"
+            "logger-type=file\n"
+            "log-level=info\n"
+            "log-file-async=1\n"
+            "log-dir=" + tmpConfPath.getParent().getAbsolutePath();
+
+      REQUIRE_FALSE(core::writeStringToFile(tmpConfPath, confFileContents));
+
+      clearLogEnvVars();
+      core::system::setenv("RS_LOG_CONF_FILE", tmpConfPath.getAbsolutePath());
+
+      std::string id = core::system::generateShortenedUuid();
+      REQUIRE_FALSE(core::system::initializeStderrLog("logging-tests-" + id, log::LogLevel::WARN, true));
+
+      LOG_DEBUG_MESSAGE("Debug message");
+      LOG_INFO_MESSAGE("Info message");
+      LOG_ERROR_MESSAGE("Error message");
+
+      // errors are written right away (but by another thread)
+      FilePath logFile = tmpConfPath.getParent().completeChildPath("logging-tests-" + id + ".log");
+      std::string logFileContents;
+      for (int i = 0; i < 50 && logFileContents.find("Error message") == std::string::npos; ++i)
+      {
+         boost::this_thread::sleep(boost::posix_time::milliseconds(20));
+         core::readStringFromFile(logFile, &logFileContents);
+      }
+
+      REQUIRE(logFileContents.find("Debug message") == std::string::npos);
+      REQUIRE(logFileContents.find("Info message") != std::string::npos);
+      REQUIRE(logFileContents.find("Error message") != std::string::npos);
+      REQUIRE(logFileContents.find("Info message") < logFileContents.find("Error message"));
+   }
+
+   test_that("Asynchronous file logs keep every message from every thread")
+   {
+      FilePath logDir;
+      REQUIRE_FALSE(FilePath::tempFilePath(logDir));
+
+      std::string id = "logging-tests-" + core::system::generateShortenedUuid();
+      log::FileLogOptions options(logDir);
+      options.setAsyncWrite(true);
+      options.setWarnSyslog(false);
+      options.setDoRotation(false);
+
+      const int kThreads = 8;
+      const int kMessages = 2000;
+      {
+         log::FileLogDestination destination(id, log::LogLevel::INFO, log::LogMessageFormatType::PRETTY,
+                                             id, options);
+
+         std::vector<boost::shared_ptr<boost::thread> > threads;
+         for (int i = 0; i < kThreads; ++i)
+         {
+            threads.push_back(boost::make_shared<boost::thread>([&destination, i]() {
+               for (int j = 0; j < kMessages; ++j)
+               {
+                  destination.writeLog(log::LogLevel::INFO,
+                                       "thread " + safe_convert::numberToString(i) +
+                                       " message " + safe_convert::numberToString(j) + "\n");
+               }
+            }));
+         }
+
+         for (const boost::shared_ptr<boost::thread>& thread : threads)
+            thread->join();
+
+         // destroying the destination writes any messages still queued
+      }
+
+      std::vector<std::string> lines;
+      REQUIRE_FALSE(core::readStringVectorFromFile(logDir.completeChildPath(id + ".log"), &lines));
+      REQUIRE(lines.size() == static_cast<std::size_t>(kThreads * kMessages));
+
+      // each thread's messages are in the order they were logged
+      std::vector<int> next(kThreads, 0);
+      for (const std::string& line : lines)
+      {
+         int thread = 0, message = 0;
+         REQUIRE(std::sscanf(line.c_str(), "thread %d message %d", &thread, &message) == 2);
+         REQUIRE(message == next[thread]++);
+      }
+
+      REQUIRE_FALSE(logDir.removeIfExists());
+   }
+
+   test_that("Asynchronous file logs are written synchronously by forked children")
+   {
+      FilePath logDir;
+      REQUIRE_FALSE(FilePath::tempFilePath(logDir));
+
+      std::string id = "logging-tests-" + core::system::generateShortenedUuid();
+      log::FileLogOptions options(logDir);
+      options.setAsyncWrite(true);
+      options.setWarnSyslog(false);
+      options.setDoRotation(false);
+
+      // more messages than the queue holds
+      const int kMessages = 10000;
+      {
+         log::FileLogDestination destination(id, log::LogLevel::INFO, log::LogMessageFormatType::PRETTY,
+                                             id, options);
+
+         // (the child has no writer thread, as it hasn't been refreshed)
+         pid_t pid = ::fork();
+         REQUIRE(pid != -1);
+         if (pid == 0)
+         {
+            for (int i = 0; i < kMessages; ++i)
+               destination.writeLog(log::LogLevel::INFO, "message " + safe_convert::numberToString(i) + "\n");
+            ::_exit(0);
+         }
+
+         int status = 0;
+         pid_t result = 0;
+         for (int i = 0; i < 500 && result == 0; ++i)
+         {
+            result = ::waitpid(pid, &status, WNOHANG);
+            if (result == 0)
+               boost::this_thread::sleep(boost::posix_time::milliseconds(20));
+         }
+
+         if (result == 0)
+         {
+            ::kill(pid, SIGKILL);
+            ::waitpid(pid, &status, 0);
+         }
+
+         REQUIRE(result == pid);
+         REQUIRE(WIFEXITED(status));
+      }
+
+      std::vector<std::string> lines;
+      REQUIRE_FALSE(core::readStringVectorFromFile(logDir.completeChildPath(id + ".log"), &lines));
+      REQUIRE(lines.size() == static_cast<std::size_t>(kMessages));
+
+      REQUIRE_FALSE(logDir.removeIfExists());
+   }
+#endif
+}
+
+#ifndef _WIN32
+TEST_CASE("File log throughput benchmark", "[.benchmark]")
+{
+   const int kThreads = 16;
+   const int kMessages = 20000;
+
+   for (bool asyncWrite : { false, true })
+   {
+      FilePath logDir;
+      REQUIRE_FALSE(FilePath::tempFilePath(logDir));
+
+      std::string id = "logging-bench-" + core::system::generateShortenedUuid();
+      log::FileLogOptions options(logDir);
+      options.setAsyncWrite(asyncWrite);
+      options.setWarnSyslog(false);
+      options.setMaxSizeMb(1024);
+
+      log::FileLogDestination destination(id, log::LogLevel::INFO, log::LogMessageFormatType::PRETTY,
+                                          id, options);
+      std::string message = "2022-05-01T12:00:00.000000Z [rsession-user] INFO Received event: "
+                            "{\"type\":\"console_output\",\"data\":\"[1] 42\"}\n";
+
+      boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+      std::vector<boost::shared_ptr<boost::thread> > threads;
+      for (int i = 0; i < kThreads; ++i)
+      {
+         threads.push_back(boost::make_shared<boost::thread>([&]() {
+            for (int j = 0; j < kMessages; ++j)
+               destination.writeLog(log::LogLevel::INFO, message);
+         }));
+      }
+
+      for (const boost::shared_ptr<boost::thread>& thread : threads)
+         thread->join();
+
+      double seconds = (boost::posix_time::microsec_clock::universal_time() - start).total_microseconds() / 1e6;
+      std::cout << (asyncWrite ? "async: " : "sync: ")
+                << static_cast<int>(kThreads * kMessages / seconds) << " log calls/sec from "
+                << kThreads << " threads" << std::endl;
+
+      REQUIRE_FALSE(logDir.removeIfExists());
+   }
 }
+#endif
 
 } // namespace unit_tests
 } // namespace core
@@ -131,6 +131,52 @@ bool isSubsequence(std::string const& self,
             ;
 }
 
+namespace {
+
+inline char asciiToLower(char ch)
+{
+   return (ch >= 'A' && ch <= 'Z') ? static_cast<char>(ch + ('a' - 'A')) : ch;
+}
+
+} // anonymous namespace
+
+bool isSubsequence(const char* begin,
+                   const char* end,
+                   std::string const& other,
+                   std::string::size_type other_n,
+                   bool caseInsensitive)
+{
+   if (other_n > other.length())
+      other_n = other.length();
+
+   if (other_n == 0)
+      return true;
+
+   if (other_n > static_cast<std::string::size_type>(end - begin))
+      return false;
+
+   std::string::size_type other_idx = 0;
+   char otherChar = other[0];
+   if (caseInsensitive)
+      otherChar = asciiToLower(otherChar);
+
+   for (const char* it = begin; it != end; ++it)
+   {
+      char selfChar = caseInsensitive ? asciiToLower(*it) : *it;
+      if (selfChar != otherChar)
+         continue;
+
+      if (++other_idx == other_n)
+         return true;
+
+      otherChar = other[other_idx];
+      if (caseInsensitive)
+         otherChar = asciiToLower(otherChar);
+   }
+
+   return false;
+}
+
 bool isSubsequence(std::string const& self,
                    std::string const& other)
 {
@@ -559,7 +605,7 @@ std::vector<bool> initAlphaLookupTable()
 
 bool isalpha(wchar_t c)
 {
-   static std::vector<bool> lookup = initAlphaLookupTable();
+   static const std::vector<bool> lookup = initAlphaLookupTable();
    if (c >= 0xFFFF)
       return false; // This function only supports BMP
    return lookup.at(c);
@@ -567,10 +613,7 @@ bool isalpha(wchar_t c)
 
 bool isalnum(wchar_t c)
 {
-   static std::vector<bool> lookup;
-   if (lookup.empty())
-      lookup = initAlnumLookupTable();
-
+   static const std::vector<bool> lookup = initAlnumLookupTable();
    if (c >= 0xFFFF)
       return false; // This function only supports BMP
    return lookup.at(c);
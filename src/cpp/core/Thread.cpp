@@ -15,6 +15,11 @@
 
 #include <core/Backtrace.hpp>
 
+#include <algorithm>
+
+#include <boost/assert.hpp>
+#include <boost/bind/bind.hpp>
+
 #include <shared_core/Error.hpp>
 
 #include <core/Macros.hpp>
@@ -34,6 +39,9 @@ namespace {
 // via initializeMainThreadId() if necessary
 boost::thread::id s_mainThreadId = boost::this_thread::get_id();
 
+// threads belonging to worker pools (which must never call into R)
+ThreadsafeSet<boost::thread::id> s_workerThreadIds;
+
 } // end anonymous namespace
 
 void safeLaunchThread(boost::function<void()> threadMain,
@@ -60,6 +68,94 @@ void safeLaunchThread(boost::function<void()> threadMain,
    }
 }
 
+WorkerPool::WorkerPool(std::size_t threadCount)
+   : threadCount_(std::max<std::size_t>(threadCount, 1)),
+     stopped_(false)
+{
+}
+
+WorkerPool::~WorkerPool()
+{
+   try
+   {
+      stop();
+   }
+   CATCH_UNEXPECTED_EXCEPTION
+}
+
+void WorkerPool::enque(const boost::function<void()>& task)
+{
+   LOCK_MUTEX(mutex_)
+   {
+      if (stopped_)
+         return;
+
+      tasks_.push(task);
+
+      // start the threads on first use
+      while (threads_.size() < threadCount_)
+      {
+         boost::shared_ptr<boost::thread> pThread(new boost::thread());
+         safeLaunchThread(boost::bind(&WorkerPool::run, this), pThread.get());
+         threads_.push_back(pThread);
+      }
+   }
+   END_LOCK_MUTEX
+
+   condition_.notify_one();
+}
+
+void WorkerPool::stop()
+{
+   std::vector<boost::shared_ptr<boost::thread> > threads;
+   LOCK_MUTEX(mutex_)
+   {
+      stopped_ = true;
+      tasks_ = std::queue<boost::function<void()> >();
+      threads.swap(threads_);
+   }
+   END_LOCK_MUTEX
+
+   condition_.notify_all();
+
+   for (const boost::shared_ptr<boost::thread>& pThread : threads)
+   {
+      if (pThread->joinable())
+         pThread->join();
+   }
+}
+
+void WorkerPool::run()
+{
+   boost::thread::id threadId = boost::this_thread::get_id();
+   s_workerThreadIds.insert(threadId);
+
+   while (true)
+   {
+      boost::function<void()> task;
+      {
+         boost::unique_lock<boost::mutex> lock(mutex_);
+         while (!stopped_ && tasks_.empty())
+            condition_.wait(lock);
+
+         if (stopped_)
+         {
+            s_workerThreadIds.remove(threadId);
+            return;
+         }
+
+         task = tasks_.front();
+         tasks_.pop();
+      }
+
+      try
+      {
+         task();
+      }
+      CATCH_UNEXPECTED_EXCEPTION
+   }
+}
+
 void initializeMainThreadId(boost::thread::id id)
 {
    s_mainThreadId = id;
@@ -96,6 +192,11 @@ bool assertMainThread(
 
    core::log::logErrorMessage(errorMessage, errorLocation);
 
+   // worker pool tasks run while R is busy on the main thread, so they must
+   // never call into R; make that hard to miss in debug builds
+   BOOST_ASSERT_MSG(!s_workerThreadIds.contains(boost::this_thread::get_id()),
+                    "main thread only function called from a worker pool thread");
+
 #ifndef RSTUDIO_PACKAGE_BUILD
    // print a backtrace in developer builds
    core::backtrace::printBacktrace();
@@ -0,0 +1,266 @@
+/*
+ * ThreadTests.cpp
+ *
+ * Copyright (C) 2022 by RStudio, PBC
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <tests/TestThat.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <core/Thread.hpp>
+
+namespace rstudio {
+namespace core {
+namespace thread {
+namespace tests {
+
+namespace {
+
+typedef std::pair<int, int> Item; // (producer, sequence)
+
+// stands in for the previous client event queue: a vector guarded by a
+// mutex, with every add notifying waiters and removal copying the vector
+class LockingQueue
+{
+public:
+   void add(const std::string& event)
+   {
+      LOCK_MUTEX(mutex_)
+      {
+         events_.push_back(event);
+      }
+      END_LOCK_MUTEX
+
+      condition_.notify_all();
+   }
+
+   void remove(std::vector<std::string>* pEvents)
+   {
+      LOCK_MUTEX(mutex_)
+      {
+         pEvents->insert(pEvents->end(), events_.begin(), events_.end());
+         events_.clear();
+      }
+      END_LOCK_MUTEX
+   }
+
+private:
+   boost::mutex mutex_;
+   boost::condition condition_;
+   std::vector<std::string> events_;
+};
+
+class LockFreeQueue
+{
+public:
+   void add(const std::string& event)
+   {
+      queue_.enque(event);
+   }
+
+   void remove(std::vector<std::string>* pEvents)
+   {
+      std::string event;
+      while (queue_.deque(&event))
+         pEvents->push_back(std::move(event));
+   }
+
+private:
+   MpscQueue<std::string> queue_;
+};
+
+struct StallStats
+{
+   StallStats() : totalNs(0), maxNs(0), received(0) {}
+
+   int64_t totalNs;
+   int64_t maxNs;
+   std::size_t received;
+};
+
+// a single producer (the R thread) adds events while another thread drains
+// the queue in small batches (the http thread servicing get_events);
+// returns the time the producer spent inside add
+template <typename Queue>
+StallStats measureProducerStall(int events)
+{
+   Queue queue;
+   std::atomic<bool> done(false);
+   StallStats stats;
+
+   boost::thread consumer([&]() {
+      std::vector<std::string> batch;
+      while (!done.load())
+      {
+         queue.remove(&batch);
+         stats.received += batch.size();
+         batch.clear();
+         boost::this_thread::sleep_for(boost::chrono::microseconds(200));
+      }
+      queue.remove(&batch);
+      stats.received += batch.size();
+   });
+
+   const std::string event = "{\"type\":\"console_output\",\"data\":\"[1] 42\\n\"}";
+   for (int i = 0; i < events; ++i)
+   {
+      auto start = std::chrono::steady_clock::now();
+      queue.add(event);
+      int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now() - start).count();
+      stats.totalNs += ns;
+      stats.maxNs = std::max(stats.maxNs, ns);
+   }
+
+   done.store(true);
+   consumer.join();
+   return stats;
+}
+
+} // anonymous namespace
+
+test_context("MpscQueue")
+{
+   test_that("Values are dequed in the order they were enqued")
+   {
+      MpscQueue<std::string> queue;
+      expect_true(queue.isEmpty());
+
+      queue.enque("a");
+      std::string b = "b";
+      queue.enque(b);
+      queue.enque(std::string("c"));
+      expect_false(queue.isEmpty());
+
+      std::string value;
+      expect_true(queue.deque(&value) && value == "a");
+      expect_true(queue.deque(&value) && value == "b");
+      expect_true(queue.deque(&value) && value == "c");
+      expect_false(queue.deque(&value));
+      expect_true(queue.isEmpty());
+   }
+
+   test_that("All values from concurrent producers are delivered in per-producer order")
+   {
+      const int kProducers = 4;
+      const int kPerProducer = 20000;
+
+      MpscQueue<Item> queue;
+      std::vector<boost::shared_ptr<boost::thread> > producers;
+      for (int p = 0; p < kProducers; ++p)
+      {
+         producers.push_back(boost::shared_ptr<boost::thread>(new boost::thread([&queue, p]() {
+            for (int i = 0; i < kPerProducer; ++i)
+               queue.enque(Item(p, i));
+         })));
+      }
+
+      std::vector<int> nextExpected(kProducers, 0);
+      int received = 0;
+      bool ordered = true;
+      while (received < kProducers * kPerProducer)
+      {
+         Item item;
+         if (!queue.deque(&item))
+         {
+            boost::this_thread::yield();
+            continue;
+         }
+
+         ordered = ordered && item.second == nextExpected[item.first];
+         nextExpected[item.first] = item.second + 1;
+         ++received;
+      }
+
+      for (auto& producer : producers)
+         producer->join();
+
+      expect_true(ordered);
+      expect_true(queue.isEmpty());
+   }
+}
+
+test_context("WorkerPool")
+{
+   test_that("All enqueued tasks are run")
+   {
+      const int kTasks = 1000;
+
+      std::atomic<int> completed(0);
+      {
+         WorkerPool pool(4);
+         for (int i = 0; i < kTasks; ++i)
+            pool.enque([&completed]() { ++completed; });
+
+         while (completed < kTasks)
+            boost::this_thread::yield();
+      }
+
+      expect_true(completed == kTasks);
+   }
+
+   test_that("Stopping the pool discards queued tasks")
+   {
+      std::atomic<int> completed(0);
+      std::atomic<bool> release(false);
+
+      WorkerPool pool(1);
+      pool.enque([&]() {
+         while (!release)
+            boost::this_thread::yield();
+         ++completed;
+      });
+      for (int i = 0; i < 10; ++i)
+         pool.enque([&completed]() { ++completed; });
+
+      boost::thread releaser([&release]() {
+         boost::this_thread::sleep_for(boost::chrono::milliseconds(50));
+         release = true;
+      });
+      pool.stop();
+      releaser.join();
+
+      // only the running task completes
+      expect_true(completed <= 1);
+
+      pool.enque([&completed]() { ++completed; });
+      expect_true(completed <= 1);
+   }
+}
+
+TEST_CASE("Client event queue producer stall", "[.benchmark]")
+{
+   const int kEvents = 500000;
+
+   StallStats locking = measureProducerStall<LockingQueue>(kEvents);
+   StallStats lockFree = measureProducerStall<LockFreeQueue>(kEvents);
+
+   std::cout << "producer stall adding " << kEvents << " events with a concurrent consumer: "
+             << "locking total " << locking.totalNs / 1000000 << "ms "
+             << "(max " << locking.maxNs / 1000 << "us), "
+             << "lock free total " << lockFree.totalNs / 1000000 << "ms "
+             << "(max " << lockFree.maxNs / 1000 << "us)"
+             << std::endl;
+
+   CHECK(locking.received == static_cast<std::size_t>(kEvents));
+   CHECK(lockFree.received == static_cast<std::size_t>(kEvents));
+}
+
+} // namespace tests
+} // namespace thread
+} // namespace core
+} // namespace rstudio
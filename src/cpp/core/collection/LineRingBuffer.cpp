@@ -0,0 +1,169 @@
+/*
+ * LineRingBuffer.cpp
+ *
+ * Copyright (C) 2022 by RStudio, PBC
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/collection/LineRingBuffer.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+namespace rstudio {
+namespace core {
+namespace collection {
+
+namespace {
+
+// don't bother compacting small buffers
+const std::size_t kMinCompactSize = 4096;
+
+} // anonymous namespace
+
+LineRingBuffer::LineRingBuffer(std::size_t maxLines)
+   : begin_(0),
+     ring_(std::max<std::size_t>(maxLines, 1)),
+     ringHead_(0),
+     lineCount_(0)
+{
+}
+
+void LineRingBuffer::append(const std::string& text)
+{
+   append(text.data(), text.length());
+}
+
+void LineRingBuffer::append(const char* pText, std::size_t length)
+{
+   if (length == 0)
+      return;
+
+   const char* pBegin = pText;
+   const char* pEnd = pText + length;
+
+   // if the text could hold more lines than are retained then skip copying
+   // anything before its trailing lines (keeps very long outputs from being
+   // copied in full just to be dropped)
+   if (length > ring_.size())
+   {
+      std::size_t newlines = 0;
+      for (const char* pos = pEnd; pos != pBegin; --pos)
+      {
+         if (*(pos - 1) == '\n' && ++newlines > ring_.size())
+         {
+            // everything retained so far is dropped along with the text
+            // preceding this newline
+            clear();
+            pBegin = pos;
+            break;
+         }
+      }
+   }
+
+   std::size_t offset = buffer_.size();
+   buffer_.append(pBegin, pEnd - pBegin);
+
+   const char* pos = pBegin;
+   while ((pos = static_cast<const char*>(std::memchr(pos, '\n', pEnd - pos))) != nullptr)
+   {
+      ++pos;
+
+      if (lineCount_ == ring_.size())
+         dropOldestLine();
+
+      std::size_t index = ringHead_ + lineCount_;
+      if (index >= ring_.size())
+         index -= ring_.size();
+
+      ring_[index] = offset + (pos - pBegin);
+      ++lineCount_;
+   }
+
+   compact();
+}
+
+void LineRingBuffer::setMaxLines(std::size_t maxLines)
+{
+   maxLines = std::max<std::size_t>(maxLines, 1);
+   if (maxLines == ring_.size())
+      return;
+
+   while (lineCount_ > maxLines)
+      dropOldestLine();
+
+   std::vector<std::size_t> ring(maxLines);
+   for (std::size_t i = 0; i < lineCount_; ++i)
+      ring[i] = ring_[(ringHead_ + i) % ring_.size()];
+
+   ring_.swap(ring);
+   ringHead_ = 0;
+}
+
+std::string LineRingBuffer::str() const
+{
+   return buffer_.substr(begin_);
+}
+
+std::string LineRingBuffer::take()
+{
+   std::string text;
+   if (begin_ == 0)
+      text.swap(buffer_);
+   else
+      text.assign(buffer_, begin_, std::string::npos);
+
+   clear();
+   return text;
+}
+
+void LineRingBuffer::clear()
+{
+   buffer_.clear();
+   begin_ = 0;
+   ringHead_ = 0;
+   lineCount_ = 0;
+}
+
+void LineRingBuffer::swap(LineRingBuffer& other)
+{
+   buffer_.swap(other.buffer_);
+   std::swap(begin_, other.begin_);
+   ring_.swap(other.ring_);
+   std::swap(ringHead_, other.ringHead_);
+   std::swap(lineCount_, other.lineCount_);
+}
+
+void LineRingBuffer::dropOldestLine()
+{
+   begin_ = ring_[ringHead_];
+   if (++ringHead_ == ring_.size())
+      ringHead_ = 0;
+   --lineCount_;
+}
+
+void LineRingBuffer::compact()
+{
+   // reclaim the dropped prefix once it is several times the size of the
+   // retained text; the text moved is a fraction of the text dropped, so
+   // compaction is amortized O(1) per appended byte
+   if (begin_ < kMinCompactSize || begin_ < 4 * size())
+      return;
+
+   buffer_.erase(0, begin_);
+   for (std::size_t i = 0; i < lineCount_; ++i)
+      ring_[(ringHead_ + i) % ring_.size()] -= begin_;
+   begin_ = 0;
+}
+
+} // namespace collection
+} // namespace core
+} // namespace rstudio
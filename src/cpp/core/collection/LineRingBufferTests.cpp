@@ -0,0 +1,202 @@
+/*
+ * LineRingBufferTests.cpp
+ *
+ * Copyright (C) 2022 by RStudio, PBC
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <tests/TestThat.hpp>
+
+#include <chrono>
+#include <iostream>
+
+#include <sys/resource.h>
+
+#include <core/StringUtils.hpp>
+#include <core/collection/LineRingBuffer.hpp>
+#include <shared_core/json/Json.hpp>
+
+namespace rstudio {
+namespace core {
+namespace collection {
+namespace tests {
+
+namespace {
+
+long peakRssKb()
+{
+   struct rusage usage;
+   ::getrusage(RUSAGE_SELF, &usage);
+   return usage.ru_maxrss;
+}
+
+std::string consoleLine(int i)
+{
+   return "[1] \"iteration " + std::to_string(i) + "\"\n";
+}
+
+// converts a flushed batch of output to json as the client event queue does
+std::size_t toJson(const std::string& text)
+{
+   json::Object output;
+   output["text"] = text;
+   return output["text"].getString().size();
+}
+
+} // anonymous namespace
+
+test_context("LineRingBuffer")
+{
+   test_that("Only the trailing lines are retained")
+   {
+      LineRingBuffer buffer(3);
+      expect_true(buffer.empty());
+
+      buffer.append("a\nb\n");
+      buffer.append("c\nd");
+      expect_true(buffer.str() == "a\nb\nc\nd");
+      expect_true(buffer.lineCount() == 3);
+
+      buffer.append("\ne\n");
+      expect_true(buffer.str() == "c\nd\ne\n");
+      expect_true(buffer.lineCount() == 3);
+      expect_true(buffer.size() == 6);
+   }
+
+   test_that("Long appends are trimmed before being copied")
+   {
+      LineRingBuffer buffer(2);
+      buffer.append("partial");
+      buffer.append(" line\n1\n2\n3\n4");
+      expect_true(buffer.str() == "2\n3\n4");
+   }
+
+   test_that("Text without newlines is retained in full")
+   {
+      LineRingBuffer buffer(1);
+      buffer.append("abc");
+      buffer.append("def");
+      expect_true(buffer.str() == "abcdef");
+      expect_true(buffer.lineCount() == 0);
+   }
+
+   test_that("Taking the text empties the buffer")
+   {
+      LineRingBuffer buffer(2);
+      buffer.append("x\ny\nz\n");
+      expect_true(buffer.take() == "y\nz\n");
+      expect_true(buffer.empty());
+
+      buffer.append("next\n");
+      expect_true(buffer.take() == "next\n");
+   }
+
+   test_that("Changing the line limit drops the oldest lines")
+   {
+      LineRingBuffer buffer(4);
+      buffer.append("1\n2\n3\n4\n");
+      buffer.setMaxLines(2);
+      expect_true(buffer.str() == "3\n4\n");
+
+      buffer.setMaxLines(3);
+      buffer.append("5\n");
+      expect_true(buffer.str() == "3\n4\n5\n");
+      buffer.append("6\n");
+      expect_true(buffer.str() == "4\n5\n6\n");
+   }
+
+   test_that("Retained text matches trimLeadingLines over many appends")
+   {
+      const int kLimit = 100;
+      LineRingBuffer buffer(kLimit);
+      std::string all;
+      for (int i = 0; i < 20000; ++i)
+      {
+         std::string line = consoleLine(i);
+         buffer.append(line);
+         all += line;
+      }
+
+      // trimLeadingLines also keeps the newline ending the last dropped line
+      string_utils::trimLeadingLines(kLimit, &all);
+      expect_true("\n" + buffer.str() == all);
+   }
+}
+
+TEST_CASE("Console output buffering benchmark", "[.benchmark]")
+{
+   const int kLines = 10000000;
+   const int kLimit = 1001; // default console capacity + 1
+
+   // a client polling regularly, and one that isn't connected at all
+   const int kLinesPerFlush[] = { 100000, kLines };
+
+   // the ring buffer runs first since peak RSS can only grow
+   for (int linesPerFlush : kLinesPerFlush)
+   {
+      long rssBefore = peakRssKb();
+      auto start = std::chrono::steady_clock::now();
+      std::size_t bytes = 0;
+      {
+         LineRingBuffer buffer(kLimit);
+         for (int i = 0; i < kLines; ++i)
+         {
+            buffer.append(consoleLine(i));
+            if ((i + 1) % linesPerFlush == 0)
+               bytes += toJson(buffer.take());
+         }
+      }
+      double seconds = std::chrono::duration<double>(
+               std::chrono::steady_clock::now() - start).count();
+
+      std::cout << kLines << " console lines, flushed every " << linesPerFlush << ": "
+                << "ring buffer " << static_cast<long>(kLines / seconds / 1000) << "k lines/s, "
+                << "peak rss +" << (peakRssKb() - rssBefore) << "kb"
+                << std::endl;
+
+      CHECK(bytes > 0);
+   }
+
+   // previous implementation: concatenate everything, then trim on flush
+   for (int linesPerFlush : kLinesPerFlush)
+   {
+      long rssBefore = peakRssKb();
+      auto start = std::chrono::steady_clock::now();
+      std::size_t bytes = 0;
+      {
+         std::string pending;
+         for (int i = 0; i < kLines; ++i)
+         {
+            pending += consoleLine(i);
+            if ((i + 1) % linesPerFlush == 0)
+            {
+               string_utils::trimLeadingLines(kLimit, &pending);
+               bytes += toJson(pending);
+               pending.clear();
+            }
+         }
+      }
+      double seconds = std::chrono::duration<double>(
+               std::chrono::steady_clock::now() - start).count();
+
+      std::cout << kLines << " console lines, flushed every " << linesPerFlush << ": "
+                << "concatenate and trim " << static_cast<long>(kLines / seconds / 1000) << "k lines/s, "
+                << "peak rss +" << (peakRssKb() - rssBefore) << "kb"
+                << std::endl;
+
+      CHECK(bytes > 0);
+   }
+}
+
+} // namespace tests
+} // namespace collection
+} // namespace core
+} // namespace rstudio
@@ -0,0 +1,312 @@
+/*
+ * PathIndexTests.cpp
+ *
+ * Copyright (C) 2022 by RStudio, PBC
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <tests/TestThat.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+
+#include <core/FileInfo.hpp>
+#include <core/StringUtils.hpp>
+#include <core/collection/PathIndex.hpp>
+#include <core/collection/Tree.hpp>
+
+namespace rstudio {
+namespace core {
+namespace collection {
+namespace tests {
+
+namespace {
+
+struct FileInfoTraits
+{
+   static const std::string& path(const FileInfo& fileInfo) { return fileInfo.absolutePath(); }
+   static bool isDirectory(const FileInfo& fileInfo) { return fileInfo.isDirectory(); }
+};
+
+typedef PathIndex<FileInfo, FileInfoTraits> FileIndex;
+
+FileInfo file(const std::string& path, uintmax_t size = 0)
+{
+   return FileInfo(path, false, size, 0);
+}
+
+FileInfo directory(const std::string& path)
+{
+   return FileInfo(path, true);
+}
+
+std::vector<std::string> paths(FileIndex::range range)
+{
+   std::vector<std::string> result;
+   for (FileIndex::const_iterator it = range.first; it != range.second; ++it)
+      result.push_back(it->absolutePath());
+   return result;
+}
+
+std::vector<std::string> directoriesBelow(const FileIndex& index, const std::string& path)
+{
+   std::vector<std::string> result;
+   index.forEachDirectoryBelow(path, [&result](const std::string& directory) {
+      result.push_back(directory);
+      return true;
+   });
+   return result;
+}
+
+// the previous implementation: a tree.hh tree with a node per path component
+// and a linear scan of the children at each level (as in SessionCodeSearch)
+class EntryTree : public tree<FileInfo>
+{
+public:
+   EntryTree()
+   {
+      insert(begin(), FileInfo("", true));
+   }
+
+   void insertEntry(const FileInfo& entry)
+   {
+      const std::string& absolutePath = entry.absolutePath();
+      iterator parent = begin();
+      std::string::size_type matchIndex = absolutePath.find('/');
+      while (matchIndex != std::string::npos)
+      {
+         FileInfo path(absolutePath.substr(0, matchIndex), true);
+         if ((*parent).absolutePath() != path.absolutePath())
+         {
+            sibling_iterator it = parent.begin();
+            sibling_iterator end = parent.end();
+            for (; it != end; ++it)
+               if ((*it).absolutePath() == path.absolutePath())
+                  break;
+
+            parent = (it == end) ? append_child(parent, path) : iterator(it);
+         }
+         matchIndex = absolutePath.find('/', matchIndex + 1);
+      }
+
+      sibling_iterator it = parent.begin();
+      sibling_iterator end = parent.end();
+      for (; it != end; ++it)
+         if ((*it).absolutePath() == absolutePath)
+            break;
+
+      if (it == end)
+         append_child(parent, entry);
+      else
+         *it = entry;
+   }
+};
+
+// a project of ~100k files in 3 levels of directories
+std::vector<std::string> projectFiles()
+{
+   std::vector<std::string> files;
+   for (int i = 0; i < 20; ++i)
+      for (int j = 0; j < 50; ++j)
+         for (int k = 0; k < 100; ++k)
+            files.push_back("/home/user/project/pkg" + std::to_string(i) +
+                            "/R" + std::to_string(j) +
+                            "/file_" + std::to_string(k) + "_" + std::to_string(j) + ".R");
+   return files;
+}
+
+// as matched when searching the tree
+bool nameMatches(const std::string& path, const std::string& term)
+{
+   std::string name = path.substr(path.rfind('/') + 1);
+   return string_utils::isSubsequence(name, term, true);
+}
+
+// as matched when searching the index (without copying the name)
+bool nameMatchesInPlace(const std::string& path, const std::string& term)
+{
+   const char* begin = path.data() + path.rfind('/') + 1;
+   const char* end = path.data() + path.length();
+   return string_utils::isSubsequence(begin, end, term, term.length(), true);
+}
+
+} // anonymous namespace
+
+test_context("PathIndex")
+{
+   test_that("Paths are ordered with directories before their siblings")
+   {
+      expect_true(pathLessThan("a/b", "a/b/c"));
+      expect_true(pathLessThan("a/b/c", "a/b-c"));
+      expect_true(pathLessThan("a/b/z", "a/b.c"));
+      expect_false(pathLessThan("a/b", "a/b"));
+   }
+
+   test_that("Names can be matched in place")
+   {
+      std::string path = "/p/R/SessionCodeSearch.cpp";
+      expect_true(nameMatchesInPlace(path, "scs"));
+      expect_true(nameMatchesInPlace(path, "SCS"));
+      expect_false(nameMatchesInPlace(path, "pr"));
+      expect_true(nameMatchesInPlace(path, ""));
+      expect_true(string_utils::isSubsequence(path.data(), path.data() + path.size(), "pzzz", 1, false));
+   }
+
+   test_that("Values are found regardless of insertion order")
+   {
+      FileIndex index;
+      index.insert(file("/p/c"));
+      index.insert(file("/p/a"));
+      index.insert(file("/p/b/x"));
+      index.insert(file("/p/a", 10));
+
+      expect_true(index.size() == 3);
+      REQUIRE(index.find("/p/a") != nullptr);
+      expect_true(index.find("/p/a")->size() == 10);
+      expect_true(index.find("/p/b") == nullptr);
+      expect_true(index.find("/p/b/x") != nullptr);
+
+      std::vector<std::string> all = paths(FileIndex::range(index.begin(), index.end()));
+      expect_true(std::is_sorted(all.begin(), all.end(), pathLessThan));
+
+      // replacing an already sorted value
+      index.insert(file("/p/c", 20));
+      expect_true(index.size() == 3);
+      expect_true(index.find("/p/c")->size() == 20);
+   }
+
+   test_that("Everything below a directory is a contiguous range")
+   {
+      FileIndex index;
+      index.insert(file("/p/b-c/z"));
+      index.insert(file("/p/b/x"));
+      index.insert(directory("/p/b"));
+      index.insert(file("/p/b/y/z"));
+      index.insert(file("/p/bb"));
+
+      std::vector<std::string> expected = { "/p/b/x", "/p/b/y/z" };
+      expect_true(paths(index.below("/p/b")) == expected);
+      expect_true(index.below("/p/q").first == index.below("/p/q").second);
+      expect_true(index.containsDirectory("/p/b/y"));
+      expect_false(index.containsDirectory("/p/q"));
+   }
+
+   test_that("Removing a directory removes everything below it")
+   {
+      FileIndex index;
+      index.insert(file("/p/b/x"));
+      index.insert(file("/p/b/y/z"));
+      index.insert(file("/p/bb"));
+
+      expect_true(index.remove("/p/b"));
+      expect_true(index.size() == 1);
+      expect_true(index.find("/p/bb") != nullptr);
+
+      expect_true(index.remove("/p/bb"));
+      expect_false(index.remove("/p/bb"));
+      expect_true(index.empty());
+   }
+
+   test_that("Inserted and implied directories are each reported once")
+   {
+      FileIndex index;
+      index.insert(file("/p/a"));
+      index.insert(directory("/p/b"));
+      index.insert(file("/p/c/d/x"));
+      index.insert(file("/p/c/y"));
+      index.insert(file("/p/c-e/z"));
+      index.insert(directory("/p/c/d"));
+
+      std::vector<std::string> expected = { "/p/b", "/p/c", "/p/c/d", "/p/c-e" };
+      expect_true(directoriesBelow(index, "/p") == expected);
+
+      expected = { "/p/c/d" };
+      expect_true(directoriesBelow(index, "/p/c") == expected);
+   }
+}
+
+TEST_CASE("Project file index benchmark", "[.benchmark]")
+{
+   std::vector<std::string> files = projectFiles();
+   std::shuffle(files.begin(), files.end(), std::mt19937(42));
+
+   const std::string kProject = "/home/user/project";
+   const char* const kQueries[] = { "file12", "f_9_4", "xyz", "R", "file_99_49" };
+
+   // tree
+   {
+      auto start = std::chrono::steady_clock::now();
+      EntryTree entries;
+      for (const std::string& path : files)
+         entries.insertEntry(file(path));
+      auto build = std::chrono::steady_clock::now() - start;
+
+      start = std::chrono::steady_clock::now();
+      std::size_t matches = 0;
+      for (const char* query : kQueries)
+      {
+         for (EntryTree::leaf_iterator it = entries.begin_leaf(); entries.is_valid(it); ++it)
+            if (nameMatches((*it).absolutePath(), query))
+               ++matches;
+      }
+      auto search = std::chrono::steady_clock::now() - start;
+
+      std::cout << files.size() << " files, tree: build "
+                << std::chrono::duration_cast<std::chrono::milliseconds>(build).count() << "ms, "
+                << "search " << std::chrono::duration_cast<std::chrono::microseconds>(search).count() / 5
+                << "us/query (" << matches << " matches)" << std::endl;
+   }
+
+   // flat sorted index
+   {
+      auto start = std::chrono::steady_clock::now();
+      FileIndex entries;
+      for (const std::string& path : files)
+         entries.insert(file(path));
+      REQUIRE(entries.size() == files.size());
+      auto build = std::chrono::steady_clock::now() - start;
+
+      start = std::chrono::steady_clock::now();
+      std::size_t matches = 0;
+      for (const char* query : kQueries)
+      {
+         FileIndex::range range = entries.below(kProject);
+         for (FileIndex::const_iterator it = range.first; it != range.second; ++it)
+            if (nameMatchesInPlace(it->absolutePath(), query))
+               ++matches;
+      }
+      auto search = std::chrono::steady_clock::now() - start;
+
+      std::cout << files.size() << " files, sorted index: build "
+                << std::chrono::duration_cast<std::chrono::milliseconds>(build).count() << "ms, "
+                << "search " << std::chrono::duration_cast<std::chrono::microseconds>(search).count() / 5
+                << "us/query (" << matches << " matches)" << std::endl;
+
+      // incremental changes once built
+      start = std::chrono::steady_clock::now();
+      for (int i = 0; i < 1000; ++i)
+      {
+         entries.insert(file(kProject + "/pkg0/R0/new_" + std::to_string(i) + ".R"));
+         entries.find(files[i]);
+      }
+      auto incremental = std::chrono::steady_clock::now() - start;
+      std::cout << "sorted index: 1000 inserts+lookups "
+                << std::chrono::duration_cast<std::chrono::milliseconds>(incremental).count() << "ms"
+                << std::endl;
+   }
+}
+
+} // namespace tests
+} // namespace collection
+} // namespace core
+} // namespace rstudio
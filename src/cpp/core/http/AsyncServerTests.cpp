@@ -0,0 +1,329 @@
+/*
+ * AsyncServerTests.cpp
+ *
+ * Copyright (C) 2022 by RStudio, PBC
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef _WIN32
+
+#include <tests/TestThat.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/read_until.hpp>
+#include <boost/asio/streambuf.hpp>
+#include <boost/asio/write.hpp>
+
+#include <core/Thread.hpp>
+#include <core/http/LocalStreamAsyncClient.hpp>
+#include <core/http/LocalStreamConnectionPool.hpp>
+#include <core/http/TcpIpAsyncServer.hpp>
+
+namespace rstudio {
+namespace core {
+namespace http {
+
+namespace {
+
+typedef boost::asio::local::stream_protocol::socket StreamSocket;
+
+// a stand-in for a session: answers each request with a small response,
+// serving each connection (kept alive) on its own thread
+class SessionServer
+{
+public:
+   explicit SessionServer(const std::string& path)
+      : path_(path), acceptor_(ioService_), stopping_(false)
+   {
+      ::unlink(path_.c_str());
+      boost::asio::local::stream_protocol::endpoint endpoint(path_);
+      acceptor_.open(endpoint.protocol());
+      acceptor_.bind(endpoint);
+      acceptor_.listen();
+      thread_ = std::thread([this]() { acceptConnections(); });
+   }
+
+   ~SessionServer()
+   {
+      stopping_ = true;
+      try
+      {
+         boost::asio::io_service ioService;
+         StreamSocket socket(ioService);
+         socket.connect(boost::asio::local::stream_protocol::endpoint(path_));
+      }
+      catch (...)
+      {
+      }
+      thread_.join();
+
+      for (std::thread& connection : connections_)
+         connection.join();
+      ::unlink(path_.c_str());
+   }
+
+private:
+   void acceptConnections()
+   {
+      while (!stopping_)
+      {
+         boost::shared_ptr<StreamSocket> pSocket(new StreamSocket(ioService_));
+         boost::system::error_code ec;
+         acceptor_.accept(*pSocket, ec);
+         if (ec || stopping_)
+            break;
+
+         connections_.push_back(std::thread([pSocket]() { serve(pSocket); }));
+      }
+   }
+
+   static void serve(boost::shared_ptr<StreamSocket> pSocket)
+   {
+      boost::asio::streambuf buffer;
+      boost::system::error_code ec;
+      for (;;)
+      {
+         std::size_t length = boost::asio::read_until(*pSocket, buffer, "\r\n\r\n", ec);
+         if (ec)
+            break;
+
+         std::string headers(boost::asio::buffers_begin(buffer.data()),
+                             boost::asio::buffers_begin(buffer.data()) + length);
+         buffer.consume(length);
+         bool keepAlive = boost::algorithm::icontains(headers, "Connection: keep-alive");
+
+         std::string body = "{\"result\":true}";
+         std::string response =
+               "HTTP/1.1 200 OK\r\n"
+               "Content-Type: application/json\r\n"
+               "Content-Length: " + std::to_string(body.size()) + "\r\n" +
+               (keepAlive ? "Connection: keep-alive\r\n" : "Connection: close\r\n") +
+               "\r\n" + body;
+         boost::asio::write(*pSocket, boost::asio::buffer(response), ec);
+         if (ec || !keepAlive)
+            break;
+      }
+
+      pSocket->close(ec);
+   }
+
+   std::string path_;
+   boost::asio::io_service ioService_;
+   boost::asio::local::stream_protocol::acceptor acceptor_;
+   std::atomic<bool> stopping_;
+   std::thread thread_;
+   std::vector<std::thread> connections_;
+};
+
+// forward requests to the session, as rserver's session proxy does
+void proxyToSession(const std::string& sessionPath,
+                    const boost::shared_ptr<LocalStreamConnectionPool>& pPool,
+                    boost::shared_ptr<AsyncConnection> pConnection)
+{
+   boost::shared_ptr<LocalStreamAsyncClient> pClient(
+            new LocalStreamAsyncClient(pConnection->ioService(), FilePath(sessionPath)));
+   pClient->setConnectionPool(pPool);
+   pClient->request().assign(pConnection->request());
+   pClient->request().setHeader("Content-Type", "application/json");
+
+   pClient->execute(
+      [pConnection](const Response& response) { pConnection->writeResponse(response); },
+      [pConnection](const Error& error) { pConnection->writeError(error); });
+}
+
+boost::shared_ptr<TcpIpAsyncServer> startServer(std::size_t threads,
+                                                bool ioServicePerThread,
+                                                const AsyncUriHandlerFunction& handler,
+                                                int* pPort)
+{
+   boost::shared_ptr<TcpIpAsyncServer> pServer(new TcpIpAsyncServer("Test"));
+   Error error = pServer->init("127.0.0.1", "0");
+   if (error)
+      return boost::shared_ptr<TcpIpAsyncServer>();
+
+   pServer->addProxyHandler("/", handler);
+   pServer->setIoServicePerThread(ioServicePerThread);
+   error = pServer->run(threads);
+   if (error)
+      return boost::shared_ptr<TcpIpAsyncServer>();
+
+   *pPort = pServer->localEndpoint().port();
+   return pServer;
+}
+
+// make a request over a new connection, returning whether it succeeded
+bool makeRequest(boost::asio::io_service& ioService, int port)
+{
+   boost::system::error_code ec;
+   boost::asio::ip::tcp::socket socket(ioService);
+   socket.connect(boost::asio::ip::tcp::endpoint(
+                     boost::asio::ip::address_v4::loopback(), port), ec);
+   if (ec)
+      return false;
+
+   std::string request = "GET /rpc/get_environment_state HTTP/1.1\r\n"
+                         "Host: 127.0.0.1\r\n"
+                         "\r\n";
+   boost::asio::write(socket, boost::asio::buffer(request), ec);
+   if (ec)
+      return false;
+
+   boost::asio::streambuf buffer;
+   boost::asio::read(socket, buffer, ec);
+   std::string response(boost::asio::buffers_begin(buffer.data()),
+                        boost::asio::buffers_end(buffer.data()));
+   return boost::algorithm::starts_with(response, "HTTP/1.1 200");
+}
+
+// make requests from several clients at once, returning requests/sec
+double measureThroughput(int port, std::size_t clients, std::size_t requestsPerClient,
+                         std::atomic<std::size_t>* pFailures)
+{
+   auto start = std::chrono::steady_clock::now();
+
+   std::vector<std::thread> threads;
+   for (std::size_t i = 0; i < clients; ++i)
+   {
+      threads.push_back(std::thread([=]() {
+         boost::asio::io_service ioService;
+         for (std::size_t j = 0; j < requestsPerClient; ++j)
+         {
+            if (!makeRequest(ioService, port))
+               ++*pFailures;
+         }
+      }));
+   }
+
+   for (std::thread& thread : threads)
+      thread.join();
+
+   double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start).count();
+   return (clients * requestsPerClient) / seconds;
+}
+
+} // anonymous namespace
+
+test_context("AsyncServer")
+{
+   test_that("Connections are spread across an io_service per thread")
+   {
+      boost::mutex mutex;
+      std::set<boost::asio::io_service*> ioServices;
+      AsyncUriHandlerFunction handler = [&](boost::shared_ptr<AsyncConnection> pConnection)
+      {
+         LOCK_MUTEX(mutex)
+         {
+            ioServices.insert(&pConnection->ioService());
+         }
+         END_LOCK_MUTEX
+
+         pConnection->response().setStatusCode(status::Ok);
+         pConnection->writeResponse();
+      };
+
+      int port = 0;
+      boost::shared_ptr<TcpIpAsyncServer> pServer = startServer(4, true, handler, &port);
+      expect_true(pServer);
+      if (!pServer)
+         return;
+
+      boost::asio::io_service ioService;
+      bool succeeded = true;
+      for (int i = 0; i < 8; ++i)
+         succeeded = makeRequest(ioService, port) && succeeded;
+
+      pServer->stop();
+      pServer->waitUntilStopped();
+
+      expect_true(succeeded);
+      expect_true(ioServices.size() == 4);
+   }
+
+   test_that("Requests are proxied with an io_service per thread")
+   {
+      std::string sessionPath = "/tmp/rstudio-test-session-" + std::to_string(::getpid());
+      SessionServer session(sessionPath);
+      boost::shared_ptr<LocalStreamConnectionPool> pPool(new LocalStreamConnectionPool());
+
+      int port = 0;
+      boost::shared_ptr<TcpIpAsyncServer> pServer = startServer(
+               2, true, boost::bind(proxyToSession, sessionPath, pPool, _1), &port);
+      expect_true(pServer);
+      if (!pServer)
+         return;
+
+      std::atomic<std::size_t> failures(0);
+      measureThroughput(port, 4, 25, &failures);
+
+      pServer->stop();
+      pServer->waitUntilStopped();
+      pPool->clear();
+
+      expect_true(failures == 0);
+   }
+}
+
+TEST_CASE("AsyncServer io_service per thread benchmark", "[.benchmark]")
+{
+   std::string sessionPath = "/tmp/rstudio-bench-session-" + std::to_string(::getpid());
+   SessionServer session(sessionPath);
+
+   std::size_t cores = std::max(1u, std::thread::hardware_concurrency());
+   std::vector<std::size_t> threadCounts;
+   for (std::size_t threads = 1; threads < cores; threads *= 2)
+      threadCounts.push_back(threads);
+   threadCounts.push_back(cores);
+
+   const std::size_t kClients = 4 * cores;
+   const std::size_t kRequestsPerClient = 500;
+   std::atomic<std::size_t> failures(0);
+
+   for (bool ioServicePerThread : { false, true })
+   {
+      for (std::size_t threads : threadCounts)
+      {
+         boost::shared_ptr<LocalStreamConnectionPool> pPool(new LocalStreamConnectionPool(64));
+
+         int port = 0;
+         boost::shared_ptr<TcpIpAsyncServer> pServer = startServer(
+                  threads, ioServicePerThread,
+                  boost::bind(proxyToSession, sessionPath, pPool, _1), &port);
+         REQUIRE(pServer);
+
+         double throughput = measureThroughput(port, kClients, kRequestsPerClient, &failures);
+
+         pServer->stop();
+         pServer->waitUntilStopped();
+         pPool->clear();
+
+         std::cout << (ioServicePerThread ? "io_service per thread, " : "shared io_service, ")
+                   << threads << " threads: "
+                   << static_cast<int>(throughput) << " proxied requests/sec" << std::endl;
+      }
+   }
+
+   CHECK(failures == 0);
+}
+
+} // namespace http
+} // namespace core
+} // namespace rstudio
+
+#endif // _WIN32
@@ -0,0 +1,197 @@
+/*
+ * AsyncUriHandlerTests.cpp
+ *
+ * Copyright (C) 2022 by RStudio, PBC
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <tests/TestThat.hpp>
+
+#include <chrono>
+#include <iostream>
+
+#include <core/http/AsyncUriHandler.hpp>
+#include <core/http/UriPrefixIndex.hpp>
+
+namespace rstudio {
+namespace core {
+namespace http {
+
+namespace {
+
+// the prefixes registered by rserver (ServerMain.cpp, ServerSessionProxy.cpp
+// and the auth handlers), in registration order
+const char* const kServerPrefixes[] = {
+   "/auth-sign-in", "/auth-sign-out", "/auth-refresh-credentials",
+   "/auth-update-credentials", "/auth-do-sign-in", "/auth-public-key",
+   "/images", "/rpc", "/events", "/graphics", "/upload", "/export",
+   "/source", "/content", "/diff", "/file_show", "/view_pdf", "/agreement",
+   "/presentation", "/pdf_js", "/mathjax", "/connections", "/theme",
+   "/fonts", "/python", "/tutorial", "/quarto", "/help", "/files",
+   "/custom", "/session", "/docs", "/html_preview", "/rmd_output",
+   "/grid_data", "/grid_resource", "/chunk_output", "/profiles",
+   "/rmd_data", "/profiler_resource", "/dictionaries", "/p/", "/p6/",
+   "/log", "/meta", "/progress", "/unsupported_browser.htm", "/templates"
+};
+
+const char* const kRequestUris[] = {
+   "/events/get_events", "/rpc/console_input", "/rpc/get_completions",
+   "/grid_data?env=&obj=df", "/p/58fab3e4/index.html", "/files/src/main.R",
+   "/help/library/base/html/lapply.html", "/graphics/plot.png?width=600",
+   "/session/viewhtml123/index.html", "/theme/default/tomorrow.css",
+   "/unknown/resource", "/"
+};
+
+std::vector<std::string> serverPrefixes()
+{
+   return std::vector<std::string>(
+            kServerPrefixes,
+            kServerPrefixes + sizeof(kServerPrefixes) / sizeof(kServerPrefixes[0]));
+}
+
+std::size_t linearFind(const std::vector<std::string>& prefixes, const std::string& uri)
+{
+   for (std::size_t i = 0; i < prefixes.size(); ++i)
+      if (boost::algorithm::starts_with(uri, prefixes[i]))
+         return i;
+   return UriPrefixIndex::kNoMatch;
+}
+
+AsyncUriHandlers makeHandlers(const std::vector<std::string>& prefixes)
+{
+   AsyncUriHandlers handlers;
+   for (const std::string& prefix : prefixes)
+      handlers.add(AsyncUriHandler(prefix, AsyncUriHandlerFunction(), prefix == "/p/"));
+   return handlers;
+}
+
+} // anonymous namespace
+
+test_context("UriPrefixIndex")
+{
+   test_that("First registered matching prefix wins")
+   {
+      std::vector<std::string> prefixes;
+      prefixes.push_back("/files");
+      prefixes.push_back("/file");
+      prefixes.push_back("/files/special");
+      prefixes.push_back("/file");
+
+      UriPrefixIndex index;
+      index.build(prefixes);
+
+      expect_true(index.find("/files/special/a.txt") == 0);
+      expect_true(index.find("/file_show") == 1);
+      expect_true(index.find("/fil") == UriPrefixIndex::kNoMatch);
+      expect_true(index.find("") == UriPrefixIndex::kNoMatch);
+   }
+
+   test_that("Empty prefix matches every uri")
+   {
+      std::vector<std::string> prefixes;
+      prefixes.push_back("/rpc");
+      prefixes.push_back("");
+
+      UriPrefixIndex index;
+      index.build(prefixes);
+
+      expect_true(index.find("/rpc/console_input") == 0);
+      expect_true(index.find("/anything") == 1);
+      expect_true(index.find("") == 1);
+   }
+
+   test_that("Index agrees with a linear scan of the rserver handlers")
+   {
+      std::vector<std::string> prefixes = serverPrefixes();
+
+      UriPrefixIndex index;
+      index.build(prefixes);
+
+      for (const char* uri : kRequestUris)
+         expect_true(index.find(uri) == linearFind(prefixes, uri));
+      for (const std::string& prefix : prefixes)
+         expect_true(index.find(prefix + "/x") == linearFind(prefixes, prefix + "/x"));
+   }
+
+   test_that("Handlers resolve the same before and after freezing")
+   {
+      AsyncUriHandlers handlers = makeHandlers(serverPrefixes());
+
+      std::vector<std::string> before;
+      for (const char* uri : kRequestUris)
+         before.push_back(handlers.find(uri).prefix());
+
+      handlers.freeze();
+      for (std::size_t i = 0; i < before.size(); ++i)
+         expect_true(handlers.find(kRequestUris[i]).prefix() == before[i]);
+
+      expect_true(handlers.find("/p/1234/").isProxyHandler());
+      expect_true(!handlers.find("/unknown").function());
+   }
+
+   test_that("Handlers added after freezing are indexed")
+   {
+      std::vector<std::string> prefixes = serverPrefixes();
+      AsyncUriHandlers handlers = makeHandlers(prefixes);
+      handlers.freeze();
+
+      prefixes.push_back("/added");
+      prefixes.push_back("/");
+      handlers.add(AsyncUriHandler("/added", AsyncUriHandlerFunction()));
+      handlers.add(AsyncUriHandler("/", AsyncUriHandlerFunction()));
+      expect_true(handlers.isIndexed());
+      expect_true(handlers.find("/added/uri").prefix() == "/added");
+
+      // (the index agrees with a scan of every handler, including those added)
+      UriPrefixIndex index;
+      index.build(prefixes);
+      for (const char* uri : kRequestUris)
+         expect_true(handlers.find(uri).prefix() == prefixes[index.find(uri)]);
+      expect_true(handlers.find("/unknown").prefix() == "/");
+   }
+}
+
+TEST_CASE("UriPrefixIndex benchmark", "[.benchmark]")
+{
+   std::vector<std::string> prefixes = serverPrefixes();
+   AsyncUriHandlers handlers = makeHandlers(prefixes);
+
+   const std::size_t kIterations = 200000;
+   std::size_t checksum = 0;
+
+   auto start = std::chrono::steady_clock::now();
+   for (std::size_t i = 0; i < kIterations; ++i)
+      for (const char* uri : kRequestUris)
+         checksum += handlers.handlerFor(uri).prefix().size();
+   auto linear = std::chrono::steady_clock::now() - start;
+
+   handlers.freeze();
+
+   start = std::chrono::steady_clock::now();
+   for (std::size_t i = 0; i < kIterations; ++i)
+      for (const char* uri : kRequestUris)
+         checksum -= handlers.find(uri).prefix().size();
+   auto indexed = std::chrono::steady_clock::now() - start;
+
+   std::size_t lookups = kIterations * sizeof(kRequestUris) / sizeof(kRequestUris[0]);
+   std::cout << "uri routing over " << prefixes.size() << " handlers, "
+             << lookups << " lookups: linear "
+             << std::chrono::duration_cast<std::chrono::milliseconds>(linear).count() << "ms, "
+             << "indexed "
+             << std::chrono::duration_cast<std::chrono::milliseconds>(indexed).count() << "ms"
+             << std::endl;
+
+   CHECK(checksum == 0);
+}
+
+} // namespace http
+} // namespace core
+} // namespace rstudio
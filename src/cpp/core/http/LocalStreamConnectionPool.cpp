@@ -0,0 +1,224 @@
+/*
+ * LocalStreamConnectionPool.cpp
+ *
+ * Copyright (C) 2022 by RStudio, PBC
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/http/LocalStreamConnectionPool.hpp>
+
+#include <sys/socket.h>
+
+#include <cerrno>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include <core/Thread.hpp>
+#include <core/http/SocketUtils.hpp>
+
+namespace rstudio {
+namespace core {
+namespace http {
+
+namespace {
+
+// an idle connection is usable if it is open and there is nothing to read
+// from it: a read of zero bytes means the other end has closed it, and any
+// data means it is out of step with the requests made over it
+bool isUsable(LocalStreamConnectionPool::Socket& socket)
+{
+   if (!socket.is_open())
+      return false;
+
+   char buffer;
+   ssize_t result = ::recv(socket.native_handle(), &buffer, 1, MSG_PEEK | MSG_DONTWAIT);
+   return result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+}
+
+void closeConnection(LocalStreamConnectionPool::Socket& socket)
+{
+   // errors are expected here (the other end may already have closed)
+   Error error = closeSocket(socket);
+   (void) error;
+}
+
+} // anonymous namespace
+
+LocalStreamConnectionPool::LocalStreamConnectionPool(
+      std::size_t maxIdlePerStream,
+      const boost::posix_time::time_duration& maxIdleTime)
+   : maxIdlePerStream_(maxIdlePerStream),
+     maxIdleTime_(maxIdleTime),
+     lastEvicted_(boost::posix_time::microsec_clock::universal_time())
+{
+}
+
+boost::shared_ptr<LocalStreamConnectionPool::Socket> LocalStreamConnectionPool::acquire(
+      const std::string& streamPath,
+      boost::asio::io_service& ioService)
+{
+   boost::posix_time::ptime now = boost::posix_time::microsec_clock::universal_time();
+
+   LOCK_MUTEX(mutex_)
+   {
+      std::map<StreamKey, IdleConnections>::iterator it =
+            idle_.find(StreamKey(streamPath, &ioService));
+      if (it == idle_.end())
+         return boost::shared_ptr<Socket>();
+
+      // the most recently used connection is the most likely to still be open
+      IdleConnections& connections = it->second;
+      while (!connections.empty())
+      {
+         IdleConnection connection = connections.back();
+         connections.pop_back();
+
+         if (now - connection.idleSince < maxIdleTime_ && isUsable(*connection.pSocket))
+            return connection.pSocket;
+
+         closeConnection(*connection.pSocket);
+      }
+
+      idle_.erase(it);
+   }
+   END_LOCK_MUTEX
+
+   return boost::shared_ptr<Socket>();
+}
+
+void LocalStreamConnectionPool::release(const std::string& streamPath,
+                                        boost::asio::io_service& ioService,
+                                        const boost::shared_ptr<Socket>& pSocket)
+{
+   if (!pSocket || !pSocket->is_open())
+      return;
+
+   boost::posix_time::ptime now = boost::posix_time::microsec_clock::universal_time();
+
+   LOCK_MUTEX(mutex_)
+   {
+      IdleConnections& connections = idle_[StreamKey(streamPath, &ioService)];
+      if (connections.size() >= maxIdlePerStream_)
+      {
+         closeConnection(*connections.front().pSocket);
+         connections.pop_front();
+      }
+
+      IdleConnection connection = { pSocket, now };
+      connections.push_back(connection);
+
+      // periodically sweep streams which are no longer being used
+      if (now - lastEvicted_ >= maxIdleTime_)
+         evictExpired(now);
+   }
+   END_LOCK_MUTEX
+}
+
+void LocalStreamConnectionPool::evict(const std::string& streamPath)
+{
+   LOCK_MUTEX(mutex_)
+   {
+      for (std::map<StreamKey, IdleConnections>::iterator it = idle_.begin();
+           it != idle_.end();)
+      {
+         if (it->first.first != streamPath)
+         {
+            ++it;
+            continue;
+         }
+
+         for (IdleConnection& connection : it->second)
+            closeConnection(*connection.pSocket);
+
+         it = idle_.erase(it);
+      }
+   }
+   END_LOCK_MUTEX
+}
+
+void LocalStreamConnectionPool::evictExpired()
+{
+   LOCK_MUTEX(mutex_)
+   {
+      evictExpired(boost::posix_time::microsec_clock::universal_time());
+   }
+   END_LOCK_MUTEX
+}
+
+void LocalStreamConnectionPool::evictExpired(const boost::posix_time::ptime& now)
+{
+   // connections are released in order, so the expired ones are at the front
+   for (std::map<StreamKey, IdleConnections>::iterator it = idle_.begin();
+        it != idle_.end();)
+   {
+      IdleConnections& connections = it->second;
+      while (!connections.empty() && now - connections.front().idleSince >= maxIdleTime_)
+      {
+         closeConnection(*connections.front().pSocket);
+         connections.pop_front();
+      }
+
+      if (connections.empty())
+         it = idle_.erase(it);
+      else
+         ++it;
+   }
+
+   lastEvicted_ = now;
+}
+
+void LocalStreamConnectionPool::clear()
+{
+   LOCK_MUTEX(mutex_)
+   {
+      for (std::pair<const StreamKey, IdleConnections>& stream : idle_)
+      {
+         for (IdleConnection& connection : stream.second)
+            closeConnection(*connection.pSocket);
+      }
+
+      idle_.clear();
+   }
+   END_LOCK_MUTEX
+}
+
+std::size_t LocalStreamConnectionPool::idleCount(const std::string& streamPath) const
+{
+   std::size_t count = 0;
+   LOCK_MUTEX(mutex_)
+   {
+      for (const std::pair<const StreamKey, IdleConnections>& stream : idle_)
+      {
+         if (stream.first.first == streamPath)
+            count += stream.second.size();
+      }
+   }
+   END_LOCK_MUTEX
+
+   return count;
+}
+
+std::size_t LocalStreamConnectionPool::idleCount() const
+{
+   std::size_t count = 0;
+   LOCK_MUTEX(mutex_)
+   {
+      for (const std::pair<const StreamKey, IdleConnections>& stream : idle_)
+         count += stream.second.size();
+   }
+   END_LOCK_MUTEX
+
+   return count;
+}
+
+} // namespace http
+} // namespace core
+} // namespace rstudio
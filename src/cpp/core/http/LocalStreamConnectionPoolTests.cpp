@@ -0,0 +1,412 @@
+/*
+ * LocalStreamConnectionPoolTests.cpp
+ *
+ * Copyright (C) 2022 by RStudio, PBC
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef _WIN32
+
+#include <tests/TestThat.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/asio/local/connect_pair.hpp>
+#include <boost/asio/read_until.hpp>
+#include <boost/asio/streambuf.hpp>
+#include <boost/asio/write.hpp>
+
+#include <core/http/LocalStreamAsyncClient.hpp>
+#include <core/http/LocalStreamConnectionPool.hpp>
+
+namespace rstudio {
+namespace core {
+namespace http {
+
+namespace {
+
+typedef LocalStreamConnectionPool::Socket Socket;
+
+const char* const kStream = "/tmp/rstudio-test-stream";
+
+// a connected socket, along with the other end of the connection
+struct Connection
+{
+   explicit Connection(boost::asio::io_service& ioService)
+      : pSocket(new Socket(ioService)), peer(ioService)
+   {
+      boost::asio::local::connect_pair(*pSocket, peer);
+   }
+
+   boost::shared_ptr<Socket> pSocket;
+   Socket peer;
+};
+
+// a stand-in for the session's stream: serves each connection on its own
+// thread, answering each request with a small response and honoring
+// 'Connection: keep-alive'. if maxAnswers is given, the request after that
+// many on a connection is read but the connection is closed unanswered
+class StreamServer
+{
+public:
+   explicit StreamServer(const std::string& path, std::size_t maxAnswers = 0)
+      : path_(path), acceptor_(ioService_), stopping_(false),
+        maxAnswers_(maxAnswers), requestCount_(0)
+   {
+      ::unlink(path_.c_str());
+      boost::asio::local::stream_protocol::endpoint endpoint(path_);
+      acceptor_.open(endpoint.protocol());
+      acceptor_.bind(endpoint);
+      acceptor_.listen();
+      thread_ = std::thread([this]() { acceptConnections(); });
+   }
+
+   ~StreamServer()
+   {
+      // wake the acceptor so that it sees we are stopping
+      stopping_ = true;
+      try
+      {
+         boost::asio::io_service ioService;
+         Socket socket(ioService);
+         socket.connect(boost::asio::local::stream_protocol::endpoint(path_));
+      }
+      catch (...)
+      {
+      }
+      thread_.join();
+
+      for (std::thread& connection : connections_)
+         connection.join();
+      ::unlink(path_.c_str());
+   }
+
+   int requestCount() const { return requestCount_; }
+
+private:
+   void acceptConnections()
+   {
+      while (!stopping_)
+      {
+         boost::shared_ptr<Socket> pSocket(new Socket(ioService_));
+         boost::system::error_code ec;
+         acceptor_.accept(*pSocket, ec);
+         if (ec || stopping_)
+            break;
+
+         connections_.push_back(std::thread([this, pSocket]() { serve(pSocket); }));
+      }
+   }
+
+   void serve(boost::shared_ptr<Socket> pSocket)
+   {
+      boost::asio::streambuf buffer;
+      boost::system::error_code ec;
+      for (std::size_t answered = 0; ; ++answered)
+      {
+         std::size_t length = boost::asio::read_until(*pSocket, buffer, "\r\n\r\n", ec);
+         if (ec)
+            break;
+
+         ++requestCount_;
+         if (maxAnswers_ != 0 && answered == maxAnswers_)
+            break;
+
+         std::string headers(boost::asio::buffers_begin(buffer.data()),
+                             boost::asio::buffers_begin(buffer.data()) + length);
+         buffer.consume(length);
+         bool keepAlive = boost::algorithm::icontains(headers, "Connection: keep-alive");
+
+         std::string body = "{\"result\":true}";
+         std::string response =
+               "HTTP/1.1 200 OK\r\n"
+               "Content-Type: application/json\r\n"
+               "Content-Length: " + std::to_string(body.size()) + "\r\n" +
+               (keepAlive ? "Connection: keep-alive\r\n" : "Connection: close\r\n") +
+               "\r\n" + body;
+         boost::asio::write(*pSocket, boost::asio::buffer(response), ec);
+         if (ec || !keepAlive)
+            break;
+      }
+
+      pSocket->close(ec);
+   }
+
+   std::string path_;
+   boost::asio::io_service ioService_;
+   boost::asio::local::stream_protocol::acceptor acceptor_;
+   std::atomic<bool> stopping_;
+   std::size_t maxAnswers_;
+   std::atomic<int> requestCount_;
+   std::thread thread_;
+   std::vector<std::thread> connections_;
+};
+
+// make requests one at a time, returning the latency of each (in microseconds)
+std::vector<double> makeRequests(boost::asio::io_service& ioService,
+                                 const std::string& path,
+                                 const boost::shared_ptr<LocalStreamConnectionPool>& pPool,
+                                 std::size_t count,
+                                 std::size_t* pFailures)
+{
+   std::vector<double> latencies;
+   for (std::size_t i = 0; i < count; ++i)
+   {
+      auto start = std::chrono::steady_clock::now();
+
+      boost::shared_ptr<LocalStreamAsyncClient> pClient(
+               new LocalStreamAsyncClient(ioService, FilePath(path)));
+      if (pPool)
+         pClient->setConnectionPool(pPool);
+
+      pClient->request().setMethod("POST");
+      pClient->request().setUri("/rpc/get_environment_state");
+      pClient->request().setHeader("Content-Type", "application/json");
+      pClient->request().setBody("{\"method\":\"get_environment_state\",\"params\":[]}");
+
+      bool succeeded = false;
+      pClient->execute([&](const Response& response) {
+                          succeeded = response.statusCode() == status::Ok;
+                       },
+                       [&](const Error&) {});
+      ioService.run();
+      ioService.reset();
+
+      if (!succeeded)
+         ++*pFailures;
+
+      latencies.push_back(std::chrono::duration<double, std::micro>(
+                             std::chrono::steady_clock::now() - start).count());
+   }
+   return latencies;
+}
+
+void reportLatencies(const std::string& label, std::vector<double> latencies)
+{
+   double total = 0;
+   for (double latency : latencies)
+      total += latency;
+
+   std::sort(latencies.begin(), latencies.end());
+   double p99 = latencies[latencies.size() * 99 / 100];
+
+   std::cout << label << ": " << static_cast<int>(latencies.size() / (total / 1e6))
+             << " requests/sec, p99 " << p99 << "us" << std::endl;
+}
+
+} // anonymous namespace
+
+test_context("LocalStreamConnectionPool")
+{
+   boost::asio::io_service ioService;
+
+   test_that("Released connections are handed out again")
+   {
+      LocalStreamConnectionPool pool;
+      expect_true(!pool.acquire(kStream, ioService));
+
+      Connection first(ioService);
+      Connection second(ioService);
+      pool.release(kStream, ioService, first.pSocket);
+      pool.release(kStream, ioService, second.pSocket);
+      expect_true(pool.idleCount(kStream) == 2);
+      expect_true(pool.idleCount("/tmp/other-stream") == 0);
+
+      // most recently released first
+      expect_true(pool.acquire(kStream, ioService) == second.pSocket);
+      expect_true(pool.acquire(kStream, ioService) == first.pSocket);
+      expect_true(!pool.acquire(kStream, ioService));
+      expect_true(pool.idleCount() == 0);
+   }
+
+   test_that("Connections closed by the other end are discarded")
+   {
+      LocalStreamConnectionPool pool;
+
+      Connection closed(ioService);
+      Connection unread(ioService);
+      pool.release(kStream, ioService, closed.pSocket);
+      pool.release(kStream, ioService, unread.pSocket);
+
+      closed.peer.close();
+      boost::asio::write(unread.peer, boost::asio::buffer("stale"));
+
+      expect_true(!pool.acquire(kStream, ioService));
+      expect_true(!closed.pSocket->is_open());
+      expect_true(!unread.pSocket->is_open());
+      expect_true(pool.idleCount() == 0);
+   }
+
+   test_that("The oldest connection is closed when a stream has too many")
+   {
+      LocalStreamConnectionPool pool(2);
+
+      Connection first(ioService);
+      Connection second(ioService);
+      Connection third(ioService);
+      pool.release(kStream, ioService, first.pSocket);
+      pool.release(kStream, ioService, second.pSocket);
+      pool.release(kStream, ioService, third.pSocket);
+
+      expect_true(pool.idleCount(kStream) == 2);
+      expect_true(!first.pSocket->is_open());
+      expect_true(second.pSocket->is_open());
+   }
+
+   test_that("Connections idle too long are closed")
+   {
+      LocalStreamConnectionPool pool(8, boost::posix_time::milliseconds(20));
+
+      Connection expired(ioService);
+      pool.release(kStream, ioService, expired.pSocket);
+      std::this_thread::sleep_for(std::chrono::milliseconds(40));
+
+      Connection recent(ioService);
+      pool.release("/tmp/other-stream", ioService, recent.pSocket);
+
+      // the release above swept the expired connection
+      expect_true(pool.idleCount(kStream) == 0);
+      expect_true(!expired.pSocket->is_open());
+      expect_true(pool.acquire("/tmp/other-stream", ioService) == recent.pSocket);
+   }
+
+   test_that("Evicting a stream closes its connections")
+   {
+      LocalStreamConnectionPool pool;
+
+      Connection first(ioService);
+      Connection other(ioService);
+      pool.release(kStream, ioService, first.pSocket);
+      pool.release("/tmp/other-stream", ioService, other.pSocket);
+
+      pool.evict(kStream);
+      expect_true(pool.idleCount(kStream) == 0);
+      expect_true(!first.pSocket->is_open());
+      expect_true(pool.idleCount() == 1);
+
+      pool.clear();
+      expect_true(pool.idleCount() == 0);
+      expect_true(!other.pSocket->is_open());
+   }
+
+   test_that("Requests reuse kept alive connections to the stream")
+   {
+      std::string path = "/tmp/rstudio-test-stream-" + std::to_string(::getpid());
+      StreamServer server(path);
+      boost::asio::io_service requestIoService;
+      boost::shared_ptr<LocalStreamConnectionPool> pPool(new LocalStreamConnectionPool());
+
+      std::size_t failures = 0;
+      makeRequests(requestIoService, path, pPool, 5, &failures);
+      expect_true(failures == 0);
+      expect_true(pPool->idleCount(path) == 1);
+
+      // without a pool the connection is closed after each response
+      makeRequests(requestIoService, path, boost::shared_ptr<LocalStreamConnectionPool>(), 2, &failures);
+      expect_true(failures == 0);
+   }
+
+   test_that("Requests written in full are not retried")
+   {
+      // the other end reads the second request on the kept alive
+      // connection but closes it without answering
+      std::string path = "/tmp/rstudio-test-stream-" + std::to_string(::getpid());
+      StreamServer server(path, 1);
+      boost::asio::io_service requestIoService;
+      boost::shared_ptr<LocalStreamConnectionPool> pPool(new LocalStreamConnectionPool());
+
+      // (the second may have been acted on, so it mustn't be sent again)
+      std::size_t failures = 0;
+      makeRequests(requestIoService, path, pPool, 2, &failures);
+      expect_true(failures == 1);
+      expect_true(server.requestCount() == 2);
+   }
+
+   test_that("Connections are only handed out to requests on the io_service they were made with")
+   {
+      LocalStreamConnectionPool pool;
+      boost::asio::io_service otherIoService;
+
+      Connection connection(ioService);
+      Connection otherConnection(otherIoService);
+      pool.release(kStream, ioService, connection.pSocket);
+      pool.release(kStream, otherIoService, otherConnection.pSocket);
+      expect_true(pool.idleCount(kStream) == 2);
+
+      expect_true(pool.acquire(kStream, otherIoService) == otherConnection.pSocket);
+      expect_true(!pool.acquire(kStream, otherIoService));
+      expect_true(pool.acquire(kStream, ioService) == connection.pSocket);
+
+      // evicting a stream closes its connections on every io_service
+      pool.release(kStream, ioService, connection.pSocket);
+      pool.release(kStream, otherIoService, otherConnection.pSocket);
+      pool.evict(kStream);
+      expect_true(pool.idleCount() == 0);
+      expect_true(!connection.pSocket->is_open());
+      expect_true(!otherConnection.pSocket->is_open());
+   }
+
+   test_that("Requests run by different io_services don't share connections")
+   {
+      std::string path = "/tmp/rstudio-test-stream-" + std::to_string(::getpid());
+      StreamServer server(path);
+      boost::asio::io_service firstIoService;
+      boost::asio::io_service secondIoService;
+      boost::shared_ptr<LocalStreamConnectionPool> pPool(new LocalStreamConnectionPool());
+
+      // (each run on its own thread, as the server's io_service shards are)
+      std::size_t firstFailures = 0, secondFailures = 0;
+      std::thread first([&]() { makeRequests(firstIoService, path, pPool, 200, &firstFailures); });
+      std::thread second([&]() { makeRequests(secondIoService, path, pPool, 200, &secondFailures); });
+      first.join();
+      second.join();
+
+      expect_true(firstFailures == 0);
+      expect_true(secondFailures == 0);
+
+      // each io_service kept its own connection
+      expect_true(pPool->idleCount(path) == 2);
+      expect_true(pPool->acquire(path, firstIoService));
+      expect_true(pPool->acquire(path, secondIoService));
+   }
+}
+
+TEST_CASE("LocalStreamConnectionPool benchmark", "[.benchmark]")
+{
+   std::string path = "/tmp/rstudio-bench-stream-" + std::to_string(::getpid());
+   StreamServer server(path);
+
+   const std::size_t kRequests = 5000;
+   std::size_t failures = 0;
+
+   boost::asio::io_service ioService;
+   std::vector<double> unpooled = makeRequests(
+            ioService, path, boost::shared_ptr<LocalStreamConnectionPool>(), kRequests, &failures);
+   std::vector<double> pooled = makeRequests(
+            ioService, path, boost::make_shared<LocalStreamConnectionPool>(), kRequests, &failures);
+
+   reportLatencies("connection per request", unpooled);
+   reportLatencies("pooled connections", pooled);
+
+   CHECK(failures == 0);
+}
+
+} // namespace http
+} // namespace core
+} // namespace rstudio
+
+#endif // _WIN32
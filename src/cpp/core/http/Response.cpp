@@ -25,6 +25,7 @@
 #include <boost/algorithm/string/trim.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/asio/buffer.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
 
 #include <core/http/URL.hpp>
 #include <core/http/Util.hpp>
@@ -442,6 +443,41 @@ Error Response::setBody(const std::string& content)
    return setBody(is);
 }
 
+Error Response::setBody(std::string&& content)
+{
+   if (contentEncoding() == kGzipEncoding)
+   {
+#ifdef _WIN32
+      // never gzip on win32
+      removeHeader("Content-Encoding");
+#else
+      try
+      {
+         // compress straight from the content buffer into the body
+         std::string compressed;
+         boost::iostreams::filtering_ostream filteringStream;
+         filteringStream.push(boost::iostreams::gzip_compressor());
+         filteringStream.push(boost::iostreams::back_inserter(compressed));
+         filteringStream.write(content.data(), content.size());
+         filteringStream.reset();
+
+         content.swap(compressed);
+      }
+      catch(const std::exception& e)
+      {
+         Error error = systemError(boost::system::errc::io_error,
+                                   ERROR_LOCATION);
+         error.addProperty("what", e.what());
+         return error;
+      }
+#endif
+   }
+
+   body_ = std::move(content);
+   setContentLength(gsl::narrow_cast<int>(body_.length()));
+   return Success();
+}
+
 Error Response::setCacheableBody(const FilePath& filePath,
                                  const Request& request)
 {
@@ -27,6 +27,12 @@
 
 #include <iostream>
 
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
 #include <boost/asio/placeholders.hpp>
 #include <boost/bind/bind.hpp>
 
@@ -42,6 +48,46 @@ namespace rstudio {
 namespace core {
 namespace http {
 
+namespace {
+
+#ifdef __linux__
+
+// the most data moved by a single splice (the default capacity of a pipe)
+const std::size_t kSpliceSize = 64 * 1024;
+
+// the number of splices made in a row before yielding to other work
+const int kMaxSplicesPerWait = 16;
+
+void closePipe(int pipe[2])
+{
+   for (int i = 0; i < 2; ++i)
+   {
+      if (pipe[i] != -1)
+      {
+         ::close(pipe[i]);
+         pipe[i] = -1;
+      }
+   }
+}
+
+bool setNonBlocking(int fd)
+{
+   int flags = ::fcntl(fd, F_GETFL);
+   return flags != -1 && ::fcntl(fd, F_SETFL, flags | O_NONBLOCK) != -1;
+}
+
+#endif
+
+} // anonymous namespace
+
+SocketProxy::~SocketProxy()
+{
+#ifdef __linux__
+   closePipe(clientPipe_);
+   closePipe(serverPipe_);
+#endif
+}
+
 void SocketProxy::readClient()
 {
    ptrClient_->asyncReadSome(
@@ -150,6 +196,139 @@ void SocketProxy::handleServerWrite(const boost::system::error_code& e,
    }
 }
 
+// on linux, data is moved between plain (unencrypted) sockets with splice(2):
+// from the socket into a pipe, and from the pipe into the other socket, all
+// without being copied into and out of our buffers
+bool SocketProxy::startSplicing()
+{
+#ifdef __linux__
+   int clientHandle = ptrClient_->nativeHandle();
+   int serverHandle = ptrServer_->nativeHandle();
+   if (clientHandle == -1 || serverHandle == -1)
+      return false;
+
+   if (!setNonBlocking(clientHandle) || !setNonBlocking(serverHandle))
+      return false;
+
+   if (::pipe2(clientPipe_, O_NONBLOCK | O_CLOEXEC) == -1)
+      return false;
+
+   if (::pipe2(serverPipe_, O_NONBLOCK | O_CLOEXEC) == -1)
+   {
+      closePipe(clientPipe_);
+      return false;
+   }
+
+   splice(true);
+   splice(false);
+   return true;
+#else
+   return false;
+#endif
+}
+
+void SocketProxy::splice(bool fromClient)
+{
+#ifdef __linux__
+   RECURSIVE_LOCK_MUTEX(socketMutex_)
+   {
+      if (closed_)
+         return;
+
+      Socket& from = fromClient ? *ptrClient_ : *ptrServer_;
+      Socket& to = fromClient ? *ptrServer_ : *ptrClient_;
+      int* pipe = fromClient ? clientPipe_ : serverPipe_;
+      std::size_t& pipeBytes = fromClient ? clientPipeBytes_ : serverPipeBytes_;
+
+      for (int i = 0; i < kMaxSplicesPerWait; ++i)
+      {
+         // fill the pipe once everything in it has been written
+         if (pipeBytes == 0)
+         {
+            ssize_t result = ::splice(from.nativeHandle(), nullptr, pipe[1], nullptr,
+                                      kSpliceSize, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            if (result == 0)
+            {
+               handleError(boost::asio::error::eof, ERROR_LOCATION);
+               return;
+            }
+            else if (result == -1)
+            {
+               if (errno == EINTR)
+                  continue;
+
+               if (errno == EAGAIN)
+                  waitForSplice(fromClient, false);
+               else
+                  handleError(boost::system::error_code(errno, boost::system::system_category()),
+                              ERROR_LOCATION);
+               return;
+            }
+
+            if (fromClient && checkFunction_ && !checkFunction_())
+            {
+               close();
+               return;
+            }
+
+            pipeBytes = result;
+         }
+
+         ssize_t result = ::splice(pipe[0], nullptr, to.nativeHandle(), nullptr,
+                                   pipeBytes, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+         if (result == -1)
+         {
+            if (errno == EINTR)
+               continue;
+
+            if (errno == EAGAIN)
+               waitForSplice(fromClient, true);
+            else
+               handleError(boost::system::error_code(errno, boost::system::system_category()),
+                           ERROR_LOCATION);
+            return;
+         }
+
+         pipeBytes -= result;
+      }
+
+      // give other connections a turn, continuing when we next can
+      waitForSplice(fromClient, pipeBytes > 0);
+   }
+   END_LOCK_MUTEX
+#endif
+}
+
+void SocketProxy::waitForSplice(bool fromClient, bool forWrite)
+{
+   if (forWrite)
+   {
+      Socket& to = fromClient ? *ptrServer_ : *ptrClient_;
+      to.asyncWait(boost::asio::socket_base::wait_write,
+                   boost::bind(&SocketProxy::handleSpliceWait,
+                               SocketProxy::shared_from_this(),
+                               fromClient,
+                               boost::asio::placeholders::error));
+   }
+   else
+   {
+      Socket& from = fromClient ? *ptrClient_ : *ptrServer_;
+      from.asyncWait(boost::asio::socket_base::wait_read,
+                     boost::bind(&SocketProxy::handleSpliceWait,
+                                 SocketProxy::shared_from_this(),
+                                 fromClient,
+                                 boost::asio::placeholders::error));
+   }
+}
+
+void SocketProxy::handleSpliceWait(bool fromClient, const boost::system::error_code& e)
+{
+   if (!e)
+      splice(fromClient);
+   else
+      handleError(e, ERROR_LOCATION);
+}
+
 void SocketProxy::handleError(const boost::system::error_code& e,
                               const core::ErrorLocation& location)
 {
@@ -0,0 +1,253 @@
+/*
+ * SocketProxyTests.cpp
+ *
+ * Copyright (C) 2022 by RStudio, PBC
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef _WIN32
+
+#include <tests/TestThat.hpp>
+
+#include <sys/resource.h>
+
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+
+#include <core/http/SocketProxy.hpp>
+
+namespace rstudio {
+namespace core {
+namespace http {
+
+namespace {
+
+using boost::asio::ip::tcp;
+
+// a plain tcp socket; offers direct access to the socket only if splicing
+class TcpSocket : public Socket
+{
+public:
+   TcpSocket(boost::asio::io_service& ioService, bool allowSplice)
+      : socket_(ioService), allowSplice_(allowSplice)
+   {
+   }
+
+   tcp::socket& socket() { return socket_; }
+
+   virtual void asyncReadSome(boost::asio::mutable_buffers_1 buffers, Handler handler)
+   {
+      socket_.async_read_some(buffers, handler);
+   }
+
+   virtual void asyncWrite(const boost::asio::const_buffers_1& buffer, Handler handler)
+   {
+      boost::asio::async_write(socket_, buffer, handler);
+   }
+
+   virtual void asyncWrite(const std::vector<boost::asio::const_buffer>& buffers,
+                           Handler handler)
+   {
+      boost::asio::async_write(socket_, buffers, handler);
+   }
+
+   virtual void close()
+   {
+      boost::system::error_code ec;
+      socket_.shutdown(tcp::socket::shutdown_both, ec);
+      socket_.close(ec);
+   }
+
+   virtual int nativeHandle()
+   {
+      return allowSplice_ ? socket_.native_handle() : -1;
+   }
+
+   virtual void asyncWait(boost::asio::socket_base::wait_type waitType, Handler handler)
+   {
+      socket_.async_wait(waitType,
+                         [handler](const boost::system::error_code& ec) { handler(ec, 0); });
+   }
+
+private:
+   tcp::socket socket_;
+   bool allowSplice_;
+};
+
+char patternByte(std::size_t offset)
+{
+   return static_cast<char>(offset % 251);
+}
+
+// a client connected through a socket proxy to an echo server, all on the
+// loopback interface
+class ProxiedEcho
+{
+public:
+   explicit ProxiedEcho(bool splice)
+      : proxyAcceptor_(ioService_, tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0)),
+        echoAcceptor_(ioService_, tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0)),
+        client_(clientIoService_),
+        echo_(ioService_)
+   {
+      // the client connects to the proxy
+      boost::shared_ptr<TcpSocket> pProxyClient(new TcpSocket(ioService_, splice));
+      client_.connect(proxyAcceptor_.local_endpoint());
+      proxyAcceptor_.accept(pProxyClient->socket());
+
+      // which connects to the echo server
+      boost::shared_ptr<TcpSocket> pProxyServer(new TcpSocket(ioService_, splice));
+      pProxyServer->socket().connect(echoAcceptor_.local_endpoint());
+      echoAcceptor_.accept(echo_);
+
+      SocketProxy::create(pProxyClient, pProxyServer);
+
+      proxyThread_ = std::thread([this]() { ioService_.run(); });
+      echoThread_ = std::thread([this]() { runEcho(); });
+   }
+
+   ~ProxiedEcho()
+   {
+      boost::system::error_code ec;
+      client_.close(ec);
+      echoThread_.join();
+      proxyThread_.join();
+   }
+
+   // send bytes through the proxy, returning whether all of them were
+   // echoed back intact
+   bool transfer(std::size_t bytes)
+   {
+      std::thread writer([&]() {
+         std::vector<char> buffer(64 * 1024);
+         for (std::size_t offset = 0; offset < bytes; offset += buffer.size())
+         {
+            std::size_t size = std::min(buffer.size(), bytes - offset);
+            for (std::size_t i = 0; i < size; ++i)
+               buffer[i] = patternByte(offset + i);
+            boost::system::error_code ec;
+            boost::asio::write(client_, boost::asio::buffer(buffer.data(), size), ec);
+            if (ec)
+               return;
+         }
+      });
+
+      bool intact = true;
+      std::vector<char> buffer(64 * 1024);
+      for (std::size_t offset = 0; offset < bytes;)
+      {
+         boost::system::error_code ec;
+         std::size_t size = client_.read_some(
+                  boost::asio::buffer(buffer.data(), std::min(buffer.size(), bytes - offset)), ec);
+         if (ec)
+         {
+            intact = false;
+            break;
+         }
+
+         for (std::size_t i = 0; i < size; ++i)
+            intact = intact && buffer[i] == patternByte(offset + i);
+         offset += size;
+      }
+
+      writer.join();
+      return intact;
+   }
+
+private:
+   void runEcho()
+   {
+      std::vector<char> buffer(64 * 1024);
+      for (;;)
+      {
+         boost::system::error_code ec;
+         std::size_t size = echo_.read_some(boost::asio::buffer(buffer), ec);
+         if (ec)
+            break;
+         boost::asio::write(echo_, boost::asio::buffer(buffer.data(), size), ec);
+         if (ec)
+            break;
+      }
+   }
+
+   boost::asio::io_service ioService_;
+   boost::asio::io_service clientIoService_;
+   tcp::acceptor proxyAcceptor_;
+   tcp::acceptor echoAcceptor_;
+   tcp::socket client_;
+   tcp::socket echo_;
+   std::thread proxyThread_;
+   std::thread echoThread_;
+};
+
+double cpuSeconds()
+{
+   struct rusage usage;
+   ::getrusage(RUSAGE_SELF, &usage);
+   return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+          usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+} // anonymous namespace
+
+test_context("SocketProxy")
+{
+   test_that("Data is proxied intact through buffers")
+   {
+      ProxiedEcho echo(false);
+      expect_true(echo.transfer(8 * 1024 * 1024 + 17));
+   }
+
+   test_that("Data is proxied intact when splicing")
+   {
+      ProxiedEcho echo(true);
+      expect_true(echo.transfer(8 * 1024 * 1024 + 17));
+      expect_true(echo.transfer(1));
+   }
+}
+
+TEST_CASE("SocketProxy throughput benchmark", "[.benchmark]")
+{
+   const std::size_t kBytes = 1024 * 1024 * 1024;
+
+   for (bool splice : { false, true })
+   {
+      ProxiedEcho echo(splice);
+
+      double cpuStart = cpuSeconds();
+      auto start = std::chrono::steady_clock::now();
+      bool intact = echo.transfer(kBytes);
+      double seconds = std::chrono::duration<double>(
+                          std::chrono::steady_clock::now() - start).count();
+      double cpu = cpuSeconds() - cpuStart;
+
+      // note that the cpu time includes the client and echo server (the same
+      // for both), which send and receive the data twice over
+      std::cout << (splice ? "splice: " : "buffered: ")
+                << (kBytes / seconds) / (1024 * 1024 * 1024) << " GB/s each way, "
+                << static_cast<int>(100 * cpu / seconds) << "% cpu" << std::endl;
+
+      CHECK(intact);
+   }
+}
+
+} // namespace http
+} // namespace core
+} // namespace rstudio
+
+#endif // _WIN32
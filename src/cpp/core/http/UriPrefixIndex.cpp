@@ -0,0 +1,137 @@
+/*
+ * UriPrefixIndex.cpp
+ *
+ * Copyright (C) 2022 by RStudio, PBC
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/http/UriPrefixIndex.hpp>
+
+#include <algorithm>
+#include <deque>
+#include <limits>
+#include <map>
+
+namespace rstudio {
+namespace core {
+namespace http {
+
+namespace {
+
+// pointer-based trie used only while building; it is flattened into the
+// contiguous representation used for lookups once all prefixes are added
+struct BuildNode
+{
+   BuildNode() : value(UriPrefixIndex::kNoMatch) {}
+
+   std::map<char, std::size_t> children;
+   std::size_t value;
+};
+
+} // anonymous namespace
+
+const std::size_t UriPrefixIndex::kNoMatch = std::numeric_limits<std::size_t>::max();
+
+void UriPrefixIndex::build(const std::vector<std::string>& prefixes)
+{
+   clear();
+
+   std::vector<BuildNode> trie(1);
+   for (std::size_t i = 0; i < prefixes.size(); ++i)
+   {
+      std::size_t current = 0;
+      for (char ch : prefixes[i])
+      {
+         std::map<char, std::size_t>::const_iterator it = trie[current].children.find(ch);
+         if (it == trie[current].children.end())
+         {
+            trie.push_back(BuildNode());
+            trie[current].children[ch] = trie.size() - 1;
+            current = trie.size() - 1;
+         }
+         else
+         {
+            current = it->second;
+         }
+      }
+
+      // the first registration of a duplicate prefix wins
+      trie[current].value = std::min(trie[current].value, i);
+   }
+
+   // flatten breadth-first so that the children of each node are adjacent
+   // (std::map iteration keeps them sorted by label)
+   nodes_.resize(trie.size());
+   labels_.resize(trie.size());
+
+   std::deque<std::pair<std::size_t, std::size_t> > pending; // (trie node, flat node)
+   pending.push_back(std::make_pair(0, 0));
+   labels_[0] = '\0';
+   std::size_t next = 1;
+
+   while (!pending.empty())
+   {
+      const BuildNode& source = trie[pending.front().first];
+      Node& target = nodes_[pending.front().second];
+      pending.pop_front();
+
+      target.value = source.value;
+      target.firstChild = next;
+      target.childCount = source.children.size();
+
+      for (const auto& child : source.children)
+      {
+         labels_[next] = child.first;
+         pending.push_back(std::make_pair(child.second, next));
+         ++next;
+      }
+   }
+}
+
+void UriPrefixIndex::clear()
+{
+   nodes_.clear();
+   labels_.clear();
+}
+
+std::size_t UriPrefixIndex::find(const std::string& uri) const
+{
+   if (nodes_.empty())
+      return kNoMatch;
+
+   std::size_t best = nodes_[0].value;
+   std::size_t current = 0;
+   for (char ch : uri)
+   {
+      current = findChild(nodes_[current], ch);
+      if (current == kNoMatch)
+         break;
+
+      best = std::min(best, nodes_[current].value);
+   }
+
+   return best;
+}
+
+std::size_t UriPrefixIndex::findChild(const Node& node, char label) const
+{
+   std::vector<char>::const_iterator begin = labels_.begin() + node.firstChild;
+   std::vector<char>::const_iterator end = begin + node.childCount;
+   std::vector<char>::const_iterator it = std::lower_bound(begin, end, label);
+   if (it == end || *it != label)
+      return kNoMatch;
+
+   return static_cast<std::size_t>(it - labels_.begin());
+}
+
+} // namespace http
+} // namespace core
+} // namespace rstudio
@@ -69,7 +69,12 @@ public:
    {
    }
 
-   // COPYING: via compliler (copyable members)
+   // COPYING: via compliler (copyable members); moves are declared
+   // explicitly since the virtual destructor suppresses them
+   FileInfo(const FileInfo&) = default;
+   FileInfo(FileInfo&&) = default;
+   FileInfo& operator=(const FileInfo&) = default;
+   FileInfo& operator=(FileInfo&&) = default;
 
 public:
    bool empty() const { return absolutePath_.empty(); }
@@ -90,7 +95,7 @@ public:
    }
    
 public:
-   std::string absolutePath() const { return absolutePath_; }
+   const std::string& absolutePath() const { return absolutePath_; }
    bool isDirectory() const { return isDirectory_; }
    uintmax_t size() const { return size_; }
    std::time_t lastWriteTime() const { return lastWriteTime_; }
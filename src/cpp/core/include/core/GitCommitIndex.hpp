@@ -0,0 +1,103 @@
+/*
+ * GitCommitIndex.hpp
+ *
+ * Copyright (C) 2022 by RStudio, PBC
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef CORE_GIT_COMMIT_INDEX_HPP
+#define CORE_GIT_COMMIT_INDEX_HPP
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+#include <core/GitGraph.hpp>
+
+namespace rstudio {
+namespace core {
+
+class Error;
+class FilePath;
+
+namespace gitgraph {
+
+// The format (for git log --pretty) of the output read by CommitIndex.
+extern const char* const kCommitIndexLogFormat;
+
+struct IndexedCommit
+{
+   std::string id;
+   std::vector<std::string> parents;
+
+   // "name <email>"
+   std::string author;
+
+   // The commit time (seconds since the epoch) and its time zone offset
+   // (e.g. "+0200"), as reported by git
+   std::string time;
+   std::string timeZone;
+
+   std::string message;
+};
+
+// An index of the commits reachable from a revision, in the order listed by
+// git log (i.e. children before their parents), from which pages of history
+// and their graph lines can be read without asking git for the commits
+// which precede them.
+//
+// As the revision moves (e.g. new commits are made), the commits which are
+// now reachable can be prepended to the index. Graph lines are generated
+// from checkpoints of the graph's state, which are made as needed and
+// discarded when commits are prepended.
+class CommitIndex : boost::noncopyable
+{
+public:
+   // The commits at the tips of the revision the index contains.
+   const std::vector<std::string>& tips() const { return tips_; }
+
+   std::size_t size() const { return commits_.size(); }
+   bool empty() const { return commits_.empty(); }
+   const IndexedCommit& at(std::size_t index) const { return commits_[index]; }
+
+   // Adds the commits in the given git log output (in kCommitIndexLogFormat)
+   // ahead of those already in the index; these should be the commits
+   // reachable from the given tips which the index doesn't have.
+   Error prepend(const std::string& logOutput, const std::vector<std::string>& tips);
+
+   void clear();
+
+   // Returns the graph lines (see Line::string) for count commits, starting
+   // from the commit at the given index.
+   std::vector<std::string> graphLines(std::size_t start, std::size_t count);
+
+   // Returns the indexes of the commits whose id, author or message contain
+   // all of the given patterns (ignoring case).
+   std::vector<std::size_t> search(const std::vector<std::string>& patterns) const;
+
+   Error readFromFile(const FilePath& filePath);
+   Error writeToFile(const FilePath& filePath) const;
+
+private:
+   std::vector<std::string> tips_;
+   std::deque<IndexedCommit> commits_;
+
+   // The graph's state before every kCheckpointInterval'th commit.
+   std::vector<GitGraph::State> checkpoints_;
+};
+
+} // namespace gitgraph
+} // namespace core
+} // namespace rstudio
+
+#endif // CORE_GIT_COMMIT_INDEX_HPP
@@ -75,6 +75,18 @@ public:
    Line addCommit(const std::string& commit,
                   const std::vector<std::string>& parents);
 
+   // The state of the graph between calls to addCommit. Saving and
+   // restoring this allows lines to be generated from any point in a
+   // history, rather than only from its first commit.
+   struct State
+   {
+      int nextColumnId;
+      Line pendingLine;
+   };
+
+   State state() const;
+   void restoreState(const State& state);
+
 private:
    int nextColumnId_;
    Line pendingLine_;
@@ -74,6 +74,14 @@ bool isSubsequence(std::string const& self,
                    std::string const& other,
                    std::string::size_type other_n);
 
+// as above, over the characters in [begin, end) (e.g. the filename within a
+// path) and without allocating; case insensitive comparison is ASCII only
+bool isSubsequence(const char* begin,
+                   const char* end,
+                   std::string const& other,
+                   std::string::size_type other_n,
+                   bool caseInsensitive);
+
 std::vector<int> subsequenceIndices(std::string const& sequence,
                                     std::string const& query);
 
@@ -16,10 +16,13 @@
 #ifndef CORE_THREAD_HPP
 #define CORE_THREAD_HPP
 
+#include <atomic>
 #include <queue>
+#include <vector>
 
 #include <boost/utility.hpp>
 #include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
 
 #include <core/BoostErrors.hpp>
 #include <core/BoostThread.hpp>
@@ -311,6 +314,96 @@ private:
    std::queue<T> queue_;
 };
 
+// unbounded multi-producer, single-consumer queue. enque never blocks or
+// takes a lock (producers only contend on a single atomic exchange), so it
+// is suitable for threads that must not stall behind a consumer. deque and
+// isEmpty must only ever be called from one thread at a time (callers with
+// several consuming threads need to serialize them with their own lock).
+// T must be default constructible.
+template <typename T>
+class MpscQueue : boost::noncopyable
+{
+public:
+   MpscQueue()
+      : pHead_(new Node()),
+        pTail_(pHead_.load(std::memory_order_relaxed))
+   {
+   }
+
+   ~MpscQueue()
+   {
+      while (pTail_ != nullptr)
+      {
+         Node* pNext = pTail_->pNext.load(std::memory_order_relaxed);
+         delete pTail_;
+         pTail_ = pNext;
+      }
+   }
+
+   // COPYING: boost::noncopyable
+
+public:
+
+   void enque(const T& val)
+   {
+      Node* pNode = new Node();
+      pNode->value = val;
+      push(pNode);
+   }
+
+   void enque(T&& val)
+   {
+      Node* pNode = new Node();
+      pNode->value = std::move(val);
+      push(pNode);
+   }
+
+   // consumer only
+   bool deque(T* pVal)
+   {
+      Node* pNext = pTail_->pNext.load(std::memory_order_acquire);
+      if (pNext == nullptr)
+         return false;
+
+      // the dequeued node becomes the new (empty) tail
+      *pVal = std::move(pNext->value);
+      pNext->value = T();
+      delete pTail_;
+      pTail_ = pNext;
+      return true;
+   }
+
+   // consumer only. an element whose enque is still in progress may not be
+   // visible yet
+   bool isEmpty() const
+   {
+      return pTail_->pNext.load(std::memory_order_acquire) == nullptr;
+   }
+
+private:
+   struct Node
+   {
+      Node() : pNext(nullptr) {}
+
+      std::atomic<Node*> pNext;
+      T value;
+   };
+
+   void push(Node* pNode)
+   {
+      // claim the head position then link the previous head to us; until
+      // the link is published the consumer simply sees the queue end early
+      Node* pPrev = pHead_.exchange(pNode, std::memory_order_acq_rel);
+      pPrev->pNext.store(pNode, std::memory_order_release);
+   }
+
+   // most recently enqueued node (producers)
+   std::atomic<Node*> pHead_;
+
+   // already consumed node preceding the next value (consumer)
+   Node* pTail_;
+};
+
 template <typename T>
 class ThreadsafeSet
 {
@@ -363,6 +456,34 @@ private:
    mutable boost::mutex mutex_;
 };
 
+// fixed size pool of background threads which run tasks in the order they
+// were enqueued. threads are started when the first task is enqueued. tasks
+// must not call into R
+class WorkerPool : boost::noncopyable
+{
+public:
+   explicit WorkerPool(std::size_t threadCount);
+   ~WorkerPool();
+
+   void enque(const boost::function<void()>& task);
+
+   // discard queued tasks and wait for running tasks to complete; the
+   // pool can't be used after it is stopped
+   void stop();
+
+   std::size_t threadCount() const { return threadCount_; }
+
+private:
+   void run();
+
+   const std::size_t threadCount_;
+   boost::mutex mutex_;
+   boost::condition_variable condition_;
+   std::queue<boost::function<void()> > tasks_;
+   std::vector<boost::shared_ptr<boost::thread> > threads_;
+   bool stopped_;
+};
+
 void safeLaunchThread(boost::function<void()> threadMain,
                       boost::thread* pThread = nullptr);
 
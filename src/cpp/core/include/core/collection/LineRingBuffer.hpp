@@ -0,0 +1,90 @@
+/*
+ * LineRingBuffer.hpp
+ *
+ * Copyright (C) 2022 by RStudio, PBC
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef CORE_LINE_RING_BUFFER_HPP
+#define CORE_LINE_RING_BUFFER_HPP
+
+#include <cstddef>
+
+#include <string>
+#include <vector>
+
+namespace rstudio {
+namespace core {
+namespace collection {
+
+// accumulates text while retaining only its trailing lines: at most maxLines
+// newline terminated lines plus any partial line which follows them. the
+// text is kept contiguous and a ring of line offsets records where each
+// retained line starts, so dropping the oldest line is O(1) (the buffer is
+// compacted only once the dropped prefix dominates it) and the retained text
+// can usually be taken without copying
+class LineRingBuffer
+{
+public:
+   explicit LineRingBuffer(std::size_t maxLines);
+
+   // COPYING: via compiler
+
+   void append(const std::string& text);
+   void append(const char* pText, std::size_t length);
+
+   // change the number of lines retained (drops lines if necessary)
+   void setMaxLines(std::size_t maxLines);
+   std::size_t maxLines() const { return ring_.size(); }
+
+   bool empty() const { return begin_ == buffer_.size(); }
+
+   // retained length in bytes
+   std::size_t size() const { return buffer_.size() - begin_; }
+
+   // number of complete lines retained
+   std::size_t lineCount() const { return lineCount_; }
+
+   // copy of the retained text
+   std::string str() const;
+
+   // remove and return the retained text
+   std::string take();
+
+   void clear();
+
+   void swap(LineRingBuffer& other);
+
+private:
+   void dropOldestLine();
+   void compact();
+
+   // retained text is buffer_[begin_, end)
+   std::string buffer_;
+   std::size_t begin_;
+
+   // offsets (into buffer_) just past the newline of each retained line,
+   // oldest first starting at ringHead_
+   std::vector<std::size_t> ring_;
+   std::size_t ringHead_;
+   std::size_t lineCount_;
+};
+
+inline void swap(LineRingBuffer& lhs, LineRingBuffer& rhs)
+{
+   lhs.swap(rhs);
+}
+
+} // namespace collection
+} // namespace core
+} // namespace rstudio
+
+#endif // CORE_LINE_RING_BUFFER_HPP
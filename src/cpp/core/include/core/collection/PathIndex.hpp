@@ -0,0 +1,302 @@
+/*
+ * PathIndex.hpp
+ *
+ * Copyright (C) 2022 by RStudio, PBC
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef CORE_COLLECTION_PATH_INDEX_HPP
+#define CORE_COLLECTION_PATH_INDEX_HPP
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace rstudio {
+namespace core {
+namespace collection {
+
+// orders paths as a pre-order walk of the directory tree: '/' sorts before
+// any other character, so a directory is immediately followed by everything
+// below it (e.g. "a/b", "a/b/c", "a/b-c")
+inline int comparePaths(const char* lhs, std::size_t lhsLength,
+                        const char* rhs, std::size_t rhsLength)
+{
+   std::size_t length = std::min(lhsLength, rhsLength);
+   for (std::size_t i = 0; i < length; ++i)
+   {
+      unsigned char a = static_cast<unsigned char>(lhs[i]);
+      unsigned char b = static_cast<unsigned char>(rhs[i]);
+      if (a == b)
+         continue;
+
+      if (a == '/')
+         return -1;
+      if (b == '/')
+         return 1;
+      return a < b ? -1 : 1;
+   }
+
+   if (lhsLength == rhsLength)
+      return 0;
+   return lhsLength < rhsLength ? -1 : 1;
+}
+
+inline bool pathLessThan(const std::string& lhs, const std::string& rhs)
+{
+   return comparePaths(lhs.data(), lhs.length(), rhs.data(), rhs.length()) < 0;
+}
+
+// index of values keyed by absolute path, stored in a single sorted array.
+// lookups are O(log n), and everything below a directory is a contiguous
+// range which can be scanned linearly. directories implied by the paths of
+// values need not be inserted themselves.
+//
+// inserts of paths that are not already indexed are appended and merged into
+// the sorted array when the index is next scanned, so bulk loads cost
+// O(n log n) overall rather than O(n) per insert, and lookups interleaved
+// with inserts don't force a merge each time.
+//
+// Traits provides:
+//
+//    static const std::string& path(const T& value);
+//    static bool isDirectory(const T& value);
+template <typename T, typename Traits>
+class PathIndex
+{
+public:
+   typedef typename std::vector<T>::const_iterator const_iterator;
+   typedef std::pair<const_iterator, const_iterator> range;
+
+   PathIndex() : sortedCount_(0) {}
+
+   // insert a value, replacing any value with the same path
+   void insert(const T& value)
+   {
+      const std::string& path = Traits::path(value);
+
+      // appending in order keeps the array sorted
+      if (sortedCount_ == values_.size() &&
+          (values_.empty() || pathLessThan(Traits::path(values_.back()), path)))
+      {
+         values_.push_back(value);
+         ++sortedCount_;
+         return;
+      }
+
+      // replace in place if already indexed
+      typename std::vector<T>::iterator it = lowerBound(values_.begin(),
+                                                        values_.begin() + sortedCount_,
+                                                        path);
+      if (it != values_.begin() + sortedCount_ && Traits::path(*it) == path)
+      {
+         *it = value;
+         return;
+      }
+
+      values_.push_back(value);
+   }
+
+   // remove the value for a path along with any values below it
+   bool remove(const std::string& path)
+   {
+      merge();
+
+      typename std::vector<T>::iterator begin = lowerBound(values_.begin(), values_.end(), path);
+      typename std::vector<T>::iterator end = begin;
+      if (end != values_.end() && Traits::path(*end) == path)
+         ++end;
+      end = std::partition_point(end, values_.end(), IsBelow(path));
+
+      if (begin == end)
+         return false;
+
+      values_.erase(begin, end);
+      sortedCount_ = values_.size();
+      return true;
+   }
+
+   const T* find(const std::string& path) const
+   {
+      // a short run of unsorted values is cheaper to scan than to merge (the
+      // most recently inserted value for a path wins)
+      if (values_.size() - sortedCount_ <= kMaxScannedValues)
+      {
+         for (std::size_t i = values_.size(); i > sortedCount_; --i)
+         {
+            if (Traits::path(values_[i - 1]) == path)
+               return &values_[i - 1];
+         }
+
+         const_iterator end = values_.cbegin() + sortedCount_;
+         const_iterator it = lowerBound(values_.cbegin(), end, path);
+         if (it == end || Traits::path(*it) != path)
+            return nullptr;
+         return &(*it);
+      }
+
+      merge();
+
+      const_iterator it = lowerBound(values_.cbegin(), values_.cend(), path);
+      if (it == values_.cend() || Traits::path(*it) != path)
+         return nullptr;
+      return &(*it);
+   }
+
+   // values strictly below a directory
+   range below(const std::string& directory) const
+   {
+      merge();
+
+      const_iterator begin = lowerBound(values_.cbegin(), values_.cend(), directory);
+      if (begin != values_.cend() && Traits::path(*begin) == directory)
+         ++begin;
+      return range(begin,
+                   std::partition_point(begin, values_.cend(), IsBelow(directory)));
+   }
+
+   // does the index contain the directory itself or anything below it
+   bool containsDirectory(const std::string& directory) const
+   {
+      range values = below(directory);
+      return values.first != values.second || find(directory) != nullptr;
+   }
+
+   // invoke f with the path of every directory below a directory (both those
+   // inserted and those implied by the paths of other values), in index
+   // order; f returns false to stop
+   template <typename F>
+   void forEachDirectoryBelow(const std::string& directory, F f) const
+   {
+      range values = below(directory);
+
+      // directories are contiguous in index order, so each is reported when
+      // the first value within it is reached
+      std::string previous = directory;
+      for (const_iterator it = values.first; it != values.second; ++it)
+      {
+         const std::string& path = Traits::path(*it);
+         std::size_t length = Traits::isDirectory(*it) ? path.length() : path.rfind('/');
+
+         // find the deepest directory shared with the previous value
+         std::size_t common = 0;
+         std::size_t limit = std::min(length, previous.length());
+         while (common < limit && path[common] == previous[common])
+            ++common;
+
+         bool atBoundary =
+               (common == length || path[common] == '/') &&
+               (common == previous.length() || previous[common] == '/');
+         if (!atBoundary)
+            common = path.rfind('/', common - 1);
+
+         // report the directories below it
+         for (std::size_t pos = path.find('/', common + 1);
+              pos < length;
+              pos = path.find('/', pos + 1))
+         {
+            if (!f(path.substr(0, pos)))
+               return;
+         }
+
+         if (length > common && !f(path.substr(0, length)))
+            return;
+
+         previous.assign(path, 0, length);
+      }
+   }
+
+   const_iterator begin() const { merge(); return values_.cbegin(); }
+   const_iterator end() const { merge(); return values_.cend(); }
+
+   std::size_t size() const { merge(); return values_.size(); }
+   bool empty() const { return values_.empty(); }
+
+   void clear()
+   {
+      values_.clear();
+      sortedCount_ = 0;
+   }
+
+private:
+   static const std::size_t kMaxScannedValues = 64;
+
+   // is a path below a directory (a partition predicate over the index)
+   class IsBelow
+   {
+   public:
+      explicit IsBelow(const std::string& directory)
+         : directory_(directory)
+      {
+      }
+
+      bool operator()(const T& value) const
+      {
+         const std::string& path = Traits::path(value);
+         return path.length() > directory_.length() &&
+                path[directory_.length()] == '/' &&
+                path.compare(0, directory_.length(), directory_) == 0;
+      }
+
+   private:
+      const std::string& directory_;
+   };
+
+   template <typename Iterator>
+   static Iterator lowerBound(Iterator begin, Iterator end, const std::string& path)
+   {
+      return std::lower_bound(begin, end, path, [](const T& value, const std::string& path) {
+         return pathLessThan(Traits::path(value), path);
+      });
+   }
+
+   // merge values appended out of order into the sorted array
+   void merge() const
+   {
+      if (sortedCount_ == values_.size())
+         return;
+
+      auto less = [](const T& lhs, const T& rhs) {
+         return pathLessThan(Traits::path(lhs), Traits::path(rhs));
+      };
+
+      // sort the appended values, keeping only the last value for each path
+      typename std::vector<T>::iterator tail = values_.begin() + sortedCount_;
+      std::stable_sort(tail, values_.end(), less);
+      typename std::vector<T>::iterator last = values_.end();
+      typename std::vector<T>::iterator out = values_.end();
+      while (last != tail)
+      {
+         --last;
+         if (out != values_.end() && Traits::path(*last) == Traits::path(*out))
+            continue;
+         --out;
+         if (out != last)
+            *out = std::move(*last);
+      }
+      if (out != tail)
+         values_.erase(std::move(out, values_.end(), tail), values_.end());
+
+      std::inplace_merge(values_.begin(), tail, values_.end(), less);
+      sortedCount_ = values_.size();
+   }
+
+   mutable std::vector<T> values_;
+   mutable std::size_t sortedCount_;
+};
+
+} // namespace collection
+} // namespace core
+} // namespace rstudio
+
+#endif // CORE_COLLECTION_PATH_INDEX_HPP
@@ -179,6 +179,13 @@ public:
       boost::asio::async_write(socket(), buffers, handler);
    }
 
+   virtual void asyncWait(boost::asio::socket_base::wait_type waitType,
+                          Handler handler)
+   {
+      socket().lowest_layer().async_wait(
+               waitType, boost::bind(handler, boost::asio::placeholders::error, 0));
+   }
+
    virtual void close()
    {
       // ensure the socket is only closed once - boost considers
@@ -277,11 +284,15 @@ protected:
    void writeRequest()
    {
       // specify closing of the connection after the request unless this is
-      // an attempt to upgrade to websockets
+      // an attempt to upgrade to websockets (or the subclass keeps the
+      // connection alive for subsequent requests)
       Header overrideHeader;
       if (!util::isWSUpgradeRequest(request_))
       {
-         overrideHeader = Header::connectionClose();
+         if (requestKeepAlive())
+            overrideHeader = Header::connectionKeepAlive();
+         else
+            overrideHeader = Header::connectionClose();
       }
 
       // write
@@ -324,6 +335,27 @@ protected:
       handleError(Error(ec, location));
    }
 
+   // errors writing the request or reading the status line of the response;
+   // if the request couldn't be written in full it may be retried (e.g. if
+   // it was written to a kept alive connection which the other end has
+   // since closed). once written the other end may have acted on it, so
+   // it's never retried (it needn't be idempotent)
+   void handleRequestError(const boost::system::error_code& ec,
+                           const ErrorLocation& location)
+   {
+      bool requestWritten = false;
+      LOCK_MUTEX(socketMutex_)
+      {
+         requestWritten = requestWritten_;
+      }
+      END_LOCK_MUTEX
+
+      if (!requestWritten && responseBuffer_.size() == 0 && retryOnNewConnection())
+         return;
+
+      handleErrorCode(ec, location);
+   }
+
    void handleUnexpectedError(const std::string& description,
                               const ErrorLocation& location)
    {
@@ -338,6 +370,26 @@ private:
    virtual void connectAndWriteRequest() = 0;
    virtual std::string getDefaultHostHeader() = 0;
 
+   // hooks for subclasses which keep connections alive across requests:
+   // ask the other end to keep the connection open after the response
+   virtual bool requestKeepAlive()
+   {
+      return false;
+   }
+
+   // hand off the connection once the response is complete (called
+   // instead of closing it when keepConnectionAlive() is true)
+   virtual void releaseConnection()
+   {
+   }
+
+   // retry the request on a new connection (called only if the request
+   // wasn't written in full); return false if it can't be
+   virtual bool retryOnNewConnection()
+   {
+      return false;
+   }
+
    bool retryConnectionIfRequired(const Error& connectionError,
                                   Error* pOtherError)
    {
@@ -462,7 +514,7 @@ private:
          }
          else
          {
-            handleErrorCode(ec, ERROR_LOCATION);
+            handleRequestError(ec, ERROR_LOCATION);
          }
       }
       CATCH_UNEXPECTED_ASYNC_CLIENT_EXCEPTION
@@ -495,7 +547,7 @@ private:
          }
          else
          {
-            handleErrorCode(ec, ERROR_LOCATION);
+            handleRequestError(ec, ERROR_LOCATION);
          }
       }
       CATCH_UNEXPECTED_ASYNC_CLIENT_EXCEPTION
@@ -723,7 +775,9 @@ private:
 
    void closeAndRespond()
    {
-      if (!keepConnectionAlive())
+      if (keepConnectionAlive())
+         releaseConnection();
+      else
          close();
 
       if (responseHandler_ && (!chunkedEncoding_ || !chunkHandler_))
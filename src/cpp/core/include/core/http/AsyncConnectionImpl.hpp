@@ -280,6 +280,21 @@ public:
       socketOperations_->asyncReadSome(buffer, handler);
    }
 
+   virtual int nativeHandle()
+   {
+#ifndef _WIN32
+      if (!sslStream_)
+         return socket_->native_handle();
+#endif
+      return -1;
+   }
+
+   virtual void asyncWait(boost::asio::socket_base::wait_type waitType,
+                          Socket::Handler handler)
+   {
+      socket_->async_wait(waitType, boost::bind(handler, boost::asio::placeholders::error, 0));
+   }
+
    virtual void asyncWrite(
                      const std::vector<boost::asio::const_buffer>& buffers,
                      Socket::Handler handler)
@@ -332,6 +347,18 @@ public:
       requestParser_.setFormHandler(formHandler);
    }
 
+   // the uri handler resolved when the request headers were parsed; cached
+   // so that dispatching the completed request does not route it again
+   void setUriHandler(const AsyncUriHandler* pUriHandler)
+   {
+      pUriHandler_ = pUriHandler;
+   }
+
+   const AsyncUriHandler* uriHandler() const
+   {
+      return pUriHandler_;
+   }
+
    virtual void continueParsing()
    {
       // continue parsing by reinvoking the read handler
@@ -609,6 +636,8 @@ private:
    boost::recursive_mutex mutex_;
    bool closed_ = false;
 
+   const AsyncUriHandler* pUriHandler_ = nullptr;
+
    size_t bytesTransferred_;
 
    boost::any connectionData_;
@@ -69,6 +69,8 @@ public:
    virtual void setRequestFilter(RequestFilter requestFilter) = 0;
    virtual void setResponseFilter(ResponseFilter responseFilter) = 0;
 
+   virtual void setIoServicePerThread(bool ioServicePerThread) = 0;
+
    virtual Error runSingleThreaded() = 0;
 
    virtual Error run(std::size_t threadPoolSize = 1) = 0;
@@ -16,10 +16,12 @@
 #ifndef CORE_HTTP_ASYNC_SERVER_IMPL_HPP
 #define CORE_HTTP_ASYNC_SERVER_IMPL_HPP
 
+#include <set>
 #include <vector>
 
 #include <boost/utility.hpp>
 #include <boost/shared_ptr.hpp>
+#include <boost/make_shared.hpp>
 #include <boost/function.hpp>
 #include <boost/algorithm/string.hpp>
 #include <boost/variant/static_visitor.hpp>
@@ -85,8 +87,13 @@ public:
         additionalResponseHeaders_(additionalResponseHeaders),
         scheduledCommandInterval_(boost::posix_time::seconds(3)),
         scheduledCommandTimer_(acceptorService_.ioService()),
+        ioServicePerThread_(false),
+        nextShard_(0),
+        nextConnectionShard_(0),
         running_(false)
    {
+      shards_.push_back(boost::make_shared<ConnectionShard>(
+                                             boost::ref(acceptorService_.ioService())));
    }
    
    virtual ~AsyncServerImpl()
@@ -172,12 +179,26 @@ public:
       responseFilter_ = responseFilter;
    }
 
+   // run each thread of the pool on its own io_service rather than all of
+   // them on one: accepted connections are handed to the io_services round
+   // robin and serviced entirely by that thread, which avoids the threads
+   // contending for the shared io_service (and its locks) under load. the
+   // server's io_service (see ioService()) is run by the first thread only
+   virtual void setIoServicePerThread(bool ioServicePerThread)
+   {
+      BOOST_ASSERT(!running_);
+      ioServicePerThread_ = ioServicePerThread;
+   }
+
    virtual Error runSingleThreaded()
    {
 
       // update state
       running_ = true;
 
+      // handler registration is closed; compile the routing index
+      uriHandlers_.freeze();
+
       // get ready for next connection
       acceptNextConnection();
 
@@ -186,7 +207,7 @@ public:
 
 
       // run
-      runServiceThread();
+      runServiceThread(acceptorService_.ioService());
 
 
       return Success();
@@ -202,6 +223,25 @@ public:
          // update state
          running_ = true;
 
+         // handler registration is closed; compile the routing index
+         uriHandlers_.freeze();
+
+         // create an io_service for each of the other threads
+         if (ioServicePerThread_)
+         {
+            for (std::size_t i = 1; i < threadPoolSize; ++i)
+            {
+               boost::shared_ptr<boost::asio::io_service> pIoService(
+                                                   new boost::asio::io_service());
+               ioServiceWork_.push_back(
+                        boost::make_shared<boost::asio::io_service::work>(
+                                                            boost::ref(*pIoService)));
+               ioServices_.push_back(pIoService);
+               shards_.push_back(boost::make_shared<ConnectionShard>(
+                                                            boost::ref(*pIoService)));
+            }
+         }
+
          // get ready for next connection
          acceptNextConnection();
 
@@ -218,10 +258,14 @@ public:
          // create the threads
          for (std::size_t i=0; i < threadPoolSize; ++i)
          {
+            boost::asio::io_service& ioService = ioServicePerThread_ ?
+                     shards_[i]->ioService : acceptorService_.ioService();
+
             // run the thread
             boost::shared_ptr<boost::thread> pThread(new boost::thread(
                               &AsyncServerImpl<ProtocolType>::runServiceThread,
-                              this));
+                              this,
+                              boost::ref(ioService)));
             
             // add to list of threads
             threads_.push_back(pThread);
@@ -245,18 +289,28 @@ public:
          LOG_ERROR(Error(closeEc, ERROR_LOCATION));
       
       // stop the server 
-      acceptorService_.ioService().stop();
+      ioServiceWork_.clear();
+      for (const boost::shared_ptr<ConnectionShard>& pShard : shards_)
+         pShard->ioService.stop();
 
       std::set<boost::weak_ptr<AsyncConnectionImpl<typename ProtocolType::socket> >> connections;
       boost::shared_ptr<AsyncConnectionImpl<typename ProtocolType::socket>> pendingConnection;
       RECURSIVE_LOCK_MUTEX(mutex_)
       {
          running_ = false;
-         connections = connections_;
          pendingConnection = ptrNextConnection_;
       }
       END_LOCK_MUTEX
 
+      for (const boost::shared_ptr<ConnectionShard>& pShard : shards_)
+      {
+         LOCK_MUTEX(pShard->mutex)
+         {
+            connections.insert(pShard->connections.begin(), pShard->connections.end());
+         }
+         END_LOCK_MUTEX
+      }
+
       // gracefully stop all open connections to ensure they are freed
       // before our io service (socket acceptor) is freed - if this is
       // not guaranteed, boost will crash when attempting to free socket objects
@@ -272,12 +326,15 @@ public:
             instance->close();
       }
 
-      // the list should be empty now, but clear it to make sure
-      RECURSIVE_LOCK_MUTEX(mutex_)
+      // the lists should be empty now, but clear them to make sure
+      for (const boost::shared_ptr<ConnectionShard>& pShard : shards_)
       {
-         connections_.clear();
+         LOCK_MUTEX(pShard->mutex)
+         {
+            pShard->connections.clear();
+         }
+         END_LOCK_MUTEX
       }
-      END_LOCK_MUTEX
 
       // ensure we "close" the empty connection that is always created to handle the next incoming connection
       // if we do not specifically close it here, it will attempt to close itself when no shared_ptr to
@@ -309,46 +366,53 @@ public:
    
 private:
 
-   void runServiceThread()
+   void runServiceThread(boost::asio::io_service& ioService)
    {
       try
       {
          boost::system::error_code ec;
-         acceptorService_.ioService().run(ec);
+         ioService.run(ec);
          if (ec)
             LOG_ERROR(Error(ec, ERROR_LOCATION));
       }
       CATCH_UNEXPECTED_EXCEPTION
    }
 
-   void addConnection(const boost::weak_ptr<AsyncConnectionImpl<typename ProtocolType::socket>>& connection)
+   void addConnection(std::size_t shard,
+                      const boost::weak_ptr<AsyncConnectionImpl<typename ProtocolType::socket>>& connection)
    {
       // add connection to our map
       // note that we only hold a weak_ptr to the connection so that it can go out of scope on its own
       // if we didn't allow this, unused (finished) connections may never close
-      RECURSIVE_LOCK_MUTEX(mutex_)
+      LOCK_MUTEX(shards_[shard]->mutex)
       {
-         connections_.insert(connection);
+         shards_[shard]->connections.insert(connection);
       }
       END_LOCK_MUTEX
    }
 
-   void onConnectionClosed(const boost::weak_ptr<AsyncConnectionImpl<typename ProtocolType::socket>>& connection)
+   void onConnectionClosed(std::size_t shard,
+                           const boost::weak_ptr<AsyncConnectionImpl<typename ProtocolType::socket>>& connection)
    {
-      RECURSIVE_LOCK_MUTEX(mutex_)
+      LOCK_MUTEX(shards_[shard]->mutex)
       {
-         connections_.erase(connection);
+         shards_[shard]->connections.erase(connection);
       }
       END_LOCK_MUTEX
    }
 
    void acceptNextConnection()
    {
+      // hand out connections to the io_services in turn (accepts are never
+      // concurrent so no lock is required here)
+      nextConnectionShard_ = nextShard_;
+      nextShard_ = (nextShard_ + 1) % shards_.size();
+
       ptrNextConnection_.reset(
                new AsyncConnectionImpl<typename ProtocolType::socket> (
 
          // controlling io_service
-         acceptorService_.ioService(),
+         shards_[nextConnectionShard_]->ioService,
 
          // optional ssl context - only used for SSL connections
          sslContext_,
@@ -363,7 +427,7 @@ private:
 
          // close handler
          boost::bind(&AsyncServerImpl<ProtocolType>::onConnectionClosed,
-                     this, _1),
+                     this, nextConnectionShard_, _1),
 
          // request filter
          boost::bind(&AsyncServerImpl<ProtocolType>::connectionRequestFilter,
@@ -393,7 +457,7 @@ private:
          if (!ec) 
          {
             boost::weak_ptr<AsyncConnectionImpl<typename ProtocolType::socket>> weak(ptrNextConnection_);
-            addConnection(weak);
+            addConnection(nextConnectionShard_, weak);
             ptrNextConnection_->startReading();
          }
          else
@@ -445,9 +509,10 @@ private:
          if (notFoundHandler_)
             pAsyncConnection->response().setNotFoundHandler(notFoundHandler_);
 
-         std::string uri = pRequest->uri();
-         AsyncUriHandler handler = uriHandlers_.handlerFor(uri);
-         boost::optional<AsyncUriHandlerFunctionVariant> handlerFunc = handler.function();
+         // route the request and remember the result for handleConnection
+         const AsyncUriHandler& handler = uriHandlers_.find(pRequest->uri());
+         pConnection->setUriHandler(&handler);
+         const boost::optional<AsyncUriHandlerFunctionVariant>& handlerFunc = handler.function();
 
          if (!handler.isProxyHandler())
          {
@@ -546,20 +611,25 @@ private:
          boost::shared_ptr<AsyncConnection> pAsyncConnection =
              boost::static_pointer_cast<AsyncConnection>(pConnection);
 
-         // call the appropriate handler to generate a response
-         std::string uri = pRequest->uri();
-         AsyncUriHandler handler = uriHandlers_.handlerFor(uri);
-         boost::optional<AsyncUriHandlerFunctionVariant> handlerFunc = handler.function();
+         // call the appropriate handler to generate a response (this was
+         // normally resolved when the headers were parsed)
+         const AsyncUriHandler* pHandler = pConnection->uriHandler();
+         if (!pHandler)
+            pHandler = &uriHandlers_.find(pRequest->uri());
+         pConnection->setUriHandler(nullptr);
 
-         // if no handler was assigned but we have a default, use it instead
-         if (!handlerFunc && defaultHandler_)
-            handlerFunc = defaultHandler_;
+         const boost::optional<AsyncUriHandlerFunctionVariant>& handlerFunc = pHandler->function();
 
-         // call handler if we have one
+         // call handler if we have one; if no handler was assigned but
+         // we have a default, use it instead
          if (handlerFunc)
          {
             visitHandler(handlerFunc.get(), pAsyncConnection);
          }
+         else if (defaultHandler_)
+         {
+            defaultHandler_(pAsyncConnection);
+         }
          else
          {
             // log error
@@ -731,9 +801,24 @@ private:
       pConnection->response().setStatusCode(http::status::NotFound);
    }
 
+   // the connections serviced by an io_service
+   struct ConnectionShard : boost::noncopyable
+   {
+      explicit ConnectionShard(boost::asio::io_service& ioService)
+         : ioService(ioService)
+      {
+      }
+
+      boost::asio::io_service& ioService;
+      boost::mutex mutex;
+      std::set<boost::weak_ptr<AsyncConnectionImpl<typename ProtocolType::socket> >> connections;
+   };
+
 private:
    boost::recursive_mutex mutex_;
    SocketAcceptorService<ProtocolType> acceptorService_;
+   std::vector<boost::shared_ptr<boost::asio::io_service> > ioServices_;
+   std::vector<boost::shared_ptr<boost::asio::io_service::work> > ioServiceWork_;
    bool abortOnResourceError_;
    std::string serverName_;
    std::string baseUri_;
@@ -742,7 +827,6 @@ private:
    Headers additionalResponseHeaders_;
    boost::shared_ptr<boost::asio::ssl::context> sslContext_;
    boost::shared_ptr<AsyncConnectionImpl<typename ProtocolType::socket> > ptrNextConnection_;
-   std::set<boost::weak_ptr<AsyncConnectionImpl<typename ProtocolType::socket> >> connections_;
    AsyncUriHandlers uriHandlers_;
    AsyncUriHandlerFunction defaultHandler_;
    std::vector<boost::shared_ptr<boost::thread> > threads_;
@@ -752,6 +836,10 @@ private:
    RequestFilter requestFilter_;
    ResponseFilter responseFilter_;
    NotFoundHandler notFoundHandler_;
+   bool ioServicePerThread_;
+   std::vector<boost::shared_ptr<ConnectionShard> > shards_;
+   std::size_t nextShard_;
+   std::size_t nextConnectionShard_;
    bool running_;
 };
 
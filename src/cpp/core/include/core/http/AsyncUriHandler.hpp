@@ -28,6 +28,7 @@
 
 #include <core/http/UriHandler.hpp>
 #include <core/http/AsyncConnection.hpp>
+#include <core/http/UriPrefixIndex.hpp>
 
 using namespace boost::placeholders;
 
@@ -97,7 +98,12 @@ public:
       return boost::algorithm::starts_with(uri, prefix_);
    }
 
-   boost::optional<AsyncUriHandlerFunctionVariant> function() const
+   const std::string& prefix() const
+   {
+      return prefix_;
+   }
+
+   const boost::optional<AsyncUriHandlerFunctionVariant>& function() const
    {
       return function_;
    }
@@ -148,13 +154,45 @@ class AsyncUriHandlers
    // COPYING: via compiler
 
 public:
+   AsyncUriHandlers() : frozen_(false) {}
+
    void add(AsyncUriHandler handler)
    {
+      // adding a handler invalidates any handler references handed out
       uriHandlers_.push_back(handler);
+
+      // a handler added once we're frozen (e.g. after the server starts
+      // running) would otherwise send every lookup back to the linear scan
+      if (frozen_)
+         freeze();
    }
 
-   AsyncUriHandler handlerFor(const std::string& uri) const
+   // compile the registered prefixes into a prefix trie; called once
+   // handler registration is complete (e.g. when the server starts running)
+   void freeze()
    {
+      frozen_ = true;
+
+      std::vector<std::string> prefixes;
+      prefixes.reserve(uriHandlers_.size());
+      for (const AsyncUriHandler& handler : uriHandlers_)
+         prefixes.push_back(handler.prefix());
+
+      index_.build(prefixes);
+   }
+
+   // returns the first registered handler matching the uri (or an empty
+   // handler if there is none). the returned reference remains valid
+   // until another handler is added
+   const AsyncUriHandler& find(const std::string& uri) const
+   {
+      if (!index_.empty())
+      {
+         std::size_t pos = index_.find(uri);
+         return pos != UriPrefixIndex::kNoMatch ? uriHandlers_[pos] : emptyHandler();
+      }
+
+      // not yet frozen; fall back to scanning the handlers in order
       std::vector<AsyncUriHandler>::const_iterator handler =
             std::find_if(
               uriHandlers_.begin(),
@@ -166,12 +204,31 @@ public:
       }
       else
       {
-         return AsyncUriHandler();
+         return emptyHandler();
       }
    }
 
+   AsyncUriHandler handlerFor(const std::string& uri) const
+   {
+      return find(uri);
+   }
+
+   // whether lookups use the compiled index (rather than a linear scan)
+   bool isIndexed() const
+   {
+      return !index_.empty();
+   }
+
 private:
+   static const AsyncUriHandler& emptyHandler()
+   {
+      static const AsyncUriHandler instance;
+      return instance;
+   }
+
    std::vector<AsyncUriHandler> uriHandlers_;
+   UriPrefixIndex index_;
+   bool frozen_;
 };
 
 } // namespace http
@@ -20,6 +20,7 @@
 
 #include <boost/function.hpp>
 #include <boost/optional.hpp>
+#include <boost/algorithm/string/predicate.hpp>
 
 #include <boost/asio/local/stream_protocol.hpp>
 
@@ -29,7 +30,9 @@
 #include <core/system/PosixUser.hpp>
 
 #include <core/http/AsyncClient.hpp>
+#include <core/http/LocalStreamConnectionPool.hpp>
 #include <core/http/LocalStreamSocketUtils.hpp>
+#include <core/http/Util.hpp>
 
 namespace rstudio {
 namespace core {
@@ -49,11 +52,27 @@ public:
                                                                 logToStderr),
        socket_(ioService),
        localStreamPath_(localStreamPath),
-       validateUid_(validateUid)
+       validateUid_(validateUid),
+       pooledConnection_(false)
    {
       setConnectionRetryProfile(retryProfile);
    }
 
+   // (optional) pool of kept alive connections to the stream: the request
+   // is made over an idle connection from the pool if there is one, and
+   // the connection is returned to the pool after a complete response
+   // (requires a server which honors 'Connection: keep-alive'). must be
+   // set prior to calling execute
+   void setConnectionPool(const boost::shared_ptr<LocalStreamConnectionPool>& pPool)
+   {
+      pPool_ = pPool;
+   }
+
+   virtual int nativeHandle()
+   {
+      return socket_.native_handle();
+   }
+
 protected:
 
    virtual boost::asio::local::stream_protocol::socket& socket()
@@ -65,6 +84,21 @@ private:
 
    virtual void connectAndWriteRequest()
    {
+      // use a kept alive connection if we can (it was validated when
+      // it was established)
+      if (pPool_ && requestKeepAlive())
+      {
+         boost::shared_ptr<LocalStreamConnectionPool::Socket> pSocket =
+               pPool_->acquire(localStreamPath_.getAbsolutePath(), ioService());
+         if (pSocket)
+         {
+            socket_ = std::move(*pSocket);
+            pooledConnection_ = true;
+            writeRequest();
+            return;
+         }
+      }
+
       // validate if requested
       if (validateUid_.is_initialized() && localStreamPath_.exists())
       {
@@ -110,6 +144,60 @@ private:
       return "localhost";
    }
 
+   virtual bool requestKeepAlive()
+   {
+      // uploads and upgrades write to (or take over) the connection
+      // beyond the request itself
+      return pPool_ &&
+             request().method() != "HEAD" &&
+             !util::isWSUpgradeRequest(request()) &&
+             request().headerValue("Content-Type").find("multipart/") != 0;
+   }
+
+   virtual bool stopReadingAndRespond()
+   {
+      // with the connection kept open the end of the response is
+      // indicated by its length rather than by the connection closing
+      return requestKeepAlive() &&
+             !chunkedEncoding_ &&
+             !response_.headerValue("Content-Length").empty() &&
+             response_.body().length() >= response_.contentLength();
+   }
+
+   virtual bool keepConnectionAlive()
+   {
+      return requestKeepAlive() &&
+             !chunkedEncoding_ &&
+             !boost::algorithm::iequals(response_.headerValue("Connection"), "close") &&
+             !response_.headerValue("Content-Length").empty() &&
+             response_.body().length() == response_.contentLength();
+   }
+
+   virtual void releaseConnection()
+   {
+      boost::shared_ptr<LocalStreamConnectionPool::Socket> pSocket(
+               new LocalStreamConnectionPool::Socket(std::move(socket_)));
+      pPool_->release(localStreamPath_.getAbsolutePath(), ioService(), pSocket);
+   }
+
+   virtual bool retryOnNewConnection()
+   {
+      // a kept alive connection may have been closed by the other end
+      // just as we wrote to it (the base class only asks us to retry if
+      // the request wasn't fully written, so the other end can't have
+      // acted on it)
+      if (!pooledConnection_)
+         return false;
+
+      pooledConnection_ = false;
+      boost::system::error_code ec;
+      socket_.close(ec);
+      pPool_->evict(localStreamPath_.getAbsolutePath());
+
+      connectAndWriteRequest();
+      return true;
+   }
+
    void handleConnect(const boost::system::error_code& ec)
    {
       try
@@ -140,6 +228,8 @@ private:
    boost::asio::local::stream_protocol::socket socket_;
    core::FilePath localStreamPath_;
    boost::optional<UidType> validateUid_;
+   boost::shared_ptr<LocalStreamConnectionPool> pPool_;
+   bool pooledConnection_;
 };
    
    
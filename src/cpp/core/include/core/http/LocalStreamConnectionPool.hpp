@@ -0,0 +1,104 @@
+/*
+ * LocalStreamConnectionPool.hpp
+ *
+ * Copyright (C) 2022 by RStudio, PBC
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef CORE_HTTP_LOCAL_STREAM_CONNECTION_POOL_HPP
+#define CORE_HTTP_LOCAL_STREAM_CONNECTION_POOL_HPP
+
+#include <deque>
+#include <map>
+#include <string>
+#include <utility>
+
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+namespace rstudio {
+namespace core {
+namespace http {
+
+// idle connections to local streams, kept alive after a response so that
+// subsequent requests to the same stream can skip connecting (and the
+// accept and validation of the connection at the other end). connections
+// are checked before being handed out: those which have been idle too long,
+// or which the other end has closed (e.g. because the process serving the
+// stream has exited), are closed and discarded. a connection is only handed
+// out to requests run by the io_service it was made with (as its handlers
+// are run by that io_service's threads).
+class LocalStreamConnectionPool : boost::noncopyable
+{
+public:
+   typedef boost::asio::local::stream_protocol::socket Socket;
+
+   explicit LocalStreamConnectionPool(
+         std::size_t maxIdlePerStream = 8,
+         const boost::posix_time::time_duration& maxIdleTime =
+                                             boost::posix_time::seconds(60));
+
+   // take an idle connection to a stream made with the given io_service;
+   // returns a null pointer if there are none (in which case a new
+   // connection should be made)
+   boost::shared_ptr<Socket> acquire(const std::string& streamPath,
+                                     boost::asio::io_service& ioService);
+
+   // return a connection made with the given io_service, having read the
+   // complete response to the last request made over it
+   void release(const std::string& streamPath,
+                boost::asio::io_service& ioService,
+                const boost::shared_ptr<Socket>& pSocket);
+
+   // close the idle connections to a stream, whichever io_service they were
+   // made with (e.g. once its process exits)
+   void evict(const std::string& streamPath);
+
+   // close the connections which have been idle too long
+   void evictExpired();
+
+   void clear();
+
+   std::size_t idleCount(const std::string& streamPath) const;
+   std::size_t idleCount() const;
+
+private:
+   struct IdleConnection
+   {
+      boost::shared_ptr<Socket> pSocket;
+      boost::posix_time::ptime idleSince;
+   };
+
+   typedef std::deque<IdleConnection> IdleConnections;
+
+   // idle connections are kept by stream and by io_service
+   typedef std::pair<std::string, boost::asio::io_service*> StreamKey;
+
+   void evictExpired(const boost::posix_time::ptime& now);
+
+   const std::size_t maxIdlePerStream_;
+   const boost::posix_time::time_duration maxIdleTime_;
+
+   mutable boost::mutex mutex_;
+   std::map<StreamKey, IdleConnections> idle_;
+   boost::posix_time::ptime lastEvicted_;
+};
+
+} // namespace http
+} // namespace core
+} // namespace rstudio
+
+#endif // CORE_HTTP_LOCAL_STREAM_CONNECTION_POOL_HPP
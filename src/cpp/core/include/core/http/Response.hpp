@@ -159,6 +159,10 @@ public:
    Headers getCookies(const std::vector<std::string>& names = {}) const;
    
    Error setBody(const std::string& content);
+
+   // takes ownership of the content rather than copying it through the
+   // stream filters (gzip encoding is still applied if requested)
+   Error setBody(std::string&& content);
    
    Error setCacheableBody(const std::string& content,
                           const Request& request)
@@ -22,6 +22,8 @@
 #include <boost/function.hpp>
 
 #include <boost/asio/buffer.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/socket_base.hpp>
 
 namespace rstudio {
 namespace core {
@@ -46,6 +48,21 @@ public:
                      Handler Handler) = 0;
 
    virtual void close() = 0;
+
+   // direct access to the underlying socket, so that data can be moved
+   // between sockets without copying it through user space (see SocketProxy).
+   // the native handle is -1 if this is not possible, e.g. because the data
+   // is encrypted before being written to the socket
+   virtual int nativeHandle()
+   {
+      return -1;
+   }
+
+   virtual void asyncWait(boost::asio::socket_base::wait_type waitType,
+                          Handler handler)
+   {
+      handler(boost::asio::error::operation_not_supported, 0);
+   }
 };
 
 } // namespace http
@@ -42,10 +42,18 @@ public:
                                                             ptrServer,
                                                             checkFunction,
                                                             closeFunction));
-      pProxy->readClient();
-      pProxy->readServer();
+
+      // move data directly between the sockets if we can, otherwise
+      // through our buffers
+      if (!pProxy->startSplicing())
+      {
+         pProxy->readClient();
+         pProxy->readServer();
+      }
    }
 
+   ~SocketProxy();
+
 private:
    SocketProxy(boost::shared_ptr<core::http::Socket> ptrClient,
                boost::shared_ptr<core::http::Socket> ptrServer,
@@ -59,6 +67,11 @@ private:
    void readClient();
    void readServer();
 
+   bool startSplicing();
+   void splice(bool fromClient);
+   void waitForSplice(bool fromClient, bool forWrite);
+   void handleSpliceWait(bool fromClient, const boost::system::error_code& e);
+
    void handleClientRead(const boost::system::error_code& e,
                          std::size_t bytesTransferred);
    void handleServerRead(const boost::system::error_code& e,
@@ -77,6 +90,14 @@ private:
    boost::shared_ptr<core::http::Socket> ptrServer_;
    boost::array<char, 8192> clientBuffer_;
    boost::array<char, 8192> serverBuffer_;
+
+   // when splicing, the pipes through which data is moved in each direction
+   // (and the number of bytes in each not yet written to the other socket)
+   int clientPipe_[2] = { -1, -1 };
+   int serverPipe_[2] = { -1, -1 };
+   std::size_t clientPipeBytes_ = 0;
+   std::size_t serverPipeBytes_ = 0;
+
    boost::recursive_mutex socketMutex_;
    boost::function<bool()> checkFunction_;
    boost::function<void()> closeFunction_;
@@ -50,6 +50,15 @@ public:
    {
    }
 
+   virtual int nativeHandle()
+   {
+#ifndef _WIN32
+      return socket_.native_handle();
+#else
+      return -1;
+#endif
+   }
+
 protected:
 
    virtual boost::asio::ip::tcp::socket& socket()
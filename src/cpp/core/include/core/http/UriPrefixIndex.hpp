@@ -0,0 +1,76 @@
+/*
+ * UriPrefixIndex.hpp
+ *
+ * Copyright (C) 2022 by RStudio, PBC
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef CORE_HTTP_URI_PREFIX_INDEX_HPP
+#define CORE_HTTP_URI_PREFIX_INDEX_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace rstudio {
+namespace core {
+namespace http {
+
+// compiled prefix trie used to route uris to handlers. the index is built
+// once from the registered prefixes and then answers "which is the first
+// registered prefix that the uri starts with" in a single pass over the uri,
+// which matches the semantics of the linear starts_with scan it replaces
+//
+// the trie is flattened into contiguous arrays (children of a node are
+// stored adjacently and sorted by label) so lookups touch very little memory
+// and the index can be shared read-only between threads
+class UriPrefixIndex
+{
+public:
+   static const std::size_t kNoMatch;
+
+   UriPrefixIndex() {}
+
+   // COPYING: via compiler
+
+   // (re)build the index; positions in the vector are the values returned
+   // by find (lower positions win when several prefixes match)
+   void build(const std::vector<std::string>& prefixes);
+
+   void clear();
+
+   bool empty() const { return nodes_.empty(); }
+
+   // returns the position of the first registered prefix matching the uri,
+   // or kNoMatch if none does
+   std::size_t find(const std::string& uri) const;
+
+private:
+   struct Node
+   {
+      Node() : firstChild(0), childCount(0), value(kNoMatch) {}
+
+      std::size_t firstChild;
+      std::size_t childCount;
+      std::size_t value;
+   };
+
+   std::size_t findChild(const Node& node, char label) const;
+
+   std::vector<Node> nodes_;
+   std::vector<char> labels_;
+};
+
+} // namespace http
+} // namespace core
+} // namespace rstudio
+
+#endif // CORE_HTTP_URI_PREFIX_INDEX_HPP
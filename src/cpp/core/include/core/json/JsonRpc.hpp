@@ -401,6 +401,9 @@ public:
 
    void setField(const std::string& name, const Value& value)
    { 
+      if (name == json::kRpcResult)
+         writeResult_.clear();
+
       response_[name] = value;
    }
    
@@ -424,8 +427,14 @@ public:
    // low level hook to set the full response
    void setResponse(const Object& response)
    {
+      writeResult_.clear();
       response_ = response;
    }
+
+   // stream the result directly into the serialized response when it is
+   // written rather than materializing it as a json::Value first (used for
+   // large results, which would otherwise be copied several times)
+   void setStreamedResult(const boost::function<void(StreamWriter&)>& writeResult);
    
    // specify a function to run after the response
    void setAfterResponse(const boost::function<void()>& afterResponse);
@@ -442,6 +451,8 @@ public:
    
    void write(std::ostream& os) const;
 
+   void write(StreamWriter& writer) const;
+
    static bool parse(const std::string& input,
                      JsonRpcResponse* pResponse);
 
@@ -450,6 +461,7 @@ public:
    
 private:
    Object response_;
+   boost::function<void(StreamWriter&)> writeResult_;
    boost::function<void()> afterResponse_;
    bool suppressDetectChanges_;
 };
@@ -30,6 +30,7 @@
 #include <shared_core/SafeConvert.hpp>
 #include <core/StringUtils.hpp>
 #include <core/RegexUtils.hpp>
+#include <core/Thread.hpp>
 
 #include <core/r_util/RTokenizer.hpp>
 #include <core/r_util/RFunctionInformation.hpp>
@@ -198,6 +199,11 @@ public:
    RSourceIndex(const std::string& context,
                 const std::string& code);
 
+   // Recreate a previously computed index (e.g. from RSourceIndexCache)
+   RSourceIndex(const std::string& context,
+                const std::vector<RSourceItem>& items,
+                const std::vector<std::string>& inferredPackages);
+
    const std::string& context() const { return context_; }
 
    template <typename OutputIterator>
@@ -296,12 +302,19 @@ private:
    
 public:
 
-   static const std::set<std::string>& getAllInferredPackages()
+   // returns a copy since indexes may be built on background threads
+   static std::set<std::string> getAllInferredPackages()
    {
-      return allInferredPkgNames();
+      LOCK_MUTEX(inferredPkgNamesMutex())
+      {
+         return allInferredPkgNames();
+      }
+      END_LOCK_MUTEX
+
+      return std::set<std::string>();
    }
 
-   const std::vector<std::string>& getInferredPackages()
+   const std::vector<std::string>& getInferredPackages() const
    {
       return inferredPkgNames_;
    }
@@ -366,33 +379,45 @@ public:
    static std::vector<std::string> getAllUnindexedPackages()
    {
       std::vector<std::string> result;
-      typedef std::set<std::string>::const_iterator iterator_t;
-      for (iterator_t it = allInferredPkgNames().begin();
-           it != allInferredPkgNames().end();
-           ++it)
+      LOCK_MUTEX(inferredPkgNamesMutex())
       {
-         if (allInferredPkgNames().count(*it) == 0)
-            result.push_back(*it);
+         typedef std::set<std::string>::const_iterator iterator_t;
+         for (iterator_t it = allInferredPkgNames().begin();
+              it != allInferredPkgNames().end();
+              ++it)
+         {
+            if (allInferredPkgNames().count(*it) == 0)
+               result.push_back(*it);
+         }
       }
+      END_LOCK_MUTEX
       return result;
    }
 
    void addInferredPackage(const std::string& packageName)
    {
       inferredPkgNames_.push_back(packageName);
-      allInferredPkgNames().insert(packageName);
+      addGloballyInferredPackage(packageName);
    }
    
    static void addGloballyInferredPackage(const std::string& pkgName)
    {
-      allInferredPkgNames().insert(pkgName);
+      LOCK_MUTEX(inferredPkgNamesMutex())
+      {
+         allInferredPkgNames().insert(pkgName);
+      }
+      END_LOCK_MUTEX
    }
    
    static void setImportedPackages(const std::set<std::string>& pkgNames)
    {
       importedPackages().clear();
       importedPackages().insert(pkgNames.begin(), pkgNames.end());
-      allInferredPkgNames().insert(pkgNames.begin(), pkgNames.end());
+      LOCK_MUTEX(inferredPkgNamesMutex())
+      {
+         allInferredPkgNames().insert(pkgNames.begin(), pkgNames.end());
+      }
+      END_LOCK_MUTEX
    }
    
    static const std::set<std::string>& getImportedPackages()
@@ -407,7 +432,7 @@ public:
       importFromDirectives() = map;
       for (const std::string& pkg : map | boost::adaptors::map_keys)
       {
-         allInferredPkgNames().insert(pkg);
+         addGloballyInferredPackage(pkg);
       }
    }
    
@@ -453,6 +478,13 @@ private:
       static std::set<std::string> instance;
       return instance;
    }
+
+   // guards allInferredPkgNames (indexes are built on background threads)
+   static boost::mutex& inferredPkgNamesMutex()
+   {
+      static boost::mutex instance;
+      return instance;
+   }
    
    // NOTE: All source indexes share a set of completions
    static std::map<std::string, PackageInformation>& packageInformation()
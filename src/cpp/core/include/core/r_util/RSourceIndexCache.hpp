@@ -0,0 +1,122 @@
+/*
+ * RSourceIndexCache.hpp
+ *
+ * Copyright (C) 2022 by RStudio, PBC
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef CORE_R_UTIL_R_SOURCE_INDEX_CACHE_HPP
+#define CORE_R_UTIL_R_SOURCE_INDEX_CACHE_HPP
+
+#include <cstdint>
+#include <ctime>
+#include <map>
+#include <set>
+#include <string>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/utility.hpp>
+
+#include <core/FileInfo.hpp>
+#include <core/r_util/RSourceIndex.hpp>
+
+namespace boost {
+namespace iostreams {
+class mapped_file_source;
+} // namespace iostreams
+} // namespace boost
+
+namespace rstudio {
+namespace core {
+
+class Error;
+class FilePath;
+
+namespace r_util {
+
+// on-disk cache of source indexes, so that the symbol index of a project is
+// available when a session starts without re-tokenizing every file. entries
+// are keyed by path and validated by modification time and size; when those
+// have changed (e.g. the file was touched by a checkout) the content hash
+// still allows the cached index to be used once the file has been read.
+//
+// the cache file is memory mapped when read and entries are only decoded
+// when first looked up
+class RSourceIndexCache : boost::noncopyable
+{
+public:
+   RSourceIndexCache();
+   ~RSourceIndexCache();
+
+   // read the cache from a file; caches written with a different build id
+   // (or in an older format) are ignored
+   Error read(const FilePath& cacheFile, const std::string& buildId);
+
+   // write the cache to a file (atomically replacing any existing one)
+   Error write(const FilePath& cacheFile, const std::string& buildId);
+
+   // index for a file whose modification time and size are unchanged
+   boost::shared_ptr<RSourceIndex> find(const FileInfo& fileInfo);
+
+   // index for a file whose contents are unchanged
+   boost::shared_ptr<RSourceIndex> find(const std::string& absolutePath,
+                                        uint32_t contentHash);
+
+   // cached index for a file (and the hash of the contents it was built
+   // from), to be validated by the caller
+   boost::shared_ptr<RSourceIndex> get(const std::string& absolutePath,
+                                       uint32_t* pContentHash);
+
+   void update(const FileInfo& fileInfo,
+               uint32_t contentHash,
+               const boost::shared_ptr<RSourceIndex>& pIndex);
+
+   void remove(const std::string& absolutePath);
+
+   // remove entries for files that no longer exist
+   void removeAllExcept(const std::set<std::string>& absolutePaths);
+
+   void clear();
+
+   std::size_t size() const { return entries_.size(); }
+
+   // have entries changed since the cache was last read or written
+   bool dirty() const { return dirty_; }
+
+   static uint32_t contentHash(const std::string& code);
+
+private:
+   struct Entry
+   {
+      Entry() : lastWriteTime(0), size(0), contentHash(0), dataOffset(0), dataLength(0) {}
+
+      std::time_t lastWriteTime;
+      uintmax_t size;
+      uint32_t contentHash;
+
+      // decoded index; null until looked up if the entry was read from disk
+      boost::shared_ptr<RSourceIndex> pIndex;
+      std::size_t dataOffset;
+      std::size_t dataLength;
+   };
+
+   boost::shared_ptr<RSourceIndex> decode(Entry* pEntry);
+
+   std::map<std::string, Entry> entries_;
+   boost::shared_ptr<boost::iostreams::mapped_file_source> pMappedFile_;
+   bool dirty_;
+};
+
+} // namespace r_util
+} // namespace core
+} // namespace rstudio
+
+#endif // CORE_R_UTIL_R_SOURCE_INDEX_CACHE_HPP
@@ -115,7 +115,9 @@ private:
    
 public:
    
-   // TODO: May be worthwhile to implement binary search here.
+   // Move to the last token starting at or before a position (as tokens
+   // are ordered by position, this is a binary search). Fails if the
+   // position lies within or after the last token.
    bool moveToPosition(const Position& destination)
    {
       std::size_t n = n_;
@@ -123,18 +125,23 @@ public:
       if (n == 0)
          return false;
       
-      std::size_t offset = 1;
-      while (offset < n)
+      // find the first token (after the first) starting after the position
+      std::size_t lower = 1;
+      std::size_t upper = n;
+      while (lower < upper)
       {
-         if (destination < rTokens_.atUnsafe(offset).position())
-         {
-            offset_ = offset - 1;
-            return true;
-         }
-         ++offset;
+         std::size_t middle = lower + (upper - lower) / 2;
+         if (destination < rTokens_.atUnsafe(middle).position())
+            upper = middle;
+         else
+            lower = middle + 1;
       }
       
-      return false;
+      if (lower == n)
+         return false;
+      
+      offset_ = lower - 1;
+      return true;
    }
    
    bool moveToPosition(std::size_t row, std::size_t column)
@@ -30,6 +30,7 @@
 #include <boost/utility.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/regex.hpp>
+#include <boost/utility/string_view.hpp>
 
 #include <core/Macros.hpp>
 
@@ -169,10 +170,17 @@ public:
    }
 
 private:
-   std::wstring emptyToken_;
+   // default tokens refer to a shared empty string rather than carrying
+   // their own
+   static const std::wstring& emptyContent()
+   {
+      static const std::wstring instance;
+      return instance;
+   }
+
    TokenType type_ = TokenType::ERR;
-   std::wstring::const_iterator begin_ = emptyToken_.cbegin();
-   std::wstring::const_iterator end_ = emptyToken_.cend();
+   std::wstring::const_iterator begin_ = emptyContent().cbegin();
+   std::wstring::const_iterator end_ = emptyContent().cend();
    std::size_t offset_ = -1;
    std::size_t row_ = 0;
    std::size_t column_ = 0;
@@ -201,23 +209,21 @@ public:
 
    RToken nextToken();
 
+   // resume tokenizing from a token boundary; the caller supplies the
+   // position of the boundary and the brackets open there
+   void resume(std::size_t offset,
+               std::size_t row,
+               std::size_t column,
+               const std::vector<char>& braceStack);
+
+   const std::wstring& data() const { return data_; }
+   std::size_t offset() const { return pos_ - begin_; }
+   std::size_t row() const { return row_; }
+   std::size_t column() const { return column_; }
+   const std::vector<char>& braceStack() const { return braceStack_; }
+
 private:
-   Error matchRawStringLiteral(RToken* pToken);
-   
-   RToken matchWhitespace();
-   RToken matchNumber();
-   RToken matchIdentifier();
-   RToken matchComment();
-   RToken matchDelimited();
-   RToken matchUserOperator();
-   RToken matchKnitrEmbeddedChunk();
-   RToken matchOperator();
    bool eol();
-   wchar_t peek();
-   wchar_t peek(int lookahead);
-   wchar_t eat();
-   std::size_t tokenLength(const boost::wregex& regex);
-   void eatUntil(const boost::wregex& regex);
    RToken consumeToken(RToken::TokenType tokenType, std::size_t length);
    
 private:
@@ -230,6 +236,73 @@ private:
    std::vector<char> braceStack_; // needed for tokenization of `[[`, `[`
 };
 
+// A token yielded by RUtf8Tokenizer. Rather than iterators into the source,
+// the token records its type and the byte offset and length of its content,
+// so it is only 12 bytes and remains valid when the tokens are copied or
+// moved. Content and positions are resolved against the source code.
+class RCompactToken final
+{
+public:
+   RCompactToken()
+      : offset_(0), length_(0), type_(RToken::ERR)
+   {
+   }
+
+   RCompactToken(RToken::TokenType type, std::size_t offset, std::size_t length)
+      : offset_(static_cast<uint32_t>(offset)),
+        length_(static_cast<uint32_t>(length)),
+        type_(type)
+   {
+   }
+
+   RToken::TokenType type() const { return type_; }
+   std::size_t offset() const { return offset_; }
+   std::size_t length() const { return length_; }
+
+   bool isType(RToken::TokenType type) const
+   {
+      return type_ == type;
+   }
+
+   boost::string_view content(boost::string_view code) const
+   {
+      return code.substr(offset_, length_);
+   }
+
+   // allow direct use in conditional statements (nullability)
+   explicit operator bool() const
+   {
+      return length_ != 0;
+   }
+
+private:
+   uint32_t offset_;
+   uint32_t length_;
+   RToken::TokenType type_;
+};
+
+// Tokenize UTF-8 encoded R code in place, yielding the same tokens as
+// RTokenizer does for the equivalent wide string (with offsets and lengths
+// in bytes rather than characters). The code is not copied, so it must
+// outlive the tokenizer. Sources larger than 4GB are not supported.
+class RUtf8Tokenizer : boost::noncopyable
+{
+public:
+   explicit RUtf8Tokenizer(boost::string_view code)
+      : code_(code),
+        pos_(0)
+   {
+   }
+
+   // COPYING: boost::noncopyable
+
+   RCompactToken nextToken();
+
+private:
+   boost::string_view code_;
+   std::size_t pos_;
+   std::vector<char> braceStack_; // needed for tokenization of `[[`, `[`
+};
 
 // Set of RTokens. Note that the RTokens returned from the set
 // are conceptually iterators so are only valid for the lifetime of
@@ -275,19 +348,26 @@ public:
    const_iterator end() const { return tokens_.end(); }
    
    explicit RTokens(const std::wstring& code, int flags = None)
-      : tokenizer_(code)
+      : tokenizer_(code), flags_(flags)
    {
       while (RToken token = tokenizer_.nextToken())
       {
-         if ((flags & StripWhitespace) && token.type() == RToken::WHITESPACE)
-            continue;
-
-         if ((flags & StripComments) && token.type() == RToken::COMMENT)
-            continue;
-
-         push_back(token);
+         if (!isStripped(token))
+            push_back(token);
       }
    }
+
+   // Tokenize code that differs from the code of a previous set of tokens
+   // only after its first 'prefixLength' and before its last 'suffixLength'
+   // characters (as after an edit). Only the changed region is re-tokenized;
+   // the tokens on either side of it are reused from 'previous'.
+   RTokens(const std::wstring& code,
+           const RTokens& previous,
+           std::size_t prefixLength,
+           std::size_t suffixLength,
+           int flags = None);
+
+   const std::wstring& code() const { return tokenizer_.data(); }
    
    friend std::ostream& operator <<(std::ostream& os,
                                     const RTokens& rTokens)
@@ -298,11 +378,68 @@ public:
    }
 
 private:
+   bool isStripped(const RToken& token) const
+   {
+      return ((flags_ & StripWhitespace) && token.type() == RToken::WHITESPACE) ||
+             ((flags_ & StripComments) && token.type() == RToken::COMMENT);
+   }
+
     RTokenizer tokenizer_;
+    int flags_;
     Tokens tokens_;
     RToken dummyToken_;
 };
 
+// Set of RCompactTokens for UTF-8 encoded code. As with RUtf8Tokenizer the
+// code is not copied, so it must outlive the tokens.
+class RCompactTokens
+{
+   typedef std::vector<RCompactToken> Tokens;
+
+public:
+
+   explicit RCompactTokens(boost::string_view code, int flags = RTokens::None);
+
+   std::size_t size() const { return tokens_.size(); }
+   bool empty() const { return tokens_.empty(); }
+
+   // Safe 'at' method that returns a dummy token if
+   // an out of bounds offset is specified.
+   const RCompactToken& at(std::size_t offset) const
+   {
+      if (UNLIKELY(offset >= tokens_.size()))
+         return dummyToken_;
+      return tokens_[offset];
+   }
+
+   const RCompactToken& atUnsafe(std::size_t offset) const
+   {
+      return tokens_[offset];
+   }
+
+   typedef Tokens::const_iterator const_iterator;
+
+   const_iterator begin() const { return tokens_.begin(); }
+   const_iterator end() const { return tokens_.end(); }
+
+   boost::string_view code() const { return code_; }
+
+   boost::string_view content(const RCompactToken& token) const
+   {
+      return token.content(code_);
+   }
+
+   // the row and column of a token (the column counts characters rather
+   // than bytes, as for RToken)
+   core::collection::Position position(const RCompactToken& token) const;
+
+private:
+   boost::string_view code_;
+   Tokens tokens_;
+   std::vector<std::size_t> lineOffsets_;
+   RCompactToken dummyToken_;
+};
+
 namespace token_utils {
 
 inline bool isBinaryOp(const RToken& token)
@@ -212,8 +212,18 @@ public:
       }
    }
 
-   // poll for input and exit status
-   void poll();
+   // poll for input and exit status. if the process is having its events
+   // watched (see below) then pass whether any were reported since the last
+   // poll, as output and exit status are only checked for when they were
+   void poll(bool hasEvents = true);
+
+#ifndef _WIN32
+   // report output and exit as readable events on the given epoll instance
+   // (tagged with id). returns false if this isn't supported (e.g. not on
+   // linux, or on kernels without pidfd), in which case every poll must
+   // check for output and exit
+   bool watchEvents(int epollFd, uint64_t id);
+#endif
 
    // has it exited?
    virtual bool exited();
@@ -228,6 +238,8 @@ public:
 
 private:
 
+   void pollSubprocs(bool hasRecentOutput);
+
    void reportError(const Error& error)
    {
       if (callbacks_.onError)
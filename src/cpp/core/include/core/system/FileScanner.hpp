@@ -39,12 +39,22 @@ namespace system {
 struct FileScannerOptions
 {
    FileScannerOptions()
-      : recursive(false), yield(false)
+      : recursive(false), yield(false), sort(true), threads(1)
    {
    }
 
    bool recursive;
    bool yield;
+
+   // sort the entries of each directory by name (note that the file
+   // monitors rely on sorted trees)
+   bool sort;
+
+   // number of threads to scan with (recursive scans only). filter and
+   // onBeforeScanDir are never called concurrently, but may be called from
+   // threads other than the caller's
+   std::size_t threads;
+
    boost::function<bool(const FileInfo&)> filter;
    boost::function<Error(const FileInfo&)> onBeforeScanDir;
 };
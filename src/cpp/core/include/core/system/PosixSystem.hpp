@@ -251,8 +251,20 @@ std::vector<SubprocInfo> getSubprocessesViaPgrep(PidType pid);
 // subprocesses or unable to determine if there are subprocesses
 #ifndef __APPLE__
 std::vector<SubprocInfo> getSubprocessesViaProcFs(PidType pid);
+
+// Detect subprocesses via a snapshot of the process table (read via procfs)
+// which is shared by all callers, and re-read only when older than maxAge
+std::vector<SubprocInfo> getSubprocessesViaProcFsSnapshot(
+      PidType pid,
+      const boost::posix_time::time_duration& maxAge);
 #endif // !__APPLE__
 
+// Detect subprocesses, accepting results up to maxAge old; used when polling
+// many processes for subprocesses so they needn't each read the process table
+std::vector<SubprocInfo> getSubprocessesFromSnapshot(
+      PidType pid,
+      const boost::posix_time::time_duration& maxAge);
+
 #ifdef __APPLE__
 // Detect current working directory via Mac-only APIs.
 // Note that this will only work reliably for child processes.
@@ -203,14 +203,57 @@ void JsonRpcResponse::runAfterResponse()
       afterResponse_();
 }
    
+void JsonRpcResponse::setStreamedResult(
+                           const boost::function<void(StreamWriter&)>& writeResult)
+{
+   // keep a placeholder so the result retains its position in the response
+   setResult(Value());
+   writeResult_ = writeResult;
+}
+
 Object JsonRpcResponse::getRawResponse()
 {
-   return response_;
+   if (!writeResult_)
+      return response_;
+
+   // materialize the streamed result
+   std::ostringstream ostr;
+   write(ostr);
+
+   Object response;
+   Error error = response.parse(ostr.str());
+   if (error)
+      LOG_ERROR(error);
+
+   return response;
 }
    
 void JsonRpcResponse::write(std::ostream& os) const
 {
-   response_.write(os);
+   std::string output;
+   StreamWriter writer(&output);
+   write(writer);
+   os << output;
+}
+
+void JsonRpcResponse::write(StreamWriter& writer) const
+{
+   if (!writeResult_)
+   {
+      writer.write(response_);
+      return;
+   }
+
+   writer.startObject();
+   for (const Object::Member& member : response_)
+   {
+      writer.key(member.getName());
+      if (member.getName() == json::kRpcResult)
+         writeResult_(writer);
+      else
+         writer.write(member.getValue());
+   }
+   writer.endObject();
 }
    
 void JsonRpcResponse::setError(const Error& error,
@@ -343,10 +386,11 @@ void setJsonRpcResponse(const JsonRpcResponse& jsonRpcResponse,
    if (pResponse->contentType().empty())
        pResponse->setContentType(json::kJsonContentType);
    
-   // set body 
-   std::stringstream responseStream;
-   jsonRpcResponse.write(responseStream);
-   Error error = pResponse->setBody(responseStream);
+   // set body (serialized straight into the buffer that becomes the body)
+   std::string body;
+   StreamWriter writer(&body);
+   jsonRpcResponse.write(writer);
+   Error error = pResponse->setBody(std::move(body));
    
    // report error to client if one occurred
    if (error)
@@ -16,8 +16,18 @@
 
 #include <tests/TestThat.hpp>
 
+#include <chrono>
+#include <iostream>
+
+#include <sys/resource.h>
+
+#include <boost/bind/bind.hpp>
+
+#include <core/http/Response.hpp>
 #include <core/json/JsonRpc.hpp>
 
+using namespace boost::placeholders;
+
 namespace rstudio {
 namespace core {
 namespace tests {
@@ -79,6 +89,18 @@ json::Value createValue()
 
 json::Object s_object;
 
+void writeStreamedResult(const json::Value& value, json::StreamWriter& writer)
+{
+   writer.write(value);
+}
+
+long peakRssKb()
+{
+   struct rusage usage;
+   ::getrusage(RUSAGE_SELF, &usage);
+   return usage.ru_maxrss;
+}
+
 } // anonymous namespace
 
 
@@ -350,6 +372,93 @@ TEST_CASE("JsonRpc")
       json::JsonRpcResponse jsonRpcResponse;
       jsonRpcResponse.setResult(root);
    }
+
+   SECTION("Streamed results are written in place of the result field")
+   {
+      json::Object object = createObject();
+
+      json::JsonRpcResponse materialized;
+      materialized.setResult(object);
+      materialized.setField("extra", "value");
+
+      json::JsonRpcResponse streamed;
+      streamed.setStreamedResult(boost::bind(writeStreamedResult, object, _1));
+      streamed.setField("extra", "value");
+
+      std::ostringstream materializedStream, streamedStream;
+      materialized.write(materializedStream);
+      streamed.write(streamedStream);
+      REQUIRE(materializedStream.str() == streamedStream.str());
+      REQUIRE(streamed.getRawResponse().write() == materialized.getRawResponse().write());
+
+      // setting a result explicitly replaces the streamed one
+      streamed.setResult(1);
+      REQUIRE(streamed.getRawResponse()[json::kRpcResult].getInt() == 1);
+   }
+
+   SECTION("Responses are serialized into the http body")
+   {
+      json::JsonRpcResponse jsonRpcResponse;
+      jsonRpcResponse.setResult(createObject());
+
+      http::Response response;
+      json::setJsonRpcResponse(jsonRpcResponse, &response);
+
+      std::ostringstream expected;
+      jsonRpcResponse.write(expected);
+      REQUIRE(response.body() == expected.str());
+      REQUIRE(response.contentLength() == static_cast<int>(expected.str().size()));
+   }
+}
+
+TEST_CASE("JsonRpc response serialization benchmark", "[.benchmark]")
+{
+   const int kElements = 500000;
+
+   json::Array result;
+   for (int i = 0; i < kElements; ++i)
+      result.push_back("/home/user/project/R/file" + std::to_string(i) + ".R");
+
+   json::JsonRpcResponse jsonRpcResponse;
+   jsonRpcResponse.setResult(result);
+
+   // the streaming path runs first since peak RSS can only grow
+   long rssBefore = peakRssKb();
+   auto start = std::chrono::steady_clock::now();
+   std::size_t streamedSize = 0;
+   {
+      http::Response response;
+      json::setJsonRpcResponse(jsonRpcResponse, &response);
+      streamedSize = response.body().size();
+   }
+   auto streamed = std::chrono::steady_clock::now() - start;
+   long rssStreamed = peakRssKb();
+
+   // previous implementation: serialize to a string stream, then copy
+   // through the response's stream filters
+   start = std::chrono::steady_clock::now();
+   std::size_t bufferedSize = 0;
+   {
+      http::Response response;
+      std::stringstream responseStream;
+      responseStream << jsonRpcResponse.getRawResponse().write();
+      Error error = response.setBody(responseStream);
+      REQUIRE_FALSE(error);
+      bufferedSize = response.body().size();
+   }
+   auto buffered = std::chrono::steady_clock::now() - start;
+   long rssBuffered = peakRssKb();
+
+   std::cout << "json rpc response of " << streamedSize << " bytes: "
+             << "streamed "
+             << std::chrono::duration_cast<std::chrono::milliseconds>(streamed).count() << "ms "
+             << "(peak rss +" << (rssStreamed - rssBefore) << "kb), "
+             << "buffered "
+             << std::chrono::duration_cast<std::chrono::milliseconds>(buffered).count() << "ms "
+             << "(peak rss +" << (rssBuffered - rssBefore) << "kb)"
+             << std::endl;
+
+   REQUIRE(streamedSize == bufferedSize);
 }
 
 } // namespace tests
@@ -644,6 +644,16 @@ RSourceIndex::RSourceIndex(const std::string& context, const std::string& code)
    
 }
 
+RSourceIndex::RSourceIndex(const std::string& context,
+                           const std::vector<RSourceItem>& items,
+                           const std::vector<std::string>& inferredPackages)
+   : context_(context),
+     items_(items)
+{
+   for (const std::string& packageName : inferredPackages)
+      addInferredPackage(packageName);
+}
+
 } // namespace r_util
 } // namespace core 
 } // namespace rstudio
@@ -0,0 +1,434 @@
+/*
+ * RSourceIndexCache.cpp
+ *
+ * Copyright (C) 2022 by RStudio, PBC
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/r_util/RSourceIndexCache.hpp>
+
+#include <cstring>
+
+#include <boost/crc.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+
+#include <core/FileSerializer.hpp>
+#include <core/Log.hpp>
+
+#include <shared_core/Error.hpp>
+#include <shared_core/FilePath.hpp>
+
+namespace rstudio {
+namespace core {
+namespace r_util {
+
+namespace {
+
+// the file is written in host byte order (it lives in per-user scratch
+// storage); bump the format version whenever the layout changes
+const uint32_t kCacheMagic = 0x58444953; // "SIDX"
+const uint32_t kCacheFormatVersion = 1;
+
+class CacheWriter
+{
+public:
+   explicit CacheWriter(std::string* pBuffer) : pBuffer_(pBuffer) {}
+
+   template <typename T>
+   void write(T value)
+   {
+      pBuffer_->append(reinterpret_cast<const char*>(&value), sizeof(T));
+   }
+
+   void write(const std::string& value)
+   {
+      write(static_cast<uint32_t>(value.size()));
+      pBuffer_->append(value);
+   }
+
+   // reserve space for a length to be filled in by endBlock
+   std::size_t beginBlock()
+   {
+      write(static_cast<uint32_t>(0));
+      return pBuffer_->size();
+   }
+
+   void endBlock(std::size_t start)
+   {
+      uint32_t length = static_cast<uint32_t>(pBuffer_->size() - start);
+      std::memcpy(&(*pBuffer_)[start - sizeof(uint32_t)], &length, sizeof(uint32_t));
+   }
+
+private:
+   std::string* pBuffer_;
+};
+
+// bounds checked reader over (memory mapped) cache data; any read past the
+// end marks the reader as failed and yields empty values
+class CacheReader
+{
+public:
+   CacheReader(const char* pData, std::size_t length)
+      : pos_(pData), end_(pData + length), failed_(false)
+   {
+   }
+
+   template <typename T>
+   T read()
+   {
+      T value = T();
+      if (remaining() < sizeof(T))
+      {
+         failed_ = true;
+         return value;
+      }
+
+      std::memcpy(&value, pos_, sizeof(T));
+      pos_ += sizeof(T);
+      return value;
+   }
+
+   std::string readString()
+   {
+      uint32_t length = read<uint32_t>();
+      if (remaining() < length)
+      {
+         failed_ = true;
+         return std::string();
+      }
+
+      std::string value(pos_, length);
+      pos_ += length;
+      return value;
+   }
+
+   const char* skip(std::size_t length)
+   {
+      if (remaining() < length)
+      {
+         failed_ = true;
+         return pos_;
+      }
+
+      const char* pStart = pos_;
+      pos_ += length;
+      return pStart;
+   }
+
+   bool failed() const { return failed_; }
+   bool atEnd() const { return pos_ == end_; }
+
+private:
+   std::size_t remaining() const
+   {
+      return failed_ ? 0 : static_cast<std::size_t>(end_ - pos_);
+   }
+
+   const char* pos_;
+   const char* end_;
+   bool failed_;
+};
+
+void writeIndex(const RSourceIndex& index, CacheWriter* pWriter)
+{
+   pWriter->write(index.context());
+
+   const std::vector<std::string>& packages = index.getInferredPackages();
+   pWriter->write(static_cast<uint32_t>(packages.size()));
+   for (const std::string& package : packages)
+      pWriter->write(package);
+
+   pWriter->write(static_cast<uint32_t>(index.items().size()));
+   for (const RSourceItem& item : index.items())
+   {
+      pWriter->write(static_cast<int32_t>(item.type()));
+      pWriter->write(item.name());
+      pWriter->write(static_cast<uint32_t>(item.signature().size()));
+      for (const RS4MethodParam& param : item.signature())
+      {
+         pWriter->write(param.name());
+         pWriter->write(param.type());
+      }
+      pWriter->write(static_cast<int32_t>(item.braceLevel()));
+      pWriter->write(static_cast<int32_t>(item.line()));
+      pWriter->write(static_cast<int32_t>(item.column()));
+      pWriter->write(static_cast<uint8_t>(item.hidden()));
+   }
+}
+
+boost::shared_ptr<RSourceIndex> readIndex(CacheReader* pReader)
+{
+   std::string context = pReader->readString();
+
+   uint32_t packageCount = pReader->read<uint32_t>();
+   std::vector<std::string> packages;
+   for (uint32_t i = 0; i < packageCount && !pReader->failed(); ++i)
+      packages.push_back(pReader->readString());
+
+   uint32_t itemCount = pReader->read<uint32_t>();
+   std::vector<RSourceItem> items;
+   for (uint32_t i = 0; i < itemCount && !pReader->failed(); ++i)
+   {
+      int type = pReader->read<int32_t>();
+      std::string name = pReader->readString();
+
+      uint32_t paramCount = pReader->read<uint32_t>();
+      std::vector<RS4MethodParam> signature;
+      for (uint32_t j = 0; j < paramCount && !pReader->failed(); ++j)
+      {
+         std::string paramName = pReader->readString();
+         std::string paramType = pReader->readString();
+         signature.push_back(RS4MethodParam(paramName, paramType));
+      }
+
+      int braceLevel = pReader->read<int32_t>();
+      int line = pReader->read<int32_t>();
+      int column = pReader->read<int32_t>();
+      bool hidden = pReader->read<uint8_t>() != 0;
+
+      items.push_back(RSourceItem(type, name, signature, braceLevel, line, column, hidden));
+   }
+
+   if (pReader->failed())
+      return boost::shared_ptr<RSourceIndex>();
+
+   return boost::shared_ptr<RSourceIndex>(new RSourceIndex(context, items, packages));
+}
+
+} // anonymous namespace
+
+RSourceIndexCache::RSourceIndexCache()
+   : dirty_(false)
+{
+}
+
+RSourceIndexCache::~RSourceIndexCache()
+{
+}
+
+Error RSourceIndexCache::read(const FilePath& cacheFile, const std::string& buildId)
+{
+   clear();
+
+   if (!cacheFile.exists() || cacheFile.getSize() == 0)
+      return Success();
+
+   boost::shared_ptr<boost::iostreams::mapped_file_source> pMappedFile;
+   try
+   {
+      pMappedFile.reset(new boost::iostreams::mapped_file_source(
+                           cacheFile.getAbsolutePath()));
+   }
+   catch(const std::exception& e)
+   {
+      Error error = systemError(boost::system::errc::io_error, ERROR_LOCATION);
+      error.addProperty("what", e.what());
+      error.addProperty("path", cacheFile.getAbsolutePath());
+      return error;
+   }
+
+   // read the header; a cache from another build or format is silently
+   // discarded (it will be replaced on the next write)
+   CacheReader reader(pMappedFile->data(), pMappedFile->size());
+   if (reader.read<uint32_t>() != kCacheMagic ||
+       reader.read<uint32_t>() != kCacheFormatVersion ||
+       reader.readString() != buildId)
+   {
+      return Success();
+   }
+
+   // read the entry directory, skipping over the (lazily decoded) indexes
+   std::map<std::string, Entry> entries;
+   uint32_t entryCount = reader.read<uint32_t>();
+   for (uint32_t i = 0; i < entryCount && !reader.failed(); ++i)
+   {
+      std::string path = reader.readString();
+
+      Entry entry;
+      entry.lastWriteTime = static_cast<std::time_t>(reader.read<int64_t>());
+      entry.size = static_cast<uintmax_t>(reader.read<uint64_t>());
+      entry.contentHash = reader.read<uint32_t>();
+      entry.dataLength = reader.read<uint32_t>();
+      entry.dataOffset = reader.skip(entry.dataLength) - pMappedFile->data();
+
+      entries.insert(std::make_pair(path, entry));
+   }
+
+   if (reader.failed() || !reader.atEnd())
+   {
+      Error error = systemError(boost::system::errc::illegal_byte_sequence, ERROR_LOCATION);
+      error.addProperty("description", "Source index cache is corrupt");
+      error.addProperty("path", cacheFile.getAbsolutePath());
+      return error;
+   }
+
+   entries_.swap(entries);
+   pMappedFile_ = pMappedFile;
+   return Success();
+}
+
+Error RSourceIndexCache::write(const FilePath& cacheFile, const std::string& buildId)
+{
+   std::string buffer;
+   CacheWriter writer(&buffer);
+   writer.write(kCacheMagic);
+   writer.write(kCacheFormatVersion);
+   writer.write(buildId);
+
+   // only entries which have (or can produce) an index are written
+   uint32_t entryCount = 0;
+   for (auto& entry : entries_)
+   {
+      if (decode(&entry.second))
+         ++entryCount;
+   }
+
+   writer.write(entryCount);
+   for (const auto& entry : entries_)
+   {
+      if (!entry.second.pIndex)
+         continue;
+
+      writer.write(entry.first);
+      writer.write(static_cast<int64_t>(entry.second.lastWriteTime));
+      writer.write(static_cast<uint64_t>(entry.second.size));
+      writer.write(entry.second.contentHash);
+
+      std::size_t start = writer.beginBlock();
+      writeIndex(*entry.second.pIndex, &writer);
+      writer.endBlock(start);
+   }
+
+   // every entry is decoded now so the old file is no longer needed (and
+   // must be unmapped before it can be replaced on Windows)
+   pMappedFile_.reset();
+
+   FilePath tempFile = cacheFile.getParent().completePath(cacheFile.getFilename() + ".tmp");
+   Error error = writeStringToFile(tempFile, buffer);
+   if (error)
+      return error;
+
+   error = tempFile.move(cacheFile, FilePath::MoveDirect, true);
+   if (error)
+      return error;
+
+   dirty_ = false;
+   return Success();
+}
+
+boost::shared_ptr<RSourceIndex> RSourceIndexCache::find(const FileInfo& fileInfo)
+{
+   std::map<std::string, Entry>::iterator it = entries_.find(fileInfo.absolutePath());
+   if (it == entries_.end() ||
+       it->second.lastWriteTime != fileInfo.lastWriteTime() ||
+       it->second.size != fileInfo.size())
+   {
+      return boost::shared_ptr<RSourceIndex>();
+   }
+
+   return decode(&it->second);
+}
+
+boost::shared_ptr<RSourceIndex> RSourceIndexCache::find(const std::string& absolutePath,
+                                                        uint32_t contentHash)
+{
+   std::map<std::string, Entry>::iterator it = entries_.find(absolutePath);
+   if (it == entries_.end() || it->second.contentHash != contentHash)
+      return boost::shared_ptr<RSourceIndex>();
+
+   return decode(&it->second);
+}
+
+boost::shared_ptr<RSourceIndex> RSourceIndexCache::get(const std::string& absolutePath,
+                                                       uint32_t* pContentHash)
+{
+   std::map<std::string, Entry>::iterator it = entries_.find(absolutePath);
+   if (it == entries_.end())
+      return boost::shared_ptr<RSourceIndex>();
+
+   *pContentHash = it->second.contentHash;
+   return decode(&it->second);
+}
+
+void RSourceIndexCache::update(const FileInfo& fileInfo,
+                               uint32_t contentHash,
+                               const boost::shared_ptr<RSourceIndex>& pIndex)
+{
+   Entry& entry = entries_[fileInfo.absolutePath()];
+   if (entry.pIndex == pIndex &&
+       entry.lastWriteTime == fileInfo.lastWriteTime() &&
+       entry.size == fileInfo.size())
+   {
+      return;
+   }
+
+   entry = Entry();
+   entry.lastWriteTime = fileInfo.lastWriteTime();
+   entry.size = fileInfo.size();
+   entry.contentHash = contentHash;
+   entry.pIndex = pIndex;
+   dirty_ = true;
+}
+
+void RSourceIndexCache::remove(const std::string& absolutePath)
+{
+   if (entries_.erase(absolutePath))
+      dirty_ = true;
+}
+
+void RSourceIndexCache::removeAllExcept(const std::set<std::string>& absolutePaths)
+{
+   for (std::map<std::string, Entry>::iterator it = entries_.begin(); it != entries_.end(); )
+   {
+      if (absolutePaths.count(it->first) == 0)
+      {
+         entries_.erase(it++);
+         dirty_ = true;
+      }
+      else
+      {
+         ++it;
+      }
+   }
+}
+
+void RSourceIndexCache::clear()
+{
+   entries_.clear();
+   pMappedFile_.reset();
+   dirty_ = false;
+}
+
+uint32_t RSourceIndexCache::contentHash(const std::string& code)
+{
+   boost::crc_32_type result;
+   result.process_bytes(code.data(), code.length());
+   return result.checksum();
+}
+
+boost::shared_ptr<RSourceIndex> RSourceIndexCache::decode(Entry* pEntry)
+{
+   if (pEntry->pIndex || !pMappedFile_ || pEntry->dataLength == 0)
+      return pEntry->pIndex;
+
+   CacheReader reader(pMappedFile_->data() + pEntry->dataOffset, pEntry->dataLength);
+   pEntry->pIndex = readIndex(&reader);
+   pEntry->dataLength = 0;
+
+   if (!pEntry->pIndex)
+      LOG_WARNING_MESSAGE("Ignoring corrupt source index cache entry");
+
+   return pEntry->pIndex;
+}
+
+} // namespace r_util
+} // namespace core
+} // namespace rstudio
@@ -0,0 +1,283 @@
+/*
+ * RSourceIndexCacheTests.cpp
+ *
+ * Copyright (C) 2022 by RStudio, PBC
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <tests/TestThat.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+
+#include <core/FileSerializer.hpp>
+#include <core/Thread.hpp>
+#include <core/r_util/RSourceIndexCache.hpp>
+
+#include <shared_core/FilePath.hpp>
+
+namespace rstudio {
+namespace core {
+namespace unit_tests {
+
+using namespace core::r_util;
+
+namespace {
+
+const char* const kBuildId = "2022.12.0";
+
+std::string sourceFile(int i)
+{
+   std::string n = std::to_string(i);
+   return
+         "library(utils" + n + ")\n"
+         "#' Documented function\n"
+         "helper_" + n + " <- function(x, y = 1) {\n"
+         "   inner <- function() x + y\n"
+         "   inner()\n"
+         "}\n"
+         "\n"
+         "setGeneric(\"area" + n + "\", function(shape) standardGeneric(\"area" + n + "\"))\n"
+         "setMethod(\"area" + n + "\", signature(shape = \"circle\"), function(shape) pi)\n"
+         "value_" + n + " <- 42\n";
+}
+
+FileInfo fileInfo(int i, std::time_t lastWriteTime = 1000)
+{
+   return FileInfo("/project/R/file" + std::to_string(i) + ".R",
+                   false,
+                   sourceFile(i).size(),
+                   lastWriteTime);
+}
+
+boost::shared_ptr<RSourceIndex> indexFile(int i)
+{
+   return boost::shared_ptr<RSourceIndex>(
+            new RSourceIndex("~/project/R/file" + std::to_string(i) + ".R", sourceFile(i)));
+}
+
+bool sameIndex(const RSourceIndex& lhs, const RSourceIndex& rhs)
+{
+   if (lhs.context() != rhs.context() ||
+       lhs.getInferredPackages() != rhs.getInferredPackages() ||
+       lhs.items().size() != rhs.items().size())
+   {
+      return false;
+   }
+
+   for (std::size_t i = 0; i < lhs.items().size(); ++i)
+   {
+      const RSourceItem& a = lhs.items()[i];
+      const RSourceItem& b = rhs.items()[i];
+      if (a.type() != b.type() || a.name() != b.name() ||
+          a.line() != b.line() || a.column() != b.column() ||
+          a.braceLevel() != b.braceLevel() || a.hidden() != b.hidden() ||
+          a.signature().size() != b.signature().size())
+      {
+         return false;
+      }
+
+      for (std::size_t j = 0; j < a.signature().size(); ++j)
+      {
+         if (a.signature()[j].name() != b.signature()[j].name() ||
+             a.signature()[j].type() != b.signature()[j].type())
+         {
+            return false;
+         }
+      }
+   }
+
+   return true;
+}
+
+} // anonymous namespace
+
+test_context("RSourceIndexCache")
+{
+   FilePath cacheFile;
+   REQUIRE_FALSE(FilePath::tempFilePath(".sidx", cacheFile));
+
+   test_that("Indexes survive a write and read")
+   {
+      RSourceIndexCache cache;
+      for (int i = 0; i < 10; ++i)
+         cache.update(fileInfo(i), RSourceIndexCache::contentHash(sourceFile(i)), indexFile(i));
+      expect_true(cache.dirty());
+      REQUIRE_FALSE(cache.write(cacheFile, kBuildId));
+      expect_false(cache.dirty());
+
+      RSourceIndexCache restored;
+      REQUIRE_FALSE(restored.read(cacheFile, kBuildId));
+      expect_true(restored.size() == 10);
+
+      for (int i = 0; i < 10; ++i)
+      {
+         boost::shared_ptr<RSourceIndex> pIndex = restored.find(fileInfo(i));
+         REQUIRE(pIndex);
+         expect_true(sameIndex(*pIndex, *indexFile(i)));
+      }
+      expect_false(restored.dirty());
+   }
+
+   test_that("Changed files are only matched by content")
+   {
+      RSourceIndexCache cache;
+      cache.update(fileInfo(1), RSourceIndexCache::contentHash(sourceFile(1)), indexFile(1));
+      REQUIRE_FALSE(cache.write(cacheFile, kBuildId));
+
+      RSourceIndexCache restored;
+      REQUIRE_FALSE(restored.read(cacheFile, kBuildId));
+
+      FileInfo touched = fileInfo(1, 2000);
+      expect_true(!restored.find(touched));
+      expect_true(!restored.find(touched.absolutePath(), RSourceIndexCache::contentHash("x <- 1")));
+      expect_true(restored.find(touched.absolutePath(), RSourceIndexCache::contentHash(sourceFile(1))));
+
+      uint32_t contentHash = 0;
+      expect_true(restored.get(touched.absolutePath(), &contentHash));
+      expect_true(contentHash == RSourceIndexCache::contentHash(sourceFile(1)));
+      expect_true(!restored.find(fileInfo(2)));
+   }
+
+   test_that("Entries for removed files are pruned")
+   {
+      RSourceIndexCache cache;
+      for (int i = 0; i < 3; ++i)
+         cache.update(fileInfo(i), 0, indexFile(i));
+      REQUIRE_FALSE(cache.write(cacheFile, kBuildId));
+
+      RSourceIndexCache restored;
+      REQUIRE_FALSE(restored.read(cacheFile, kBuildId));
+
+      std::set<std::string> existing;
+      existing.insert(fileInfo(0).absolutePath());
+      existing.insert(fileInfo(2).absolutePath());
+      restored.removeAllExcept(existing);
+      expect_true(restored.dirty());
+      expect_true(restored.size() == 2);
+      expect_true(!restored.find(fileInfo(1)));
+      expect_true(restored.find(fileInfo(2)));
+   }
+
+   test_that("Caches from other builds or corrupt files are ignored")
+   {
+      RSourceIndexCache cache;
+      cache.update(fileInfo(1), 0, indexFile(1));
+      REQUIRE_FALSE(cache.write(cacheFile, kBuildId));
+
+      RSourceIndexCache other;
+      REQUIRE_FALSE(other.read(cacheFile, "2023.03.0"));
+      expect_true(other.size() == 0);
+
+      std::string contents;
+      REQUIRE_FALSE(readStringFromFile(cacheFile, &contents));
+      REQUIRE_FALSE(writeStringToFile(cacheFile, contents.substr(0, contents.size() - 3)));
+
+      RSourceIndexCache corrupt;
+      expect_true(corrupt.read(cacheFile, kBuildId));
+      expect_true(corrupt.size() == 0);
+   }
+
+   cacheFile.removeIfExists();
+}
+
+TEST_CASE("RSourceIndexCache warm start benchmark", "[.benchmark]")
+{
+   const int kFiles = 20000;
+
+   FilePath cacheFile;
+   REQUIRE_FALSE(FilePath::tempFilePath(".sidx", cacheFile));
+
+   // cold start: tokenize and index every file
+   auto start = std::chrono::steady_clock::now();
+   RSourceIndexCache cache;
+   for (int i = 0; i < kFiles; ++i)
+   {
+      std::string code = sourceFile(i);
+      cache.update(fileInfo(i), RSourceIndexCache::contentHash(code), indexFile(i));
+   }
+   auto cold = std::chrono::steady_clock::now() - start;
+
+   start = std::chrono::steady_clock::now();
+   REQUIRE_FALSE(cache.write(cacheFile, kBuildId));
+   auto write = std::chrono::steady_clock::now() - start;
+
+   // warm start: read the cache and look up every file
+   start = std::chrono::steady_clock::now();
+   RSourceIndexCache restored;
+   REQUIRE_FALSE(restored.read(cacheFile, kBuildId));
+   std::size_t items = 0;
+   for (int i = 0; i < kFiles; ++i)
+   {
+      boost::shared_ptr<RSourceIndex> pIndex = restored.find(fileInfo(i));
+      REQUIRE(pIndex);
+      items += pIndex->items().size();
+   }
+   auto warm = std::chrono::steady_clock::now() - start;
+
+   std::cout << "source index for " << kFiles << " files (" << items << " items, "
+             << cacheFile.getSize() / 1024 << "kb cache): "
+             << "cold " << std::chrono::duration_cast<std::chrono::milliseconds>(cold).count() << "ms, "
+             << "write " << std::chrono::duration_cast<std::chrono::milliseconds>(write).count() << "ms, "
+             << "warm " << std::chrono::duration_cast<std::chrono::milliseconds>(warm).count() << "ms"
+             << std::endl;
+
+   cacheFile.removeIfExists();
+}
+
+TEST_CASE("Source index build benchmark", "[.benchmark]")
+{
+   const int kFiles = 20000;
+
+   // roughly 100 lines per file
+   std::vector<std::string> files;
+   for (int i = 0; i < kFiles; ++i)
+   {
+      std::string code;
+      for (int j = 0; j < 10; ++j)
+         code += sourceFile(i * 10 + j);
+      files.push_back(code);
+   }
+
+   const std::size_t kThreadCounts[] = { 1, 4, 8 };
+   for (std::size_t threadCount : kThreadCounts)
+   {
+      std::vector<boost::shared_ptr<RSourceIndex> > indexes(kFiles);
+      std::atomic<int> completed(0);
+
+      auto start = std::chrono::steady_clock::now();
+      {
+         core::thread::WorkerPool pool(threadCount);
+         for (int i = 0; i < kFiles; ++i)
+         {
+            pool.enque([&, i]() {
+               indexes[i].reset(new RSourceIndex("file" + std::to_string(i) + ".R", files[i]));
+               ++completed;
+            });
+         }
+
+         while (completed < kFiles)
+            boost::this_thread::sleep_for(boost::chrono::milliseconds(1));
+      }
+      auto elapsed = std::chrono::steady_clock::now() - start;
+
+      std::cout << "indexed " << kFiles << " files with " << threadCount << " thread(s): "
+                << std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() << "ms"
+                << std::endl;
+
+      CHECK(indexes.back()->items().size() > 0);
+   }
+}
+
+} // namespace unit_tests
+} // namespace core
+} // namespace rstudio
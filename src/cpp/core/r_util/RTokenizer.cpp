@@ -13,26 +13,12 @@
  *
  */
 
-// A very low level assertion (line 595 of cpp_regex_traits.hpp) is firing
-// on WindowsXP when we create a boost::wregex within R session. This code
-// is part of boost attempting to detect the sort syntax, and the assertion
-// is that there are no nulls in a buffer after a call to locale->transform.
-// Within the same method there are workarounds for both borland c++ and
-// dinkumware c++ std library to strip embedded nulls, so it seems as if
-// there is some variation in whether nulls come out of the call to transforn.
-// Note also that boost has a macro titled BOOST_REGEX_NO_WIN32 which we are
-// not using, which means that boost regex does call into native windows APIs
-// for locale oriented functions (thus explaining a difference in runtime
-// behavior across platforms). Tokenization appears to continue to work
-// correctly in the presence of the assertion (with the annoying side effect
-// of logging an assertion every time the product starts up)
-
 #include <core/r_util/RTokenizer.hpp>
 
-#include <boost/regex.hpp>
-
+#include <cstring>
 #include <iostream>
 #include <sstream>
+#include <type_traits>
 
 #include <shared_core/Error.hpp>
 #include <core/Log.hpp>
@@ -45,576 +31,577 @@ namespace r_util {
 
 namespace {
 
-class TokenPatterns
+// the code point at the start of a sequence of code units, and the number of
+// code units encoding it (wide strings are treated as a code point per unit)
+inline uint32_t codePointAt(const wchar_t* pos, const wchar_t* end, std::size_t* pLength)
 {
-private:
-   friend TokenPatterns& tokenPatterns();
-   TokenPatterns()
-      : NUMBER(L"[0-9]*(\\.[0-9]*)?([eE][+-]?[0-9]*)?[Li]?"),
-        HEX_NUMBER(L"0x[0-9a-fA-F]*L?"),
-        USER_OPERATOR(L"%[^\\n%]*%"),
-        WHITESPACE(L"[\\s\x00A0\x3000]+"),
-        COMMENT(L"#[^\\n]*$")
-   {
-   }
-
-public:
-   const boost::wregex NUMBER;
-   const boost::wregex HEX_NUMBER;
-   const boost::wregex USER_OPERATOR;
-   const boost::wregex WHITESPACE;
-   const boost::wregex COMMENT;
-};
-
-TokenPatterns& tokenPatterns()
-{
-   static TokenPatterns instance;
-   return instance;
+   *pLength = 1;
+   return static_cast<uint32_t>(*pos);
 }
 
-void updatePosition(std::wstring::const_iterator pos,
-                    std::size_t length,
-                    std::size_t* pRow,
-                    std::size_t* pColumn)
+inline uint32_t codePointAt(const char* pos, const char* end, std::size_t* pLength)
 {
-   std::size_t newlineCount;
-   std::wstring::const_iterator it =
-         string_utils::countNewlines(pos, pos + length, &newlineCount);
-   
-   if (newlineCount == 0)
+   const unsigned char* bytes = reinterpret_cast<const unsigned char*>(pos);
+   std::size_t available = end - pos;
+
+   uint32_t codePoint = bytes[0];
+   std::size_t length = 1;
+   if (codePoint >= 0xF0)
    {
-      *pColumn += length;
+      codePoint &= 0x07;
+      length = 4;
    }
-   else
+   else if (codePoint >= 0xE0)
    {
-      *pRow += newlineCount;
-      
-      // The column is now the token length, minus the
-      // index of the last newline.
-      *pColumn = length - (it - pos) - 1;
+      codePoint &= 0x0F;
+      length = 3;
+   }
+   else if (codePoint >= 0xC0)
+   {
+      codePoint &= 0x1F;
+      length = 2;
+   }
+
+   // invalid sequences are treated as a single (non-alphanumeric) character
+   if (length > available)
+   {
+      *pLength = 1;
+      return 0xFFFD;
+   }
+
+   for (std::size_t i = 1; i < length; ++i)
+   {
+      if ((bytes[i] & 0xC0) != 0x80)
+      {
+         *pLength = 1;
+         return 0xFFFD;
+      }
+      codePoint = (codePoint << 6) | (bytes[i] & 0x3F);
    }
+
+   *pLength = length;
+   return codePoint;
 }
 
-Error tokenizeError(const std::string& reason, const ErrorLocation& location)
+inline bool isDigit(uint32_t ch)
 {
-   Error error(boost::system::errc::invalid_argument, location);
-   error.addProperty("reason", reason);
-   return error;
+   return ch >= '0' && ch <= '9';
 }
 
-} // anonymous namespace
-
-RToken RTokenizer::nextToken()
+inline bool isHexDigit(uint32_t ch)
 {
-  if (eol())
-     return RToken();
-
-  wchar_t c = peek();
-
-  // check for raw string literals
-  if (c == L'r' || c == L'R')
-  {
-     wchar_t next = peek(1);
-     if (next == L'"' || next == L'\'')
-     {
-        RToken token;
-        Error error = matchRawStringLiteral(&token);
-        if (!error)
-           return token;
-     }
-  }
-  
-  switch (c)
-  {
-  case L'(':
-     return consumeToken(RToken::LPAREN, 1);
-  case L')':
-     return consumeToken(RToken::RPAREN, 1);
-  case L'{':
-     return consumeToken(RToken::LBRACE, 1);
-  case L'}':
-     return consumeToken(RToken::RBRACE, 1);
-  case L';':
-     return consumeToken(RToken::SEMI, 1);
-  case L',':
-     return consumeToken(RToken::COMMA, 1);
-     
-  case L'[':
-  {
-     RToken token;
-     if (peek(1) == L'[')
-     {
-        braceStack_.push_back(RToken::LDBRACKET);
-        token = consumeToken(RToken::LDBRACKET, 2);
-     }
-     else
-     {
-        braceStack_.push_back(RToken::LBRACKET);
-        token = consumeToken(RToken::LBRACKET, 1);
-     }
-     return token;
-  }
-     
-  case L']':
-  {
-     if (braceStack_.empty()) // TODO: warn?
-     {
-        if (peek(1) == L']')
-           return consumeToken(RToken::RDBRACKET, 2);
-        else
-           return consumeToken(RToken::RBRACKET, 1);
-     }
-     else
-     {
-        RToken token;
-        if (peek(1) == L']')
-        {
-           wchar_t top = braceStack_[braceStack_.size() - 1];
-           if (top == RToken::LDBRACKET)
-              token = consumeToken(RToken::RDBRACKET, 2);
-           else
-              token = consumeToken(RToken::RBRACKET, 1);
-        }
-        else
-           token = consumeToken(RToken::RBRACKET, 1);
-        
-        braceStack_.pop_back();
-        return token;
-     }
-  }
-     
-  case L'"':
-  case L'\'':
-  case L'`':
-     return matchDelimited();
-  case L'#':
-     return matchComment();
-  case L'%':
-     return matchUserOperator();
-  case L' ': case L'\t': case L'\r': case L'\n':
-  case L'\x00A0': case L'\x3000':
-     return matchWhitespace();
-  case L'\\':
-     return matchIdentifier();
-     
-  case L'_':
-     // R 4.2.0 introduced the pipe-bind operator;
-     // parse that as a special identifier.
-     return consumeToken(RToken::ID, 1);
-  }
-
-  wchar_t cNext = peek(1);
-
-  if ((c >= L'0' && c <= L'9')
-        || (c == L'.' && cNext >= L'0' && cNext <= L'9'))
-  {
-     RToken numberToken = matchNumber();
-     if (numberToken.length() > 0)
-        return numberToken;
-  }
-
-  if (string_utils::isalnum(c) || c == L'.')
-  {
-     // From Section 10.3.2, identifiers must not start with
-     // a digit, nor may they start with a period followed by
-     // a digit.
-     //
-     // Since we're not checking for either condition, we must
-     // match on identifiers AFTER we have already tried to
-     // match on number.
-     return matchIdentifier();
-  }
-  
-  // check for embedded knitr chunks
-  RToken embeddedChunk = matchKnitrEmbeddedChunk();
-  if (embeddedChunk)
-     return embeddedChunk;
-
-  RToken oper = matchOperator();
-  if (oper)
-     return oper;
-
-  // Error!!
-  return consumeToken(RToken::ERR, 1);
+   return isDigit(ch) || (ch >= 'a' && ch <= 'f') || (ch >= 'A' && ch <= 'F');
 }
 
-
-
-RToken RTokenizer::matchWhitespace()
+inline bool isAlnum(uint32_t ch)
 {
-   return consumeToken(RToken::WHITESPACE, tokenLength(tokenPatterns().WHITESPACE));
+   if (ch < 0x80)
+      return isDigit(ch) || (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z');
+   return ch < 0xFFFF && string_utils::isalnum(static_cast<wchar_t>(ch));
 }
 
-Error RTokenizer::matchRawStringLiteral(RToken* pToken)
+inline bool isWhitespace(uint32_t ch)
 {
-   auto start = pos_;
-   
-   // consume leading 'r' or 'R'
-   wchar_t firstChar = eat();
-   if (!(firstChar == L'r' || firstChar == L'R'))
+   switch (ch)
    {
-      pos_ = start;
-      return tokenizeError(
-               "expected 'r' or 'R' at start of raw string literal",
-               ERROR_LOCATION);
-   }
-   
-   // consume quote character
-   wchar_t quoteChar = eat();
-   if (!(quoteChar == L'"' || quoteChar == L'\''))
-   {
-      pos_ = start;
-      return tokenizeError(
-               "expected quote character at start of raw string literal",
-               ERROR_LOCATION);
-   }
-   
-   // consume an optional number of hyphens
-   int hyphenCount = 0;
-   wchar_t ch = eat();
-   while (ch == L'-')
-   {
-      hyphenCount++;
-      ch = eat();
+   case ' ': case '\t': case '\r': case '\n': case '\v': case '\f':
+   case 0x00A0: case 0x3000:
+      return true;
+   default:
+      return false;
    }
-   
-   // okay, we're now sitting on open parenthesis
-   wchar_t lhs = ch;
-   
-   // form right boundary character based on consumed parenthesis.
-   // if it wasn't a parenthesis, just look for the associated closing quote
-   wchar_t rhs;
-   if (lhs == L'(')
+}
+
+// Scans the next token in a sequence of code units. The scanning rules are
+// shared by the wide and UTF-8 tokenizers; only ASCII characters are
+// significant to the grammar, so apart from identifiers and whitespace the
+// code units can be compared directly.
+template <typename Char>
+class TokenScanner
+{
+public:
+   TokenScanner(const Char* pos, const Char* end, std::vector<char>* pBraceStack)
+      : pos_(pos), end_(end), pBraceStack_(pBraceStack)
    {
-      rhs = L')';
    }
-   else if (lhs == L'{')
+
+   // the type and length (in code units) of the token at the current
+   // position, which must not be at the end of the code
+   std::size_t nextToken(RToken::TokenType* pType)
    {
-      rhs = L'}';
+      uint32_t c = peek();
+
+      // check for raw string literals
+      if (c == 'r' || c == 'R')
+      {
+         uint32_t next = peek(1);
+         if (next == '"' || next == '\'')
+         {
+            std::size_t length = matchRawStringLiteral(pType);
+            if (length > 0)
+               return length;
+         }
+      }
+
+      switch (c)
+      {
+      case '(': return token(RToken::LPAREN, 1, pType);
+      case ')': return token(RToken::RPAREN, 1, pType);
+      case '{': return token(RToken::LBRACE, 1, pType);
+      case '}': return token(RToken::RBRACE, 1, pType);
+      case ';': return token(RToken::SEMI, 1, pType);
+      case ',': return token(RToken::COMMA, 1, pType);
+
+      case '[':
+      {
+         if (peek(1) == '[')
+         {
+            pBraceStack_->push_back(RToken::LDBRACKET);
+            return token(RToken::LDBRACKET, 2, pType);
+         }
+         else
+         {
+            pBraceStack_->push_back(RToken::LBRACKET);
+            return token(RToken::LBRACKET, 1, pType);
+         }
+      }
+
+      case ']':
+      {
+         if (pBraceStack_->empty()) // TODO: warn?
+         {
+            if (peek(1) == ']')
+               return token(RToken::RDBRACKET, 2, pType);
+            else
+               return token(RToken::RBRACKET, 1, pType);
+         }
+
+         char top = pBraceStack_->back();
+         pBraceStack_->pop_back();
+         if (peek(1) == ']' && top == RToken::LDBRACKET)
+            return token(RToken::RDBRACKET, 2, pType);
+         else
+            return token(RToken::RBRACKET, 1, pType);
+      }
+
+      case '"':
+      case '\'':
+      case '`':
+         return matchDelimited(pType);
+      case '#':
+         return token(RToken::COMMENT, commentLength(), pType);
+      case '%':
+      {
+         std::size_t length = userOperatorLength();
+         if (length == 0)
+            return token(RToken::ERR, 1, pType);
+         else
+            return token(RToken::UOPER, length, pType);
+      }
+      case ' ': case '\t': case '\r': case '\n':
+         return token(RToken::WHITESPACE, whitespaceLength(), pType);
+      case '\\':
+         return token(RToken::ID, identifierLength(), pType);
+
+      case '_':
+         // R 4.2.0 introduced the pipe-bind operator;
+         // parse that as a special identifier.
+         return token(RToken::ID, 1, pType);
+      }
+
+      uint32_t cNext = peek(1);
+
+      if (isDigit(c) || (c == '.' && isDigit(cNext)))
+      {
+         std::size_t length = numberLength();
+         if (length > 0)
+            return token(RToken::NUMBER, length, pType);
+      }
+
+      std::size_t charLength;
+      uint32_t codePoint = codePointAt(pos_, end_, &charLength);
+      if (codePoint == 0x00A0 || codePoint == 0x3000)
+         return token(RToken::WHITESPACE, whitespaceLength(), pType);
+
+      if (isAlnum(codePoint) || c == '.')
+      {
+         // From Section 10.3.2, identifiers must not start with
+         // a digit, nor may they start with a period followed by
+         // a digit.
+         //
+         // Since we're not checking for either condition, we must
+         // match on identifiers AFTER we have already tried to
+         // match on number.
+         return token(RToken::ID, identifierLength(), pType);
+      }
+
+      // check for embedded knitr chunks
+      std::size_t length = knitrEmbeddedChunkLength();
+      if (length > 0)
+         return token(RToken::STRING, length, pType);
+
+      length = operatorLength();
+      if (length > 0)
+         return token(RToken::OPER, length, pType);
+
+      // Error!! (consuming the whole character)
+      return token(RToken::ERR, charLength, pType);
    }
-   else if (lhs == L'[')
+
+private:
+
+   static std::size_t token(RToken::TokenType type,
+                            std::size_t length,
+                            RToken::TokenType* pType)
    {
-      rhs = L']';
+      *pType = type;
+      return length;
    }
-   else
+
+   uint32_t peek(std::size_t lookahead = 0) const
    {
-      pos_ = start;
-      return tokenizeError(
-               "expected opening bracket at start of raw string literal",
-               ERROR_LOCATION);
+      if (UNLIKELY(static_cast<std::size_t>(end_ - pos_) <= lookahead))
+         return 0;
+
+      // compare as unsigned so bytes of multibyte characters are never
+      // mistaken for ASCII
+      return static_cast<typename std::make_unsigned<Char>::type>(pos_[lookahead]);
    }
-   
-   // start searching for the end of the raw string
-   bool valid = false;
-   
-   while (true)
+
+   std::size_t matchRawStringLiteral(RToken::TokenType* pType)
    {
-      // i know, i know -- a label!? we use that here just because
-      // we need to 'break' out of a nested loop below, and just
-      // using a simple goto is cleaner than having e.g. an extra
-      // boolean flag tracking whether we should 'continue'
-      LOOP:
-      
-      if (eol())
-         break;
-      
-      // find the boundary character
-      wchar_t ch = eat();
-      if (ch != rhs)
-         goto LOOP;
-      
-      // consume hyphens
-      for (int i = 0; i < hyphenCount; i++)
+      // skip the leading 'r' or 'R' and quote character
+      uint32_t quoteChar = peek(1);
+      std::size_t offset = 2;
+
+      // consume an optional number of hyphens
+      std::size_t hyphenCount = 0;
+      while (peek(offset) == '-')
       {
-         ch = eat();
-         if (ch != L'-')
-            goto LOOP;
+         ++hyphenCount;
+         ++offset;
       }
-      
-      // consume quote character
-      ch = eat();
-      if (ch != quoteChar)
-         goto LOOP;
-      
-      // we're at the end of the string; break out of the loop
-      valid = true;
-      break;
-   }
-   
-   // update position
-   std::size_t row = row_;
-   std::size_t column = column_;
-   updatePosition(start, pos_ - start, &row_, &column_);
- 
-   // set token and return success
-   auto type = valid ? RToken::STRING : RToken::ERR;
-   *pToken = RToken(type, start, pos_, start - data_.begin(), row, column);
-   return Success();
-}
 
-RToken RTokenizer::matchDelimited()
-{
-   auto start = pos_;
-   auto quote = eat();
+      // form right boundary character based on the opening bracket
+      uint32_t rhs;
+      switch (peek(offset))
+      {
+      case '(': rhs = ')'; break;
+      case '{': rhs = '}'; break;
+      case '[': rhs = ']'; break;
+      default: return 0;
+      }
+      ++offset;
 
-   while (!eol())
-   {
-      wchar_t ch = eat();
-      
-      // skip over escaped characters
-      if (ch == L'\\')
+      // search for the end of the raw string
+      std::size_t length = end_ - pos_;
+      while (offset < length)
       {
-         if (!eol())
+         // find the boundary character
+         if (pos_[offset++] != static_cast<Char>(rhs))
+            continue;
+
+         // followed by the hyphens and quote character
+         std::size_t i = 0;
+         while (i < hyphenCount && peek(offset + i) == '-')
+            ++i;
+         if (i < hyphenCount)
          {
-            eat();
+            offset += i;
             continue;
          }
+
+         if (peek(offset + hyphenCount) == quoteChar)
+            return token(RToken::STRING, offset + hyphenCount + 1, pType);
+
+         offset += hyphenCount;
       }
-      
-      // check for matching quote
-      if (ch == quote)
+
+      // unterminated raw strings run to the end of the code
+      return token(RToken::ERR, length, pType);
+   }
+
+   std::size_t matchDelimited(RToken::TokenType* pType)
+   {
+      Char quote = pos_[0];
+      std::size_t length = end_ - pos_;
+      std::size_t offset = 1;
+
+      while (offset < length)
       {
-         break;
+         Char ch = pos_[offset++];
+
+         // skip over escaped characters
+         if (ch == '\\')
+         {
+            if (offset < length)
+            {
+               ++offset;
+               continue;
+            }
+         }
+
+         // check for matching quote
+         if (ch == quote)
+            break;
       }
+
+      // NOTE: the Java version of the tokenizer returns a special RStringToken
+      // subclass which includes the wellFormed flag as an attribute. Our
+      // implementation of RToken is stack based so doesn't support subclasses
+      // (because they will be sliced when copied). If we need the well
+      // formed flag we can just add it onto RToken.
+      return token(quote == '`' ? RToken::ID : RToken::STRING, offset, pType);
    }
-   
-   // because delimited items can contain newlines,
-   // update our row + column position after parsing the token
-   std::size_t row = row_;
-   std::size_t column = column_;
-   updatePosition(start, pos_ - start, &row_, &column_);
-
-   // NOTE: the Java version of the tokenizer returns a special RStringToken
-   // subclass which includes the wellFormed flag as an attribute. Our
-   // implementation of RToken is stack based so doesn't support subclasses
-   // (because they will be sliced when copied). If we need the well
-   // formed flag we can just add it onto RToken.
-   return RToken(quote == L'`' ? RToken::ID : RToken::STRING,
-                 start,
-                 pos_,
-                 start - data_.begin(),
-                 row,
-                 column);
-}
 
-RToken RTokenizer::matchNumber()
-{
-   std::size_t length = tokenLength(tokenPatterns().HEX_NUMBER);
-   if (length == 0)
-      length = tokenLength(tokenPatterns().NUMBER);
+   // [0-9]*(\.[0-9]*)?([eE][+-]?[0-9]*)?[Li]? or 0x[0-9a-fA-F]*L?
+   std::size_t numberLength() const
+   {
+      std::size_t offset = 0;
+      if (peek(0) == '0' && peek(1) == 'x')
+      {
+         offset = 2;
+         while (isHexDigit(peek(offset)))
+            ++offset;
+         if (peek(offset) == 'L')
+            ++offset;
+         return offset;
+      }
 
-   return consumeToken(RToken::NUMBER, length);
-}
+      while (isDigit(peek(offset)))
+         ++offset;
 
-RToken RTokenizer::matchIdentifier()
-{
-   std::wstring::const_iterator start = pos_;
-   
-   bool match = true;
-   while (match)
-   {
-      eat();
-    
-      wchar_t ch = peek();
-      match =
-            string_utils::isalnum(ch) ||
-            ch == L'.' ||
-            ch == L'_';
-   }
-   
-   std::size_t row = row_;
-   std::size_t column = column_;
-   updatePosition(start, pos_ - start, &row_, &column_);
-   
-   return RToken(RToken::ID,
-                 start,
-                 pos_,
-                 start - data_.begin(),
-                 row,
-                 column);
-}
+      if (peek(offset) == '.')
+      {
+         ++offset;
+         while (isDigit(peek(offset)))
+            ++offset;
+      }
 
-RToken RTokenizer::matchComment()
-{
-   return consumeToken(RToken::COMMENT, tokenLength(tokenPatterns().COMMENT));
-}
+      if (peek(offset) == 'e' || peek(offset) == 'E')
+      {
+         ++offset;
+         if (peek(offset) == '+' || peek(offset) == '-')
+            ++offset;
+         while (isDigit(peek(offset)))
+            ++offset;
+      }
 
-RToken RTokenizer::matchUserOperator()
-{
-   std::size_t length = tokenLength(tokenPatterns().USER_OPERATOR);
-   if (length == 0)
-      return consumeToken(RToken::ERR, 1);
-   else
-      return consumeToken(RToken::UOPER, length);
-}
+      if (peek(offset) == 'L' || peek(offset) == 'i')
+         ++offset;
 
-RToken RTokenizer::matchKnitrEmbeddedChunk()
-{
-   wchar_t ch;
-   
-   // bail if we don't start with '<<' here
-   if (peek(0) != L'<' ||
-       peek(1) != L'<')
-   {
-      return RToken();
+      return offset;
    }
-   
-   // consume the chunk label, looking for '>>'
-   for (int offset = 1; ; offset++)
+
+   std::size_t identifierLength() const
    {
-      // give up on newlines or EOF
-      ch = peek(offset);
-      if (ch == 0 || ch == L'\n')
-         return RToken();
-      
-      // look for closing '>>'
-      if (peek(offset + 0) == L'>' &&
-          peek(offset + 1) == L'>')
+      // the first character has already been matched
+      std::size_t charLength;
+      codePointAt(pos_, end_, &charLength);
+      const Char* it = pos_ + charLength;
+
+      while (it < end_)
       {
-         return consumeToken(RToken::STRING, offset + 2);
+         uint32_t codePoint = codePointAt(it, end_, &charLength);
+         if (!(isAlnum(codePoint) || codePoint == '.' || codePoint == '_'))
+            break;
+         it += charLength;
       }
-   }
-   
-   return RToken();
-}
 
-RToken RTokenizer::matchOperator()
-{
-   wchar_t cNext = peek(1);
+      return it - pos_;
+   }
 
-   switch (peek())
+   // comments run to the end of the line, excluding the carriage return
+   // of a CRLF line ending
+   std::size_t commentLength() const
    {
-   
-   case L':': // :::, ::, :=
+      const Char* it = std::find(pos_, end_, static_cast<Char>('\n'));
+      if (it != end_ && it - pos_ > 1 && *(it - 1) == '\r')
+         --it;
+      return it - pos_;
+   }
+
+   // %[^\n%]*%
+   std::size_t userOperatorLength() const
    {
-      if (cNext == L'=')
-      {
-         return consumeToken(RToken::OPER, 2);
-      }
-      else if (cNext == L':')
+      for (const Char* it = pos_ + 1; it < end_; ++it)
       {
-         wchar_t cNextNext = peek(2);
-         return consumeToken(RToken::OPER, cNextNext == L':' ? 3 : 2);
+         if (*it == '%')
+            return it - pos_ + 1;
+         else if (*it == '\n')
+            return 0;
       }
+      return 0;
    }
-      
-   case L'|': // ||, |>, |
-      if (cNext == L'|' || cNext == L'>')
-         return consumeToken(RToken::OPER, 2);
-      else
-         return consumeToken(RToken::OPER, 1);
-      
-   case L'&': // &&, &
-      return consumeToken(RToken::OPER, cNext == L'&' ? 2 : 1);
-      
-   case L'<': // <=, <-, <<-, <
-      if (cNext == L'=' || cNext == L'-') // <=, <-
+
+   std::size_t whitespaceLength() const
+   {
+      const Char* it = pos_;
+      while (it < end_)
       {
-         return consumeToken(RToken::OPER, 2);
+         std::size_t charLength;
+         if (!isWhitespace(codePointAt(it, end_, &charLength)))
+            break;
+         it += charLength;
       }
-      else if (cNext == L'<')
+      return it - pos_;
+   }
+
+   std::size_t knitrEmbeddedChunkLength() const
+   {
+      // bail if we don't start with '<<' here
+      if (peek(0) != '<' || peek(1) != '<')
+         return 0;
+
+      // consume the chunk label, looking for '>>'
+      for (std::size_t offset = 1; ; offset++)
       {
-         wchar_t cNextNext = peek(2);
-         if (cNextNext == L'-') // <<-
-            return consumeToken(RToken::OPER, 3);
+         // give up on newlines or EOF
+         uint32_t ch = peek(offset);
+         if (ch == 0 || ch == '\n')
+            return 0;
+
+         // look for closing '>>'
+         if (ch == '>' && peek(offset + 1) == '>')
+            return offset + 2;
       }
-      else // plain old <
+   }
+
+   std::size_t operatorLength() const
+   {
+      uint32_t cNext = peek(1);
+
+      switch (peek())
       {
-         return consumeToken(RToken::OPER, 1);
-      }
-      
-   case L'-': // also -> and ->>
-      if (cNext == L'>')
+
+      case ':': // :::, ::, :=
       {
-         wchar_t cNextNext = peek(2);
-         return consumeToken(RToken::OPER, cNextNext == L'>' ? 3 : 2);
+         if (cNext == '=')
+            return 2;
+         else if (cNext == ':')
+            return peek(2) == ':' ? 3 : 2;
       }
-      else
-      {
-         return consumeToken(RToken::OPER, 1);
+
+      case '|': // ||, |>, |
+         return cNext == '|' || cNext == '>' ? 2 : 1;
+
+      case '&': // &&, &
+         return cNext == '&' ? 2 : 1;
+
+      case '<': // <=, <-, <<-, <
+         if (cNext == '=' || cNext == '-') // <=, <-
+            return 2;
+         else if (cNext == '<' && peek(2) == '-') // <<-
+            return 3;
+         else // plain old <
+            return 1;
+
+      case '-': // also -> and ->>
+         if (cNext == '>')
+            return peek(2) == '>' ? 3 : 2;
+         else
+            return 1;
+
+      case '*': // '*' and '**' (which R's parser converts to '^')
+         return cNext == '*' ? 2 : 1;
+
+      case '+': case '/': case '?':
+      case '^': case '~': case '$': case '@':
+         // single-character operators
+         return 1;
+
+      case '>': // also >=
+         return cNext == '=' ? 2 : 1;
+
+      case '=': // also =>, ==
+         return cNext == '=' || cNext == '>' ? 2 : 1;
+
+      case '!': // also !=
+         return cNext == '=' ? 2 : 1;
+
+      default:
+         return 0;
       }
-      
-   case L'*': // '*' and '**' (which R's parser converts to '^')
-      return consumeToken(RToken::OPER, cNext == L'*' ? 2 : 1);
-      
-   case L'+': case L'/': case L'?':
-   case L'^': case L'~': case L'$': case L'@':
-      // single-character operators
-      return consumeToken(RToken::OPER, 1);
-      
-   case L'>': // also >=
-      return consumeToken(RToken::OPER, cNext == L'=' ? 2 : 1);
-      
-   case L'=': // also =>, ==
-      if (cNext == L'=' || cNext == '>')
-         return consumeToken(RToken::OPER, 2);
-      else
-         return consumeToken(RToken::OPER, 1);
-         
-   case L'!': // also !=
-      return consumeToken(RToken::OPER, cNext == L'=' ? 2 : 1);
-      
-   default:
-      return RToken();
    }
-}
 
-bool RTokenizer::eol()
+   const Char* pos_;
+   const Char* end_;
+   std::vector<char>* pBraceStack_;
+};
+
+void updatePosition(std::wstring::const_iterator pos,
+                    std::size_t length,
+                    std::size_t* pRow,
+                    std::size_t* pColumn)
 {
-   return pos_ >= data_.end();
+   std::size_t newlineCount;
+   std::wstring::const_iterator it =
+         string_utils::countNewlines(pos, pos + length, &newlineCount);
+   
+   if (newlineCount == 0)
+   {
+      *pColumn += length;
+   }
+   else
+   {
+      *pRow += newlineCount;
+      
+      // The column is now the token length, minus the
+      // index of the last newline.
+      *pColumn = length - (it - pos) - 1;
+   }
 }
 
-wchar_t RTokenizer::peek()
+// track the '[' and '[[' brackets left open by a token, as the tokenizer does
+void updateBraceStack(const RToken& token, std::vector<char>* pBraceStack)
 {
-   return peek(0);
+   switch (token.type())
+   {
+   case RToken::LBRACKET:
+   case RToken::LDBRACKET:
+      pBraceStack->push_back(token.type());
+      break;
+   case RToken::RBRACKET:
+   case RToken::RDBRACKET:
+      if (!pBraceStack->empty())
+         pBraceStack->pop_back();
+      break;
+   default:
+      break;
+   }
 }
 
-wchar_t RTokenizer::peek(int lookahead)
+} // anonymous namespace
+
+RToken RTokenizer::nextToken()
 {
-   // NOTE: MSVC is extra picky in debug mode, so when we compare
-   // iterators here we need to make sure we don't construct an iterator
-   // that points outside of the string from which it was derived
-   // this is a safer way of checking pos_ + lookahead >= data_.end()
-   if (UNLIKELY(data_.end() - pos_ <= lookahead))
-      return 0;
+   if (eol())
+      return RToken();
 
-   return *(pos_ + lookahead);
-}
+   const wchar_t* pos = data_.data() + (pos_ - begin_);
+   const wchar_t* end = data_.data() + data_.size();
 
-wchar_t RTokenizer::eat()
-{
-   wchar_t result = *pos_;
-   pos_++;
-   return result;
+   RToken::TokenType type;
+   std::size_t length = TokenScanner<wchar_t>(pos, end, &braceStack_).nextToken(&type);
+   return consumeToken(type, length);
 }
 
-std::size_t RTokenizer::tokenLength(const boost::wregex& regex)
+void RTokenizer::resume(std::size_t offset,
+                        std::size_t row,
+                        std::size_t column,
+                        const std::vector<char>& braceStack)
 {
-   boost::wsmatch match;
-   std::wstring::const_iterator end = data_.end();
-   boost::match_flag_type flg = boost::match_default | boost::match_continuous;
-   if (regex_utils::search(pos_, end, match, regex, flg))
-      return match.length();
-   else
-      return 0;
+   pos_ = begin_ + std::min(offset, data_.size());
+   row_ = row;
+   column_ = column;
+   braceStack_ = braceStack;
 }
 
-void RTokenizer::eatUntil(const boost::wregex& regex)
+bool RTokenizer::eol()
 {
-   boost::wsmatch match;
-   std::wstring::const_iterator end = data_.end();
-   if (regex_utils::search(pos_, end, match, regex))
-   {
-      pos_ = match[0].first;
-   }
-   else
-   {
-      // eat all on failure to match
-      pos_ = data_.end();
-   }
+   return pos_ >= data_.end();
 }
 
-
 RToken RTokenizer::consumeToken(RToken::TokenType tokenType,
                                 std::size_t length)
 {
@@ -646,6 +633,159 @@ RToken RTokenizer::consumeToken(RToken::TokenType tokenType,
                  column);
 }
 
+RTokens::RTokens(const std::wstring& code,
+                 const RTokens& previous,
+                 std::size_t prefixLength,
+                 std::size_t suffixLength,
+                 int flags)
+   : tokenizer_(code), flags_(flags)
+{
+   const std::wstring& previousCode = previous.code();
+   const std::wstring& data = tokenizer_.data();
+   const Tokens& previousTokens = previous.tokens_;
+
+   bool reusable =
+         previous.flags_ == flags &&
+         prefixLength + suffixLength <= std::min(code.size(), previousCode.size());
+
+   // no token looks ahead past the end of its line, so the tokens ending
+   // before the newline preceding the change are unaffected by it
+   std::size_t prefixEnd = 0;
+   if (reusable && prefixLength > 0)
+   {
+      std::size_t newline = previousCode.rfind(L'\n', prefixLength - 1);
+      if (newline != std::wstring::npos)
+         prefixEnd = newline;
+   }
+
+   tokens_.reserve(previousTokens.size());
+
+   std::vector<char> braceStack;
+   std::size_t i = 0;
+   for (; i < previousTokens.size(); ++i)
+   {
+      const RToken& token = previousTokens[i];
+      if (token.offset() + token.length() > prefixEnd)
+         break;
+
+      tokens_.push_back(RToken(token.type(),
+                               data.begin() + token.offset(),
+                               data.begin() + token.offset() + token.length(),
+                               token.offset(),
+                               token.row(),
+                               token.column()));
+      updateBraceStack(token, &braceStack);
+   }
+
+   if (i > 0)
+   {
+      const RToken& last = previousTokens[i - 1];
+      std::size_t row = last.row();
+      std::size_t column = last.column();
+      updatePosition(last.begin(), last.length(), &row, &column);
+      tokenizer_.resume(last.offset() + last.length(), row, column, braceStack);
+   }
+
+   // re-tokenize until the tokenizer reaches the start of a previous token
+   // within the unchanged suffix in the same state, after which the tokens
+   // are the same (up to a change in row)
+   std::size_t suffixStart = code.size() - suffixLength;
+   std::size_t previousSuffixStart = previousCode.size() - suffixLength;
+   while (true)
+   {
+      std::size_t offset = tokenizer_.offset();
+      if (reusable && offset >= suffixStart)
+      {
+         std::size_t target = offset - suffixStart + previousSuffixStart;
+         while (i < previousTokens.size() && previousTokens[i].offset() < target)
+            updateBraceStack(previousTokens[i++], &braceStack);
+
+         if (i < previousTokens.size() &&
+             previousTokens[i].offset() == target &&
+             previousTokens[i].column() == tokenizer_.column() &&
+             braceStack == tokenizer_.braceStack())
+         {
+            std::size_t firstRow = previousTokens[i].row();
+            for (; i < previousTokens.size(); ++i)
+            {
+               const RToken& token = previousTokens[i];
+               std::size_t tokenOffset = token.offset() - previousSuffixStart + suffixStart;
+               tokens_.push_back(RToken(token.type(),
+                                        data.begin() + tokenOffset,
+                                        data.begin() + tokenOffset + token.length(),
+                                        tokenOffset,
+                                        token.row() - firstRow + tokenizer_.row(),
+                                        token.column()));
+            }
+            return;
+         }
+      }
+
+      RToken token = tokenizer_.nextToken();
+      if (!token)
+         break;
+
+      if (!isStripped(token))
+         push_back(token);
+   }
+}
+
+RCompactToken RUtf8Tokenizer::nextToken()
+{
+   if (pos_ >= code_.size())
+      return RCompactToken();
+
+   const char* pos = code_.data() + pos_;
+   const char* end = code_.data() + code_.size();
+
+   RToken::TokenType type;
+   std::size_t length = TokenScanner<char>(pos, end, &braceStack_).nextToken(&type);
+
+   RCompactToken token(type, pos_, length);
+   pos_ += length;
+   return token;
+}
+
+RCompactTokens::RCompactTokens(boost::string_view code, int flags)
+   : code_(code)
+{
+   RUtf8Tokenizer tokenizer(code);
+   while (RCompactToken token = tokenizer.nextToken())
+   {
+      if ((flags & RTokens::StripWhitespace) && token.type() == RToken::WHITESPACE)
+         continue;
+
+      if ((flags & RTokens::StripComments) && token.type() == RToken::COMMENT)
+         continue;
+
+      tokens_.push_back(token);
+   }
+
+   lineOffsets_.push_back(0);
+   for (const char* it = code.data(), *end = code.data() + code.size();
+        (it = static_cast<const char*>(std::memchr(it, '\n', end - it))) != nullptr;
+        ++it)
+   {
+      lineOffsets_.push_back(it - code.data() + 1);
+   }
+}
+
+core::collection::Position RCompactTokens::position(const RCompactToken& token) const
+{
+   std::vector<std::size_t>::const_iterator it =
+         std::upper_bound(lineOffsets_.begin(), lineOffsets_.end(), token.offset()) - 1;
+
+   // count the characters (rather than the continuation bytes) on the line
+   std::size_t column = 0;
+   for (std::size_t i = *it; i < token.offset(); ++i)
+   {
+      if ((static_cast<unsigned char>(code_[i]) & 0xC0) != 0x80)
+         ++column;
+   }
+
+   return core::collection::Position(it - lineOffsets_.begin(), column);
+}
+
 class ConversionCache
 {
 public:
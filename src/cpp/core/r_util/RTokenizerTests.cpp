@@ -17,7 +17,16 @@
 
 #include <core/r_util/RTokenizer.hpp>
 
+#include <atomic>
+#include <chrono>
 #include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <core/FileSerializer.hpp>
+
+#include <shared_core/FilePath.hpp>
 
 #include <tests/TestThat.hpp>
 
@@ -229,11 +238,124 @@ void testWhitespace()
 }
 
 
+// check that the UTF-8 tokenizer yields the same tokens as the wide one
+bool sameTokens(const std::string& code)
+{
+   std::wstring wideCode = string_utils::utf8ToWide(code);
+   RTokens wideTokens(wideCode);
+   RCompactTokens tokens(code);
+   if (tokens.size() != wideTokens.size())
+      return false;
+
+   for (std::size_t i = 0; i < tokens.size(); ++i)
+   {
+      const RCompactToken& token = tokens.atUnsafe(i);
+      const RToken& wideToken = wideTokens.atUnsafe(i);
+      if (token.type() != wideToken.type() ||
+          tokens.content(token).to_string() != wideToken.contentAsUtf8() ||
+          !(tokens.position(token) == wideToken.position()))
+      {
+         return false;
+      }
+   }
+
+   return true;
+}
+
+// check that re-tokenizing an edit yields the same tokens as tokenizing the
+// edited code from scratch
+bool sameTokensAfterEdit(const std::wstring& code,
+                         std::size_t offset,
+                         std::size_t length,
+                         const std::wstring& replacement,
+                         int flags)
+{
+   std::wstring edited = code.substr(0, offset) + replacement + code.substr(offset + length);
+
+   std::size_t prefixLength = offset;
+   std::size_t suffixLength = code.size() - offset - length;
+   RTokens previous(code, flags);
+   RTokens tokens(edited, previous, prefixLength, suffixLength, flags);
+   RTokens expected(edited, flags);
+   if (tokens.size() != expected.size())
+      return false;
+
+   for (std::size_t i = 0; i < tokens.size(); ++i)
+   {
+      const RToken& token = tokens.atUnsafe(i);
+      const RToken& expectedToken = expected.atUnsafe(i);
+      if (token.type() != expectedToken.type() ||
+          token.offset() != expectedToken.offset() ||
+          token.content() != expectedToken.content() ||
+          !(token.position() == expectedToken.position()))
+      {
+         return false;
+      }
+   }
+
+   return true;
+}
+
+// the R sources within the repository
+std::string realWorldRCode()
+{
+   FilePath sourceFile = FilePath::safeCurrentPath(FilePath()).completePath(__FILE__);
+   FilePath sourceDir = sourceFile.getParent().getParent().getParent();
+   std::vector<FilePath> children;
+   sourceDir.getChildrenRecursive([&](int, const FilePath& child) {
+      if (child.getExtensionLowerCase() == ".r")
+         children.push_back(child);
+      return true;
+   });
+
+   std::string code;
+   for (const FilePath& child : children)
+   {
+      std::string contents;
+      if (!readStringFromFile(child, &contents))
+         code += contents;
+   }
+   return code;
+}
+
 } // anonymous namespace
 
 
 test_context("RTokenizer")
 {
+   // (first, so that the threads are the first to look up non-ASCII characters)
+   test_that("Non-ASCII code can be tokenized on several threads at once")
+   {
+      std::string code = "\xc3\xa9t\xc3\xa9 <- \xe4\xb8\xad\xe6\x96\x87 + \xce\xb1\xce\xb2\xce\xb3\n";
+
+      const int kThreads = 8;
+      std::atomic<bool> start(false);
+      std::vector<std::size_t> symbolCounts(kThreads, 0);
+      std::vector<std::thread> threads;
+      for (int i = 0; i < kThreads; ++i)
+      {
+         threads.push_back(std::thread([&, i]() {
+            while (!start)
+               std::this_thread::yield();
+
+            for (int j = 0; j < 100; ++j)
+            {
+               RCompactTokens tokens(code, RTokens::StripWhitespace);
+               for (std::size_t k = 0; k < tokens.size(); ++k)
+                  if (tokens.atUnsafe(k).isType(RToken::ID))
+                     ++symbolCounts[i];
+            }
+         }));
+      }
+
+      start = true;
+      for (std::thread& thread : threads)
+         thread.join();
+
+      for (std::size_t symbolCount : symbolCounts)
+         expect_true(symbolCount == 300);
+   }
+
    test_that("We tokenize various strings correctly")
    {
       testVoid();
@@ -322,9 +444,113 @@ test_context("RTokenizer")
       RTokens rTokens(L"<<chunk>>");
       expect_true(rTokens.size() == 1);
    }
+
+   test_that("UTF-8 code is tokenized as its wide equivalent")
+   {
+      expect_true(sameTokens(""));
+      expect_true(sameTokens("x <- c(1, 2L, 0xFFL, 1e-3i) # comment\ny[[1]][2] %>% f"));
+      expect_true(sameTokens("r\"-(raw \"string\")-\" + r'[x]' + r'(unterminated"));
+      expect_true(sameTokens("'a\\'b' `c d` \"e\nf\" <<chunk>> a :: b ::: c |> d"));
+      expect_true(sameTokens("\xc3\x81qc1 <- '\xe4\xb8\xad' \xe2\x86\x92 \xc2\xa0\xe3\x80\x80 x\n  \xc3\xa9t\xc3\xa9 = 1"));
+      expect_true(sameTokens("\\(x) x + 1; _ -> y ->> z; a ** b; !a != b; a := b; ]] ]"));
+   }
+
+   test_that("UTF-8 tokens have a compact representation")
+   {
+      expect_true(sizeof(RCompactToken) <= 16);
+
+      std::string code = "f <- function(x)\n  x[[\"\xc3\xa9\"]]";
+      RCompactTokens tokens(code, RTokens::StripWhitespace);
+      expect_true(tokens.size() == 10);
+      expect_true(tokens.content(tokens.at(0)) == "f");
+      expect_true(tokens.at(1).isType(RToken::OPER));
+      expect_true(tokens.content(tokens.at(8)) == "\"\xc3\xa9\"");
+      expect_true(tokens.position(tokens.at(9)) == collection::Position(1, 8));
+      expect_false(tokens.at(10));
+
+      RCompactTokens crlfTokens("# comment\r\nx", RTokens::StripWhitespace);
+      expect_true(crlfTokens.content(crlfTokens.at(0)) == "# comment");
+      expect_true(crlfTokens.position(crlfTokens.at(1)) == collection::Position(1, 0));
+   }
+
+   test_that("Edits are re-tokenized incrementally")
+   {
+      std::wstring code =
+            L"x <- list(a = 1)[[1]]  # first\n"
+            L"f <- function(y) {\n"
+            L"   y %in% x[['a']]\n"
+            L"}\n"
+            L"s <- \"multi\nline\"; r\"(raw)\"\n"
+            L"z <- f(2) + 3\n";
+
+      // an edit within a line, across lines, and at either end
+      expect_true(sameTokensAfterEdit(code, 40, 1, L"yy", RTokens::None));
+      expect_true(sameTokensAfterEdit(code, 40, 1, L"yy", RTokens::StripComments));
+      expect_true(sameTokensAfterEdit(code, 28, 10, L"\n\n", RTokens::StripWhitespace));
+      expect_true(sameTokensAfterEdit(code, 0, 0, L"library(x)\n", RTokens::None));
+      expect_true(sameTokensAfterEdit(code, code.size(), 0, L"\nw", RTokens::None));
+
+      // edits that change the tokenization of the code that follows
+      expect_true(sameTokensAfterEdit(code, 75, 0, L"\"", RTokens::None));
+      expect_true(sameTokensAfterEdit(code, 14, 0, L"[", RTokens::None));
+      expect_true(sameTokensAfterEdit(code, 61, 0, L"%", RTokens::None));
+      expect_true(sameTokensAfterEdit(code, 94, 1, L"", RTokens::None));
+
+      // random edits of real code
+      std::wstring realCode = string_utils::utf8ToWide(realWorldRCode().substr(0, 20000));
+      const wchar_t* const kReplacements[] = {
+         L"", L"x", L"\n", L"(", L")", L"[", L"]]", L"\"", L"'", L"#", L"%", L"{\n", L" <- "
+      };
+
+      std::mt19937 random(42);
+      for (int i = 0; i < 500; ++i)
+      {
+         std::size_t offset = random() % realCode.size();
+         std::size_t length = std::min<std::size_t>(random() % 4, realCode.size() - offset);
+         const wchar_t* replacement = kReplacements[random() % 13];
+         int flags = i % 2 ? RTokens::StripComments : RTokens::None;
+         if (!sameTokensAfterEdit(realCode, offset, length, replacement, flags))
+         {
+            FAIL("edit at " << offset << " not re-tokenized correctly");
+         }
+      }
+   }
    
 }
 
+TEST_CASE("RTokenizer throughput benchmark", "[.benchmark]")
+{
+   std::string code = realWorldRCode();
+   REQUIRE(!code.empty());
+   while (code.size() < 16 * 1024 * 1024)
+      code += code;
+
+   double megabytes = code.size() / (1024.0 * 1024.0);
+
+   auto start = std::chrono::steady_clock::now();
+   std::wstring wideCode = string_utils::utf8ToWide(code);
+   RTokens wideTokens(wideCode);
+   auto wide = std::chrono::steady_clock::now() - start;
+
+   start = std::chrono::steady_clock::now();
+   RCompactTokens tokens(code);
+   auto utf8 = std::chrono::steady_clock::now() - start;
+
+   REQUIRE(tokens.size() == wideTokens.size());
+
+   auto throughput = [&](std::chrono::steady_clock::duration elapsed) {
+      return megabytes / std::chrono::duration<double>(elapsed).count();
+   };
+
+   std::cout << "tokenized " << megabytes << "MB of R code (" << tokens.size() << " tokens): "
+             << "wide " << throughput(wide) << "MB/s ("
+             << (wideCode.size() * sizeof(wchar_t) + wideTokens.size() * sizeof(RToken)) / (1024 * 1024)
+             << "MB), "
+             << "utf-8 " << throughput(utf8) << "MB/s ("
+             << tokens.size() * sizeof(RCompactToken) / (1024 * 1024) << "MB)"
+             << std::endl;
+}
+
 } // namespace r_util
 } // namespace core 
 } // namespace rstudio
@@ -27,7 +27,9 @@
 #else
 #include <pty.h>
 #include <asm/ioctls.h>
+#include <sys/epoll.h>
 #include <sys/prctl.h>
+#include <sys/syscall.h>
 #endif
 
 #include <sys/wait.h>
@@ -115,8 +117,8 @@ Error readPipe(int pipeFd, std::string* pOutput, bool *pEOF = nullptr)
    if (pEOF)
       *pEOF = false;
 
-   // setup and read into buffer
-   const std::size_t kBufferSize = 512;
+   // setup and read into buffer (large enough to drain a full pipe at once)
+   const std::size_t kBufferSize = 65536;
    char buffer[kBufferSize];
    std::size_t bytesRead = posix::posixCall<std::size_t>(
                      boost::bind(::read, pipeFd, buffer, kBufferSize));
@@ -935,14 +937,45 @@ struct AsyncChildProcess::AsyncImpl
       : calledOnStarted_(false),
         finishedStdout_(false),
         finishedStderr_(false),
-        exited_(false)
+        exited_(false),
+        epollFd_(-1),
+        pidFd_(-1)
    {
    }
+
+   ~AsyncImpl()
+   {
+      stopWatching();
+   }
+
+   void stopWatching(int fd)
+   {
+#ifndef __APPLE__
+      if (epollFd_ != -1 && fd != -1)
+         ::epoll_ctl(epollFd_, EPOLL_CTL_DEL, fd, nullptr);
+#endif
+   }
+
+   void stopWatching()
+   {
+      if (pidFd_ != -1)
+      {
+         stopWatching(pidFd_);
+         ::close(pidFd_);
+         pidFd_ = -1;
+      }
+      epollFd_ = -1;
+   }
+
    bool calledOnStarted_;
    bool finishedStdout_;
    bool finishedStderr_;
    bool exited_;
    boost::scoped_ptr<ChildProcessSubprocPoll> pSubprocPoll_;
+
+   // epoll instance our output and exit (via a pidfd) are reported to
+   int epollFd_;
+   int pidFd_;
 };
 
 AsyncChildProcess::AsyncChildProcess(const std::string& exe,
@@ -973,6 +1006,51 @@ AsyncChildProcess::AsyncChildProcess(const ProcessOptions& options)
 
 AsyncChildProcess::~AsyncChildProcess()
 {
+   // (stop watching our pipes while they're still open)
+   pAsyncImpl_->stopWatching(pImpl_->fdStdout);
+   pAsyncImpl_->stopWatching(pImpl_->fdStderr);
+   pAsyncImpl_->stopWatching();
+}
+
+bool AsyncChildProcess::watchEvents(int epollFd, uint64_t id)
+{
+#if !defined(__APPLE__) && defined(SYS_pidfd_open)
+   if (pAsyncImpl_->epollFd_ != -1 || pAsyncImpl_->exited_ || pImpl_->pid == -1)
+      return false;
+
+   // without a pidfd we'd have no notification of exit (e.g. if the
+   // process closed its output, or passed it to a subprocess)
+   int pidFd = static_cast<int>(::syscall(SYS_pidfd_open, pImpl_->pid, 0));
+   if (pidFd == -1)
+      return false;
+
+   pAsyncImpl_->epollFd_ = epollFd;
+   pAsyncImpl_->pidFd_ = pidFd;
+
+   // with a pseudoterminal, stdout is the master and there is no stderr
+   int fds[] = { pidFd, pImpl_->fdStdout, pImpl_->fdStderr };
+   for (int fd : fds)
+   {
+      if (fd == -1)
+         continue;
+
+      struct epoll_event event;
+      event.events = EPOLLIN;
+      event.data.u64 = id;
+      if (::epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) == -1)
+      {
+         LOG_ERROR(systemError(errno, ERROR_LOCATION));
+         pAsyncImpl_->stopWatching(pImpl_->fdStdout);
+         pAsyncImpl_->stopWatching(pImpl_->fdStderr);
+         pAsyncImpl_->stopWatching();
+         return false;
+      }
+   }
+
+   return true;
+#else
+   return false;
+#endif
 }
 
 Error AsyncChildProcess::terminate()
@@ -1027,7 +1105,7 @@ bool AsyncChildProcess::hasRecentOutput() const
       return true;
 }
 
-void AsyncChildProcess::poll()
+void AsyncChildProcess::poll(bool hasEvents)
 {
    // skip polling if we're not on the main thread,
    // and the process options request we run on the main thread only
@@ -1050,11 +1128,16 @@ void AsyncChildProcess::poll()
       else
          setPipeNonBlocking(pImpl_->fdStderr);
 
-      // setup for subprocess polling
+      // setup for subprocess polling (every terminal polls, so they share a
+      // snapshot of the process table rather than each reading it in turn)
+      boost::function<std::vector<SubprocInfo>(PidType)> subProcCheck;
+      if (options().reportHasSubprocs)
+         subProcCheck = boost::bind(core::system::getSubprocessesFromSnapshot,
+                                    _1, kCheckSubprocDelay / 2);
       pAsyncImpl_->pSubprocPoll_.reset(new ChildProcessSubprocPoll(
          pImpl_->pid,
          kResetRecentDelay, kCheckSubprocDelay, kCheckCwdDelay,
-         options().reportHasSubprocs ? core::system::getSubprocesses : nullptr,
+         subProcCheck,
          options().ignoredSubprocs,
          options().trackCwd ? core::system::currentWorkingDir : nullptr));
 
@@ -1076,6 +1159,14 @@ void AsyncChildProcess::poll()
 
    bool hasRecentOutput = false;
 
+   // when our events are watched, there is no output or exit to check for
+   // unless some were reported
+   if (pAsyncImpl_->epollFd_ != -1 && !hasEvents)
+   {
+      pollSubprocs(false);
+      return;
+   }
+
    // check stdout and fire event if we got output
    if (!pAsyncImpl_->finishedStdout_)
    {
@@ -1095,7 +1186,10 @@ void AsyncChildProcess::poll()
          }
 
          if (eof)
-           pAsyncImpl_->finishedStdout_ = true;
+         {
+            pAsyncImpl_->stopWatching(pImpl_->fdStdout);
+            pAsyncImpl_->finishedStdout_ = true;
+         }
       }
    }
 
@@ -1119,7 +1213,10 @@ void AsyncChildProcess::poll()
          }
 
          if (eof)
-           pAsyncImpl_->finishedStderr_ = true;
+         {
+            pAsyncImpl_->stopWatching(pImpl_->fdStderr);
+            pAsyncImpl_->finishedStderr_ = true;
+         }
       }
    }
 
@@ -1137,6 +1234,9 @@ void AsyncChildProcess::poll()
    if (result != 0)
    {
       // close all of our pipes
+      pAsyncImpl_->stopWatching(pImpl_->fdStdout);
+      pAsyncImpl_->stopWatching(pImpl_->fdStderr);
+      pAsyncImpl_->stopWatching();
       pImpl_->closeAll(ERROR_LOCATION);
 
       // fire exit event
@@ -1164,6 +1264,11 @@ void AsyncChildProcess::poll()
          LOG_ERROR(systemError(errno, ERROR_LOCATION));
    }
 
+   pollSubprocs(hasRecentOutput);
+}
+
+void AsyncChildProcess::pollSubprocs(bool hasRecentOutput)
+{
    // Perform optional periodic operations
    if (pAsyncImpl_->pSubprocPoll_->poll(hasRecentOutput))
    {
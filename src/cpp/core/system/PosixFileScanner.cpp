@@ -16,14 +16,24 @@
 #include <core/system/FileScanner.hpp>
 
 #include <dirent.h>
+#include <fcntl.h>
 #include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
 
 #include <shared_core/Error.hpp>
 #include <core/Log.hpp>
 #include <shared_core/FilePath.hpp>
 #include <core/BoostThread.hpp>
-
-#include "config.h"
+#include <core/Thread.hpp>
 
 namespace rstudio {
 namespace core {
@@ -31,172 +41,353 @@ namespace system {
 
 namespace {
 
-#if defined(__APPLE__) && !defined(HAVE_SCANDIR_POSIX)
-int entryFilter(struct dirent *entry)
-#else
-int entryFilter(const struct dirent *entry)
-#endif
+// the entries read from a directory, along with the entries of those
+// subdirectories which are scanned in turn
+struct ScannedDir
 {
-   if (::strcmp(entry->d_name, ".") == 0 || ::strcmp(entry->d_name, "..") == 0)
-      return 0;
-   else
-      return 1;
-}
+   struct Entry
+   {
+      std::string name;
+      FileInfo fileInfo;
+      std::unique_ptr<ScannedDir> pSubdir;
+   };
+
+   std::vector<Entry> entries;
+};
 
 // note: because R may change LC_COLLATE, we cannot
 // use strcoll (otherwise we run into race issues where
 // the file monitor attempts to access LC_COLLATE just as
-// R is replacing it). to avoid this, we use strcmp and
+// R is replacing it). to avoid this, we compare bytes and
 // don't sort according to locale.
-#if !defined(HAVE_SCANDIR_POSIX)
-int alphasort(const void* voidlhs, const void* voidrhs)
+bool compareNames(const ScannedDir::Entry& lhs, const ScannedDir::Entry& rhs)
 {
-   const dirent** lhs = (const dirent**)voidlhs;
-   const dirent** rhs = (const dirent**)voidrhs;
-#else
-int alphasort(const dirent** lhs, const dirent** rhs)
-{
-#endif
-   return strcmp((*lhs)->d_name, (*rhs)->d_name);
+   return std::strcmp(lhs.name.c_str(), rhs.name.c_str()) < 0;
 }
 
-// wrapper for scandir api
-Error scanDir(const std::string& dirPath, std::vector<std::string>* pNames)
+struct ScanTask
+{
+   FileInfo dirInfo;
+   ScannedDir* pDir;
+};
+
+// scans a directory and (for recursive scans) its subdirectories. each
+// thread works through its own queue of directories depth first, and when
+// that is empty takes the oldest (and so likely biggest) directory queued
+// by another thread. entries are read relative to their directory's fd,
+// so the file system needn't resolve the full path for each one.
+class DirectoryScanner : boost::noncopyable
 {
-   // read directory contents into namelist
-   struct dirent **namelist;
-   int entries = ::scandir(dirPath.c_str(),
-                           &namelist,
-                           entryFilter,
-                           alphasort);
-   if (entries == -1)
+public:
+   explicit DirectoryScanner(const FileScannerOptions& options)
+      : options_(options),
+        pending_(0),
+        stopped_(false),
+        interrupted_(false)
    {
-      Error error = systemError(errno, ERROR_LOCATION);
-      error.addProperty("path", dirPath);
-      return error;
+      std::size_t threads = options.recursive ? std::max<std::size_t>(options.threads, 1) : 1;
+      for (std::size_t i = 0; i < threads; ++i)
+         queues_.push_back(boost::make_shared<WorkQueue>());
    }
 
-   // extract the namelist then free it
-   for(int i=0; i<entries; i++)
+   // errors scanning the directory itself are returned, while those for
+   // subdirectories are logged: we don't want one "bad" directory to cause
+   // us to abort the entire scan. yes the result will be incomplete however
+   // it will be even more incomplete if we fail entirely
+   Error scan(const FileInfo& dirInfo, ScannedDir* pDir)
    {
-      // get the name (then free it)
-      std::string name(namelist[i]->d_name);
-      ::free(namelist[i]);
+      Error error = scanDir(dirInfo, pDir, 0);
+      if (error)
+         return error;
 
-      // add to the vector
-      pNames->push_back(name);
-   }
-   ::free(namelist);
+      // the calling thread scans too (and watches for interrupts)
+      std::vector<boost::shared_ptr<boost::thread> > threads;
+      for (std::size_t i = 1; i < queues_.size(); ++i)
+      {
+         boost::shared_ptr<boost::thread> pThread(new boost::thread());
+         core::thread::safeLaunchThread(boost::bind(&DirectoryScanner::run, this, i),
+                                        pThread.get());
+         threads.push_back(pThread);
+      }
 
-   return Success();
-}
+      run(0);
 
-} // anonymous namespace
+      for (const boost::shared_ptr<boost::thread>& pThread : threads)
+      {
+         if (pThread->joinable())
+            pThread->join();
+      }
 
-Error scanFiles(const tree<FileInfo>::iterator_base& fromNode,
-                const FileScannerOptions& options,
-                tree<FileInfo>* pTree)
-{
-   // clear all existing
-   pTree->erase_children(fromNode);
+      // mark as expected to suppress logging
+      if (interrupted_)
+      {
+         Error error = core::systemError(boost::system::errc::interrupted, ERROR_LOCATION);
+         error.setExpected();
+         return error;
+      }
 
-   // create FilePath for root
-   FilePath rootPath(fromNode->absolutePath());
+      return Success();
+   }
 
-   // yield if requested (only applies to recursive scans)
-   if (options.recursive && options.yield)
-      boost::this_thread::yield();
+private:
+   struct WorkQueue
+   {
+      std::mutex mutex;
+      std::deque<ScanTask> tasks;
+   };
 
-   // call onBeforeScanDir hook
-   if (options.onBeforeScanDir)
+   void run(std::size_t index)
    {
-      Error error = options.onBeforeScanDir(*fromNode);
-      if (error)
-         return error;
-   }
+      while (!stopped_)
+      {
+         if (index == 0 && boost::this_thread::interruption_requested())
+         {
+            interrupted_ = true;
+            stopped_ = true;
+            break;
+         }
 
-   // read directory contents
-   std::vector<std::string> names;
-   Error error = scanDir(fromNode->absolutePath(), &names);
-   if (error)
-      return error;
+         ScanTask task;
+         if (!takeTask(index, &task))
+         {
+            if (pending_ == 0)
+               break;
 
-   // iterate over the names
-   for (const std::string& name : names)
+            // wait for more work (or for the scan to be complete)
+            std::unique_lock<std::mutex> lock(idleMutex_);
+            idleCondition_.wait_for(lock, std::chrono::milliseconds(5));
+            continue;
+         }
+
+         if (options_.yield)
+            boost::this_thread::yield();
+
+         try
+         {
+            Error error = scanDir(task.dirInfo, task.pDir, index);
+            if (error)
+               LOG_ERROR(error);
+         }
+         CATCH_UNEXPECTED_EXCEPTION
+
+         if (--pending_ == 0)
+            idleCondition_.notify_all();
+      }
+   }
+
+   void addTask(std::size_t index, const ScanTask& task)
    {
-      // check for interrupt (mark as expected to suppress logging)
-      if (boost::this_thread::interruption_requested())
+      ++pending_;
       {
-         Error error = core::systemError(boost::system::errc::interrupted, ERROR_LOCATION);
-         error.setExpected();
-         return error;
+         std::lock_guard<std::mutex> lock(queues_[index]->mutex);
+         queues_[index]->tasks.push_back(task);
       }
 
-      // compute the path
-      std::string path = rootPath.completeChildPath(name).getAbsolutePath();
+      if (queues_.size() > 1)
+         idleCondition_.notify_one();
+   }
 
-      // get the attributes
-      struct stat st;
-      int res = ::lstat(path.c_str(), &st);
-      if (res == -1)
+   bool takeTask(std::size_t index, ScanTask* pTask)
+   {
+      // our own most recently queued directory first
       {
-         if (errno != ENOENT && errno != EACCES)
+         WorkQueue& queue = *queues_[index];
+         std::lock_guard<std::mutex> lock(queue.mutex);
+         if (!queue.tasks.empty())
          {
-            Error error = systemError(errno, ERROR_LOCATION);
-            error.addProperty("path", path);
-            LOG_ERROR(error);
+            *pTask = queue.tasks.back();
+            queue.tasks.pop_back();
+            return true;
          }
-         continue;
       }
 
-      // create the FileInfo
-      FileInfo fileInfo;
-      bool isSymlink = S_ISLNK(st.st_mode);
-      if (S_ISDIR(st.st_mode))
+      // then steal from the others
+      for (std::size_t i = 1; i < queues_.size(); ++i)
+      {
+         WorkQueue& queue = *queues_[(index + i) % queues_.size()];
+         std::lock_guard<std::mutex> lock(queue.mutex);
+         if (!queue.tasks.empty())
+         {
+            *pTask = queue.tasks.front();
+            queue.tasks.pop_front();
+            return true;
+         }
+      }
+
+      return false;
+   }
+
+   Error scanDir(const FileInfo& dirInfo, ScannedDir* pDir, std::size_t index)
+   {
+      // call onBeforeScanDir hook
+      if (options_.onBeforeScanDir)
       {
-         fileInfo = FileInfo(path, true, isSymlink);
+         std::lock_guard<std::mutex> lock(callbackMutex_);
+         Error error = options_.onBeforeScanDir(dirInfo);
+         if (error)
+            return error;
       }
-      else
+
+      const std::string& dirPath = dirInfo.absolutePath();
+      int fd = ::open(dirPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+      DIR* pDirStream = (fd == -1) ? nullptr : ::fdopendir(fd);
+      if (pDirStream == nullptr)
       {
-         fileInfo = FileInfo(path,
-                             false,
-                             st.st_size,
-#ifdef __APPLE__
-                             st.st_mtimespec.tv_sec,
-#else
-                             st.st_mtime,
-#endif
-                             isSymlink);
+         Error error = systemError(errno, ERROR_LOCATION);
+         error.addProperty("path", dirPath);
+         if (fd != -1)
+            ::close(fd);
+         return error;
       }
 
-      // apply the filter (if any)
-      if (!options.filter || options.filter(fileInfo))
+      std::string prefix = dirPath;
+      if (prefix.empty() || prefix[prefix.size() - 1] != '/')
+         prefix.push_back('/');
+
+      Error error = Success();
+      while (!stopped_)
       {
-         // add the correct type of FileEntry
-         if (fileInfo.isDirectory())
+         errno = 0;
+         struct dirent* pEntry = ::readdir(pDirStream);
+         if (pEntry == nullptr)
          {
-            tree<FileInfo>::iterator_base child = pTree->append_child(fromNode,
-                                                                      fileInfo);
-            // recurse if requested and this isn't a link
-            if (options.recursive && !fileInfo.isSymlink())
+            if (errno != 0)
             {
-               // try to scan the files in the subdirectory -- if we fail
-               // we continue because we don't want one "bad" directory
-               // to cause us to abort the entire scan. yes the tree
-               // will be incomplete however it will be even more incomplete
-               // if we fail entirely
-               Error error = scanFiles(child, options, pTree);
-               if (error)
-                  LOG_ERROR(error);
+               error = systemError(errno, ERROR_LOCATION);
+               error.addProperty("path", dirPath);
             }
+            break;
+         }
+
+         const char* name = pEntry->d_name;
+         if (::strcmp(name, ".") == 0 || ::strcmp(name, "..") == 0)
+            continue;
+
+         std::string path = prefix + name;
+
+         // directories need no more than their type, which is usually
+         // returned along with their names
+         FileInfo fileInfo;
+#ifdef DT_DIR
+         if (pEntry->d_type == DT_DIR)
+         {
+            fileInfo = FileInfo(path, true, false);
          }
          else
+#endif
+         {
+            struct stat st;
+            if (::fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) == -1)
+            {
+               if (errno != ENOENT && errno != EACCES)
+               {
+                  Error statError = systemError(errno, ERROR_LOCATION);
+                  statError.addProperty("path", path);
+                  LOG_ERROR(statError);
+               }
+               continue;
+            }
+
+            bool isSymlink = S_ISLNK(st.st_mode);
+            if (S_ISDIR(st.st_mode))
+            {
+               fileInfo = FileInfo(path, true, isSymlink);
+            }
+            else
+            {
+               fileInfo = FileInfo(path,
+                                   false,
+                                   st.st_size,
+#ifdef __APPLE__
+                                   st.st_mtimespec.tv_sec,
+#else
+                                   st.st_mtime,
+#endif
+                                   isSymlink);
+            }
+         }
+
+         // apply the filter (if any)
+         if (options_.filter)
+         {
+            std::lock_guard<std::mutex> lock(callbackMutex_);
+            if (!options_.filter(fileInfo))
+               continue;
+         }
+
+         ScannedDir::Entry entry;
+         entry.name = name;
+         entry.fileInfo = std::move(fileInfo);
+
+         // recurse if requested and this isn't a link
+         if (options_.recursive && entry.fileInfo.isDirectory() && !entry.fileInfo.isSymlink())
          {
-            pTree->append_child(fromNode, fileInfo);
+            entry.pSubdir.reset(new ScannedDir());
+            ScanTask task = { entry.fileInfo, entry.pSubdir.get() };
+            addTask(index, task);
          }
+
+         pDir->entries.push_back(std::move(entry));
       }
+
+      // (closes fd)
+      ::closedir(pDirStream);
+
+      if (options_.sort)
+         std::sort(pDir->entries.begin(), pDir->entries.end(), compareNames);
+
+      return error;
    }
 
+   const FileScannerOptions& options_;
+   std::vector<boost::shared_ptr<WorkQueue> > queues_;
+
+   // directories queued but not yet scanned
+   std::atomic<std::size_t> pending_;
+   std::atomic<bool> stopped_;
+   std::atomic<bool> interrupted_;
+
+   std::mutex idleMutex_;
+   std::condition_variable idleCondition_;
+
+   // serializes calls to filter and onBeforeScanDir
+   std::mutex callbackMutex_;
+};
+
+void appendEntries(const tree<FileInfo>::iterator_base& node,
+                   ScannedDir* pDir,
+                   tree<FileInfo>* pTree)
+{
+   for (ScannedDir::Entry& entry : pDir->entries)
+   {
+      tree<FileInfo>::iterator_base child = pTree->append_child(node, entry.fileInfo);
+      if (entry.pSubdir)
+         appendEntries(child, entry.pSubdir.get(), pTree);
+   }
+}
+
+} // anonymous namespace
+
+Error scanFiles(const tree<FileInfo>::iterator_base& fromNode,
+                const FileScannerOptions& options,
+                tree<FileInfo>* pTree)
+{
+   // clear all existing
+   pTree->erase_children(fromNode);
+
+   // yield if requested (only applies to recursive scans)
+   if (options.recursive && options.yield)
+      boost::this_thread::yield();
+
+   // read the directory (and its subdirectories) then build the tree
+   ScannedDir dir;
+   DirectoryScanner scanner(options);
+   Error error = scanner.scan(*fromNode, &dir);
+   if (error)
+      return error;
+
+   appendEntries(fromNode, &dir, pTree);
+
    // return success
    return Success();
 }
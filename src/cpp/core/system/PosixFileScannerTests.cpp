@@ -0,0 +1,227 @@
+/*
+ * PosixFileScannerTests.cpp
+ *
+ * Copyright (C) 2022 by RStudio, PBC
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef _WIN32
+
+#include <tests/TestThat.hpp>
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+#include <shared_core/FilePath.hpp>
+
+#include <core/FileSerializer.hpp>
+#include <core/Log.hpp>
+#include <core/system/FileScanner.hpp>
+
+namespace rstudio {
+namespace core {
+namespace system {
+namespace tests {
+
+namespace {
+
+// a directory tree with dirCount directories (each with subdirCount
+// subdirectories) of filesPerDir files
+FilePath createTree(std::size_t dirCount, std::size_t subdirCount, std::size_t filesPerDir)
+{
+   FilePath root;
+   Error error = FilePath::tempFilePath(root);
+   if (!error)
+      error = root.ensureDirectory();
+   if (error)
+      LOG_ERROR(error);
+
+   for (std::size_t i = 0; i < dirCount; ++i)
+   {
+      FilePath dir = root.completeChildPath("dir" + std::to_string(i));
+      dir.ensureDirectory();
+      for (std::size_t j = 0; j < subdirCount; ++j)
+      {
+         FilePath subdir = dir.completeChildPath("sub" + std::to_string(j));
+         subdir.ensureDirectory();
+         for (std::size_t k = 0; k < filesPerDir; ++k)
+         {
+            std::string path = subdir.completeChildPath("file" + std::to_string(k) + ".R").getAbsolutePath();
+            FILE* pFile = ::fopen(path.c_str(), "w");
+            if (pFile)
+               ::fclose(pFile);
+         }
+      }
+   }
+
+   return root;
+}
+
+std::vector<std::string> scannedPaths(const FilePath& root,
+                                      const FileScannerOptions& options)
+{
+   tree<FileInfo> files;
+   Error error = scanFiles(FileInfo(root), options, &files);
+   if (error)
+      LOG_ERROR(error);
+
+   // (depth first, in the order of the tree)
+   std::vector<std::string> paths;
+   for (tree<FileInfo>::iterator it = files.begin(); it != files.end(); ++it)
+      paths.push_back(it->absolutePath());
+   return paths;
+}
+
+} // anonymous namespace
+
+test_context("PosixFileScanner")
+{
+   FilePath root = createTree(3, 4, 5);
+   writeStringToFile(root.completeChildPath("data.csv"), "a,b\n1,2\n");
+   ::symlink(root.completeChildPath("dir0").getAbsolutePath().c_str(),
+             root.completeChildPath("link").getAbsolutePath().c_str());
+
+   FileScannerOptions options;
+   options.recursive = true;
+
+   test_that("Files are listed with their attributes and links aren't followed")
+   {
+      tree<FileInfo> files;
+      expect_false(scanFiles(FileInfo(root), options, &files));
+
+      // the root, 3 dirs, 12 subdirs, 60 files, a csv and a link
+      expect_true(files.size() == 78);
+
+      bool foundCsv = false, foundLink = false;
+      for (tree<FileInfo>::iterator it = files.begin(); it != files.end(); ++it)
+      {
+         if (it->absolutePath() == root.completeChildPath("data.csv").getAbsolutePath())
+         {
+            foundCsv = true;
+            expect_true(it->size() == 8);
+            expect_false(it->isDirectory());
+         }
+         else if (it->absolutePath() == root.completeChildPath("link").getAbsolutePath())
+         {
+            foundLink = true;
+            expect_true(it->isSymlink());
+            expect_true(files.number_of_children(it) == 0);
+         }
+      }
+      expect_true(foundCsv && foundLink);
+   }
+
+   test_that("Scans with several threads build the same sorted tree")
+   {
+      std::vector<std::string> serial = scannedPaths(root, options);
+
+      options.threads = 4;
+      std::vector<std::string> parallel = scannedPaths(root, options);
+      options.threads = 1;
+
+      expect_true(serial == parallel);
+
+      // siblings are sorted by name
+      expect_true(serial[1] == root.completeChildPath("data.csv").getAbsolutePath());
+      expect_true(serial[2] == root.completeChildPath("dir0").getAbsolutePath());
+   }
+
+   test_that("Unsorted scans find the same files")
+   {
+      std::vector<std::string> sorted = scannedPaths(root, options);
+
+      options.threads = 4;
+      options.sort = false;
+      std::vector<std::string> unsorted = scannedPaths(root, options);
+      options.sort = true;
+      options.threads = 1;
+
+      std::sort(sorted.begin(), sorted.end());
+      std::sort(unsorted.begin(), unsorted.end());
+      expect_true(sorted == unsorted);
+   }
+
+   test_that("Callbacks are not called concurrently")
+   {
+      std::atomic<int> active(0);
+      std::atomic<bool> overlapped(false);
+      std::atomic<int> dirsScanned(0);
+
+      FileScannerOptions callbackOptions;
+      callbackOptions.recursive = true;
+      callbackOptions.threads = 4;
+      callbackOptions.onBeforeScanDir = [&](const FileInfo&) {
+         if (++active > 1)
+            overlapped = true;
+         ++dirsScanned;
+         --active;
+         return Success();
+      };
+      callbackOptions.filter = [&](const FileInfo& fileInfo) {
+         if (++active > 1)
+            overlapped = true;
+         --active;
+         return fileInfo.absolutePath().find("sub3") == std::string::npos;
+      };
+
+      std::vector<std::string> paths = scannedPaths(root, callbackOptions);
+
+      expect_false(overlapped);
+
+      // the root, 3 dirs and the 9 subdirs not filtered out (along with
+      // their 45 files, a csv and a link)
+      expect_true(dirsScanned == 13);
+      expect_true(paths.size() == 60);
+   }
+
+   root.removeIfExists();
+}
+
+TEST_CASE("PosixFileScanner benchmark", "[.benchmark]")
+{
+   // 500k files, in 1000 directories
+   FilePath root = createTree(40, 25, 500);
+
+   FileScannerOptions options;
+   options.recursive = true;
+
+   for (bool sort : { true, false })
+   {
+      for (std::size_t threads : { 1, 2, 4, 8, 16 })
+      {
+         options.sort = sort;
+         options.threads = threads;
+
+         auto start = std::chrono::steady_clock::now();
+         tree<FileInfo> files;
+         REQUIRE_FALSE(scanFiles(FileInfo(root), options, &files));
+         double seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start).count();
+
+         std::cout << threads << " threads" << (sort ? ", sorted: " : ", unsorted: ")
+                   << files.size() << " entries in " << seconds << "s" << std::endl;
+      }
+   }
+
+   root.removeIfExists();
+}
+
+} // namespace tests
+} // namespace system
+} // namespace core
+} // namespace rstudio
+
+#endif // _WIN32
@@ -19,6 +19,7 @@
 
 #include <iostream>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <boost/algorithm/string.hpp>
@@ -1125,47 +1126,110 @@ std::vector<SubprocInfo> getSubprocessesMac(PidType pid)
 
 #else
 
-std::vector<SubprocInfo> getSubprocessesViaProcFs(PidType pid)
+namespace {
+
+// a process as read from its /proc/<pid>/stat file
+struct ProcStat
 {
-   std::vector<SubprocInfo> subprocs;
+   PidType pid;
+   PidType ppid;
+   std::string exe;
+};
 
-   core::FilePath procFsPath("/proc");
-   if (!procFsPath.exists())
+// The parent pid is the fourth field (whitespace separated) in the
+// single-line of the stat file. The first field is an int, second field
+// is a string enclosed in parenthesis (...), the third is a single
+// character, and the fourth is the parent pid (int). There are numerous
+// fields after that, all ints of varying sizes.
+//
+// The trick is that the third field can contain arbitrary text,
+// including whitespace and more parenthesis, inside its surrounding
+// parenthesis. The safe way to parse this is to search the file
+// in reverse for the closing parenthesis, then seek forward until we
+// reach the first integer character.
+//
+// An example:
+//    4075 (My )(great Program) S 4074 ....
+bool parseProcStat(const std::string& contents, ProcStat* pStat)
+{
+   size_t closingParen = contents.find_last_of(')');
+   if (closingParen == std::string::npos)
    {
-      return getSubprocessesViaPgrep(pid);
+      LOG_ERROR_MESSAGE("no closing parenthesis");
+      return false;
    }
 
-   // We iterate all /proc/###/stat files, where ### is a process id.
-   //
-   // The parent pid is the fourth field (whitespace separated) in the
-   // single-line of the stat file. The first field is an int, second field
-   // is a string enclosed in parenthesis (...), the third is a single
-   // character, and the fourth is the parent pid (int). There are numerous
-   // fields after that, all ints of varying sizes.
-   //
-   // The trick is that the third field can contain arbitrary text,
-   // including whitespace and more parenthesis, inside its surrounding
-   // parenthesis. The safe way to parse this is to search the file
-   // in reverse for the closing parenthesis, then seek forward until we
-   // reach the first integer character.
-   //
-   // An example:
-   //    4075 (My )(great Program) S 4074 ....
+   size_t i = contents.find_first_of("0123456789", closingParen);
+   if (i == std::string::npos)
+   {
+      LOG_ERROR_MESSAGE("no integer after closing parenthesis");
+      return false;
+   }
 
-   std::vector<FilePath> children;
-   Error error = procFsPath.getChildren(children);
-   if (error)
+   size_t j = contents.find_first_not_of("0123456789", i);
+   if (j == std::string::npos)
    {
-      LOG_ERROR(error);
-      return subprocs;
+      LOG_ERROR_MESSAGE("no non-int after first int");
+      return false;
+   }
+
+   size_t ppidLen = j - i;
+   pStat->ppid = safe_convert::stringTo<PidType>(contents.substr(i, ppidLen), -1);
+   if (pStat->ppid == -1)
+   {
+      LOG_ERROR_MESSAGE("unrecognized parent process id");
+      return false;
+   }
+
+   size_t openParen = contents.find_first_of('(');
+   if (openParen == std::string::npos)
+   {
+      LOG_ERROR_MESSAGE("no opening parenthesis");
+      return false;
+   }
+   if (openParen < 2) // at a minimum, "# (foo)"
+   {
+      LOG_ERROR_MESSAGE("no pid before exe name");
+      return false;
+   }
+   if (closingParen < openParen)
+   {
+      LOG_ERROR_MESSAGE("closing paren before open paren");
+      return false;
    }
 
-   for (const FilePath& child : children)
+   pStat->exe = contents.substr(openParen + 1, closingParen - openParen - 1);
+   pStat->pid = safe_convert::stringTo<PidType>(contents.substr(0, openParen - 1), -1);
+   if (pStat->pid == -1)
    {
+      LOG_ERROR_MESSAGE("unrecognized child process id");
+      return false;
+   }
+
+   return true;
+}
+
+// read the stat file of every process; returns false if procfs isn't
+// available. the fields we need are at the start of the (single line) stat
+// file, so each is read with a single read into a fixed buffer
+bool readProcessTable(std::vector<ProcStat>* pProcesses)
+{
+   DIR* pProcDir = ::opendir("/proc");
+   if (pProcDir == nullptr)
+      return false;
+
+   int procFd = ::dirfd(pProcDir);
+   char buffer[1024];
+   for (;;)
+   {
+      struct dirent* pEntry = ::readdir(pProcDir);
+      if (pEntry == nullptr)
+         break;
+
       // only interested in the numeric directories (pid)
-      std::string filename = child.getFilename();
-      bool isNumber = true;
-      for (std::string::const_iterator k = filename.begin(); k != filename.end(); ++k)
+      const char* name = pEntry->d_name;
+      bool isNumber = *name != '\0';
+      for (const char* k = name; *k != '\0'; ++k)
       {
          if (!isdigit(*k))
          {
@@ -1177,78 +1241,113 @@ std::vector<SubprocInfo> getSubprocessesViaProcFs(PidType pid)
       if (!isNumber)
          continue;
 
-      // load the stat file
-      std::string contents;
-      FilePath statFile(child.completePath("stat"));
-      Error error = rstudio::core::readStringFromFile(statFile, &contents);
-      if (error)
-      {
+      // load the stat file (the process may have exited since we listed it)
+      std::string statPath = std::string(name) + "/stat";
+      int fd = ::openat(procFd, statPath.c_str(), O_RDONLY | O_CLOEXEC);
+      if (fd == -1)
          continue;
-      }
 
-      size_t closingParen = contents.find_last_of(')');
-      if (closingParen == std::string::npos)
-      {
-         LOG_ERROR_MESSAGE("no closing parenthesis");
+      ssize_t bytesRead = ::read(fd, buffer, sizeof(buffer));
+      ::close(fd);
+      if (bytesRead <= 0)
          continue;
-      }
 
-      size_t i = contents.find_first_of("0123456789", closingParen);
-      if (i == std::string::npos)
-      {
-         LOG_ERROR_MESSAGE("no integer after closing parenthesis");
-         continue;
-      }
+      ProcStat stat;
+      if (parseProcStat(std::string(buffer, bytesRead), &stat))
+         pProcesses->push_back(stat);
+   }
 
-      size_t j = contents.find_first_not_of("0123456789", i);
-      if (j == std::string::npos)
-      {
-         LOG_ERROR_MESSAGE("no non-int after first int");
-         continue;
-      }
+   ::closedir(pProcDir);
+   return true;
+}
 
-      size_t ppidLen = j - i;
-      PidType ppid = safe_convert::stringTo<PidType>(contents.substr(i, ppidLen), -1);
-      if (ppid == -1)
-      {
-         LOG_ERROR_MESSAGE("unrecognized parent process id");
-         continue;
-      }
-      if (ppid != pid)
-      {
-         continue;
-      }
+// the child processes of every process, as of the last time the process
+// table was read; shared by everyone polling for subprocesses so that the
+// table is read at most once per interval no matter how many are polling
+class ProcessTableSnapshot : boost::noncopyable
+{
+public:
+   ProcessTableSnapshot() : valid_(false) {}
 
-      size_t openParen = contents.find_first_of('(');
-      if (openParen == std::string::npos)
-      {
-         LOG_ERROR_MESSAGE("no opening parenthesis");
-         continue;
-      }
-      if (openParen < 2) // at a minimum, "# (foo)"
-      {
-         LOG_ERROR_MESSAGE("no pid before exe name");
-         continue;
-      }
-      if (closingParen < openParen)
+   bool getSubprocesses(PidType pid,
+                        const boost::posix_time::time_duration& maxAge,
+                        std::vector<SubprocInfo>* pSubprocs)
+   {
+      LOCK_MUTEX(mutex_)
       {
-         LOG_ERROR_MESSAGE("closing paren before open paren");
-         continue;
+         boost::posix_time::ptime now = boost::posix_time::microsec_clock::universal_time();
+         if (!valid_ || now - readTime_ >= maxAge)
+         {
+            std::vector<ProcStat> processes;
+            if (!readProcessTable(&processes))
+               return false;
+
+            children_.clear();
+            for (const ProcStat& process : processes)
+            {
+               SubprocInfo info;
+               info.pid = process.pid;
+               info.exe = process.exe;
+               children_[process.ppid].push_back(info);
+            }
+
+            readTime_ = now;
+            valid_ = true;
+         }
+
+         auto it = children_.find(pid);
+         if (it != children_.end())
+            *pSubprocs = it->second;
+         return true;
       }
+      END_LOCK_MUTEX
+
+      return false;
+   }
 
-      SubprocInfo info;
-      info.exe = contents.substr(openParen + 1, closingParen - openParen - 1);
-      info.pid = safe_convert::stringTo<PidType>(contents.substr(0, openParen - 1), -1);
-      if (info.pid == -1)
+private:
+   boost::mutex mutex_;
+   bool valid_;
+   boost::posix_time::ptime readTime_;
+   std::unordered_map<PidType, std::vector<SubprocInfo> > children_;
+};
+
+} // anonymous namespace
+
+std::vector<SubprocInfo> getSubprocessesViaProcFs(PidType pid)
+{
+   std::vector<ProcStat> processes;
+   if (!readProcessTable(&processes))
+      return getSubprocessesViaPgrep(pid);
+
+   std::vector<SubprocInfo> subprocs;
+   for (const ProcStat& process : processes)
+   {
+      if (process.ppid == pid)
       {
-         LOG_ERROR_MESSAGE("unrecognized child process id");
-         continue;
+         SubprocInfo info;
+         info.pid = process.pid;
+         info.exe = process.exe;
+         subprocs.push_back(info);
       }
-      subprocs.push_back(info);
    }
 
    return subprocs;
 }
+
+std::vector<SubprocInfo> getSubprocessesViaProcFsSnapshot(
+      PidType pid,
+      const boost::posix_time::time_duration& maxAge)
+{
+   // (leaked to avoid destruction order issues at exit)
+   static ProcessTableSnapshot* s_pSnapshot = new ProcessTableSnapshot();
+
+   std::vector<SubprocInfo> subprocs;
+   if (!s_pSnapshot->getSubprocesses(pid, maxAge, &subprocs))
+      return getSubprocessesViaPgrep(pid);
+
+   return subprocs;
+}
 #endif // !__APPLE__
 
 std::vector<SubprocInfo> getSubprocesses(PidType pid)
@@ -1260,6 +1359,18 @@ std::vector<SubprocInfo> getSubprocesses(PidType pid)
 #endif
 }
 
+std::vector<SubprocInfo> getSubprocessesFromSnapshot(
+      PidType pid,
+      const boost::posix_time::time_duration& maxAge)
+{
+#ifdef __APPLE__
+   // (the mac api lists the children of a single process, so is cheap)
+   return getSubprocessesMac(pid);
+#else // Linux
+   return getSubprocessesViaProcFsSnapshot(pid, maxAge);
+#endif
+}
+
 #ifdef __APPLE__
 
 FilePath currentWorkingDirMac(PidType pid)
@@ -21,6 +21,10 @@
 #include <sys/wait.h>
 #include <unistd.h>
 #include <grp.h>
+
+#include <chrono>
+#include <iostream>
+
 #include <tests/TestThat.hpp>
 
 namespace rstudio {
@@ -274,6 +278,36 @@ test_context("PosixSystemTests")
          ::waitpid(pid, nullptr, 0);
       }
    }
+
+   test_that("Subprocess detected correctly with procfs snapshot, which is shared until stale")
+   {
+      pid_t pid = fork();
+      expect_false(pid == -1);
+      std::string exe = "sleep";
+
+      if (pid == 0)
+      {
+         execlp(exe.c_str(), exe.c_str(), "10000", nullptr);
+         expect_true(false); // shouldn't get here!
+      }
+      else
+      {
+         ::sleep(1);
+         boost::posix_time::seconds fresh(0);
+         boost::posix_time::hours stale(1);
+
+         std::vector<SubprocInfo> children = getSubprocessesViaProcFsSnapshot(getpid(), fresh);
+         expect_true(children.size() == 1 && children[0].pid == pid && children[0].exe == exe);
+
+         ::kill(pid, SIGKILL);
+         ::waitpid(pid, nullptr, 0);
+
+         // the snapshot is reused (so still lists the subprocess) until it's
+         // older than the given age
+         expect_true(getSubprocessesViaProcFsSnapshot(getpid(), stale).size() == 1);
+         expect_true(getSubprocessesViaProcFsSnapshot(getpid(), fresh).empty());
+      }
+   }
 #endif // !__APPLE__
 
    test_that("Empty list of subprocesses returned correctly with generic method")
@@ -550,6 +584,63 @@ TEST_CASE("PermanentlyDropPrivAlternateTests", "[requiresRoot]")
    }
 }
 
+#ifndef __APPLE__
+
+TEST_CASE("Subprocess polling benchmark", "[.benchmark]")
+{
+   // poll each "terminal" (a child process) for subprocesses once, as each
+   // terminal does every 200ms, reading the process table for each or
+   // sharing a snapshot of it
+   std::vector<pid_t> terminals;
+   for (std::size_t count : { 1, 5, 10, 20 })
+   {
+      while (terminals.size() < count)
+      {
+         pid_t pid = fork();
+         REQUIRE(pid != -1);
+         if (pid == 0)
+         {
+            ::sleep(10000);
+            _exit(0);
+         }
+         terminals.push_back(pid);
+      }
+
+      for (bool snapshot : { false, true })
+      {
+         const int kRounds = 20;
+         auto start = std::chrono::steady_clock::now();
+         for (int i = 0; i < kRounds; ++i)
+         {
+            for (pid_t pid : terminals)
+            {
+               if (snapshot)
+                  getSubprocessesViaProcFsSnapshot(pid, boost::posix_time::milliseconds(100));
+               else
+                  getSubprocessesViaProcFs(pid);
+            }
+
+            // the next round is an interval later, so needs a fresh snapshot
+            if (snapshot)
+               getSubprocessesViaProcFsSnapshot(0, boost::posix_time::seconds(0));
+         }
+         double ms = std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - start).count() / kRounds;
+
+         std::cout << count << " terminals, " << (snapshot ? "shared snapshot: " : "read each: ")
+                   << ms << "ms per poll interval" << std::endl;
+      }
+   }
+
+   for (pid_t pid : terminals)
+   {
+      ::kill(pid, SIGKILL);
+      ::waitpid(pid, nullptr, 0);
+   }
+}
+
+#endif // !__APPLE__
+
 } // end namespace tests
 } // end namespace system
 } // end namespace core
@@ -16,6 +16,13 @@
 #include <core/system/Process.hpp>
 
 #include <iostream>
+#include <map>
+#include <set>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <unistd.h>
+#endif
 
 #include <boost/algorithm/cxx11/any_of.hpp>
 #include <boost/bind/bind.hpp>
@@ -83,18 +90,90 @@ Error runCommand(const std::string& command,
 
 struct ProcessSupervisor::Impl
 {
-   Impl() : isPolling(false) {}
+   Impl() : isPolling(false), epollFd(-1), nextWatchId(1) {}
    bool isPolling;
    std::vector<boost::shared_ptr<AsyncChildProcess> > children;
+
+   // children report their output and exit through epoll (where supported)
+   // so that each poll need only read from (and reap) those with activity,
+   // and wait can sleep until there is some. ids are 0 for children which
+   // can't be watched, and so are checked on every poll
+   int epollFd;
+   uint64_t nextWatchId;
+   std::map<AsyncChildProcess*, uint64_t> watchIds;
+
+   // returns the ids of the children with events pending, waiting up to
+   // timeoutMs for some
+   std::set<uint64_t> waitForEvents(int timeoutMs)
+   {
+      std::set<uint64_t> ids;
+#ifdef __linux__
+      if (epollFd == -1)
+         return ids;
+
+      const int kMaxEvents = 64;
+      struct epoll_event events[kMaxEvents];
+      for (;;)
+      {
+         int count = ::epoll_wait(epollFd, events, kMaxEvents, timeoutMs);
+         if (count == -1)
+         {
+            if (errno != EINTR)
+               LOG_ERROR(systemError(errno, ERROR_LOCATION));
+            break;
+         }
+
+         for (int i = 0; i < count; ++i)
+            ids.insert(events[i].data.u64);
+
+         // (level triggered, so pending events are reported each call)
+         if (count < kMaxEvents)
+            break;
+         timeoutMs = 0;
+      }
+#endif
+      return ids;
+   }
+
+   // poll a child, watching its events if we haven't tried to yet
+   void pollChild(const boost::shared_ptr<AsyncChildProcess>& pChild,
+                  const std::set<uint64_t>& eventIds)
+   {
+      auto it = watchIds.find(pChild.get());
+      if (it == watchIds.end())
+      {
+         uint64_t id = nextWatchId++;
+         if (epollFd == -1 || !pChild->watchEvents(epollFd, id))
+            id = 0;
+         watchIds[pChild.get()] = id;
+
+         pChild->poll(true);
+         return;
+      }
+
+      uint64_t id = it->second;
+      pChild->poll(id == 0 || eventIds.count(id) > 0);
+   }
 };
 
 ProcessSupervisor::ProcessSupervisor()
    : pImpl_(new Impl())
 {
+#ifdef __linux__
+   pImpl_->epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+   if (pImpl_->epollFd == -1)
+      LOG_ERROR(systemError(errno, ERROR_LOCATION));
+#endif
 }
 
 ProcessSupervisor::~ProcessSupervisor()
 {
+#ifdef __linux__
+   // (children stop watching when destroyed, after which this isn't used)
+   pImpl_->children.clear();
+   if (pImpl_->epollFd != -1)
+      ::close(pImpl_->epollFd);
+#endif
 }
 
 namespace {
@@ -347,15 +426,20 @@ bool ProcessSupervisor::poll()
       // runProgram or runCommand. This would then result in a push_back on
       // the children vector and if this required a realloc would invalidate
       // all of the iterators currently pointing into the container
+      std::set<uint64_t> eventIds = pImpl_->waitForEvents(0);
       std::vector<boost::shared_ptr<AsyncChildProcess> > children = pImpl_->children;
-      std::for_each(children.begin(),
-                    children.end(),
-                    boost::bind(&AsyncChildProcess::poll, _1));
+      for (const boost::shared_ptr<AsyncChildProcess>& pChild : children)
+         pImpl_->pollChild(pChild, eventIds);
 
       // remove any children who have exited from our list. note that it's safe
       // in this case to use pImpl_->children directly because the call to
       // AsyncChildProcess::exited just checks a member variable rather than
       // executing code that could cause re-entry
+      for (const boost::shared_ptr<AsyncChildProcess>& pChild : pImpl_->children)
+      {
+         if (pChild->exited())
+            pImpl_->watchIds.erase(pChild.get());
+      }
       pImpl_->children.erase(std::remove_if(
                                 pImpl_->children.begin(),
                                 pImpl_->children.end(),
@@ -390,8 +474,14 @@ bool ProcessSupervisor::wait(
 
    while (poll())
    {
-      // wait the specified polling interval
-      boost::this_thread::sleep(pollingInterval);
+      // wait the specified polling interval (or until a watched child has
+      // output or exits)
+#ifdef __linux__
+      if (pImpl_->epollFd != -1)
+         pImpl_->waitForEvents(static_cast<int>(pollingInterval.total_milliseconds()));
+      else
+#endif
+         boost::this_thread::sleep(pollingInterval);
 
       // check for timeout if appropriate
       if (!timeoutTime.is_not_a_date_time())
@@ -16,7 +16,9 @@
 #ifndef _WIN32
 
 #include <atomic>
+#include <chrono>
 #include <signal.h>
+#include <sys/resource.h>
 
 #include <boost/bind/bind.hpp>
 #include <boost/thread.hpp>
@@ -592,6 +594,127 @@ test_context("ProcessTests")
       // We also sometimes see exitCode of 1 for generic exits so we allow either one.
       REQUIRE((exitCode == 1 || exitCode == 143));
    }
+
+   test_that("ProcessSupervisor delivers output and exit of watched children")
+   {
+      ProcessSupervisor supervisor;
+
+      const int kChildren = 5;
+      std::string outputs[kChildren];
+      int exitCodes[kChildren];
+      for (int i = 0; i < kChildren; ++i)
+      {
+         exitCodes[i] = -1;
+
+         // more output than fits in a pipe, then more after a pause
+         ProcessCallbacks callbacks;
+         callbacks.onStdout = boost::bind(&appendOutput, _2, outputs + i);
+         callbacks.onExit = boost::bind(&checkExitCode, _1, exitCodes + i);
+         Error error = supervisor.runCommand(
+                  "head -c 200000 /dev/zero; sleep 0.2; echo; exit " +
+                     safe_convert::numberToString(i),
+                  ProcessOptions(), callbacks);
+         REQUIRE_FALSE(error);
+      }
+
+      CHECK(supervisor.wait(boost::posix_time::milliseconds(50),
+                            boost::posix_time::seconds(10)));
+      for (int i = 0; i < kChildren; ++i)
+      {
+         CHECK(outputs[i].size() == 200001);
+         CHECK(exitCodes[i] == i);
+      }
+   }
+
+   test_that("ProcessSupervisor reports exit of children whose output is still open")
+   {
+      ProcessSupervisor supervisor;
+
+      // the background subprocess keeps stdout open after the child exits
+      int exitCode = -1;
+      ProcessCallbacks callbacks;
+      callbacks.onExit = boost::bind(&checkExitCode, _1, &exitCode);
+      ProcessOptions options;
+      options.detachSession = true;
+      Error error = supervisor.runCommand("sleep 3 & exit 7", options, callbacks);
+      REQUIRE_FALSE(error);
+
+      auto start = std::chrono::steady_clock::now();
+      CHECK(supervisor.wait(boost::posix_time::milliseconds(50),
+                            boost::posix_time::seconds(10)));
+      double seconds = std::chrono::duration<double>(
+                          std::chrono::steady_clock::now() - start).count();
+
+      CHECK(exitCode == 7);
+      CHECK(seconds < 2);
+   }
+}
+
+double cpuSeconds()
+{
+   struct rusage usage;
+   ::getrusage(RUSAGE_SELF, &usage);
+   return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+          usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+TEST_CASE("ProcessSupervisor benchmark", "[.benchmark]")
+{
+   // build output: many short lines, read as the session does (waiting
+   // between polls)
+   {
+      ProcessSupervisor supervisor;
+      std::size_t bytes = 0;
+      ProcessCallbacks callbacks;
+      callbacks.onStdout = [&](ProcessOperations&, const std::string& output) {
+         bytes += output.size();
+      };
+      Error error = supervisor.runCommand(
+               "yes 'gcc -O2 -c src/module.cpp -o build/module.o' | head -c 100000000",
+               ProcessOptions(), callbacks);
+      REQUIRE_FALSE(error);
+
+      auto start = std::chrono::steady_clock::now();
+      supervisor.wait(boost::posix_time::milliseconds(50));
+      double seconds = std::chrono::duration<double>(
+                          std::chrono::steady_clock::now() - start).count();
+
+      CHECK(bytes == 100000000);
+      std::cout << "build output: " << (bytes / seconds) / (1024 * 1024) << " MB/s" << std::endl;
+   }
+
+   // idle children: the cost of each poll while 50 children wait
+   {
+      ProcessSupervisor supervisor;
+      const int kChildren = 50;
+      for (int i = 0; i < kChildren; ++i)
+      {
+         ProcessCallbacks callbacks;
+         callbacks.onStdout = [](ProcessOperations&, const std::string&) {};
+         Error error = supervisor.runCommand("sleep 30", ProcessOptions(), callbacks);
+         REQUIRE_FALSE(error);
+      }
+      supervisor.poll();
+
+      const int kPolls = 300;
+      double cpuStart = cpuSeconds();
+      auto start = std::chrono::steady_clock::now();
+      for (int i = 0; i < kPolls; ++i)
+      {
+         supervisor.poll();
+         boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+      }
+      double seconds = std::chrono::duration<double>(
+                          std::chrono::steady_clock::now() - start).count();
+      double cpu = cpuSeconds() - cpuStart;
+
+      std::cout << kChildren << " idle children: "
+                << 1e6 * cpu / kPolls << "us cpu per poll, "
+                << 100 * cpu / seconds << "% cpu polling every 10ms" << std::endl;
+
+      supervisor.terminateAll();
+      supervisor.wait(boost::posix_time::milliseconds(10), boost::posix_time::seconds(10));
+   }
 }
 
 } // end namespace tests
@@ -680,7 +680,7 @@ bool AsyncChildProcess::hasRecentOutput() const
       return true;
 }
 
-void AsyncChildProcess::poll()
+void AsyncChildProcess::poll(bool /*hasEvents*/)
 {
    // skip polling if we're not on the main thread,
    // and the process options request we run on the main thread only
@@ -794,6 +794,11 @@ void AsyncChildProcess::poll()
       pAsyncImpl_->pSubprocPoll_->stop();
    }
 
+   pollSubprocs(hasRecentOutput);
+}
+
+void AsyncChildProcess::pollSubprocs(bool hasRecentOutput)
+{
    // Perform optional periodic operations
    if (pAsyncImpl_->pSubprocPoll_->poll(hasRecentOutput))
    {
@@ -491,6 +491,9 @@ Handle registerMonitor(const core::FilePath& filePath,
    options.yield = true;
    options.filter = filter;
    options.onBeforeScanDir = addWatchFunction(pContext, true);
+   // (scanning mostly waits on the file system, so use a few threads
+   // even on machines with few cores; this helps most on network drives)
+   options.threads = 4;
    Error error = scanFiles(FileInfo(filePath), options, &pContext->fileTree);
    if (error)
    {
@@ -314,6 +314,9 @@ Handle registerMonitor(const FilePath& filePath,
    options.recursive = recursive;
    options.yield = true;
    options.filter = filter;
+   // (scanning mostly waits on the file system, so use a few threads
+   // even on machines with few cores; this helps most on network drives)
+   options.threads = 4;
    Error error = scanFiles(FileInfo(filePath), options, &pContext->fileTree);
    if (error)
    {
@@ -426,6 +426,48 @@ void listEnvironment(SEXP env,
    }
 }
 
+void listEnvironmentBindings(SEXP env,
+                             bool includeAll,
+                             bool includeLastDotValue,
+                             std::vector<Binding>* pBindings)
+{
+   if (!ASSERT_MAIN_THREAD())
+      return;
+
+   pBindings->clear();
+
+   // get the (unsorted) list of environment vars; we look up each binding
+   // by symbol, so there's no need to convert the names to strings
+   SEXP envVarsSEXP;
+   Protect rProtect(envVarsSEXP = R_lsInternal3(env, includeAll ? TRUE : FALSE, FALSE));
+
+   int count = Rf_length(envVarsSEXP);
+   pBindings->reserve(count + 1);
+   for (int i = 0; i < count; i++)
+   {
+      SEXP symbolSEXP = Rf_installTrChar(STRING_ELT(envVarsSEXP, i));
+
+      // Merely calling Rf_findVarInFrame on an active binding will fire the
+      // binding. Don't try to get the SEXP for the variable in this case;
+      // leave the value as nil.
+      SEXP varSEXP = R_NilValue;
+      if (!R_BindingIsActive(symbolSEXP, env))
+         varSEXP = Rf_findVarInFrame(env, symbolSEXP);
+
+      if (varSEXP != R_UnboundValue) // should never be unbound
+         pBindings->push_back(std::make_pair(PRINTNAME(symbolSEXP), varSEXP));
+   }
+
+   // add in .Last.value if it exists
+   if (!includeAll && includeLastDotValue)
+   {
+      SEXP symbolSEXP = Rf_install(".Last.value");
+      SEXP lastValueSEXP = Rf_findVar(symbolSEXP, env);
+      if (lastValueSEXP != R_UnboundValue)
+         pBindings->push_back(std::make_pair(PRINTNAME(symbolSEXP), lastValueSEXP));
+   }
+}
+
 
 void listNamedAttributes(SEXP obj, Protect *pProtect, std::vector<Variable>* pVariables)
 {
@@ -66,6 +66,15 @@ void listEnvironment(SEXP env,
                      bool includeLastDotValue,
                      Protect* pProtect,
                      std::vector<Variable>* pVariables);
+
+// bindings within an environment, in no particular order. names are the
+// CHARSXPs of the bound symbols (so equal names share an address, and needn't
+// be protected), and values are as for listEnvironment
+typedef std::pair<SEXP,SEXP> Binding;
+void listEnvironmentBindings(SEXP env,
+                             bool includeAll,
+                             bool includeLastDotValue,
+                             std::vector<Binding>* pBindings);
       
 // object info
 SEXP findVar(const std::string& name,
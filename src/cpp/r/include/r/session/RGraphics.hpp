@@ -83,6 +83,11 @@ namespace device {
 
 double devicePixelRatio();
 
+// resizes the device to the size last given to it once that's due: shortly
+// after a one-off change of size, or once the size has stopped changing
+// while the plots pane is being resized (called periodically)
+void resizeIfSettled();
+
 }
    
 struct DisplayState
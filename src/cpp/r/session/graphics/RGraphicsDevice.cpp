@@ -19,11 +19,14 @@
 
 #include <boost/thread.hpp>
 #include <boost/bind/bind.hpp>
+#include <boost/format.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
 
 #include <shared_core/Error.hpp>
 #include <shared_core/FilePath.hpp>
 
 #include <core/FileSerializer.hpp>
+#include <core/Log.hpp>
 #include <core/system/Environment.hpp>
 
 #include <r/RExec.hpp>
@@ -83,6 +86,53 @@ boost::function<bool(double*, double*)> s_locatorFunction;
 int s_width = 0;
 int s_height = 0;
 double s_devicePixelRatio = 1.0;
+
+// how long we wait before resizing the device to a new size. a one-off
+// change of size is applied after a short debounce; while the pane is being
+// resized (the client sends sizes at most every 500ms) we wait for the size
+// to settle, so that the sizes in between are skipped
+const int kResizeDebounceMs = 100;
+const int kResizeSettleMs = 750;
+
+// a size given to setSize which we've yet to resize the device to (sizes
+// arrive continuously while the pane is resized, and resizing the device
+// replays the whole display list)
+struct PendingResize
+{
+   PendingResize()
+      : width(0), height(0), devicePixelRatio(0),
+        requested(boost::posix_time::not_a_date_time),
+        applyAfter(boost::posix_time::not_a_date_time)
+   {
+   }
+
+   int width;
+   int height;
+   double devicePixelRatio;
+   boost::posix_time::ptime requested;
+   boost::posix_time::ptime applyAfter;
+};
+PendingResize s_pendingResize;
+
+// when the last size was given to setSize (a size arriving soon after it
+// means the pane is still being resized)
+boost::posix_time::ptime s_lastSizeRequested(boost::posix_time::not_a_date_time);
+
+// statistics for the current resize (from the first size requested until
+// the size has settled)
+struct ResizeStats
+{
+   ResizeStats()
+      : sizesRequested(0), replays(0),
+        replayTime(boost::posix_time::milliseconds(0))
+   {
+   }
+
+   int sizesRequested;
+   int replays;
+   boost::posix_time::time_duration replayTime;
+};
+ResizeStats s_resizeStats;
    
 // provide GraphicsDeviceEvents for plot manager
 GraphicsDeviceEvents s_graphicsDeviceEvents;
@@ -489,7 +539,11 @@ void resyncDisplayList()
 void resizeGraphicsDevice()
 {
    // resync display list
+   using namespace boost::posix_time;
+   ptime start = microsec_clock::universal_time();
    resyncDisplayList();
+   s_resizeStats.replays++;
+   s_resizeStats.replayTime += microsec_clock::universal_time() - start;
 
    // notify listeners of resize
    s_graphicsDeviceEvents.onResized();
@@ -739,8 +793,26 @@ std::string imageFileExtension()
    return "png";
 }
 
+void applyPendingResize()
+{
+   if (s_pendingResize.requested.is_not_a_date_time())
+      return;
+
+   s_width = s_pendingResize.width;
+   s_height = s_pendingResize.height;
+   s_devicePixelRatio = s_pendingResize.devicePixelRatio;
+   s_pendingResize = PendingResize();
+
+   // if there is a device active sync its size
+   if (s_pGEDevDesc != nullptr)
+      resizeGraphicsDevice();
+}
+
 void onBeforeExecute()
 {
+   // code may draw on (or ask the size of) the device
+   applyPendingResize();
+
    if (s_pGEDevDesc != nullptr)
    {
       DeviceContext* pDC = (DeviceContext*)s_pGEDevDesc->dev->deviceSpecific;
@@ -825,17 +897,92 @@ Error initialize(
 
 void setSize(int width, int height, double devicePixelRatio)
 {
+   bool pending = !s_pendingResize.requested.is_not_a_date_time();
+
    // only set if the values have changed (prevents unnecessary plot 
    // invalidations from occurring)
-   if ( width != s_width || height != s_height || devicePixelRatio != s_devicePixelRatio)
+   if ( width == s_width && height == s_height && devicePixelRatio == s_devicePixelRatio)
+   {
+      // (back to the size we started at)
+      if (pending)
+      {
+         s_pendingResize = PendingResize();
+         s_graphicsDeviceEvents.onResizePending();
+      }
+      return;
+   }
+
+   // without a device there's nothing to replay
+   if (s_pGEDevDesc == nullptr)
    {
       s_width = width;
       s_height = height;
       s_devicePixelRatio = devicePixelRatio;
-      
-      // if there is a device active sync its size
-      if (s_pGEDevDesc != nullptr)
-         resizeGraphicsDevice();
+      s_pendingResize = PendingResize();
+      return;
+   }
+
+   // otherwise wait for the size to settle before resizing the device
+   if (pending &&
+       width == s_pendingResize.width &&
+       height == s_pendingResize.height &&
+       devicePixelRatio == s_pendingResize.devicePixelRatio)
+   {
+      return;
+   }
+
+   using namespace boost::posix_time;
+   ptime now = microsec_clock::universal_time();
+   bool resizing = !s_lastSizeRequested.is_not_a_date_time() &&
+                   now < s_lastSizeRequested + milliseconds(kResizeSettleMs);
+
+   s_pendingResize.width = width;
+   s_pendingResize.height = height;
+   s_pendingResize.devicePixelRatio = devicePixelRatio;
+   s_pendingResize.requested = now;
+   s_pendingResize.applyAfter = now + milliseconds(resizing ? kResizeSettleMs : kResizeDebounceMs);
+   s_lastSizeRequested = now;
+   s_resizeStats.sizesRequested++;
+
+   // (gives the plot manager the chance to show a preview at the new size)
+   s_graphicsDeviceEvents.onResizePending();
+}
+
+bool pendingSize(int* pWidth, int* pHeight, double* pDevicePixelRatio)
+{
+   if (s_pendingResize.requested.is_not_a_date_time())
+      return false;
+
+   *pWidth = s_pendingResize.width;
+   *pHeight = s_pendingResize.height;
+   *pDevicePixelRatio = s_pendingResize.devicePixelRatio;
+   return true;
+}
+
+void resizeIfSettled()
+{
+   using namespace boost::posix_time;
+   ptime now = microsec_clock::universal_time();
+   if (!s_pendingResize.requested.is_not_a_date_time())
+   {
+      if (now < s_pendingResize.applyAfter)
+         return;
+
+      // (replaying the display list may raise R errors)
+      Error error = r::exec::executeSafely(applyPendingResize);
+      if (error)
+         LOG_ERROR(error);
+   }
+
+   // report on the resize once it's complete (no more sizes have arrived)
+   if (s_resizeStats.sizesRequested > 0 &&
+       now >= s_lastSizeRequested + milliseconds(kResizeSettleMs))
+   {
+      boost::format fmt("Plots resized: %1% sizes requested, %2% replays in %3%ms");
+      LOG_DEBUG_MESSAGE(boost::str(fmt % s_resizeStats.sizesRequested %
+                                         s_resizeStats.replays %
+                                         s_resizeStats.replayTime.total_milliseconds()));
+      s_resizeStats = ResizeStats();
    }
 }
    
@@ -46,6 +46,10 @@ int getWidth();
 int getHeight();
 double devicePixelRatio();
 
+// the size most recently given to setSize, if the device has yet to be
+// resized to it (see resizeIfSettled)
+bool pendingSize(int* pWidth, int* pHeight, double* pDevicePixelRatio);
+
 // NOTE: should not be called directly!
 // use RFunction(".rs.GEplayDisplayList") instead to ensure
 // appropriate R calling handlers are active (that function will
@@ -20,14 +20,18 @@
 #include <boost/format.hpp>
 
 #include <shared_core/Error.hpp>
+#include <shared_core/Hash.hpp>
 #include <core/Log.hpp>
 
+#include <core/FileSerializer.hpp>
 #include <core/system/System.hpp>
 #include <core/StringUtils.hpp>
 
 #include <r/RExec.hpp>
 #include <r/session/RGraphics.hpp>
 
+#include "RGraphicsPlotImageCache.hpp"
+
 using namespace rstudio::core;
 
 namespace rstudio {
@@ -41,6 +45,7 @@ Plot::Plot(const GraphicsDeviceFunctions& graphicsDevice,
    : graphicsDevice_(graphicsDevice), 
      baseDirPath_(baseDirPath),
      needsUpdate_(false),
+     renderedPixelRatio_(0),
      manipulator_(manipulatorSEXP)
 {
 }
@@ -54,6 +59,7 @@ Plot::Plot(const GraphicsDeviceFunctions& graphicsDevice,
      storageUuid_(storageUuid),
      renderedSize_(renderedSize),
      needsUpdate_(false),
+     renderedPixelRatio_(0),
      manipulator_()
 {
    // invalidate if the image file doesn't exist (allows the server
@@ -119,15 +125,74 @@ void Plot::saveManipulator() const
       saveManipulator(storageUuid_);
 }
    
-Error Plot::renderFromDisplay()
+bool Plot::renderFromCache()
+{
+   return renderFromCache(graphicsDevice_.displaySize(),
+                          device::devicePixelRatio());
+}
+
+bool Plot::renderFromCache(const DisplaySize& size, double pixelRatio)
 {
-   // we can use our cached representation if we don't need an update and our 
-   // rendered size is the same as the current graphics device size
-   if ( !needsUpdate_ &&
-        (renderedSize() == graphicsDevice_.displaySize()) )
+   // our images are out of date if the plot has changed
+   if (needsUpdate_ || !hasStorage())
+      return false;
+
+   std::string backend = getDefaultBackend();
+
+   // we can use our current image if it was rendered at the same size
+   // (for plots restored from a previous session we only know the size)
+   if (size == renderedSize_ &&
+       (renderedPixelRatio_ == 0 ||
+        (pixelRatio == renderedPixelRatio_ && backend == renderedBackend_)))
    {
-      return Success();
+      return true;
    }
+
+   // otherwise look for an image rendered earlier at this size. it's stored
+   // under a new uuid (as the client caches images by file name)
+   std::string key = imageKey(size, pixelRatio, backend);
+   std::string storageUuid = core::system::generateUuid();
+   FilePath imagePath = imageFilePath(storageUuid);
+   if (key.empty() || !plotImageCache().take(key, imagePath))
+      return false;
+
+   Error error = snapshotFilePath().move(snapshotFilePath(storageUuid));
+   if (error)
+   {
+      LOG_ERROR(error);
+      imagePath.removeIfExists();
+      return false;
+   }
+
+   if (hasManipulatorFile())
+   {
+      error = manipulatorFilePath(storageUuid_).move(manipulatorFilePath(storageUuid));
+      if (error)
+         LOG_ERROR(error);
+   }
+
+   // keep our current image in case we return to its size
+   FilePath previousImagePath = imageFilePath(storageUuid_);
+   if (renderedPixelRatio_ != 0)
+      plotImageCache().insert(imageKey(renderedSize_, renderedPixelRatio_, renderedBackend_),
+                              previousImagePath);
+   error = previousImagePath.removeIfExists();
+   if (error)
+      LOG_ERROR(error);
+
+   storageUuid_ = storageUuid;
+   renderedSize_ = size;
+   renderedPixelRatio_ = pixelRatio;
+   renderedBackend_ = backend;
+   return true;
+}
+
+Error Plot::renderFromDisplay()
+{
+   // we can use a cached image if the plot hasn't changed since it was
+   // rendered at the current graphics device size
+   if (renderFromCache())
+      return Success();
    
    // generate a new storage uuid
    std::string storageUuid = core::system::generateUuid();
@@ -138,9 +203,23 @@ Error Plot::renderFromDisplay()
    Error error = graphicsDevice_.saveSnapshot(snapshotPath, imagePath);
    if (error)
       return Error(errc::PlotRenderingError, error, ERROR_LOCATION);
+
+   // if the plot hasn't changed then keep its previous image, in case we
+   // return to that size; otherwise we'll need to hash the new snapshot
+   if (!needsUpdate_ && hasStorage() && renderedPixelRatio_ != 0)
+   {
+      plotImageCache().insert(imageKey(renderedSize_, renderedPixelRatio_, renderedBackend_),
+                              imageFilePath(storageUuid_));
+   }
+   else if (needsUpdate_)
+   {
+      contentHash_.clear();
+   }
    
    // save rendered size
    renderedSize_ = graphicsDevice_.displaySize();
+   renderedPixelRatio_ = device::devicePixelRatio();
+   renderedBackend_ = getDefaultBackend();
    
    // save manipulator (if any)
    saveManipulator(storageUuid);
@@ -184,6 +263,8 @@ Error Plot::renderFromDisplaySnapshot(SEXP snapshot)
    
    // save rendered size
    renderedSize_ = graphicsDevice_.displaySize();
+   renderedPixelRatio_ = 0;
+   contentHash_.clear();
 
    // save manipulator (if any)
    saveManipulator(storageUuid);
@@ -267,6 +348,38 @@ FilePath Plot::imageFilePath(const std::string& storageUuid) const
    return baseDirPath_.completePath(storageUuid + "." + extension);
 }
 
+std::string Plot::contentHash() const
+{
+   if (contentHash_.empty())
+   {
+      std::string snapshot;
+      Error error = readStringFromFile(snapshotFilePath(), &snapshot);
+      if (error)
+         LOG_ERROR(error);
+      else
+         contentHash_ = hash::crc32HexHash(snapshot);
+   }
+
+   return contentHash_;
+}
+
+std::string Plot::imageKey(const DisplaySize& size,
+                           double devicePixelRatio,
+                           const std::string& backend) const
+{
+   // (we can't identify the plot if its snapshot couldn't be read)
+   std::string hash = contentHash();
+   if (hash.empty())
+      return std::string();
+
+   boost::format fmt("%1%:%2%x%3%@%4%:%5%");
+   return boost::str(fmt % hash %
+                           size.width %
+                           size.height %
+                           devicePixelRatio %
+                           backend);
+}
+
 bool Plot::hasManipulatorFile() const
 {
    return hasStorage() && manipulatorFilePath(storageUuid()).exists();
@@ -65,6 +65,12 @@ public:
    
    void invalidate();
    
+   // use an existing image for the current display size (or the given
+   // size) if there is one (either our own or one we rendered earlier),
+   // returning whether we did
+   bool renderFromCache();
+   bool renderFromCache(const DisplaySize& size, double devicePixelRatio);
+
    core::Error renderFromDisplay();
    core::Error renderFromDisplaySnapshot(SEXP snapshot);
    std::string imageFilename() const;
@@ -82,6 +88,11 @@ private:
    core::FilePath snapshotFilePath(const std::string& storageUuid) const;
    core::FilePath imageFilePath(const std::string& storageUuid) const;
 
+   std::string contentHash() const;
+   std::string imageKey(const DisplaySize& size,
+                        double devicePixelRatio,
+                        const std::string& backend) const;
+
    bool hasManipulatorFile() const;
    core::FilePath manipulatorFilePath(const std::string& storageUuid) const;
    void loadManipulatorIfNecessary() const;
@@ -94,6 +105,14 @@ private:
    DisplaySize renderedSize_;
    bool needsUpdate_;
 
+   // the pixel ratio and backend our image was rendered with (unknown for
+   // plots restored from a previous session)
+   double renderedPixelRatio_;
+   std::string renderedBackend_;
+
+   // hash of our snapshot (read when first needed after the plot changes)
+   mutable std::string contentHash_;
+
    // manipulator and protection scope for it
    mutable PlotManipulator manipulator_;
 };
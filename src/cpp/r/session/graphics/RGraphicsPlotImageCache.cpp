@@ -0,0 +1,151 @@
+/*
+ * RGraphicsPlotImageCache.cpp
+ *
+ * Copyright (C) 2022 by RStudio, PBC
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include "RGraphicsPlotImageCache.hpp"
+
+#include <iterator>
+
+#include <shared_core/Error.hpp>
+#include <core/Log.hpp>
+
+#include <core/system/System.hpp>
+
+using namespace rstudio::core;
+
+namespace rstudio {
+namespace r {
+namespace session {
+namespace graphics {
+
+namespace {
+
+// the most space we'll use for cached images
+const std::uintmax_t kMaxCacheSize = 64 * 1024 * 1024;
+
+} // anonymous namespace
+
+PlotImageCache& plotImageCache()
+{
+   static PlotImageCache instance;
+   return instance;
+}
+
+PlotImageCache::PlotImageCache()
+   : totalSize_(0),
+     maxSize_(kMaxCacheSize)
+{
+}
+
+PlotImageCache::PlotImageCache(std::uintmax_t maxSize)
+   : totalSize_(0),
+     maxSize_(maxSize)
+{
+}
+
+Error PlotImageCache::initialize(const FilePath& cachePath)
+{
+   cachePath_ = cachePath;
+   clear();
+
+   Error error = cachePath_.removeIfExists();
+   if (error)
+      return error;
+
+   return cachePath_.ensureDirectory();
+}
+
+void PlotImageCache::insert(const std::string& key, const FilePath& imageFile)
+{
+   if (cachePath_.isEmpty() || key.empty() || !imageFile.exists())
+      return;
+
+   auto it = index_.find(key);
+   if (it != index_.end())
+      remove(it->second);
+
+   // make sure the cache path exists (it's removed along with the plots
+   // when the graphics device is closed)
+   Error error = cachePath_.ensureDirectory();
+   if (error)
+   {
+      LOG_ERROR(error);
+      return;
+   }
+
+   FilePath cachedFile = cachePath_.completePath(
+            core::system::generateUuid() + imageFile.getExtension());
+   error = imageFile.move(cachedFile);
+   if (error)
+   {
+      LOG_ERROR(error);
+      return;
+   }
+
+   Entry entry;
+   entry.key = key;
+   entry.imageFile = cachedFile;
+   entry.size = cachedFile.getSize();
+   entries_.push_front(entry);
+   index_[key] = entries_.begin();
+   totalSize_ += entry.size;
+
+   // remove the least recently cached images until we're within our limit
+   while (totalSize_ > maxSize_ && !entries_.empty())
+      remove(std::prev(entries_.end()));
+}
+
+bool PlotImageCache::take(const std::string& key, const FilePath& targetFile)
+{
+   auto it = index_.find(key);
+   if (it == index_.end())
+      return false;
+
+   FilePath imageFile = it->second->imageFile;
+   totalSize_ -= it->second->size;
+   entries_.erase(it->second);
+   index_.erase(it);
+
+   Error error = imageFile.move(targetFile);
+   if (error)
+   {
+      LOG_ERROR(error);
+      imageFile.removeIfExists();
+      return false;
+   }
+
+   return true;
+}
+
+void PlotImageCache::clear()
+{
+   while (!entries_.empty())
+      remove(entries_.begin());
+}
+
+void PlotImageCache::remove(std::list<Entry>::iterator it)
+{
+   Error error = it->imageFile.removeIfExists();
+   if (error)
+      LOG_ERROR(error);
+
+   totalSize_ -= it->size;
+   index_.erase(it->key);
+   entries_.erase(it);
+}
+
+} // namespace graphics
+} // namespace session
+} // namespace r
+} // namespace rstudio
@@ -0,0 +1,99 @@
+/*
+ * RGraphicsPlotImageCache.hpp
+ *
+ * Copyright (C) 2022 by RStudio, PBC
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef R_SESSION_GRAPHICS_PLOT_IMAGE_CACHE_HPP
+#define R_SESSION_GRAPHICS_PLOT_IMAGE_CACHE_HPP
+
+#include <cstdint>
+#include <list>
+#include <map>
+#include <string>
+
+#include <boost/utility.hpp>
+
+#include <shared_core/FilePath.hpp>
+
+namespace rstudio {
+namespace core {
+   class Error;
+}
+}
+
+namespace rstudio {
+namespace r {
+namespace session {
+namespace graphics {
+
+// singleton
+class PlotImageCache;
+PlotImageCache& plotImageCache();
+
+// Images of plots rendered at sizes other than the one they're displayed at,
+// so that a plot which is shown again at one of those sizes (e.g. when the
+// pane is resized back, or when paging back to the plot) needn't be
+// replayed. Images are moved in and out of the cache (rather than copied),
+// and the least recently cached are removed once the cache exceeds its
+// size limit.
+class PlotImageCache : boost::noncopyable
+{
+private:
+   friend PlotImageCache& plotImageCache();
+   PlotImageCache();
+
+public:
+   // a cache other than the session's (e.g. for tests), holding at most
+   // maxSize bytes of images
+   explicit PlotImageCache(std::uintmax_t maxSize);
+
+   // removes any images left in cachePath by a previous session
+   core::Error initialize(const core::FilePath& cachePath);
+
+   // moves the image file into the cache, replacing any image already
+   // cached with the same key
+   void insert(const std::string& key, const core::FilePath& imageFile);
+
+   // moves the image cached with the given key (if any) to targetFile,
+   // returning whether there was one
+   bool take(const std::string& key, const core::FilePath& targetFile);
+
+   void clear();
+
+private:
+   struct Entry
+   {
+      std::string key;
+      core::FilePath imageFile;
+      std::uintmax_t size;
+   };
+
+   void remove(std::list<Entry>::iterator it);
+
+   core::FilePath cachePath_;
+
+   // entries, most recently cached first (and indexed by key)
+   std::list<Entry> entries_;
+   std::map<std::string, std::list<Entry>::iterator> index_;
+
+   std::uintmax_t totalSize_;
+   std::uintmax_t maxSize_;
+};
+
+} // namespace graphics
+} // namespace session
+} // namespace r
+} // namespace rstudio
+
+
+#endif // R_SESSION_GRAPHICS_PLOT_IMAGE_CACHE_HPP
@@ -0,0 +1,166 @@
+/*
+ * RGraphicsPlotImageCacheTests.cpp
+ *
+ * Copyright (C) 2022 by RStudio, PBC
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include "RGraphicsPlotImageCache.hpp"
+
+#include <tests/TestThat.hpp>
+
+#include <shared_core/Error.hpp>
+
+#include <core/FileSerializer.hpp>
+
+using namespace rstudio::core;
+
+namespace rstudio {
+namespace r {
+namespace session {
+namespace graphics {
+namespace tests {
+
+namespace {
+
+// a cache in a temporary directory, and images (of 10 bytes each) to put in it
+class TestCache
+{
+public:
+   explicit TestCache(std::uintmax_t maxSize)
+      : cache_(maxSize)
+   {
+      FilePath::tempFilePath(dir_);
+      cache_.initialize(dir_.completeChildPath("cache"));
+   }
+
+   ~TestCache()
+   {
+      dir_.removeIfExists();
+   }
+
+   PlotImageCache& cache() { return cache_; }
+
+   FilePath image(const std::string& name, const std::string& contents = "0123456789")
+   {
+      FilePath imageFile = dir_.completeChildPath(name + ".png");
+      writeStringToFile(imageFile, contents);
+      return imageFile;
+   }
+
+   void insert(const std::string& key, const std::string& contents = "0123456789")
+   {
+      cache_.insert(key, image(key, contents));
+   }
+
+   // takes the image cached with the given key, returning its contents
+   // (or an empty string if there was none)
+   std::string take(const std::string& key)
+   {
+      FilePath target = dir_.completeChildPath("taken.png");
+      if (!cache_.take(key, target))
+         return std::string();
+
+      std::string contents;
+      readStringFromFile(target, &contents);
+      target.removeIfExists();
+      return contents;
+   }
+
+   std::size_t cachedFileCount()
+   {
+      std::vector<FilePath> children;
+      dir_.completeChildPath("cache").getChildren(children);
+      return children.size();
+   }
+
+private:
+   FilePath dir_;
+   PlotImageCache cache_;
+};
+
+} // anonymous namespace
+
+test_context("Plot image cache")
+{
+   test_that("Images are moved into and out of the cache")
+   {
+      TestCache test(1024);
+
+      FilePath imageFile = test.image("a", "image a");
+      test.cache().insert("a", imageFile);
+      expect_false(imageFile.exists());
+      expect_true(test.cachedFileCount() == 1);
+
+      expect_true(test.take("a") == "image a");
+      expect_true(test.cachedFileCount() == 0);
+
+      // (taking an image removes it from the cache)
+      expect_true(test.take("a").empty());
+      expect_true(test.take("b").empty());
+   }
+
+   test_that("Inserting an image replaces the one cached with the same key")
+   {
+      TestCache test(1024);
+
+      test.insert("a", "first a");
+      test.insert("a", "second a");
+      expect_true(test.cachedFileCount() == 1);
+      expect_true(test.take("a") == "second a");
+   }
+
+   test_that("The least recently cached images are removed to stay within the size limit")
+   {
+      TestCache test(30);
+
+      test.insert("a");
+      test.insert("b");
+      test.insert("c");
+      expect_true(test.cachedFileCount() == 3);
+
+      // an image taken and cached again (as a plot's image is when it's
+      // shown at another size) is the most recently cached
+      test.insert("a", test.take("a"));
+      test.insert("d");
+      expect_true(test.cachedFileCount() == 3);
+      expect_true(test.take("b").empty());
+      expect_false(test.take("a").empty());
+      expect_false(test.take("c").empty());
+      expect_false(test.take("d").empty());
+
+      // an image larger than the cache isn't kept
+      test.insert("e", std::string(40, 'e'));
+      expect_true(test.cachedFileCount() == 0);
+      expect_true(test.take("e").empty());
+   }
+
+   test_that("Clearing the cache removes its images")
+   {
+      TestCache test(1024);
+
+      test.insert("a");
+      test.insert("b");
+      test.cache().clear();
+      expect_true(test.cachedFileCount() == 0);
+      expect_true(test.take("a").empty());
+
+      // images can be cached again afterwards
+      test.insert("c");
+      expect_true(test.take("c") == "0123456789");
+   }
+}
+
+} // namespace tests
+} // namespace graphics
+} // namespace session
+} // namespace r
+} // namespace rstudio
@@ -36,6 +36,7 @@
 
 #include "RGraphicsUtils.hpp"
 #include "RGraphicsDevice.hpp"
+#include "RGraphicsPlotImageCache.hpp"
 #include "RGraphicsPlotManipulatorManager.hpp"
 
 using namespace rstudio::core;
@@ -80,6 +81,7 @@ PlotManager::PlotManager()
       lastChange_(boost::posix_time::not_a_date_time),
       suppressDeviceEvents_(false),
       activePlot_(-1),
+      activePlotDisplayPending_(false),
       plotInfoRegex_("([A-Za-z0-9\\-]+):([0-9]+),([0-9]+)")
 {
    plots_.set_capacity(100);
@@ -102,6 +104,13 @@ Error PlotManager::initialize(const FilePath& graphicsPath,
 
    // save reference to plots state file
    plotsStateFile_ = graphicsPath_.completePath("INDEX");
+
+   // images of plots at other sizes are kept alongside the plots (but not
+   // within their directory, which is serialized with the session)
+   error = plotImageCache().initialize(graphicsPath_.getParent().completePath(
+                                          graphicsPath_.getFilename() + "-cache"));
+   if (error)
+      LOG_ERROR(error);
    
    // save reference to graphics device functions
    graphicsDevice_ = graphicsDevice;
@@ -111,6 +120,7 @@ Error PlotManager::initialize(const FilePath& graphicsPath,
    pEvents->onNewPage.connect(bind(&PlotManager::onDeviceNewPage, this, _1));
    pEvents->onDrawing.connect(bind(&PlotManager::onDeviceDrawing, this));
    pEvents->onResized.connect(bind(&PlotManager::onDeviceResized, this));
+   pEvents->onResizePending.connect(bind(&PlotManager::onDeviceResizePending, this));
    pEvents->onClosed.connect(bind(&PlotManager::onDeviceClosed, this));
 
    return Success();
@@ -160,8 +170,8 @@ Error PlotManager::setActivePlot(int index)
       // set index
       activePlot_ = index;
       
-      // render it
-      renderActivePlotToDisplay();
+      // render it (once we know we can't use a cached image)
+      activePlotDisplayPending_ = true;
 
       // trip changes flag 
       setDisplayHasChanges(true);
@@ -234,6 +244,9 @@ Error PlotManager::savePlotAsFile(const boost::function<Error()>&
 {
    if (!hasPlot())
       return Error(errc::NoActivePlot, ERROR_LOCATION);
+
+   // make sure the device is showing the active plot
+   ensureActivePlotDisplayed();
    
    // restore previous device after invoking file device
    RestorePreviousGraphicsDeviceScope restoreScope;
@@ -511,8 +524,33 @@ void PlotManager::render(boost::function<void(DisplayState)> outputFunction)
    // optional manipulator structure
    json::Value plotManipulatorJson;
 
-   if (hasPlot()) // write image for active plot
+   // size of the image
+   int width = r::session::graphics::device::getWidth();
+   int height = r::session::graphics::device::getHeight();
+
+   // if the device is yet to be resized (the plots pane is being resized)
+   // then show an image already rendered at the new size, if we have one
+   // (otherwise the client scales the current image to fit the pane)
+   DisplaySize pendingSize;
+   double pendingPixelRatio = 0;
+   if (hasPlot() &&
+       r::session::graphics::device::pendingSize(&pendingSize.width,
+                                                  &pendingSize.height,
+                                                  &pendingPixelRatio) &&
+       activePlot().renderFromCache(pendingSize, pendingPixelRatio))
    {
+      width = pendingSize.width;
+      height = pendingSize.height;
+
+      activePlot().manipulatorAsJson(&plotManipulatorJson);
+   }
+   else if (hasPlot()) // write image for active plot
+   {
+      // replay the active plot if it was just selected and we have no image
+      // of it at this size
+      if (activePlotDisplayPending_ && !activePlot().renderFromCache())
+         ensureActivePlotDisplayed();
+
       // copy current contents of the display to the active plot files
       Error error = activePlot().renderFromDisplay();
       if (error)
@@ -553,8 +591,8 @@ void PlotManager::render(boost::function<void(DisplayState)> outputFunction)
    // call output function
    DisplayState currentState(imageFilename(),
                              plotManipulatorJson,
-                             r::session::graphics::device::getWidth(),
-                             r::session::graphics::device::getHeight(),
+                             width,
+                             height,
                              activePlotIndex(), 
                              plotCount());
    outputFunction(currentState);
@@ -598,17 +636,22 @@ RSTUDIO_BOOST_SIGNAL<void ()>& PlotManager::onShowManipulator()
 
 void PlotManager::setPlotManipulatorValues(const json::Object& values)
 {
+   ensureActivePlotDisplayed();
    return plotManipulatorManager().setPlotManipulatorValues(values);
 }
 
 void PlotManager::manipulatorPlotClicked(int x, int y)
 {
+   ensureActivePlotDisplayed();
    plotManipulatorManager().manipulatorPlotClicked(x, y);
 }
 
 
 void PlotManager::onBeforeExecute()
 {
+   // code may draw on (or otherwise use) the device
+   ensureActivePlotDisplayed();
+
    graphicsDevice_.onBeforeExecute();
 }
 
@@ -714,9 +757,9 @@ Error PlotManager::restorePlotsState()
       activePlot_ = gsl::narrow_cast<int>(plots_.size()) - 1;
    }
    
-   // restore snapshot for the active plot
+   // restore snapshot for the active plot (once it's needed)
    if (hasPlot())
-      renderActivePlotToDisplay();
+      activePlotDisplayPending_ = true;
 
    return Success();
 }
@@ -789,7 +832,9 @@ void PlotManager::onDeviceNewPage(SEXP previousPageSnapshot)
    }
    
    // if we have a plot with unrendered changes then save the previous snapshot
-   if (hasPlot() && hasChanges())
+   // (unless the device never showed the active plot, in which case it has
+   // no changes to save)
+   if (hasPlot() && hasChanges() && !activePlotDisplayPending_)
    {
       if (previousPageSnapshot != R_NilValue)
       {
@@ -846,6 +891,9 @@ void PlotManager::onDeviceNewPage(SEXP previousPageSnapshot)
 
    // once we render the new plot we always reset pending manipulator state
    plotManipulatorManager().clearPendingManipulatorState();
+
+   // the device now shows the new plot
+   activePlotDisplayPending_ = false;
    
    // ensure updates
    invalidateActivePlot();
@@ -864,7 +912,17 @@ void PlotManager::onDeviceResized()
    if (suppressDeviceEvents_)
       return;
    
-   invalidateActivePlot();
+   // the plot itself hasn't changed, so we needn't invalidate it (it will
+   // be re-rendered, or taken from the cache, at the new size)
+   setDisplayHasChanges(true);
+}
+
+void PlotManager::onDeviceResizePending()
+{
+   if (suppressDeviceEvents_)
+      return;
+
+   setDisplayHasChanges(true);
 }
 
 void PlotManager::onDeviceClosed()
@@ -875,6 +933,8 @@ void PlotManager::onDeviceClosed()
    // clear plots
    activePlot_ = -1;
    plots_.clear();
+   activePlotDisplayPending_ = false;
+   plotImageCache().clear();
    
    // trip changes flag to ensure repaint
    setDisplayHasChanges(true);
@@ -923,9 +983,11 @@ void PlotManager::invalidateActivePlot()
       activePlot().invalidate();
 }
    
-// render active plot to display (used in setActivePlot and onSessionResume)
+// render active plot to display (deferred from setActivePlot and onSessionResume)
 void PlotManager::renderActivePlotToDisplay()
 {   
+   activePlotDisplayPending_ = false;
+
    suppressDeviceEvents_ = true;
    
    // attempt to render the active plot -- notify end user if there is an error
@@ -936,6 +998,12 @@ void PlotManager::renderActivePlotToDisplay()
    suppressDeviceEvents_ = false;
    
 }
+
+void PlotManager::ensureActivePlotDisplayed()
+{
+   if (activePlotDisplayPending_ && hasPlot())
+      renderActivePlotToDisplay();
+}
    
       
 Error PlotManager::plotIndexError(int index, const ErrorLocation& location)
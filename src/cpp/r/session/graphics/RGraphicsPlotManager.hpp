@@ -48,6 +48,7 @@ struct GraphicsDeviceEvents
    RSTUDIO_BOOST_SIGNAL<void (SEXP)> onNewPage;
    RSTUDIO_BOOST_SIGNAL<void ()> onDrawing;
    RSTUDIO_BOOST_SIGNAL<void ()> onResized;
+   RSTUDIO_BOOST_SIGNAL<void ()> onResizePending;
    RSTUDIO_BOOST_SIGNAL<void ()> onClosed;
 };
 
@@ -136,6 +137,7 @@ private:
    void onDeviceNewPage(SEXP previousPageSnapshot);
    void onDeviceDrawing();
    void onDeviceResized();
+   void onDeviceResizePending();
    void onDeviceClosed();
    
    // active plot 
@@ -149,8 +151,10 @@ private:
    // invalidate the active plot
    void invalidateActivePlot();
 
-   // render active plot to display (used in setActivePlot and onSessionResume)
+   // render active plot to display (deferred from setActivePlot and
+   // onSessionResume until the display is needed)
    void renderActivePlotToDisplay();
+   void ensureActivePlotDisplayed();
    
    // render active plot file file
    core::Error savePlotAsFile(const boost::function<core::Error()>&
@@ -195,6 +199,10 @@ private:
    
    int activePlot_;
    boost::circular_buffer<PtrPlot> plots_;
+
+   // whether the graphics device has yet to be given the active plot (we
+   // put off replaying it, as a cached image will often do)
+   bool activePlotDisplayPending_;
    
    boost::regex plotInfoRegex_;
 };
@@ -895,6 +895,7 @@ int main(int argc, char * const argv[])
       s_pHttpServer->setNotFoundHandler(pageNotFoundHandler);
 
       // run http server
+      s_pHttpServer->setIoServicePerThread(options.wwwIoServicePerThread());
       error = s_pHttpServer->run(options.wwwThreadPoolSize());
       if (error)
          return core::system::exitFailure(error, ERROR_LOCATION);
@@ -697,6 +697,21 @@ Error userIdForUsername(const std::string& username, UidType* pUID)
    return Success();
 }
 
+// connections to session streams, kept open between requests
+boost::shared_ptr<http::LocalStreamConnectionPool> s_pSessionConnectionPool(
+                                       new http::LocalStreamConnectionPool());
+
+void handleSessionConnectionError(const FilePath& streamPath,
+                                  const http::ErrorHandler& errorHandler,
+                                  const Error& error)
+{
+   // the session is gone (or going) so its idle connections are of no use
+   if (http::isConnectionUnavailableError(error))
+      s_pSessionConnectionPool->evict(streamPath.getAbsolutePath());
+
+   errorHandler(error);
+}
+
 void proxyRequest(
       int requestType,
       const r_util::SessionContext& context,
@@ -762,9 +777,17 @@ void proxyRequest(
    // create client
    // if the user is available on the system pass in the uid for validation to ensure
    // that we only connect to the socket if it was created by the user
-   boost::shared_ptr<http::IAsyncClient> pClient(new http::LocalStreamAsyncClient(
-                                                    ptrConnection->ioService(),
-                                                    streamPath, false, validateUid));
+   boost::shared_ptr<http::LocalStreamAsyncClient> pLocalStreamClient(
+                                    new http::LocalStreamAsyncClient(
+                                          ptrConnection->ioService(),
+                                          streamPath, false, validateUid));
+
+   // reuse connections to the session unless the caller takes over the client
+   // (e.g. to stream an upload to it)
+   if (!clientHandler)
+      pLocalStreamClient->setConnectionPool(s_pSessionConnectionPool);
+
+   boost::shared_ptr<http::IAsyncClient> pClient = pLocalStreamClient;
 
    // setup retry context
    if (!connectionRetryProfile.empty())
@@ -779,7 +802,7 @@ void proxyRequest(
    boost::shared_ptr<http::ChunkProxy> chunkProxy(new http::ChunkProxy(ptrConnection));
    chunkProxy->proxy(pClient);
    pClient->execute(boost::bind(handleProxyResponse, ptrConnection, context, _1),
-                    errorHandler);
+                    boost::bind(handleSessionConnectionError, streamPath, errorHandler, _1));
 
    if (clientHandler)
    {
@@ -117,6 +117,9 @@ protected:
       ("www-thread-pool-size",
       value<int>(&wwwThreadPoolSize_)->default_value(2),
       "The size of the threadpool from which requests will be serviced. This may be increased to enable more concurrency, but should only be done if the underlying hardware has more than 2 cores. It is recommended to use a value that is <= to the number of hardware cores, or <= to two times the number of hardware cores if the hardware utilizes hyperthreading.")
+      ("www-io-service-per-thread",
+      value<bool>(&wwwIoServicePerThread_)->default_value(false),
+      "Indicates whether or not each thread of the request threadpool should service its own set of connections. This reduces contention between the threads and can increase throughput on hosts with many cores serving many users, in which case www-thread-pool-size should be set to the number of hardware cores.")
       ("www-proxy-localhost",
       value<bool>(&wwwProxyLocalhost_)->default_value(true),
       "Indicates whether or not to proxy requests to localhost ports over the main server port. This should generally be enabled, and is used to proxy HTTP traffic within a session that belongs to code running within the session (e.g. Shiny or Plumber APIs)")
@@ -250,6 +253,7 @@ public:
    core::FilePath wwwSymbolMapsPath() const { return core::FilePath(wwwSymbolMapsPath_); }
    bool wwwUseEmulatedStack() const { return wwwUseEmulatedStack_; }
    int wwwThreadPoolSize() const { return wwwThreadPoolSize_; }
+   bool wwwIoServicePerThread() const { return wwwIoServicePerThread_; }
    bool wwwProxyLocalhost() const { return wwwProxyLocalhost_; }
    bool wwwVerifyUserAgent() const { return wwwVerifyUserAgent_; }
    rstudio::core::http::Cookie::SameSite wwwSameSite() const { return wwwSameSite_; }
@@ -300,6 +304,7 @@ protected:
    std::string wwwSymbolMapsPath_;
    bool wwwUseEmulatedStack_;
    int wwwThreadPoolSize_;
+   bool wwwIoServicePerThread_;
    bool wwwProxyLocalhost_;
    bool wwwVerifyUserAgent_;
    rstudio::core::http::Cookie::SameSite wwwSameSite_;
@@ -17,7 +17,10 @@
 
 #include "modules/SessionConsole.hpp"
 
+#include <iterator>
+
 #include <core/BoostThread.hpp>
+#include <core/Scope.hpp>
 #include <core/Thread.hpp>
 #include <shared_core/json/Json.hpp>
 #include <core/StringUtils.hpp>
@@ -32,9 +35,22 @@ namespace rstudio {
 namespace session {
  
 namespace {
+
 ClientEventQueue* s_pClientEventQueue = nullptr;
+
+const int64_t kNoEventAdded = -1;
+
+// lines of console output retained until the console capacity is known
+const std::size_t kDefaultConsoleLines = 1000;
+
+int64_t microsecondsSinceEpoch(const boost::posix_time::ptime& time)
+{
+   static const boost::posix_time::ptime epoch(boost::gregorian::date(1970, 1, 1));
+   return (time - epoch).total_microseconds();
 }
 
+} // anonymous namespace
+
 void initializeClientEventQueue()
 {
    BOOST_ASSERT(s_pClientEventQueue == nullptr);
@@ -48,15 +64,27 @@ ClientEventQueue& clientEventQueue()
    
 ClientEventQueue::ClientEventQueue()
    :  pMutex_(new boost::mutex()),
+      pOutputMutex_(new boost::mutex()),
+      pWaitMutex_(new boost::mutex()),
       pWaitForEventCondition_(new boost::condition()),
-      lastEventAddTime_(boost::posix_time::not_a_date_time)
+      addedCount_(0),
+      waiterCount_(0),
+      lastEventAddTime_(kNoEventAdded),
+      pendingConsoleOutput_(kDefaultConsoleLines),
+      havePendingConsoleOutput_(false)
 {
+   // events which carry the complete current state, so only the latest
+   // instance in a batch is of any interest to the client
+   coalescedEventTypes_.insert(client_events::kBusy);
+   coalescedEventTypes_.insert(client_events::kPlotsStateChanged);
+   coalescedEventTypes_.insert(client_events::kEnvironmentChanged);
+   coalescedEventTypes_.insert(client_events::kWorkingDirChanged);
 }
 
 bool ClientEventQueue::setActiveConsole(const std::string& console)
 {
    bool changed = false;
-   LOCK_MUTEX(*pMutex_)
+   LOCK_MUTEX(*pOutputMutex_)
    {
       if (activeConsole_ != console)
       {
@@ -72,6 +100,15 @@ bool ClientEventQueue::setActiveConsole(const std::string& console)
    return changed;
 }
 
+void ClientEventQueue::coalesceEventType(int type)
+{
+   LOCK_MUTEX(*pMutex_)
+   {
+      coalescedEventTypes_.insert(type);
+   }
+   END_LOCK_MUTEX
+}
+
 void ClientEventQueue::add(const ClientEvent& event)
 {
    if (http_methods::protocolDebugEnabled() && event.type() != client_events::kConsoleWriteError)
@@ -86,43 +123,87 @@ void ClientEventQueue::add(const ClientEvent& event)
       else
          LOG_DEBUG_MESSAGE("Queued event: " + event.typeName());
    }
-   LOCK_MUTEX(*pMutex_)
+
+   // console output is batched up for compactness/efficiency.
+   if (event.type() == client_events::kConsoleWriteOutput)
    {
-      // console output is batched up for compactness/efficiency.
-      if (event.type() == client_events::kConsoleWriteOutput)
+      if (event.data().getType() == json::Type::STRING)
       {
-         if (event.data().getType() == json::Type::STRING)
-            pendingConsoleOutput_ += event.data().getString();
+         LOCK_MUTEX(*pOutputMutex_)
+         {
+            if (!havePendingConsoleOutput_.load())
+            {
+               // If there's more console output than the client can even
+               // show, then only retain the amount that the client can show.
+               // Too much output can overwhelm the client, causing it to
+               // become unresponsive.
+               pendingConsoleOutput_.setMaxLines(
+                        r::session::consoleActions().capacity() + 1);
+            }
+
+            pendingConsoleOutput_.append(event.data().getString());
+            havePendingConsoleOutput_.store(!pendingConsoleOutput_.empty());
+         }
+         END_LOCK_MUTEX
       }
-      else if (event.type() == client_events::kConsoleWriteError &&
-               event.data().getType() == json::Type::STRING)
+   }
+   else if (event.type() == client_events::kConsoleWriteError &&
+            event.data().getType() == json::Type::STRING)
+   {
+      LOCK_MUTEX(*pOutputMutex_)
       {
          flushPendingConsoleOutput();
          enqueueClientOutputEvent(event.type(), event.data().getString());
       }
-      else
+      END_LOCK_MUTEX
+   }
+   else if (havePendingConsoleOutput_.load())
+   {
+      // flush existing console output prior to adding an 
+      // action of another type
+      LOCK_MUTEX(*pOutputMutex_)
       {
-         // flush existing console output prior to adding an 
-         // action of another type
          flushPendingConsoleOutput();
-         
-         // add event to queue
-         pendingEvents_.push_back(event);
+         enqueueClientEvent(event);
       }
-      
-      lastEventAddTime_ = boost::posix_time::microsec_clock::universal_time();
+      END_LOCK_MUTEX
    }
-   END_LOCK_MUTEX
-   
+   else
+   {
+      // coalescing happens on the consumer side so that adding an event
+      // never waits on a thread reading the queue
+      enqueueClientEvent(event);
+   }
+
+   lastEventAddTime_.store(
+            microsecondsSinceEpoch(boost::posix_time::microsec_clock::universal_time()));
+
    // notify listeners that an event has been added
-   pWaitForEventCondition_->notify_all();
+   notifyEventAdded();
+}
+
+void ClientEventQueue::notifyEventAdded()
+{
+   addedCount_.fetch_add(1);
+
+   // only pay for the lock and notification when someone is waiting (a
+   // waiter increments the count before checking addedCount_, so either it
+   // sees our increment or we see its registration)
+   if (waiterCount_.load() > 0)
+   {
+      LOCK_MUTEX(*pWaitMutex_)
+      {
+         pWaitForEventCondition_->notify_all();
+      }
+      END_LOCK_MUTEX
+   }
 }
    
 bool ClientEventQueue::hasEvents() 
 {
    LOCK_MUTEX(*pMutex_)
    {
-      return pendingEvents_.size() > 0 || pendingConsoleOutput_.length() > 0;
+      return !queue_.isEmpty() || havePendingConsoleOutput_.load();
    }
    END_LOCK_MUTEX
    
@@ -134,16 +215,26 @@ void ClientEventQueue::remove(std::vector<ClientEvent>* pEvents)
 {
    LOCK_MUTEX(*pMutex_)
    {
-      // flush any pending output
-      flushPendingConsoleOutput();
+      // most events can be taken without blocking producers
+      std::vector<ClientEvent> events;
+      dequeEvents(&events);
+      
+      LOCK_MUTEX(*pOutputMutex_)
+      {
+         // flush any pending output; draining again while producers are
+         // held off keeps it behind every event that was queued before it
+         flushPendingConsoleOutput();
+         dequeEvents(&events);
+      }
+      END_LOCK_MUTEX
+
+      // drop superseded instances of idempotent events
+      coalesceEvents(&events);
       
-      // copy the events to the caller
+      // move the events to the caller
       pEvents->insert(pEvents->begin(), 
-                      pendingEvents_.begin(), 
-                      pendingEvents_.end());
-   
-      // clear pending events
-      pendingEvents_.clear();
+                      std::make_move_iterator(events.begin()),
+                      std::make_move_iterator(events.end()));
    }
    END_LOCK_MUTEX
 }
@@ -152,8 +243,17 @@ void ClientEventQueue::clear()
 {
    LOCK_MUTEX(*pMutex_)
    {
-      pendingConsoleOutput_.clear();
-      pendingEvents_.clear();
+      QueuedEvent queued;
+      while (queue_.deque(&queued))
+      {
+      }
+
+      LOCK_MUTEX(*pOutputMutex_)
+      {
+         pendingConsoleOutput_.clear();
+         havePendingConsoleOutput_.store(false);
+      }
+      END_LOCK_MUTEX
    }
    END_LOCK_MUTEX
 }
@@ -165,9 +265,20 @@ bool ClientEventQueue::waitForEvent(
    using namespace boost;
    try
    {
-      unique_lock<mutex> lock(*pMutex_);
+      unique_lock<mutex> lock(*pWaitMutex_);
       system_time timeoutTime = get_system_time() + waitDuration;
-      return pWaitForEventCondition_->timed_wait(lock, timeoutTime);
+
+      waiterCount_.fetch_add(1);
+      core::scope::CallOnExit unregisterWaiter([this]() { waiterCount_.fetch_sub(1); });
+
+      // ignore wakeups which aren't due to an event added during the wait
+      uint64_t addedCount = addedCount_.load();
+      while (addedCount_.load() == addedCount)
+      {
+         if (!pWaitForEventCondition_->timed_wait(lock, timeoutTime))
+            return addedCount_.load() != addedCount;
+      }
+      return true;
    }
    catch(const thread_resource_error& e) 
    { 
@@ -181,19 +292,72 @@ bool ClientEventQueue::waitForEvent(
 
 bool ClientEventQueue::eventAddedSince(const boost::posix_time::ptime& time)
 {
-   LOCK_MUTEX(*pMutex_)
+   int64_t lastEventAddTime = lastEventAddTime_.load();
+   if (lastEventAddTime == kNoEventAdded)
+      return false;
+   else
+      return lastEventAddTime >= microsecondsSinceEpoch(time);
+}
+
+void ClientEventQueue::dequeEvents(std::vector<ClientEvent>* pEvents)
+{
+   // NOTE: private helper so no lock required (mutex is not recursive) 
+
+   QueuedEvent queued;
+   while (queue_.deque(&queued))
    {
-      if (lastEventAddTime_.is_not_a_date_time())
-         return false;
+      if (queued.event)
+      {
+         pEvents->push_back(std::move(*queued.event));
+      }
       else
-         return lastEventAddTime_ >= time;
+      {
+         // console output is converted to json here rather than when it
+         // was flushed to keep that work off the thread writing it
+         json::Object output;
+         output[kConsoleText] = queued.consoleText;
+         output[kConsoleId]   = queued.console;
+         pEvents->push_back(ClientEvent(queued.outputType, output));
+      }
    }
-   END_LOCK_MUTEX
-   
-   // keep compiler happy
-   return false;
 }
-   
+
+void ClientEventQueue::coalesceEvents(std::vector<ClientEvent>* pEvents)
+{
+   // NOTE: private helper so no lock required (mutex is not recursive) 
+
+   if (coalescedEventTypes_.empty())
+      return;
+
+   // walk backwards so the most recent instance of each type is kept (in
+   // its original position relative to the other events)
+   std::set<int> seenTypes;
+   std::vector<bool> superseded(pEvents->size(), false);
+   bool anySuperseded = false;
+   for (std::size_t i = pEvents->size(); i > 0; --i)
+   {
+      int type = (*pEvents)[i - 1].type();
+      if (coalescedEventTypes_.count(type) && !seenTypes.insert(type).second)
+      {
+         superseded[i - 1] = true;
+         anySuperseded = true;
+      }
+   }
+
+   if (!anySuperseded)
+      return;
+
+   std::size_t kept = 0;
+   for (std::size_t i = 0; i < pEvents->size(); ++i)
+   {
+      if (superseded[i])
+         continue;
+      if (kept != i)
+         (*pEvents)[kept] = std::move((*pEvents)[i]);
+      ++kept;
+   }
+   pEvents->erase(pEvents->begin() + kept, pEvents->end());
+}
 
 void ClientEventQueue::flushPendingConsoleOutput()
 {
@@ -201,25 +365,29 @@ void ClientEventQueue::flushPendingConsoleOutput()
    
    if ( !pendingConsoleOutput_.empty() )
    {
-      // If there's more console output than the client can even show, then
-      // truncate it to the amount that the client can show. Too much output
-      // can overwhelm the client, causing it to become unresponsive.
-      int limit = r::session::consoleActions().capacity() + 1;
-      string_utils::trimLeadingLines(limit, &pendingConsoleOutput_);
-
+      // the buffer retains no more lines than the client can show, and its
+      // text is usually taken without a copy
       enqueueClientOutputEvent(client_events::kConsoleWriteOutput, 
-            pendingConsoleOutput_);
-      pendingConsoleOutput_.clear();
+            pendingConsoleOutput_.take());
+      havePendingConsoleOutput_.store(false);
    }
 }
 
 void ClientEventQueue::enqueueClientOutputEvent(
-      int event, const std::string& text)
+      int event, std::string text)
+{
+   QueuedEvent queued;
+   queued.outputType = event;
+   queued.consoleText = std::move(text);
+   queued.console = activeConsole_;
+   queue_.enque(std::move(queued));
+}
+
+void ClientEventQueue::enqueueClientEvent(const ClientEvent& event)
 {
-   json::Object output;
-   output[kConsoleText] = text;
-   output[kConsoleId]   = activeConsole_;
-   pendingEvents_.push_back(ClientEvent(event, output));
+   QueuedEvent queued;
+   queued.event = event;
+   queue_.enque(std::move(queued));
 }
 
 } // namespace session
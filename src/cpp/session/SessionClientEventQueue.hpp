@@ -16,14 +16,19 @@
 #ifndef SESSION_SESSION_CLIENT_EVENT_QUEUE_HPP
 #define SESSION_SESSION_CLIENT_EVENT_QUEUE_HPP
 
+#include <atomic>
+#include <set>
 #include <string>
 #include <vector>
 
 #include <boost/function.hpp>
+#include <boost/optional.hpp>
 #include <boost/utility.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 
 #include <core/BoostThread.hpp>
+#include <core/Thread.hpp>
+#include <core/collection/LineRingBuffer.hpp>
 
 #include <session/SessionClientEvent.hpp>
 
@@ -46,7 +51,7 @@ private:
 public:
    // COPYING: boost::noncopyable
      
-   // add an event
+   // add an event (lock free; safe to call from any thread)
    void add(const ClientEvent& event);
    
    // remove all available events
@@ -67,11 +72,35 @@ public:
    // set the active console to be attached to console events; returns true if
    // the active console changed
    bool setActiveConsole(const std::string& console);
+
+   // deliver only the most recent event of this type in each batch removed
+   // from the queue (for events which carry complete state, e.g. busy)
+   void coalesceEventType(int type);
       
 private:   
+   // entry in the lock free queue: either an event or a batch of console
+   // output (which is only converted to an event by the consumer)
+   struct QueuedEvent
+   {
+      QueuedEvent() : outputType(0) {}
+
+      boost::optional<ClientEvent> event;
+      int outputType;
+      std::string consoleText;
+      std::string console;
+   };
+
+   void dequeEvents(std::vector<ClientEvent>* pEvents);
+
+   void coalesceEvents(std::vector<ClientEvent>* pEvents);
+
    void flushPendingConsoleOutput();
 
-   void enqueueClientOutputEvent(int event, const std::string& text);
+   void enqueueClientOutputEvent(int event, std::string text);
+
+   void enqueueClientEvent(const ClientEvent& event);
+
+   void notifyEventAdded();
  
 private:
    // synchronization objects. heap based so they are never destructed
@@ -79,16 +108,30 @@ private:
    // explicitly stop the queue and this sometimes results in mutex
    // destroy assertions if someone is waiting on the queue while
    // it is being destroyed
+   //
+   // producers never take pMutex_, which serializes the consumer side
+   // (remove, clear, hasEvents). pOutputMutex_ guards the pending console
+   // output and is only taken by producers writing (or flushing) console
+   // output. pWaitMutex_ is only taken by producers when someone is blocked
+   // in waitForEvent
    boost::mutex* pMutex_;
+   boost::mutex* pOutputMutex_;
+   boost::mutex* pWaitMutex_;
    boost::condition* pWaitForEventCondition_;
 
-   // instance data
-   std::string pendingConsoleOutput_;
-   std::string activeConsole_;
-   std::vector<ClientEvent> pendingEvents_;
-   boost::posix_time::ptime lastEventAddTime_;
-   
+   // events added by any thread, drained by the consumer
+   core::thread::MpscQueue<QueuedEvent> queue_;
+   std::atomic<uint64_t> addedCount_;
+   std::atomic<int> waiterCount_;
+   std::atomic<int64_t> lastEventAddTime_;
 
+   // consumer state (guarded by pMutex_)
+   std::set<int> coalescedEventTypes_;
+
+   // console output not yet queued (guarded by pOutputMutex_)
+   core::collection::LineRingBuffer pendingConsoleOutput_;
+   std::atomic<bool> havePendingConsoleOutput_;
+   std::string activeConsole_;
 };
 
 } // namespace session
@@ -165,23 +165,35 @@ bool ClientEventService::havePendingClientEvents()
    return false;
 }
 
-void ClientEventService::addClientEvent(const json::Object& eventObject)
+void ClientEventService::addClientEvent(json::Object&& eventObject)
 {
    LOCK_MUTEX(mutex_)
    {
-      clientEvents_.push_back(eventObject);
+      clientEvents_.push_back(std::move(eventObject));
    }
    END_LOCK_MUTEX
 }
 
 void ClientEventService::setClientEventResult(
                                        core::json::JsonRpcResponse* pResponse)
+{
+   // the pending events are serialized straight into the response body
+   // when it is written rather than being copied into the response here
+   pResponse->setStreamedResult(
+            boost::bind(&ClientEventService::writeClientEvents, this, _1));
+}
+
+void ClientEventService::writeClientEvents(core::json::StreamWriter& writer)
 {
    LOCK_MUTEX(mutex_)
    {
-      pResponse->setResult(clientEvents_);
+      writer.write(clientEvents_);
+      return;
    }
    END_LOCK_MUTEX
+
+   // couldn't access the events; deliver none
+   writer.writeNull();
 }
 
 
@@ -331,7 +343,7 @@ void ClientEventService::run()
             {
                json::Object event;
                it->asJsonObject(nextEventId++, &event);
-               addClientEvent(event);
+               addClientEvent(std::move(event));
             }
 
             // send them (pass false for kEventsPending b/c responses from the
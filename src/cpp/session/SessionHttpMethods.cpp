@@ -607,8 +607,10 @@ void handleConnection(boost::shared_ptr<HttpConnection> ptrConnection,
    }
    else if (isJsonRpcRequest(ptrConnection)) // check for json-rpc
    {
-      // r code may execute - ensure session is initialized
-      init::ensureSessionInitialized();
+      // r code may execute - ensure session is initialized (worker methods
+      // are only run once it is, and must not touch R)
+      if (connectionType != WorkerConnection)
+         init::ensureSessionInitialized();
 
       // attempt to parse & validate
       json::JsonRpcRequest jsonRpcRequest;
@@ -32,7 +32,8 @@ namespace http_methods {
 enum ConnectionType
 {
    ForegroundConnection,
-   BackgroundConnection
+   BackgroundConnection,
+   WorkerConnection
 };
 
 bool waitForMethod(const std::string& method,
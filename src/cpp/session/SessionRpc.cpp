@@ -13,6 +13,7 @@
  *
  */
 
+#include <algorithm>
 #include <string>
 
 #include "SessionRpc.hpp"
@@ -24,6 +25,7 @@
 #include <core/json/JsonRpc.hpp>
 #include <core/Exec.hpp>
 #include <core/Log.hpp>
+#include <core/Thread.hpp>
 
 #include <r/RExec.hpp>
 #include <r/RSexp.hpp>
@@ -43,11 +45,18 @@ int s_rpcDelayMs = -1;
 
 std::set<std::string> s_offlineableUris;
 
+// uris of rpc methods which are run on worker threads
+std::set<std::string> s_workerUris;
+
+// threads for worker rpc methods
+core::thread::WorkerPool* s_pWorkers = nullptr;
+
 // json rpc methods
 core::json::JsonRpcAsyncMethods* s_pJsonRpcMethods = nullptr;
    
 void endHandleRpcRequestDirect(boost::shared_ptr<HttpConnection> ptrConnection,
                          boost::posix_time::ptime executeStartTime,
+                         http_methods::ConnectionType connectionType,
                          const core::Error& executeError,
                          json::JsonRpcResponse* pJsonRpcResponse)
 {
@@ -58,8 +67,11 @@ void endHandleRpcRequestDirect(boost::shared_ptr<HttpConnection> ptrConnection,
    }
    else
    {
-      // allow modules to detect changes after rpc calls
-      if (!pJsonRpcResponse->suppressDetectChanges())
+      // allow modules to detect changes after rpc calls (the handlers for
+      // which use R, so not for methods run on worker threads)
+      bool detectChanges = !pJsonRpcResponse->suppressDetectChanges() &&
+                           connectionType != http_methods::WorkerConnection;
+      if (detectChanges)
       {
          module_context::events().onDetectChanges(
                module_context::ChangeSourceRPC);
@@ -80,7 +92,7 @@ void endHandleRpcRequestDirect(boost::shared_ptr<HttpConnection> ptrConnection,
       if (pJsonRpcResponse->hasAfterResponse())
       {
          pJsonRpcResponse->runAfterResponse();
-         if (!pJsonRpcResponse->suppressDetectChanges())
+         if (detectChanges)
          {
             module_context::events().onDetectChanges(
                   module_context::ChangeSourceRPC);
@@ -181,6 +193,13 @@ void registerRpcMethod(const core::json::JsonRpcAsyncMethod& method)
    s_pJsonRpcMethods->insert(method);
 }
 
+Error registerThreadSafeRpcMethod(const std::string& name,
+                                  const core::json::JsonRpcFunction& function)
+{
+   s_workerUris.insert("/rpc/" + name);
+   return registerRpcMethod(name, function);
+}
+
 } // namespace module_context
 
 namespace rpc {
@@ -324,6 +343,7 @@ void handleRpcRequest(const core::json::JsonRpcRequest& request,
                          boost::bind(endHandleRpcRequestDirect,
                                      ptrConnection,
                                      executeStartTime,
+                                     connectionType,
                                      _1,
                                      _2));
       }
@@ -356,7 +376,7 @@ void handleRpcRequest(const core::json::JsonRpcRequest& request,
          endHandleRpcRequestIndirect(asyncConn->asyncHandle(), executeError, nullptr);
       }
       else
-         endHandleRpcRequestDirect(ptrConnection, executeStartTime, executeError, nullptr);
+         endHandleRpcRequestDirect(ptrConnection, executeStartTime, connectionType, executeError, nullptr);
    }
 }
 
@@ -373,6 +393,18 @@ bool isOfflineableRequest(boost::shared_ptr<HttpConnection> ptrConnection)
    return true;
 }
 
+bool isWorkerRequest(boost::shared_ptr<HttpConnection> ptrConnection)
+{
+   return s_workerUris.find(ptrConnection->request().uri()) != s_workerUris.end();
+}
+
+void handleWorkerRequest(boost::shared_ptr<HttpConnection> ptrConnection)
+{
+   s_pWorkers->enque(boost::bind(http_methods::handleConnection,
+                                 ptrConnection,
+                                 http_methods::WorkerConnection));
+}
+
 Error initialize()
 {
    // intentionally allocate methods on the heap and let them leak
@@ -382,6 +414,12 @@ Error initialize()
    // the OS to clean up memory itself after the process is gone)
    s_pJsonRpcMethods = new core::json::JsonRpcAsyncMethods;
 
+   // more than one thread so that a slow method (e.g. on a network drive)
+   // doesn't hold up the others; leaked along with the methods
+   std::size_t workerCount = boost::thread::hardware_concurrency() / 2;
+   s_pWorkers = new core::thread::WorkerPool(
+            std::max<std::size_t>(2, std::min<std::size_t>(workerCount, 4)));
+
    RS_REGISTER_CALL_METHOD(rs_invokeRpc);
 
    s_offlineableUris.insert("/rpc/save_document");
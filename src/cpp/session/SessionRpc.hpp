@@ -42,6 +42,10 @@ core::Error initialize();
 
 bool isOfflineableRequest(boost::shared_ptr<HttpConnection> ptrConnection);
 
+bool isWorkerRequest(boost::shared_ptr<HttpConnection> ptrConnection);
+
+void handleWorkerRequest(boost::shared_ptr<HttpConnection> ptrConnection);
+
 void sendJsonAsyncPendingResponse(const core::json::JsonRpcRequest &request,
                                   boost::shared_ptr<HttpConnection> ptrConnection,
                                   std::string &asyncHandle);
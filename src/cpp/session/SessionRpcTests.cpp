@@ -0,0 +1,222 @@
+/*
+ * SessionRpcTests.cpp
+ *
+ * Copyright (C) 2022 by RStudio, PBC
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <tests/TestThat.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <vector>
+
+#include <boost/make_shared.hpp>
+
+#include <core/Thread.hpp>
+#include <core/http/CSRFToken.hpp>
+#include <core/http/Request.hpp>
+#include <core/json/JsonRpc.hpp>
+
+#include <r/RExec.hpp>
+
+#include <session/SessionHttpConnection.hpp>
+#include <session/SessionHttpConnectionQueue.hpp>
+#include <session/SessionModuleContext.hpp>
+#include <session/SessionPersistentState.hpp>
+
+#include "SessionHttpMethods.hpp"
+#include "SessionRpc.hpp"
+
+using namespace rstudio::core;
+
+namespace rstudio {
+namespace session {
+namespace tests {
+
+namespace {
+
+const char* const kTestWorkerMethod = "test_worker_rpc";
+
+// a json rpc request, which records when (and whether) it was answered
+class TestConnection : public HttpConnection
+{
+public:
+   explicit TestConnection(const std::string& method)
+      : received_(std::chrono::steady_clock::now()), answered_(false)
+   {
+      json::Object body;
+      body["method"] = method;
+      body["params"] = json::Array();
+      body["clientId"] = persistentState().activeClientId();
+
+      request_.setMethod("POST");
+      request_.setUri("/rpc/" + method);
+      request_.setHeader("Cookie", std::string(kCSRFTokenCookie) + "=token");
+      request_.setHeader(kCSRFTokenHeader, "token");
+      request_.setBody(body.write());
+   }
+
+   virtual const core::http::Request& request() override { return request_; }
+   virtual void sendResponse(const core::http::Response& response) override { answer(); }
+   virtual void sendJsonRpcResponse(core::json::JsonRpcResponse& jsonRpcResponse) override
+   {
+      result_ = jsonRpcResponse.result();
+      answer();
+   }
+   virtual void close() override {}
+   virtual std::string requestId() const override { return std::string(); }
+   virtual void setUploadHandler(const core::http::UriAsyncUploadHandlerFunction&) override {}
+   virtual bool isAsyncRpc() const override { return false; }
+   virtual std::chrono::steady_clock::time_point receivedTime() const override { return received_; }
+
+   bool waitForAnswer(const boost::posix_time::time_duration& timeout)
+   {
+      boost::unique_lock<boost::mutex> lock(mutex_);
+      return condition_.timed_wait(lock, timeout, [this]() { return answered_; });
+   }
+
+   const json::Value& result() const { return result_; }
+
+   double latencyMs() const
+   {
+      return std::chrono::duration<double, std::milli>(answeredTime_ - received_).count();
+   }
+
+private:
+   void answer()
+   {
+      {
+         boost::lock_guard<boost::mutex> lock(mutex_);
+         answeredTime_ = std::chrono::steady_clock::now();
+         answered_ = true;
+      }
+      condition_.notify_all();
+   }
+
+   core::http::Request request_;
+   std::chrono::steady_clock::time_point received_;
+   std::chrono::steady_clock::time_point answeredTime_;
+   json::Value result_;
+   boost::mutex mutex_;
+   boost::condition_variable condition_;
+   bool answered_;
+};
+
+Error testWorkerMethod(const json::JsonRpcRequest&, json::JsonRpcResponse* pResponse)
+{
+   pResponse->setResult(!core::thread::isMainThread());
+   return Success();
+}
+
+void ensureTestWorkerMethod()
+{
+   static bool s_registered = false;
+   if (!s_registered)
+   {
+      Error error = module_context::registerThreadSafeRpcMethod(kTestWorkerMethod, testWorkerMethod);
+      if (error)
+         LOG_ERROR(error);
+      s_registered = true;
+   }
+}
+
+// keep R busy on this (the main) thread for the given time, handling the
+// connections queued for it in between computations (as the session does)
+void runBusyR(double seconds, HttpConnectionQueue* pQueue)
+{
+   auto end = std::chrono::steady_clock::now() + std::chrono::duration<double>(seconds);
+   while (std::chrono::steady_clock::now() < end)
+   {
+      Error error = r::exec::RFunction("Sys.sleep", 0.2).call();
+      if (error)
+         LOG_ERROR(error);
+
+      while (boost::shared_ptr<HttpConnection> ptrConnection = pQueue->dequeConnection())
+         http_methods::handleConnection(ptrConnection, http_methods::ForegroundConnection);
+   }
+}
+
+} // anonymous namespace
+
+test_context("Worker RPC methods")
+{
+   ensureTestWorkerMethod();
+
+   test_that("Worker rpc methods are recognized by uri")
+   {
+      expect_true(rpc::isWorkerRequest(boost::make_shared<TestConnection>(kTestWorkerMethod)));
+      expect_false(rpc::isWorkerRequest(boost::make_shared<TestConnection>("list_files")));
+   }
+
+   test_that("Worker rpc methods are answered off the main thread while R is busy")
+   {
+      boost::shared_ptr<TestConnection> ptrConnection =
+            boost::make_shared<TestConnection>(kTestWorkerMethod);
+
+      rpc::handleWorkerRequest(ptrConnection);
+
+      HttpConnectionQueue queue;
+      runBusyR(0.2, &queue);
+
+      expect_true(ptrConnection->waitForAnswer(boost::posix_time::seconds(5)));
+      expect_true(ptrConnection->result().isBool() && ptrConnection->result().getBool());
+      expect_true(ptrConnection->latencyMs() < 200);
+   }
+}
+
+TEST_CASE("Worker RPC latency benchmark", "[.benchmark]")
+{
+   ensureTestWorkerMethod();
+
+   const int kRequests = 50;
+
+   for (bool worker : { false, true })
+   {
+      // requests arrive every 20ms while R is busy
+      HttpConnectionQueue queue;
+      std::vector<boost::shared_ptr<TestConnection> > connections;
+      boost::thread client([&]() {
+         for (int i = 0; i < kRequests; ++i)
+         {
+            boost::shared_ptr<TestConnection> ptrConnection =
+                  boost::make_shared<TestConnection>(kTestWorkerMethod);
+            connections.push_back(ptrConnection);
+            if (worker)
+               rpc::handleWorkerRequest(ptrConnection);
+            else
+               queue.enqueConnection(ptrConnection);
+            boost::this_thread::sleep(boost::posix_time::milliseconds(20));
+         }
+      });
+
+      runBusyR(kRequests * 0.02 + 0.2, &queue);
+      client.join();
+
+      std::vector<double> latencies;
+      for (const boost::shared_ptr<TestConnection>& ptrConnection : connections)
+      {
+         REQUIRE(ptrConnection->waitForAnswer(boost::posix_time::seconds(5)));
+         latencies.push_back(ptrConnection->latencyMs());
+      }
+
+      std::sort(latencies.begin(), latencies.end());
+      std::cout << (worker ? "worker threads: " : "main thread: ")
+                << "p50 " << latencies[latencies.size() / 2] << "ms, "
+                << "p99 " << latencies[latencies.size() * 99 / 100] << "ms "
+                << "while R is busy" << std::endl;
+   }
+}
+
+} // namespace tests
+} // namespace session
+} // namespace rstudio
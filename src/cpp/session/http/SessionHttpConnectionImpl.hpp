@@ -18,6 +18,7 @@
 
 
 #include <boost/array.hpp>
+#include <boost/algorithm/string/predicate.hpp>
 
 #include <boost/utility.hpp>
 #include <boost/asio/io_service.hpp>
@@ -64,9 +65,14 @@ public:
    HttpConnectionImpl(boost::asio::io_service& ioService,
                       boost::shared_ptr<boost::asio::ssl::context> sslContext,
                       const HeadersParsedHandler& headersParsed,
-                      const Handler& handler)
-      : headersParsedHandler_(headersParsed), handler_(handler),
-        receivedTime_(std::chrono::steady_clock::now())
+                      const Handler& handler,
+                      bool allowKeepAlive = false)
+      : ioService_(ioService),
+        headersParsedHandler_(headersParsed), handler_(handler),
+        receivedTime_(std::chrono::steady_clock::now()),
+        allowKeepAlive_(allowKeepAlive),
+        handedOff_(false),
+        awaitingRequest_(false)
    {
       if (sslContext)
       {
@@ -137,17 +143,26 @@ public:
          }
 
          // write the non streaming response
+         bool keepAlive = keepConnectionAlive(response);
+         core::http::Header connectionHeader = keepAlive ?
+                  core::http::Header::connectionKeepAlive() :
+                  core::http::Header::connectionClose();
          if (sslStream_)
          {
             boost::asio::write(*sslStream_,
-                               response.toBuffers(
-                                     core::http::Header::connectionClose()));
+                               response.toBuffers(connectionHeader));
          }
          else
          {
             boost::asio::write(socket(),
-                               response.toBuffers(
-                                     core::http::Header::connectionClose()));
+                               response.toBuffers(connectionHeader));
+         }
+
+         // read the next request from the connection
+         if (keepAlive)
+         {
+            readNextRequest();
+            return;
          }
       }
       catch(const boost::system::system_error& e)
@@ -191,6 +206,10 @@ public:
    // need to be closed in other circumstances
    virtual void close()
    {
+      // the connection now belongs to the next request read from it
+      if (handedOff_)
+         return;
+
       // always close connection
       core::Error error = core::http::closeSocket(*socket_);
       if (error)
@@ -252,6 +271,34 @@ public:
 
 private:
 
+   // keep the connection open for another request if the client asked for
+   // it (and the end of the response is indicated by its length)
+   bool keepConnectionAlive(const core::http::Response& response) const
+   {
+      return allowKeepAlive_ &&
+             boost::algorithm::iequals(request_.headerValue("Connection"), "keep-alive") &&
+             request_.method() != "HEAD" &&
+             !response.headerValue("Content-Length").empty();
+   }
+
+   void readNextRequest()
+   {
+      boost::shared_ptr<HttpConnectionImpl<ProtocolType> > pNext(
+               new HttpConnectionImpl<ProtocolType>(
+                  ioService_,
+                  boost::shared_ptr<boost::asio::ssl::context>(),
+                  headersParsedHandler_,
+                  handler_,
+                  allowKeepAlive_));
+
+      pNext->socket_ = socket_;
+      pNext->sslStream_ = sslStream_;
+      pNext->awaitingRequest_ = true;
+      handedOff_ = true;
+
+      pNext->readSome();
+   }
+
    // async request reading interface
    void readSome()
    {
@@ -306,6 +353,15 @@ private:
       {
          if (!e)
          {
+            // a request read from a kept-alive connection is received when
+            // its first bytes arrive (rather than when the previous response
+            // was written)
+            if (awaitingRequest_ && bytesTransferred > 0)
+            {
+               receivedTime_ = std::chrono::steady_clock::now();
+               awaitingRequest_ = false;
+            }
+
             // parse next chunk
             core::http::RequestParser::status status = requestParser_.parse(
                                         request_,
@@ -393,6 +449,8 @@ private:
    }
 
 private:
+   boost::asio::io_service& ioService_;
+
    // optional ssl stream
    // not used if the connection is not ssl enabled
    boost::shared_ptr<boost::asio::ssl::stream<typename ProtocolType::socket> > sslStream_;
@@ -406,6 +464,9 @@ private:
    HeadersParsedHandler headersParsedHandler_;
    Handler handler_;
    std::chrono::steady_clock::time_point receivedTime_;
+   bool allowKeepAlive_;
+   bool handedOff_;
+   bool awaitingRequest_;
 };
 
 } // namespace session
@@ -206,6 +206,10 @@ private:
 
    virtual core::Error cleanup() = 0;
 
+   // whether clients may make further requests over a connection once
+   // they have received a response
+   virtual bool allowKeepAlive() { return false; }
+
 private:
    boost::asio::io_service& ioService() { return acceptorService_.ioService(); }
 
@@ -222,7 +226,8 @@ private:
             boost::bind(
                  &HttpConnectionListenerImpl<ProtocolType>::enqueConnection,
                  this,
-                 _1))
+                 _1),
+            allowKeepAlive())
       );
 
       // wait for next connection
@@ -350,6 +355,12 @@ private:
          {
             eventsActive_ = false;
          }
+         // methods which don't use R needn't wait for it
+         if (init::isSessionInitialized() && rpc::isWorkerRequest(ptrHttpConnection))
+         {
+            rpc::handleWorkerRequest(ptrHttpConnection);
+            return;
+         }
          if (options().handleOfflineEnabled() && options().handleOfflineTimeoutMs() == 0 &&
              rpc::isOfflineableRequest(ptrHttpConnection) && init::isSessionInitialized())
          {
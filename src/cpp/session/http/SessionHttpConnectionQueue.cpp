@@ -15,52 +15,102 @@
 
 #include <session/SessionHttpConnectionQueue.hpp>
 
+#include <algorithm>
+
+#include <boost/algorithm/string/predicate.hpp>
+
 #include <core/Log.hpp>
 #include <shared_core/Error.hpp>
 #include <core/Thread.hpp>
 
 #include <core/http/Request.hpp>
 
+#include <session/SessionConstants.hpp>
+
 using namespace rstudio::core;
 
 namespace rstudio {
 namespace session {
 
+ConnectionPriority connectionPriority(const boost::shared_ptr<HttpConnection>& ptrConnection)
+{
+   const std::string& uri = ptrConnection->request().uri();
+   if (!boost::algorithm::starts_with(uri, "/rpc/"))
+      return BulkPriority;
+
+   if (boost::algorithm::ends_with(uri, std::string("/") + kConsoleInput) ||
+       boost::algorithm::ends_with(uri, std::string("/") + kInterrupt))
+   {
+      return InteractivePriority;
+   }
+
+   return RpcPriority;
+}
+
 void HttpConnectionQueue::enqueConnection(
                               boost::shared_ptr<HttpConnection> ptrConnection)
+{
+   enqueConnection(ptrConnection, connectionPriority(ptrConnection));
+}
+
+void HttpConnectionQueue::enqueConnection(
+                              boost::shared_ptr<HttpConnection> ptrConnection,
+                              ConnectionPriority priority)
 {
    LOCK_MUTEX(*pMutex_)
    {
-      // Add the new connection to the end of the queue
-      queue_.push_back(ptrConnection);
+      // Add the new connection to the end of its lane
+      lanes_[priority].push_back(ptrConnection);
+
+      LaneMetrics& metrics = metrics_[priority];
+      ++metrics.enqueued;
+      metrics.maxDepth = std::max(metrics.maxDepth, lanes_[priority].size());
    }
    END_LOCK_MUTEX
 
    pWaitCondition_->notify_all();
 }
 
+boost::shared_ptr<HttpConnection> HttpConnectionQueue::takeConnection(
+                                                   ConnectionPriority priority,
+                                                   Lane::iterator it)
+{
+   // (called with the mutex held)
+   boost::shared_ptr<HttpConnection> next = *it;
+   if (it == lanes_[priority].begin())
+      lanes_[priority].pop_front();
+   else
+      lanes_[priority].erase(it);
+
+   LaneMetrics& metrics = metrics_[priority];
+   ++metrics.dequeued;
+   double waitMs = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - next->receivedTime()).count();
+   metrics.totalWaitMs += waitMs;
+   metrics.maxWaitMs = std::max(metrics.maxWaitMs, waitMs);
+
+   return next;
+}
 
 boost::shared_ptr<HttpConnection> HttpConnectionQueue::doDequeConnection()
 {
    LOCK_MUTEX(*pMutex_)
    {
-      if (!queue_.empty())
+      for (int priority = 0; priority < ConnectionPriorityCount; ++priority)
       {
-         // remove the first connection
-         boost::shared_ptr<HttpConnection> next = queue_.front();
-         queue_.erase(queue_.begin());
+         Lane& lane = lanes_[priority];
+         if (lane.empty())
+            continue;
 
          // note last connection time
          lastConnectionTime_ =
                      boost::posix_time::second_clock::universal_time();
 
-         // return it
-         return next;
-      }
-      else
-      {
-         return boost::shared_ptr<HttpConnection>();
+         // remove and return the first connection
+         return takeConnection(static_cast<ConnectionPriority>(priority), lane.begin());
       }
+
+      return boost::shared_ptr<HttpConnection>();
    }
    END_LOCK_MUTEX
 
@@ -96,10 +146,13 @@ std::string HttpConnectionQueue::peekNextConnectionUri()
 {
    LOCK_MUTEX(*pMutex_)
    {
-      if (!queue_.empty())
-         return queue_.front()->request().uri();
-      else
-         return std::string();
+      for (const Lane& lane : lanes_)
+      {
+         if (!lane.empty())
+            return lane.front()->request().uri();
+      }
+
+      return std::string();
    }
    END_LOCK_MUTEX
 
@@ -143,15 +196,13 @@ boost::shared_ptr<HttpConnection> HttpConnectionQueue::dequeMatchingConnection(
 {
    LOCK_MUTEX(*pMutex_)
       {
-         size_t sz = queue_.size();
-         boost::shared_ptr<HttpConnection> next;
-         for (size_t i = 0; i < sz; i++)
+         for (int priority = 0; priority < ConnectionPriorityCount; ++priority)
          {
-            next = queue_[i];
-            if (matcher(next, now))
+            Lane& lane = lanes_[priority];
+            for (Lane::iterator it = lane.begin(); it != lane.end(); ++it)
             {
-               queue_.erase(queue_.begin() + i);
-               return next;
+               if (matcher(*it, now))
+                  return takeConnection(static_cast<ConnectionPriority>(priority), it);
             }
          }
       }
@@ -165,20 +216,34 @@ void HttpConnectionQueue::convertConnections(
 {
    LOCK_MUTEX(*pMutex_)
       {
-         size_t sz = queue_.size();
-         boost::shared_ptr<HttpConnection> next;
-         for (size_t i = 0; i < sz; i++)
+         for (Lane& lane : lanes_)
          {
-            next = queue_[i];
-            boost::shared_ptr<HttpConnection> convertedConn = converter(next, now);
-            if (convertedConn)
+            for (boost::shared_ptr<HttpConnection>& next : lane)
             {
-               queue_[i] = convertedConn;
+               boost::shared_ptr<HttpConnection> convertedConn = converter(next, now);
+               if (convertedConn)
+               {
+                  next = convertedConn;
+               }
             }
          }
       }
    END_LOCK_MUTEX
 }
 
+HttpConnectionQueue::LaneMetrics HttpConnectionQueue::metrics(ConnectionPriority priority)
+{
+   LOCK_MUTEX(*pMutex_)
+   {
+      LaneMetrics metrics = metrics_[priority];
+      metrics.depth = lanes_[priority].size();
+      return metrics;
+   }
+   END_LOCK_MUTEX
+
+   // keep compiler happy
+   return LaneMetrics();
+}
+
 } // namespace session
 } // namespace rstudio
@@ -0,0 +1,164 @@
+/*
+ * SessionHttpConnectionQueueTests.cpp
+ *
+ * Copyright (C) 2022 by RStudio, PBC
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <session/SessionHttpConnectionQueue.hpp>
+
+#include <boost/make_shared.hpp>
+
+#include <core/http/Request.hpp>
+
+#include <tests/TestThat.hpp>
+
+namespace rstudio {
+namespace session {
+namespace tests {
+
+namespace {
+
+class TestConnection : public HttpConnection
+{
+public:
+   explicit TestConnection(const std::string& uri)
+      : received_(std::chrono::steady_clock::now())
+   {
+      request_.setUri(uri);
+   }
+
+   virtual const core::http::Request& request() override { return request_; }
+   virtual void sendResponse(const core::http::Response&) override {}
+   virtual void sendJsonRpcResponse(core::json::JsonRpcResponse&) override {}
+   virtual void close() override {}
+   virtual std::string requestId() const override { return std::string(); }
+   virtual void setUploadHandler(const core::http::UriAsyncUploadHandlerFunction&) override {}
+   virtual bool isAsyncRpc() const override { return false; }
+   virtual std::chrono::steady_clock::time_point receivedTime() const override { return received_; }
+
+private:
+   core::http::Request request_;
+   std::chrono::steady_clock::time_point received_;
+};
+
+boost::shared_ptr<HttpConnection> connection(const std::string& uri)
+{
+   return boost::make_shared<TestConnection>(uri);
+}
+
+std::string nextUri(HttpConnectionQueue& queue)
+{
+   boost::shared_ptr<HttpConnection> ptrConnection = queue.dequeConnection();
+   return ptrConnection ? ptrConnection->request().uri() : std::string();
+}
+
+bool matchFind(const boost::shared_ptr<HttpConnection>& ptrConnection,
+               const std::chrono::steady_clock::time_point)
+{
+   return ptrConnection->request().uri() == "/rpc/find";
+}
+
+} // anonymous namespace
+
+test_context("HttpConnectionQueue")
+{
+   test_that("Connections are prioritized by uri")
+   {
+      expect_true(connectionPriority(connection("/rpc/console_input")) == InteractivePriority);
+      expect_true(connectionPriority(connection("/rpc/interrupt")) == InteractivePriority);
+      expect_true(connectionPriority(connection("/rpc/get_completions")) == RpcPriority);
+      expect_true(connectionPriority(connection("/file_show?path=data.csv")) == BulkPriority);
+      expect_true(connectionPriority(connection("/export/data.csv")) == BulkPriority);
+   }
+
+   test_that("Higher priority connections are dequeued first, in order within a priority")
+   {
+      HttpConnectionQueue queue;
+      queue.enqueConnection(connection("/upload"));
+      queue.enqueConnection(connection("/rpc/list_files"));
+      queue.enqueConnection(connection("/export/a.csv"));
+      queue.enqueConnection(connection("/rpc/console_input"));
+      queue.enqueConnection(connection("/rpc/get_completions"));
+
+      expect_true(queue.peekNextConnectionUri() == "/rpc/console_input");
+      expect_true(nextUri(queue) == "/rpc/console_input");
+      expect_true(nextUri(queue) == "/rpc/list_files");
+      expect_true(nextUri(queue) == "/rpc/get_completions");
+      expect_true(nextUri(queue) == "/upload");
+      expect_true(nextUri(queue) == "/export/a.csv");
+      expect_true(nextUri(queue).empty());
+      expect_true(queue.peekNextConnectionUri().empty());
+   }
+
+   test_that("Matching connections can be dequeued from any lane")
+   {
+      HttpConnectionQueue queue;
+      queue.enqueConnection(connection("/rpc/list_files"));
+      queue.enqueConnection(connection("/rpc/find"));
+      queue.enqueConnection(connection("/rpc/stat"));
+
+      std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+      boost::shared_ptr<HttpConnection> ptrConnection = queue.dequeMatchingConnection(matchFind, now);
+      expect_true(ptrConnection && ptrConnection->request().uri() == "/rpc/find");
+      expect_false(queue.dequeMatchingConnection(matchFind, now));
+
+      expect_true(nextUri(queue) == "/rpc/list_files");
+      expect_true(nextUri(queue) == "/rpc/stat");
+   }
+
+   test_that("Metrics are kept for each lane")
+   {
+      HttpConnectionQueue queue;
+      queue.enqueConnection(connection("/rpc/list_files"));
+      queue.enqueConnection(connection("/rpc/stat"));
+      queue.enqueConnection(connection("/upload"));
+      nextUri(queue);
+
+      HttpConnectionQueue::LaneMetrics rpc = queue.metrics(RpcPriority);
+      expect_true(rpc.enqueued == 2);
+      expect_true(rpc.dequeued == 1);
+      expect_true(rpc.depth == 1);
+      expect_true(rpc.maxDepth == 2);
+
+      HttpConnectionQueue::LaneMetrics bulk = queue.metrics(BulkPriority);
+      expect_true(bulk.enqueued == 1);
+      expect_true(bulk.dequeued == 0);
+      expect_true(bulk.depth == 1);
+
+      expect_true(queue.metrics(InteractivePriority).enqueued == 0);
+   }
+
+   test_that("Console input is handled ahead of 1000 queued bulk requests")
+   {
+      HttpConnectionQueue queue;
+      for (int i = 0; i < 1000; ++i)
+         queue.enqueConnection(connection("/file_show?path=file" + std::to_string(i)));
+
+      // handle some of the bulk requests before console input arrives
+      for (int i = 0; i < 10; ++i)
+         expect_true(nextUri(queue) == "/file_show?path=file" + std::to_string(i));
+      queue.enqueConnection(connection("/rpc/console_input"));
+
+      // the console input is handled next, and then the remaining bulk requests
+      expect_true(nextUri(queue) == "/rpc/console_input");
+      for (int i = 10; i < 1000; ++i)
+         expect_true(nextUri(queue) == "/file_show?path=file" + std::to_string(i));
+      expect_true(nextUri(queue).empty());
+
+      expect_true(queue.metrics(InteractivePriority).dequeued == 1);
+      expect_true(queue.metrics(BulkPriority).dequeued == 1000);
+   }
+}
+
+} // namespace tests
+} // namespace session
+} // namespace rstudio
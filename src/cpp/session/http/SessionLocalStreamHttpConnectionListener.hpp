@@ -123,6 +123,13 @@ private:
       return localStreamPath_.removeIfExists();
    }
 
+   // rserver keeps its connections to the session open between requests
+   // (the connecting user has already been validated)
+   virtual bool allowKeepAlive()
+   {
+      return true;
+   }
+
 protected:
 
    virtual bool authenticate(boost::shared_ptr<HttpConnection> ptrConnection)
@@ -59,8 +59,9 @@ private:
 
    void erasePreviouslyDeliveredEvents(int lastClientEventIdSeen);
    bool havePendingClientEvents();
-   void addClientEvent(const core::json::Object& eventObject);
+   void addClientEvent(core::json::Object&& eventObject);
    void setClientEventResult(core::json::JsonRpcResponse* pResponse);
+   void writeClientEvents(core::json::StreamWriter& writer);
 
   
 private:
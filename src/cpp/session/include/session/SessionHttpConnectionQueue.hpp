@@ -16,6 +16,7 @@
 #ifndef SESSION_HTTP_CONNECTION_QUEUE_HPP
 #define SESSION_HTTP_CONNECTION_QUEUE_HPP
 
+#include <deque>
 #include <queue>
 
 #include <boost/shared_ptr.hpp>
@@ -35,6 +36,18 @@ namespace core {
 namespace rstudio {
 namespace session {
 
+// connections are dequeued from the highest priority lane which has any,
+// and in the order they arrived within a lane
+enum ConnectionPriority
+{
+   InteractivePriority,   // console input and interrupts
+   RpcPriority,           // other rpc methods
+   BulkPriority,          // content (files, exports, uploads, etc.)
+   ConnectionPriorityCount
+};
+
+ConnectionPriority connectionPriority(const boost::shared_ptr<HttpConnection>& ptrConnection);
+
 typedef boost::function<bool(const boost::shared_ptr<HttpConnection>&,
                              const std::chrono::steady_clock::time_point)>
         HttpConnectionMatcher;
@@ -52,8 +65,28 @@ public:
    {
    }
 
+   // metrics for one priority lane (waits are from receipt to dequeue)
+   struct LaneMetrics
+   {
+      LaneMetrics()
+         : enqueued(0), dequeued(0), depth(0), maxDepth(0),
+           totalWaitMs(0), maxWaitMs(0)
+      {
+      }
+
+      std::size_t enqueued;
+      std::size_t dequeued;
+      std::size_t depth;
+      std::size_t maxDepth;
+      double totalWaitMs;
+      double maxWaitMs;
+   };
+
    void enqueConnection(boost::shared_ptr<HttpConnection> ptrConnection);
 
+   void enqueConnection(boost::shared_ptr<HttpConnection> ptrConnection,
+                        ConnectionPriority priority);
+
    boost::shared_ptr<HttpConnection> dequeConnection();
 
    boost::shared_ptr<HttpConnection> dequeConnection(
@@ -71,8 +104,14 @@ public:
                const HttpConnectionConverter matcher,
                const std::chrono::steady_clock::time_point now);
 
+   LaneMetrics metrics(ConnectionPriority priority);
+
 private:
+   typedef std::deque<boost::shared_ptr<HttpConnection> > Lane;
+
    boost::shared_ptr<HttpConnection> doDequeConnection();
+   boost::shared_ptr<HttpConnection> takeConnection(ConnectionPriority priority,
+                                                    Lane::iterator it);
    bool waitForConnection(const boost::posix_time::time_duration& waitDuration);
 
 private:
@@ -86,7 +125,8 @@ private:
 
    // instance data
    boost::posix_time::ptime lastConnectionTime_;
-   std::vector<boost::shared_ptr<HttpConnection> > queue_;
+   Lane lanes_[ConnectionPriorityCount];
+   LaneMetrics metrics_[ConnectionPriorityCount];
 };
 
 } // namespace session
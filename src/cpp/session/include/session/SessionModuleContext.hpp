@@ -244,6 +244,13 @@ core::Error registerRpcMethod(const std::string& name,
 
 void registerRpcMethod(const core::json::JsonRpcAsyncMethod& method);
 
+// register an rpc method which never calls into R. these are run on a pool
+// of worker threads as soon as they arrive (rather than waiting for R to be
+// idle), so they must be threadsafe with respect to the main thread (e.g.
+// they mustn't read the session's environment or project state)
+core::Error registerThreadSafeRpcMethod(const std::string& name,
+                                        const core::json::JsonRpcFunction& function);
+
 core::Error executeAsync(const core::json::JsonRpcFunction& function,
                          const core::json::JsonRpcRequest& request,
                          core::json::JsonRpcResponse* pResponse);
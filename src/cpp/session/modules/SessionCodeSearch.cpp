@@ -38,9 +38,11 @@
 #include <core/Debug.hpp>
 #include <core/FileSerializer.hpp>
 #include <core/Exec.hpp>
-#include <core/collection/Tree.hpp>
+#include <core/Thread.hpp>
+#include <core/collection/PathIndex.hpp>
 
 #include <core/r_util/RSourceIndex.hpp>
+#include <core/r_util/RSourceIndexCache.hpp>
 
 #include <core/system/FileChangeEvent.hpp>
 #include <core/system/FileMonitor.hpp>
@@ -51,6 +53,7 @@
 
 #include <session/SessionModuleContext.hpp>
 #include <session/SessionAsyncRProcess.hpp>
+#include <session/SessionOptions.hpp>
 #include <session/SessionQuarto.hpp>
 #include <session/SessionRUtil.hpp>
 
@@ -61,6 +64,8 @@
 #include "SessionSource.hpp"
 #include "clang/DefinitionIndex.hpp"
 
+#include "session-config.h"
+
 #include <core/Macros.hpp>
 
 using namespace rstudio::core;
@@ -163,6 +168,36 @@ bool enforceMaxResults(std::size_t maxResults,
 }
 
 
+// add a path whose name matches a search term; returns false once we are at
+// max results
+template <typename T>
+bool addMatchingPath(const std::string& path,
+                     const std::string& term,
+                     std::size_t maxResults,
+                     T* pPaths,
+                     bool* pMoreAvailable)
+{
+   std::string::size_type nameOffset = path.rfind('/') + 1;
+   if (!string_utils::isSubsequence(path.data() + nameOffset,
+                                    path.data() + path.length(),
+                                    term,
+                                    term.length(),
+                                    true))
+   {
+      return true;
+   }
+
+   pPaths->push_back(path);
+   if (pPaths->size() >= maxResults)
+   {
+      *pMoreAvailable = true;
+      return false;
+   }
+
+   return true;
+}
+
+
 // index entries we are managing
 struct Entry
 {
@@ -203,262 +238,109 @@ struct Entry
    }
 };
 
-void print_tree(tree<Entry> const& tr)
+struct EntryTraits
 {
-#ifdef RSTUDIO_ENABLE_DEBUG_MACROS
-   std::cerr << "Tree of size " << tr.size() << ".\n";
-   tree<Entry>::iterator it = tr.begin();
-   for (; it != tr.end(); ++it)
+   static const std::string& path(const Entry& entry)
    {
-      int depth = tr.depth(it);
-      for (int i = 0; i < depth; i++)
-         std::cerr << "--";
-      std::cerr << (*it).fileInfo.absolutePath() << "\n";
+      return entry.fileInfo.absolutePath();
    }
-#endif
-}
 
-class EntryTree
-      : public tree<Entry>
-{
-public:
-   
-   EntryTree()
-   {
-      // NOTE from tree.hh, line 914:
-      //
-      // If your program fails here you probably used 'append_child' to add the top
-      // node to an empty tree. From version 1.45 the top element should be added
-      // using 'insert'. See the documentation for further information, and sorry about
-      // the API change.
-      //
-      // We work around this by explicitly inserting a root node on construction.
-      Entry dummy(FileInfo("", true));
-      insert(begin(), dummy);
-   }
-   
-   // make this BOOST_FOREACH aware
-   typedef iterator const_iterator;
-   
-   const_iterator const_begin() const
-   {
-      return static_cast<const_iterator>(begin());
-   }
-   
-   const_iterator const_end() const
+   static bool isDirectory(const Entry& entry)
    {
-      return static_cast<const_iterator>(end());
+      return entry.fileInfo.isDirectory();
    }
-   
-   void insertEntry(const Entry& entry)
-   {
-      std::string absolutePath = entry.fileInfo.absolutePath();
-      if (absolutePath.empty())
-         return;
-
-      DEBUG("");
-      DEBUG("Begin entry insertion: '" << absolutePath << "'");
-      
-      // construct a tree branch from the path, with each directory forming a new node, e.g
-      //
-      //   foo/bar/baz
-      //
-      // becoming
-      //
-      // foo
-      //     --> foo/bar
-      //                  --> foo/bar/baz
-      iterator parent = begin();
-      DEBUG("First parent: '" << (*parent).fileInfo.absolutePath() << "'");
-
-      std::string::size_type matchIndex = absolutePath.find('/');
-      
-      DEBUG("Entering directory node insertion phase");
-      while (matchIndex != std::string::npos)
-      {
-         FileInfo path(
-                  absolutePath.substr(0, matchIndex), // note: don't include the trailing '/'
-                  true);
-         
-         Entry entry(path);
-         DEBUG("Entry: '" << entry.fileInfo.absolutePath() << "'");
-
-         if (isSamePath(*parent, entry))
-         {
-            DEBUG("- Node already exists as parent; skipping...");
-         }
-
-         else if (number_of_children(parent) == 0)
-         {
-            DEBUG("- Inserting new node as first child of '" << (*parent).fileInfo.absolutePath() << "'");
-
-            iterator newItr = append_child(parent, entry);
-            DEBUG("- Parent now has " << number_of_children(parent) << " children.");
-            DEBUG("- Parent now has " << number_of_siblings(parent) << " siblings.");
-            parent = newItr;
-         }
-         else
-         {
-            DEBUG("- Searching the children of this node");
-            sibling_iterator it = parent.begin();
-            sibling_iterator end = parent.end();
+};
 
-            for (; it != end; ++it)
-            {
-               DEBUG("-- Current node: '" << (*it).fileInfo.absolutePath() << "'");
-               if (isSamePath(*it, entry))
-               {
-                  DEBUG("-- Found it!");
-                  break;
-               }
-            }
+// entries are kept in a flat array sorted by path, so that everything below
+// a directory is a contiguous range
+typedef core::collection::PathIndex<Entry, EntryTraits> EntryIndex;
 
-            if (it == end)
-            {
-               DEBUG("- Adding another child to parent '" << (*parent).fileInfo.absolutePath() << "'");
-               parent = append_child(parent, entry);
-            }
-            else
-            {
-               DEBUG("- Node already exists; setting parent to child (" << (*parent).fileInfo.absolutePath() << ")");
-               parent = it;
-            }
-         }
-         
-         matchIndex = absolutePath.find('/', matchIndex + 1);
-      }
-      DEBUG("Exiting directory node insertion phase");
-      
-      // Now, we have the filename. We append that to the parent.
-      DEBUG("Parent: '" << (*parent).fileInfo.absolutePath() << "'");
-      DEBUG("Entry: '" << entry.fileInfo.absolutePath() << "'");
-      if (parent.number_of_children() == 0)
-      {
-         DEBUG("- No children at parent node; adding child");
-         parent = append_child(parent, entry);
-      }
+// request to index a file on a worker thread
+struct IndexRequest
+{
+   FileInfo fileInfo;
+   uint64_t generation;
+   std::string context;
+   core::string_utils::LineEnding lineEnding;
 
-      // We check for a dummy node. If we are inserting a file
-      // into a folder with just a dummy node, replace that node.
-      else if (parent.number_of_children() == 1 &&
-               !entry.fileInfo.isDirectory() &&
-               *child(parent, 0) == dummyEntry_)
-      {
-         DEBUG("- Replacing dummy node");
-         iterator firstChild = child(parent, 0);
-         *firstChild = entry;
-      }
+   // the already decoded file contents (files in encodings other than
+   // UTF-8 are decoded on the main thread as that requires R's iconv)
+   bool decoded;
+   std::string code;
 
-      // Otherwise, loop through all the children and try to find
-      // the node. If we don't find it, append it, otherwise no-op.
-      else
-      {
-         sibling_iterator it = parent.begin();
-         sibling_iterator end = parent.end();
-         for (; it != end; ++it)
-         {
-            DEBUG("-- Current node: '" << (*it).fileInfo.absolutePath() << "'");
-            DEBUG("-- Entry       : '" << entry.fileInfo.absolutePath() << "'");
-            
-            if (isSamePath(*it, entry))
-            {
-               DEBUG("- Found it!");
-               break;
-            }
-         }
+   // the current cached index for the file, if any
+   uint32_t cachedContentHash;
+   boost::shared_ptr<r_util::RSourceIndex> pCachedIndex;
+};
 
-         if (it == end)
-         {
-            DEBUG("- Adding another child to parent");
-            parent = append_child(parent, entry);
-         }
-         else
-         {
-            // We update the entry (because its associated index may
-            // have changed)
-            *it = entry;
-         }
-      }
+struct IndexResult
+{
+   IndexResult() : generation(0), contentHash(0) {}
 
-      // If we just inserted a folder, we append an empty child
-      // to the node. This is done to optimize lookup time.
-      if (entry.fileInfo.isDirectory())
-      {
-         DEBUG("Inserted empty directory; adding dummy child to folder node");
-         parent = append_child(parent, dummyEntry_);
-      }
-      DEBUG("");
+   FileInfo fileInfo;
+   uint64_t generation;
+   Error error;
+   uint32_t contentHash;
+   boost::shared_ptr<r_util::RSourceIndex> pIndex;
+};
 
-      DEBUG("Tree is now:");
-      print_tree(*this);
-      DEBUG("");
-   }
+typedef core::thread::ThreadsafeQueue<IndexResult> IndexResultQueue;
 
-public:
+// runs on a worker thread so must not call into R
+void indexFile(const IndexRequest& request,
+               const boost::shared_ptr<IndexResultQueue>& pResults)
+{
+   IndexResult result;
+   result.fileInfo = request.fileInfo;
+   result.generation = request.generation;
 
-   iterator find_leaf(const Entry& entry)
-   {
-      leaf_iterator it = begin_leaf();
-      for (; is_valid(it); ++it)
-         if (isSamePath(*it, entry))
-            return it;
-      return this->end();
-   }
+   FilePath filePath(request.fileInfo.absolutePath());
 
-   iterator find_branch(const Entry& entry)
+   // skip anything that isn't a regular file or is too large to index
+   if (!request.decoded &&
+       (!filePath.isRegularFile() || filePath.getSize() > 2 * 1024 * 1024))
    {
-      iterator parent = begin();
-      iterator result = end();
-      do_find_branch(entry, parent, &result);
-      return result;
+      pResults->enque(result);
+      return;
    }
-   
-private:
 
-   void do_find_branch(const Entry& entry,
-                       iterator parent,
-                       iterator* pResult)
+   std::string code = request.code;
+   if (!request.decoded)
    {
-      sibling_iterator it = parent.begin();
-      sibling_iterator end = parent.end();
-      for (; it != end; ++it)
+      result.error = readStringFromFile(filePath, &code, request.lineEnding);
+      if (!result.error)
       {
-         DEBUG("- Current branch: '" << (*it).fileInfo.absolutePath() << "'");
-         if (isSamePath(*it, entry))
-         {
-            *pResult = it;
-            return;
-         }
-
-         if (number_of_children(it) > 0)
-         {
-            DEBUG("-- Searching children of branch");
-            do_find_branch(entry, it, pResult);
-         }
+         stripBOM(&code);
+         result.error = string_utils::utf8Clean(code.begin(), code.end(), '?');
       }
-   }
 
-public:
-
-   iterator find(const Entry& entry)
-   {
-      if (entry.fileInfo.isDirectory())
-         return find_branch(entry);
-      else
-         return find_leaf(entry);
+      if (result.error)
+      {
+         pResults->enque(result);
+         return;
+      }
    }
 
-private:
+   // reuse the cached index if the contents haven't changed (e.g. the
+   // file was only touched)
+   result.contentHash = r_util::RSourceIndexCache::contentHash(code);
+   if (request.pCachedIndex && request.cachedContentHash == result.contentHash)
+      result.pIndex = request.pCachedIndex;
+   else
+      result.pIndex.reset(new r_util::RSourceIndex(request.context, code));
 
-   Entry dummyEntry_;
-   
-};
+   pResults->enque(result);
+}
 
 class SourceFileIndex : boost::noncopyable
 {
 public:
    SourceFileIndex()
-      : pEntries_(new EntryTree()), indexing_(false)
+      : pEntries_(new EntryIndex()),
+        indexing_(false),
+        pResults_(new IndexResultQueue()),
+        generation_(0),
+        publishing_(false)
    {
    }
 
@@ -471,27 +353,44 @@ public:
    boost::shared_ptr<core::r_util::RSourceIndex> get(
          const FilePath& filePath)
    {
-      Entry entry(core::toFileInfo(filePath));
-      EntryTree::iterator it = pEntries_->find(entry);
-      if (pEntries_->is_valid(it) && it != pEntries_->end())
-      {
-         const Entry& entry = *it;
-         return entry.pIndex;
-      }
+      const Entry* pEntry = pEntries_->find(filePath.getAbsolutePath());
+      if (pEntry != nullptr)
+         return pEntry->pIndex;
       return boost::shared_ptr<core::r_util::RSourceIndex>();
    }
 
    template <typename ForwardIterator>
    void enqueFiles(ForwardIterator begin, ForwardIterator end)
    {
-      // add all files to the indexing queue
+      // load indexes persisted by a previous session
+      readCache();
+
+      // files whose cached index is still current are added immediately;
+      // add all other files to the indexing queue
       using namespace rstudio::core::system;
+      std::set<std::string> paths;
+      bool addedCachedEntries = false;
       for ( ; begin != end; ++begin)
       {
+         paths.insert(begin->absolutePath());
+         if (addCachedIndexEntry(*begin))
+         {
+            addedCachedEntries = true;
+            continue;
+         }
+
          FileChangeEvent addEvent(FileChangeEvent::FileAdded, *begin);
          indexingQueue_.push(addEvent);
       }
 
+      // forget files removed since the cache was written
+      cache_.removeAllExcept(paths);
+
+      if (addedCachedEntries)
+         r_packages::AsyncPackageInformationProcess::update();
+
+      onIndexingIdle();
+
       // schedule indexing if necessary. perform up to 200ms of work
       // immediately and then continue in periodic 20ms chunks until
       // we are completed.
@@ -613,82 +512,73 @@ public:
       // create wildcard pattern if the search has a '*'
       boost::regex pattern = regex_utils::regexIfWildcardPattern(term);
       
-      // get the start and end iterators -- default to all leaves
-      EntryTree::leaf_iterator it = pEntries_->begin_leaf();
-      
-      DEBUG("Searching for node '" << parentPath.getAbsolutePath());
-      Entry parentEntry(core::toFileInfo(parentPath));
-      EntryTree::iterator parent = pEntries_->find(parentEntry);
-      if (parent != pEntries_->end())
-      {
-         DEBUG("Found node: '" + (*parent).fileInfo.absolutePath() + "'");
-         DEBUG("Node has: '" << pEntries_->number_of_children(parent) << "' children.");
-         DEBUG("Node has: '" << pEntries_->number_of_siblings(parent) << "' siblings.");
-
-         it = parent.begin();
-      }
-      else
+      // find the files below the parent
+      std::string parent = parentPath.getAbsolutePath();
+      DEBUG("Searching for node '" << parent);
+      if (!pEntries_->containsDirectory(parent))
       {
          DEBUG("Failed to find node.");
          LOG_ERROR_MESSAGE("Failed to find parent node when searching index");
          return;
       }
-      
+
+      // We allow the user to submit queries of the form e.g.
+      // <query>:<row><column>; make sure we only take items
+      // on the query up to ':'
+      std::string::size_type queryEnd = term.find(":");
+      if (queryEnd == std::string::npos)
+         queryEnd = term.length();
+
       // iterate over the files
-      for (; pEntries_->is_valid(it); ++it)
+      EntryIndex::range files = pEntries_->below(parent);
+      for (EntryIndex::const_iterator it = files.first; it != files.second; ++it)
       {
          const Entry& entry = *it;
-         
-         DEBUG("Node: '" << (*it).fileInfo.absolutePath() << "'");
-         
-         // skip if it's not a source file
-         if (sourceFilesOnly && !isSourceFile(entry.fileInfo))
+         if (entry.fileInfo.isDirectory())
             continue;
-         
-         // get file and name
-         FilePath filePath(entry.fileInfo.absolutePath());
-         std::string name = filePath.getFilename();
 
-         // compare for match (wildcard or standard)
+         DEBUG("Node: '" << entry.fileInfo.absolutePath() << "'");
+
+         // compare the name for a match (wildcard or standard); the common
+         // case of a fuzzy match is done in place as it runs on every entry
+         const std::string& path = entry.fileInfo.absolutePath();
+         std::string::size_type nameOffset = path.rfind('/') + 1;
          bool matches = false;
          if (!pattern.empty())
          {
-            matches = regex_utils::textMatches(name,
+            matches = regex_utils::textMatches(path.substr(nameOffset),
                                                pattern,
                                                prefixOnly,
                                                false);
          }
+         else if (prefixOnly)
+         {
+            matches = boost::algorithm::istarts_with(path.substr(nameOffset), term);
+         }
          else
          {
-            if (prefixOnly)
-               matches = boost::algorithm::istarts_with(name, term);
-            else
-            {
-               // We allow the user to submit queries of the form e.g.
-               // <query>:<row><column>; make sure we only take items
-               // on the query up to ':'
-               std::string::size_type queryEnd = term.find(":");
-               if (queryEnd == std::string::npos)
-                  queryEnd = term.length();
-
-               matches = string_utils::isSubsequence(name,
-                                                     term,
-                                                     queryEnd,
-                                                     true);
-            }
+            matches = string_utils::isSubsequence(path.data() + nameOffset,
+                                                  path.data() + path.length(),
+                                                  term,
+                                                  queryEnd,
+                                                  true);
          }
 
-         // add the file if we found a match
-         if (matches)
-         {
-            // name and aliased path
-            pNames->push_back(filePath.getFilename());
-            pPaths->push_back(module_context::createAliasedPath(filePath));
+         if (!matches)
+            continue;
 
-            // return if we are past max results
-            if (enforceMaxResults(maxResults, pNames, pPaths, pMoreAvailable))
-               return;
-         }
+         // skip if it's not a source file
+         if (sourceFilesOnly && !isSourceFile(entry.fileInfo))
+            continue;
+
+         // add the file: name and aliased path
+         FilePath filePath(path);
+         pNames->push_back(filePath.getFilename());
+         pPaths->push_back(module_context::createAliasedPath(filePath));
+
+         // return if we are past max results
+         if (enforceMaxResults(maxResults, pNames, pPaths, pMoreAvailable))
+            return;
       }
    }
    
@@ -699,39 +589,11 @@ public:
                       T* pPaths,
                       bool* pMoreAvailable)
    {
-      // Find the parent node in the tree
-      Entry parentEntry(core::toFileInfo(parentPath));
-      EntryTree::iterator parentItr = pEntries_->find(parentEntry);
-      if (parentItr == pEntries_->end())
-         return;
-      
-      EntryTree::iterator it = parentItr.begin();
-      EntryTree::iterator end = parentItr.end();
-      for (; it != end; ++it)
+      pEntries_->forEachDirectoryBelow(parentPath.getAbsolutePath(),
+                                       [&](const std::string& directory)
       {
-         const FileInfo& fileInfo = (*it).fileInfo;
-         if (fileInfo.isDirectory())
-         {
-            int lastSlashIndex = gsl::narrow_cast<int>(fileInfo.absolutePath().rfind('/'));
-
-            std::string fileName =
-                  fileInfo.absolutePath().substr(lastSlashIndex + 1);
-
-            bool isSubsequence =
-                  string_utils::isSubsequence(fileName, term, true);
-
-            if (isSubsequence)
-            {
-               pPaths->push_back(fileInfo.absolutePath());
-               if (pPaths->size() >= maxResults)
-               {
-                  *pMoreAvailable = true;
-                  return;
-               }
-            }
-
-         }
-      }
+         return addMatchingPath(directory, term, maxResults, pPaths, pMoreAvailable);
+      });
    }
 
    template <typename T>
@@ -741,39 +603,20 @@ public:
                               T* pPaths,
                               bool* pMoreAvailable)
    {
-      // Find the parent node in the tree
-      Entry parentEntry(core::toFileInfo(parentPath));
-      EntryTree::iterator parentItr = pEntries_->find(parentEntry);
-      if (parentItr == pEntries_->end())
-         return;
-
-      EntryTree::iterator it = parentItr.begin();
-      EntryTree::iterator end = parentItr.end();
-      for (; it != end; ++it)
+      std::string parent = parentPath.getAbsolutePath();
+      pEntries_->forEachDirectoryBelow(parent, [&](const std::string& directory)
       {
-         const FileInfo& fileInfo = (*it).fileInfo;
-
-         // Avoid dummy nodes
-         if (fileInfo.empty())
-            continue;
-
-         int lastSlashIndex = gsl::narrow_cast<int>(fileInfo.absolutePath().rfind('/'));
-
-         std::string fileName =
-               fileInfo.absolutePath().substr(lastSlashIndex + 1);
+         return addMatchingPath(directory, term, maxResults, pPaths, pMoreAvailable);
+      });
 
-         bool isSubsequence =
-               string_utils::isSubsequence(fileName, term, true);
-
-         if (isSubsequence)
-         {
-            pPaths->push_back(fileInfo.absolutePath());
-            if (pPaths->size() >= maxResults)
-            {
-               *pMoreAvailable = true;
-               return;
-            }
-         }
+      EntryIndex::range entries = pEntries_->below(parent);
+      for (EntryIndex::const_iterator it = entries.first;
+           it != entries.second && !*pMoreAvailable;
+           ++it)
+      {
+         // directories were added above
+         if (!it->fileInfo.isDirectory())
+            addMatchingPath(it->fileInfo.absolutePath(), term, maxResults, pPaths, pMoreAvailable);
       }
    }
    
@@ -781,17 +624,19 @@ public:
                   boost::function<void(const Entry&)> operation,
                   boost::function<bool(const Entry&)> filter = boost::function<bool(const Entry&)>())
    {
-      Entry parentEntry(core::toFileInfo(parentPath));
-      EntryTree::iterator parentItr = pEntries_->find_branch(parentEntry);
-      if (parentItr == pEntries_->end())
+      std::string parent = parentPath.getAbsolutePath();
+      if (!pEntries_->containsDirectory(parent))
       {
-         LOG_ERROR_MESSAGE("Failed to find node '" + parentPath.getAbsolutePath() + "'");
+         LOG_ERROR_MESSAGE("Failed to find node '" + parent + "'");
          return;
       }
       
-      EntryTree::leaf_iterator it = parentItr.begin();
-      for (; pEntries_->is_valid(it); ++it)
+      EntryIndex::range entries = pEntries_->below(parent);
+      for (EntryIndex::const_iterator it = entries.first; it != entries.second; ++it)
       {
+         if (it->fileInfo.isDirectory())
+            continue;
+
          if (filter && filter(*it))
             continue;
          
@@ -801,9 +646,34 @@ public:
    
    void clear()
    {
+      writeCache();
+      cache_.clear();
+      cacheFile_ = FilePath();
+
       indexing_ = false;
       indexingQueue_ = std::queue<core::system::FileChangeEvent>();
       pEntries_->clear();
+
+      // results of in-flight requests are discarded when published
+      pendingIndexes_.clear();
+   }
+
+   void shutdown()
+   {
+      if (pWorkers_)
+         pWorkers_->stop();
+
+      writeCache();
+   }
+
+   void writeCache()
+   {
+      if (cacheFile_.isEmpty() || !cache_.dirty())
+         return;
+
+      Error error = cache_.write(cacheFile_, RSTUDIO_VERSION);
+      if (error)
+         LOG_ERROR(error);
    }
 
 private:
@@ -842,33 +712,130 @@ private:
 
       // return status
       indexing_ = !indexingQueue_.empty();
+      onIndexingIdle();
       return indexing_;
    }
 
-   void updateIndexEntry(const FileInfo& fileInfo)
+   bool publishIndexes()
+   {
+      // add indexes built by the workers to the tree
+      bool published = false;
+      IndexResult result;
+      while (pResults_->deque(&result))
+      {
+         // discard results superseded by a later change (or a clear)
+         const std::string& path = result.fileInfo.absolutePath();
+         std::map<std::string, uint64_t>::iterator it = pendingIndexes_.find(path);
+         if (it == pendingIndexes_.end() || it->second != result.generation)
+            continue;
+         pendingIndexes_.erase(it);
+
+         if (result.error)
+         {
+            // log if not path not found error (this can happen if the
+            // file was removed after entering the indexing queue)
+            if (!core::isPathNotFoundError(result.error))
+            {
+               result.error.addProperty("src-file", path);
+               LOG_ERROR(result.error);
+            }
+            continue;
+         }
+
+         if (result.pIndex)
+            cache_.update(result.fileInfo, result.contentHash, result.pIndex);
+         else
+            cache_.remove(path);
+
+         pEntries_->insert(Entry(result.fileInfo, result.pIndex));
+         published = true;
+      }
+
+      // kick off an update
+      if (published)
+         r_packages::AsyncPackageInformationProcess::update();
+
+      publishing_ = !pendingIndexes_.empty();
+      onIndexingIdle();
+      return publishing_;
+   }
+
+   void onIndexingIdle()
    {
-      // index the source if necessary
-      boost::shared_ptr<r_util::RSourceIndex> pIndex;
+      // persist the index once we've caught up
+      if (indexingQueue_.empty() && pendingIndexes_.empty())
+         writeCache();
+   }
 
-      // read the file
+   void readCache()
+   {
+      FilePath cacheFile = projects::projectContext().scratchPath().completeChildPath(
+               "source-index");
+      if (cacheFile == cacheFile_)
+         return;
+
+      cacheFile_ = cacheFile;
+      Error error = cache_.read(cacheFile_, RSTUDIO_VERSION);
+      if (error)
+         LOG_ERROR(error);
+   }
+
+   bool addCachedIndexEntry(const FileInfo& fileInfo)
+   {
+      boost::shared_ptr<r_util::RSourceIndex> pIndex = cache_.find(fileInfo);
+      if (!pIndex)
+         return false;
+
+      FilePath filePath(fileInfo.absolutePath());
+      if (isWithinIgnoredDirectory(filePath, module_context::ignoreContentDirs()))
+         return false;
+
+      pEntries_->insert(Entry(fileInfo, pIndex));
+      return true;
+   }
+
+   void updateIndexEntry(const FileInfo& fileInfo)
+   {
       FilePath filePath(fileInfo.absolutePath());
 
       // filter certain directories (e.g. those that exist in build directories)
       if (isWithinIgnoredDirectory(filePath, module_context::ignoreContentDirs()))
          return;
 
-      if (isIndexableSourceFile(fileInfo))
+      // files which aren't R source are added without an index
+      if (!isRSourceFile(fileInfo))
+      {
+         pendingIndexes_.erase(fileInfo.absolutePath());
+         pEntries_->insert(Entry(fileInfo, boost::shared_ptr<r_util::RSourceIndex>()));
+         return;
+      }
+
+      IndexRequest request;
+      request.fileInfo = fileInfo;
+      request.generation = ++generation_;
+      request.context = module_context::createAliasedPath(filePath);
+      request.lineEnding = session::options().sourceLineEnding();
+      request.decoded = false;
+      request.cachedContentHash = 0;
+      request.pCachedIndex = cache_.get(fileInfo.absolutePath(), &request.cachedContentHash);
+
+      // decoding anything other than UTF-8 requires R so happens here
+      std::string encoding = projects::projectContext().defaultEncoding();
+      if (!encoding.empty() && !boost::algorithm::iequals(encoding, "UTF-8"))
       {
-         std::string code;
-         Error error = module_context::readAndDecodeFile(
-                                 filePath,
-                                 projects::projectContext().defaultEncoding(),
-                                 true,
-                                 &code);
+         if (!isIndexableSourceFile(fileInfo))
+         {
+            pendingIndexes_.erase(fileInfo.absolutePath());
+            pEntries_->insert(Entry(fileInfo, boost::shared_ptr<r_util::RSourceIndex>()));
+            return;
+         }
+
+         Error error = module_context::readAndDecodeFile(filePath,
+                                                         encoding,
+                                                         true,
+                                                         &request.code);
          if (error)
          {
-            // log if not path not found error (this can happen if the
-            // file was removed after entering the indexing queue)
             if (!core::isPathNotFoundError(error))
             {
                error.addProperty("src-file", filePath.getAbsolutePath());
@@ -876,33 +843,45 @@ private:
             }
             return;
          }
-
-         // add index entry
-         std::string context = module_context::createAliasedPath(filePath);
-         pIndex.reset(new r_util::RSourceIndex(context, code));
+         request.decoded = true;
       }
 
-      // attempt to add the entry
-      Entry entry(fileInfo, pIndex);
-      pEntries_->insertEntry(entry);
+      // tokenize and index the file on a worker thread; the result is
+      // published by publishIndexes
+      pendingIndexes_[fileInfo.absolutePath()] = request.generation;
+      workers().enque(boost::bind(indexFile, request, pResults_));
 
-      // kick off an update
-      r_packages::AsyncPackageInformationProcess::update();
+      if (!publishing_)
+      {
+         publishing_ = true;
+         module_context::schedulePeriodicWork(
+                           boost::posix_time::milliseconds(20),
+                           boost::bind(&SourceFileIndex::publishIndexes, this),
+                           false /* publish even when non-idle */,
+                           false /* not immediate */);
+      }
+   }
+
+   core::thread::WorkerPool& workers()
+   {
+      // leave cores for R and the rest of the session
+      if (!pWorkers_)
+      {
+         std::size_t threadCount = boost::thread::hardware_concurrency() / 2;
+         pWorkers_.reset(new core::thread::WorkerPool(
+                            std::max<std::size_t>(1, std::min<std::size_t>(threadCount, 4))));
+      }
+      return *pWorkers_;
    }
 
    void removeIndexEntry(const FileInfo& fileInfo)
    {
-      // create a fake entry with a null source index to pass to find
-      Entry entry(fileInfo, boost::shared_ptr<r_util::RSourceIndex>());
+      cache_.remove(fileInfo.absolutePath());
+      pendingIndexes_.erase(fileInfo.absolutePath());
 
-      EntryTree::iterator it = pEntries_->find(entry);
-      if (it != pEntries_->end())
-         pEntries_->erase(it);
-      else
-      {
+      // removes anything below a directory too
+      if (!pEntries_->remove(fileInfo.absolutePath()))
          DEBUG("Failed to remove index entry for file: '" << fileInfo.absolutePath() << "'");
-         print_tree(*pEntries_);
-      }
    }
 
    static bool isSourceFile(const FileInfo& fileInfo)
@@ -943,6 +922,12 @@ private:
                filePath.hasTextMimeType());
    }
 
+   static bool isRSourceFile(const FileInfo& fileInfo)
+   {
+      std::string ext = FilePath(fileInfo.absolutePath()).getExtensionLowerCase();
+      return ext == ".r" || ext == ".s";
+   }
+
    static bool isIndexableSourceFile(const FileInfo& fileInfo)
    {
       FilePath filePath(fileInfo.absolutePath());
@@ -950,8 +935,7 @@ private:
          return false;
 
       // check for R extension
-      std::string ext = filePath.getExtensionLowerCase();
-      if (ext != ".r" && ext != ".s")
+      if (!isRSourceFile(fileInfo))
          return false;
 
       // skip large files
@@ -964,11 +948,23 @@ private:
    
 private:
    // index entries
-   boost::shared_ptr<EntryTree> pEntries_;
+   boost::shared_ptr<EntryIndex> pEntries_;
 
    // indexing queue
    bool indexing_;
    std::queue<core::system::FileChangeEvent> indexingQueue_;
+
+   // indexes persisted across sessions
+   r_util::RSourceIndexCache cache_;
+   FilePath cacheFile_;
+
+   // indexes being built on worker threads (by path, with the generation
+   // of the latest request so that superseded results are discarded)
+   boost::shared_ptr<core::thread::WorkerPool> pWorkers_;
+   boost::shared_ptr<IndexResultQueue> pResults_;
+   std::map<std::string, uint64_t> pendingIndexes_;
+   uint64_t generation_;
+   bool publishing_;
 };
 
 } // anonymous namespace
@@ -2521,6 +2517,11 @@ void onFileMonitorDisabled()
    projectIndex().clear();
 }
 
+void onShutdown(bool)
+{
+   projectIndex().shutdown();
+}
+
 SEXP rs_scoreMatches(SEXP suggestionsSEXP,
                      SEXP querySEXP)
 {
@@ -2658,6 +2659,9 @@ Error initialize()
    projects::projectContext().subscribeToFileMonitor("R source file indexing",
                                                      cb);
 
+   // persist the project index so the next session starts with it
+   module_context::events().onShutdown.connect(onShutdown);
+
    // register .Call methods
    RS_REGISTER_CALL_METHOD(rs_viewFunction);
    RS_REGISTER_CALL_METHOD(rs_scoreMatches);
@@ -25,6 +25,7 @@
 #include "SessionMarkers.hpp"
 #include "SessionRParser.hpp"
 
+#include <map>
 #include <set>
 
 #include <core/Debug.hpp>
@@ -637,6 +638,16 @@ void setFileLocalParseOptions(const std::wstring& rCode,
    applyOptions(options, pOptions);
 }
 
+// incremental parsers for open documents, so that re-linting a document as it
+// is edited only re-parses the code around the edits
+typedef std::map<std::string, boost::shared_ptr<IncrementalParser> > IncrementalParsers;
+
+IncrementalParsers& incrementalParsers()
+{
+   static IncrementalParsers instance;
+   return instance;
+}
+
 } // end anonymous namespace
 
 ParseResults parse(const std::wstring& rCode,
@@ -676,7 +687,18 @@ ParseResults parse(const std::wstring& rCode,
    if (noLint)
       return ParseResults();
    
-   results = rparser::parse(origin, rCode, options);
+   if (!documentId.empty() && !isFragment)
+   {
+      boost::shared_ptr<IncrementalParser>& pParser = incrementalParsers()[documentId];
+      if (!pParser)
+         pParser.reset(new IncrementalParser());
+      
+      results = pParser->parse(origin, rCode, options);
+   }
+   else
+   {
+      results = rparser::parse(origin, rCode, options);
+   }
    
    ParseNode* pRoot = results.parseTree();
    if (!pRoot)
@@ -1051,6 +1073,23 @@ void afterSessionInitHook(bool newSession)
    }
 }
 
+void onDocRemoved(const std::string& id, const std::string&)
+{
+   incrementalParsers().erase(id);
+}
+
+void onRemoveAll()
+{
+   incrementalParsers().clear();
+}
+
+void onConsolePrompt(const std::string&)
+{
+   // the lint depends on the state of the R session (e.g. the functions
+   // available and their formals), which may have changed
+   incrementalParsers().clear();
+}
+
 bool collectLint(int depth,
                  const FilePath& path,
                  std::map<FilePath, LintItems>* pLint)
@@ -1111,6 +1150,9 @@ core::Error initialize()
    using namespace module_context;
    
    events().afterSessionInitHook.connect(afterSessionInitHook);
+   events().onConsolePrompt.connect(onConsolePrompt);
+   source_database::events().onDocRemoved.connect(onDocRemoved);
+   source_database::events().onRemoveAll.connect(onRemoveAll);
    
    session::projects::FileMonitorCallbacks cb;
    cb.onFilesChanged = onFilesChanged;
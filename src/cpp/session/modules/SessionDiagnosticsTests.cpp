@@ -17,7 +17,9 @@
 
 #include "SessionDiagnostics.hpp"
 
+#include <chrono>
 #include <iostream>
+#include <random>
 
 #include <core/collection/Tree.hpp>
 #include <shared_core/FilePath.hpp>
@@ -121,6 +123,47 @@ void lintRStudioRFiles()
    lintRFilesInSubdirectory(options().modulesRSourcePath());
 }
 
+bool sameLint(const LintItems& lhs, const LintItems& rhs)
+{
+   if (lhs.size() != rhs.size())
+      return false;
+   
+   for (std::size_t i = 0, n = lhs.size(); i < n; ++i)
+   {
+      const LintItem& a = lhs.get()[i];
+      const LintItem& b = rhs.get()[i];
+      if (a.startRow != b.startRow || a.startColumn != b.startColumn ||
+          a.endRow != b.endRow || a.endColumn != b.endColumn ||
+          a.type != b.type || a.message != b.message)
+      {
+         return false;
+      }
+   }
+   
+   return true;
+}
+
+// a document of top-level function definitions and calls
+std::wstring generatedRCode(int definitions)
+{
+   std::wstring code;
+   for (int i = 0; i < definitions; ++i)
+   {
+      std::wstring n = std::to_wstring(i);
+      code +=
+            L"helper_" + n + L" <- function(x, y = " + n + L") {\n"
+            L"   if (is.null(x))\n"
+            L"      return(y)\n"
+            L"   z <- lapply(x, function(el) el + y)\n"
+            L"   list(x = x, z = z)\n"
+            L"}\n"
+            L"\n"
+            L"value_" + n + L" <- helper_" + n + L"(list(1, 2), y = 3)\n"
+            L"print(value_" + n + L")\n";
+   }
+   return code;
+}
+
 test_context("Diagnostics")
 {
    test_that("valid expressions generate no lint")
@@ -296,9 +339,66 @@ test_context("Diagnostics")
       EXPECT_NO_LINT("x <- (1)");
    }
    
+   test_that("incremental parses produce the same lint as full parses")
+   {
+      std::wstring code = generatedRCode(50);
+      IncrementalParser parser;
+      
+      const wchar_t* const kEdits[] = {
+         L"x", L"(", L")", L"{", L"}", L"[", L"]", L"\"", L"'", L"#", L"\n", L" ",
+         L"y <- 1\n", L"library(stats)\n", L"foo <- function(a, b = 2) a + b\n"
+      };
+      
+      std::mt19937 generator(42);
+      for (int i = 0; i < 200; ++i)
+      {
+         std::size_t offset = generator() % (code.size() + 1);
+         std::size_t length = std::min<std::size_t>(generator() % 4 == 0 ? generator() % 40 : 0,
+                                                    code.size() - offset);
+         code.replace(offset, length, kEdits[generator() % (sizeof(kEdits) / sizeof(kEdits[0]))]);
+         
+         ParseResults incremental = parser.parse(FilePath(), code, s_parseOptions);
+         ParseResults full = parse(FilePath(), code, s_parseOptions);
+         expect_true(sameLint(incremental.lint(), full.lint()));
+      }
+   }
+   
    lintRStudioRFiles();
 }
 
+TEST_CASE("Incremental parse benchmark", "[.benchmark]")
+{
+   // roughly 20000 lines, typed into the middle
+   std::wstring code = generatedRCode(2200);
+   std::size_t offset = code.find(L"\n", code.size() / 2) + 1;
+   const std::wstring typed = L"value <- helper_1(list(3), y = 4)\n";
+   
+   IncrementalParser parser;
+   parser.parse(FilePath(), code, s_parseOptions);
+   
+   std::chrono::steady_clock::duration full(0);
+   std::chrono::steady_clock::duration incremental(0);
+   for (std::size_t i = 0; i < typed.size(); ++i)
+   {
+      code.insert(offset + i, 1, typed[i]);
+      
+      auto start = std::chrono::steady_clock::now();
+      ParseResults incrementalResults = parser.parse(FilePath(), code, s_parseOptions);
+      incremental += std::chrono::steady_clock::now() - start;
+      
+      start = std::chrono::steady_clock::now();
+      ParseResults fullResults = parse(FilePath(), code, s_parseOptions);
+      full += std::chrono::steady_clock::now() - start;
+      
+      CHECK(sameLint(incrementalResults.lint(), fullResults.lint()));
+   }
+   
+   std::cout << "parse per keystroke (" << typed.size() << " keystrokes): "
+             << "full " << std::chrono::duration_cast<std::chrono::microseconds>(full).count() / typed.size() << "us, "
+             << "incremental " << std::chrono::duration_cast<std::chrono::microseconds>(incremental).count() / typed.size() << "us"
+             << std::endl;
+}
+
 } // namespace linter
 } // namespace modules
 } // namespace session
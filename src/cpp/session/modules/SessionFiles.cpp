@@ -1897,10 +1897,10 @@ Error initialize()
    using boost::bind;
    ExecBlock initBlock;
    initBlock.addFunctions()
-      (bind(registerRpcMethod, "stat", stat))
+      (bind(registerThreadSafeRpcMethod, "stat", stat))
       (bind(registerRpcMethod, "is_text_file", isTextFile))
       (bind(registerRpcMethod, "is_git_directory", isGitDirectory))
-      (bind(registerRpcMethod, "is_package_directory", isPackageDirectory))
+      (bind(registerThreadSafeRpcMethod, "is_package_directory", isPackageDirectory))
       (bind(registerRpcMethod, "get_file_contents", getFileContents))
       (bind(registerRpcMethod, "list_files", listFiles))
       (bind(registerRpcMethod, "create_folder", createFolder))
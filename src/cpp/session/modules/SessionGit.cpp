@@ -49,10 +49,13 @@
 #include <core/system/Environment.hpp>
 #include <core/Exec.hpp>
 #include <core/FileSerializer.hpp>
+#include <core/GitCommitIndex.hpp>
 #include <core/GitGraph.hpp>
 #include <core/Scope.hpp>
 #include <core/StringUtils.hpp>
 
+#include <shared_core/Hash.hpp>
+
 
 #include <r/RExec.hpp>
 #include <r/RUtil.hpp>
@@ -63,6 +66,7 @@
 #include <session/prefs/UserPrefs.hpp>
 
 #include "SessionAskPass.hpp"
+#include "SessionGitStatusCache.hpp"
 
 #include "SessionVCS.hpp"
 
@@ -104,6 +108,8 @@ uint64_t s_gitVersion;
 const uint64_t GIT_1_7_2 = ((uint64_t)1 << 48) |
                            ((uint64_t)7 << 32) |
                            ((uint64_t)2 << 16);
+const uint64_t GIT_2_15 = ((uint64_t)2 << 48) |
+                          ((uint64_t)15 << 32);
 
 core::system::ProcessOptions procOptions()
 {
@@ -381,18 +387,27 @@ bool commitIsMatch(const std::vector<std::string>& patterns,
    return true;
 }
 
+std::vector<std::string> searchTextPatterns(const std::string& searchText)
+{
+   std::vector<std::string> results;
+   boost::algorithm::split(results, searchText,
+                           boost::algorithm::is_any_of(" \t\r\n"));
+   return results;
+}
+
 boost::function<bool(CommitInfo)> createSearchTextPredicate(
       const std::string& searchText)
 {
    if (searchText.empty())
       return boost::lambda::constant(true);
 
-   std::vector<std::string> results;
-   boost::algorithm::split(results, searchText,
-                           boost::algorithm::is_any_of(" \t\r\n"));
-   return boost::bind(commitIsMatch, results, _1);
+   return boost::bind(commitIsMatch, searchTextPatterns(searchText), _1);
 }
 
+// the most refs a revision can have for its history to be indexed (each is
+// passed to git on the command line)
+const std::size_t kMaxCommitIndexTips = 256;
+
 bool isUntracked(const source_control::StatusResult& statusResult,
                  const FilePath& filePath)
 {
@@ -404,6 +419,70 @@ class Git : public boost::noncopyable
 private:
    FilePath root_;
 
+   // indexes of the history of revisions, by revision
+   std::map<std::string, boost::shared_ptr<gitgraph::CommitIndex> > commitIndexes_;
+
+   // the status of the working tree, kept while a file monitor covers it
+   FilePath monitoredDir_;
+   boost::shared_ptr<StatusCache> pStatusCache_;
+
+   core::Error runStatus(const std::vector<std::string>& paths, std::string* pOutput)
+   {
+      // (without refreshing the index, which would look like a change to it)
+      ShellArgs args = gitArgs() << "--no-optional-locks"
+                       << "status" << "-z" << "--porcelain" << "--";
+      if (paths.empty())
+         args << root_;
+      else
+         args << paths;
+
+      return runGit(args, pOutput);
+   }
+
+   core::Error listFiles(std::string* pOutput)
+   {
+      return runGit(gitArgs() << "ls-files" << "-z", pOutput);
+   }
+
+   void createStatusCache()
+   {
+      pStatusCache_.reset();
+
+      // the cache relies on hearing of changes to files in the tree, and on
+      // git status leaving the index alone (--no-optional-locks). the file
+      // monitor doesn't report every change (it filters out ignored
+      // components and most hidden files), so refreshes requested by the
+      // client rescan the whole tree (see refreshStatus)
+      if (root_.isEmpty() || monitoredDir_.isEmpty() || !root_.isWithin(monitoredDir_) ||
+          s_gitVersion < GIT_2_15)
+      {
+         return;
+      }
+
+      std::string output;
+      int exitCode = EXIT_SUCCESS;
+      Error error = runGit(gitArgs() << "rev-parse" << "--git-dir" << "--git-common-dir",
+                           &output,
+                           nullptr,
+                           &exitCode);
+      if (error)
+      {
+         LOG_ERROR(error);
+         return;
+      }
+
+      std::vector<std::string> dirs = split(boost::algorithm::trim_copy(output));
+      if (exitCode != EXIT_SUCCESS || dirs.size() != 2)
+         return;
+
+      pStatusCache_.reset(new StatusCache(
+                             root_,
+                             root_.completePath(boost::algorithm::trim_copy(dirs[0])),
+                             root_.completePath(boost::algorithm::trim_copy(dirs[1])),
+                             boost::bind(&Git::runStatus, this, _1, _2),
+                             boost::bind(&Git::listFiles, this, _1)));
+   }
+
 protected:
    core::Error runGit(const ShellArgs& args,
                       std::string* pStdOut=nullptr,
@@ -516,59 +595,45 @@ public:
    void setRoot(const FilePath& path)
    {
       root_ = path;
+      commitIndexes_.clear();
+      createStatusCache();
+   }
+
+   // Called when a file monitor starts (with the directory it covers) or
+   // stops (with an empty path).
+   void setMonitoredDir(const FilePath& dir)
+   {
+      monitoredDir_ = dir;
+      createStatusCache();
+   }
+
+   void onFilesChanged(const std::vector<FilePath>& paths)
+   {
+      if (pStatusCache_)
+         pStatusCache_->invalidate(paths);
+   }
+
+   // forgets the cached status, so that changes the file monitor didn't
+   // report to us (e.g. to .env or .vscode/settings.json) are picked up
+   void refreshStatus()
+   {
+      if (pStatusCache_)
+         pStatusCache_->invalidate();
    }
 
    core::Error status(const FilePath& dir,
                       StatusResult* pStatusResult)
    {
-      using namespace boost;
+      if (pStatusCache_)
+         return pStatusCache_->status(dir, pStatusResult);
 
-      // objects to be populated from git's output
-      std::vector<FileWithStatus> files;
-      
-      // build shell arguments
-      ShellArgs arguments = gitArgs();
-      
-      arguments << "status" << "-z" << "--porcelain" << "--" << dir;
-      
       std::string output;
-      Error error = runGit(arguments, &output);
+      Error error = runGit(gitArgs() << "status" << "-z" << "--porcelain" << "--" << dir,
+                           &output);
       if (error)
          return error;
-      
-      // split and parse each piece of status output
-      std::vector<std::string> pieces = core::algorithm::split(output, "\0");
-
-      for (std::vector<std::string>::iterator it = pieces.begin();
-           it != pieces.end();
-           it++)
-      {
-         std::string line = *it;
-         if (line.length() < 4)
-            continue;
-         FileWithStatus file;
-
-         std::string status = line.substr(0, 2);
-         std::string filePath = line.substr(3);
-         file.status = status;
-         
-         // if this was a git rename or copy, we need to capture the rename target from the next
-         // field. note that Git flips the order of filenames when running with '-z'
-         if (status == "R " || status == "C ")
-            filePath = *(++it) + " -> " + filePath;
-
-         // remove trailing slashes
-         if (filePath.length() > 1 && filePath[filePath.length() - 1] == '/')
-            filePath = filePath.substr(0, filePath.size() - 1);
 
-         // file paths are returned as UTF-8 encoded paths,
-         // so no need to re-encode here
-         file.path = root_.completeChildPath(filePath);
-
-         files.push_back(file);
-      }
-
-      *pStatusResult = StatusResult(files);
+      *pStatusResult = StatusResult(parseStatus(root_, output));
 
       return Success();
    }
@@ -1184,11 +1249,202 @@ public:
       }
    }
 
+   // Returns the index of the history of the given revision, bringing it
+   // up to date with the revision's current tips; returns null if the
+   // revision can't be indexed.
+   boost::shared_ptr<gitgraph::CommitIndex> commitIndex(const std::string& rev)
+   {
+      boost::shared_ptr<gitgraph::CommitIndex> pNone;
+
+      std::string output;
+      int exitCode = EXIT_SUCCESS;
+      Error error = runGit(gitArgs() << "rev-parse" << (rev.empty() ? "HEAD" : rev),
+                           &output,
+                           nullptr,
+                           &exitCode);
+      if (error)
+      {
+         LOG_ERROR(error);
+         return pNone;
+      }
+      else if (exitCode != EXIT_SUCCESS)
+      {
+         // (e.g. a repository with no commits)
+         return pNone;
+      }
+
+      std::vector<std::string> tips;
+      for (const std::string& line : split(output))
+      {
+         if (!line.empty())
+            tips.push_back(line);
+      }
+      std::sort(tips.begin(), tips.end());
+      tips.erase(std::unique(tips.begin(), tips.end()), tips.end());
+      if (tips.empty() || tips.size() > kMaxCommitIndexTips)
+         return pNone;
+
+      FilePath indexPath = module_context::scopedScratchPath()
+            .completeChildPath("git-commit-index")
+            .completeChildPath(hash::crc32HexHash(root_.getAbsolutePath() + " " + rev));
+
+      boost::shared_ptr<gitgraph::CommitIndex>& pIndex = commitIndexes_[rev];
+      if (!pIndex)
+      {
+         pIndex.reset(new gitgraph::CommitIndex());
+         if (indexPath.exists())
+         {
+            error = pIndex->readFromFile(indexPath);
+            if (error)
+               LOG_ERROR(error);
+         }
+      }
+
+      if (pIndex->tips() == tips)
+         return pIndex;
+
+      ShellArgs args = gitArgs() << "log" << "--encoding=UTF-8" << "--date-order"
+                       << std::string("--pretty=format:") + gitgraph::kCommitIndexLogFormat
+                       << tips;
+
+      // if every commit the index has is still reachable, we only need the
+      // commits which have been made since; otherwise (e.g. after a reset
+      // or rebase) the index is rebuilt
+      if (!pIndex->empty())
+      {
+         std::string unreachable;
+         error = runGit(gitArgs() << "rev-list" << "--max-count=1" << pIndex->tips()
+                                  << "--not" << tips,
+                        &unreachable,
+                        nullptr,
+                        &exitCode);
+         if (error || exitCode != EXIT_SUCCESS || !boost::algorithm::trim_copy(unreachable).empty())
+            pIndex->clear();
+         else
+            args << "--not" << pIndex->tips();
+      }
+
+      error = runGit(args, &output, nullptr, &exitCode);
+      if (!error && exitCode == EXIT_SUCCESS)
+         error = pIndex->prepend(output, tips);
+      if (error || exitCode != EXIT_SUCCESS)
+      {
+         if (error)
+            LOG_ERROR(error);
+         commitIndexes_.erase(rev);
+         return pNone;
+      }
+
+      error = indexPath.getParent().ensureDirectory();
+      if (!error)
+         error = pIndex->writeToFile(indexPath);
+      if (error)
+         LOG_ERROR(error);
+
+      return pIndex;
+   }
+
+   core::Error logFromIndex(gitgraph::CommitIndex& index,
+                            int skip,
+                            int maxentries,
+                            const std::string& searchText,
+                            std::vector<CommitInfo>* pOutput)
+   {
+      std::size_t start = static_cast<std::size_t>(std::max(skip, 0));
+
+      std::vector<std::size_t> commits;
+      std::vector<std::string> graphLines;
+      if (searchText.empty())
+      {
+         std::size_t end = index.size();
+         if (maxentries >= 0)
+            end = std::min(end, start + maxentries);
+         for (std::size_t i = start; i < end; i++)
+            commits.push_back(i);
+         graphLines = index.graphLines(start, commits.size());
+      }
+      else
+      {
+         // (the graph isn't shown for search results)
+         std::vector<std::size_t> matches = index.search(searchTextPatterns(searchText));
+         if (start < matches.size())
+         {
+            std::size_t end = matches.size();
+            if (maxentries >= 0)
+               end = std::min(end, start + maxentries);
+            commits.assign(matches.begin() + start, matches.begin() + end);
+         }
+      }
+
+      if (commits.empty())
+         return Success();
+
+      // ask git for the refs of just the commits on this page
+      ShellArgs args = gitArgs() << "log" << "--no-walk=unsorted"
+                       << "--decorate=full" << "--pretty=format:%H%d";
+      for (std::size_t i : commits)
+         args << index.at(i).id;
+
+      std::string output;
+      Error error = runGit(args, &output);
+      if (error)
+         return error;
+
+      std::map<std::string, CommitInfo> decorations;
+      for (const std::string& line : split(output))
+      {
+         CommitInfo decoration;
+         parseCommitValue(line, &decoration);
+         if (!decoration.id.empty())
+            decorations[decoration.id] = decoration;
+      }
+
+      for (std::size_t i = 0; i < commits.size(); i++)
+      {
+         const gitgraph::IndexedCommit& indexed = index.at(commits[i]);
+
+         CommitInfo commit;
+         commit.id = indexed.id;
+         commit.author = indexed.author;
+         commit.subject = indexed.message.substr(0, indexed.message.find('\n'));
+         commit.description = indexed.message;
+         commit.parent = boost::algorithm::join(indexed.parents, " ");
+         commit.date = convertGitRawDate(indexed.time, indexed.timeZone);
+
+         std::map<std::string, CommitInfo>::const_iterator it = decorations.find(commit.id);
+         if (it != decorations.end())
+         {
+            commit.refs = it->second.refs;
+            commit.tags = it->second.tags;
+         }
+
+         if (i < graphLines.size())
+            commit.graph = graphLines[i];
+
+         pOutput->push_back(commit);
+      }
+
+      return Success();
+   }
+
    core::Error logLength(const std::string &rev,
                          const FilePath& fileFilter,
                          const std::string &searchText,
                          int *pLength)
    {
+      if (fileFilter.isEmpty())
+      {
+         boost::shared_ptr<gitgraph::CommitIndex> pIndex = commitIndex(rev);
+         if (pIndex)
+         {
+            std::size_t length = searchText.empty() ?
+                     pIndex->size() :
+                     pIndex->search(searchTextPatterns(searchText)).size();
+            *pLength = gsl::narrow_cast<int>(length);
+            return Success();
+         }
+      }
+
       if (searchText.empty())
       {
          ShellArgs args = gitArgs() << "log";
@@ -1225,6 +1481,16 @@ public:
                    const std::string& searchText,
                    std::vector<CommitInfo>* pOutput)
    {
+      // history which isn't filtered to a file is read from the revision's
+      // index, so that paging through it doesn't mean listing (and graphing)
+      // every commit which precedes the page
+      if (fileFilter.isEmpty())
+      {
+         boost::shared_ptr<gitgraph::CommitIndex> pIndex = commitIndex(rev);
+         if (pIndex)
+            return logFromIndex(*pIndex, skip, maxentries, searchText, pOutput);
+      }
+
       ShellArgs args = gitArgs() << "log" << "--encoding=UTF-8"
                        << "--pretty=raw" << "--decorate=full"
                        << "--date-order";
@@ -1793,6 +2059,10 @@ Error vcsCheckoutRemote(const json::JsonRpcRequest& request,
 Error vcsFullStatus(const json::JsonRpcRequest&,
                     json::JsonRpcResponse* pResponse)
 {
+   // the client asks for the full status when the user refreshes the git
+   // pane (or it's focused), so rescan rather than trust the cache
+   s_git_.refreshStatus();
+
    StatusResult statusResult;
    Error error = s_git_.status(s_git_.root(), &statusResult);
    if (error)
@@ -2954,6 +3224,26 @@ void onShutdown(bool)
    s_pidsToTerminate_.clear();
 }
 
+void onMonitoringEnabled(const tree<core::FileInfo>&)
+{
+   s_git_.setMonitoredDir(projects::projectContext().directory());
+}
+
+void onMonitoringDisabled()
+{
+   s_git_.setMonitoredDir(FilePath());
+}
+
+void onFilesChanged(const std::vector<core::system::FileChangeEvent>& events)
+{
+   std::vector<FilePath> paths;
+   paths.reserve(events.size());
+   for (const core::system::FileChangeEvent& event : events)
+      paths.push_back(FilePath(event.fileInfo().absolutePath()));
+
+   s_git_.onFilesChanged(paths);
+}
+
 Error addFilesToGitIgnore(const FilePath& gitIgnoreFile,
                           const std::vector<std::string>& filesToIgnore,
                           bool addExtraNewline)
@@ -3317,6 +3607,13 @@ core::Error initialize()
 
    module_context::events().onShutdown.connect(onShutdown);
 
+   // keep the working tree's status up to date as files change
+   projects::FileMonitorCallbacks cb;
+   cb.onMonitoringEnabled = onMonitoringEnabled;
+   cb.onFilesChanged = onFilesChanged;
+   cb.onMonitoringDisabled = onMonitoringDisabled;
+   projects::projectContext().subscribeToFileMonitor("", cb);
+
    initGitBin();
 
    bool interceptAskPass;
@@ -0,0 +1,403 @@
+/*
+ * SessionGitStatusCache.cpp
+ *
+ * Copyright (C) 2022 by RStudio, PBC
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include "SessionGitStatusCache.hpp"
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/algorithm/string/trim.hpp>
+
+#include <shared_core/Error.hpp>
+
+#include <core/Algorithm.hpp>
+#include <core/FileSerializer.hpp>
+
+using namespace rstudio::core;
+using rstudio::session::modules::source_control::FileWithStatus;
+using rstudio::session::modules::source_control::StatusResult;
+
+namespace rstudio {
+namespace session {
+namespace modules {
+namespace git {
+
+namespace {
+
+// the most changed paths we'll ask git about, rather than rescanning
+const std::size_t kMaxChangedPaths = 500;
+
+// the number of paths given to each git status (to keep within limits on
+// the length of command lines)
+const std::size_t kPathsPerStatus = 100;
+
+std::string fileFingerprint(const FilePath& filePath)
+{
+#ifndef _WIN32
+   // (git replaces the files rather than writing them in place, so their
+   // inode changes along with their contents)
+   struct stat st;
+   if (::stat(filePath.getAbsolutePath().c_str(), &st) == -1)
+      return "-;";
+
+#ifdef __APPLE__
+   long nanoseconds = st.st_mtimespec.tv_nsec;
+#else
+   long nanoseconds = st.st_mtim.tv_nsec;
+#endif
+
+   return std::to_string(st.st_ino) + ":" +
+          std::to_string(st.st_size) + ":" +
+          std::to_string(st.st_mtime) + "." + std::to_string(nanoseconds) + ";";
+#else
+   if (!filePath.exists())
+      return "-;";
+
+   return std::to_string(filePath.getSize()) + ":" +
+          std::to_string(filePath.getLastWriteTime()) + ";";
+#endif
+}
+
+bool isRename(const FileWithStatus& file)
+{
+   const std::string status = file.status.status();
+   return !status.empty() && (status[0] == 'R' || status[0] == 'C');
+}
+
+} // anonymous namespace
+
+std::vector<FileWithStatus> parseStatus(const FilePath& root,
+                                        const std::string& output)
+{
+   std::vector<FileWithStatus> files;
+
+   // split and parse each piece of status output
+   std::vector<std::string> pieces = core::algorithm::split(output, "\0");
+
+   for (std::vector<std::string>::iterator it = pieces.begin();
+        it != pieces.end();
+        it++)
+   {
+      std::string line = *it;
+      if (line.length() < 4)
+         continue;
+      FileWithStatus file;
+
+      std::string status = line.substr(0, 2);
+      std::string filePath = line.substr(3);
+      file.status = status;
+
+      // if this was a git rename or copy, we need to capture the rename target from the next
+      // field. note that Git flips the order of filenames when running with '-z'
+      if ((status == "R " || status == "C ") && it + 1 != pieces.end())
+         filePath = *(++it) + " -> " + filePath;
+
+      // remove trailing slashes
+      if (filePath.length() > 1 && filePath[filePath.length() - 1] == '/')
+         filePath = filePath.substr(0, filePath.size() - 1);
+
+      // file paths are returned as UTF-8 encoded paths,
+      // so no need to re-encode here
+      file.path = root.completeChildPath(filePath);
+
+      files.push_back(file);
+   }
+
+   return files;
+}
+
+StatusCache::StatusCache(const FilePath& root,
+                         const FilePath& gitDir,
+                         const FilePath& commonDir,
+                         const StatusFunction& statusFunction,
+                         const ListFilesFunction& listFilesFunction)
+   : root_(root),
+     rootPath_(root.getAbsolutePath()),
+     gitDir_(gitDir),
+     commonDir_(commonDir),
+     statusFunction_(statusFunction),
+     listFilesFunction_(listFilesFunction),
+     valid_(false),
+     hasRenames_(false),
+     rescanRequired_(false),
+     trackedDirsValid_(false)
+{
+}
+
+void StatusCache::invalidate(const std::vector<FilePath>& paths)
+{
+   if (rescanRequired_)
+      return;
+
+   for (const FilePath& path : paths)
+   {
+      std::string absolutePath = path.getAbsolutePath();
+      if (!boost::algorithm::starts_with(absolutePath, rootPath_ + "/"))
+         continue;
+
+      // changes to ignore rules can change the status of any file beneath
+      // them, so we rescan
+      if (path.getFilename() == ".gitignore")
+      {
+         invalidate();
+         return;
+      }
+
+      changed_.insert(absolutePath);
+   }
+
+   if (changed_.size() > kMaxChangedPaths)
+      invalidate();
+}
+
+void StatusCache::invalidate()
+{
+   rescanRequired_ = true;
+   changed_.clear();
+}
+
+Error StatusCache::status(const FilePath& dir, StatusResult* pResult)
+{
+   Error error = update();
+   if (error)
+      return error;
+
+   std::vector<FileWithStatus> files;
+
+   std::string dirPath = dir.getAbsolutePath();
+   if (dirPath == rootPath_)
+   {
+      files.reserve(files_.size());
+      for (const auto& entry : files_)
+         files.push_back(entry.second);
+   }
+   else if (boost::algorithm::starts_with(dirPath, rootPath_ + "/"))
+   {
+      auto it = files_.find(dirPath);
+      if (it != files_.end())
+         files.push_back(it->second);
+
+      std::string prefix = dirPath + "/";
+      for (it = files_.lower_bound(prefix);
+           it != files_.end() && boost::algorithm::starts_with(it->first, prefix);
+           it++)
+      {
+         files.push_back(it->second);
+      }
+
+      // (git lists a directory within an untracked one as untracked itself)
+      if (files.empty() && !untrackedParent(dirPath).empty())
+      {
+         FileWithStatus file;
+         file.status = std::string("??");
+         file.path = dir;
+         files.push_back(file);
+      }
+   }
+
+   *pResult = StatusResult(files);
+   return Success();
+}
+
+Error StatusCache::update()
+{
+   std::string currentFingerprint = fingerprint();
+   if (!valid_ || rescanRequired_ || currentFingerprint != fingerprint_ ||
+       (hasRenames_ && !changed_.empty()))
+   {
+      return rescan(currentFingerprint);
+   }
+
+   if (changed_.empty())
+      return Success();
+
+   // a change within an untracked directory may change whether (and how)
+   // the directory is listed, so we ask about the directory as a whole
+   std::set<std::string> paths;
+   for (const std::string& path : changed_)
+   {
+      std::string parent = untrackedParent(path);
+      paths.insert(parent.empty() ? path : parent);
+   }
+
+   return updatePaths(paths);
+}
+
+Error StatusCache::rescan(const std::string& fingerprint)
+{
+   valid_ = false;
+   files_.clear();
+   hasRenames_ = false;
+   changed_.clear();
+   rescanRequired_ = false;
+   trackedDirsValid_ = false;
+
+   std::string output;
+   Error error = statusFunction_(std::vector<std::string>(), &output);
+   if (error)
+      return error;
+
+   for (const FileWithStatus& file : parseStatus(root_, output))
+   {
+      hasRenames_ = hasRenames_ || isRename(file);
+      files_[file.path.getAbsolutePath()] = file;
+   }
+
+   // (an empty fingerprint means the index was being written, so we'll
+   // rescan next time too)
+   valid_ = !fingerprint.empty();
+   fingerprint_ = fingerprint;
+   return Success();
+}
+
+Error StatusCache::updatePaths(const std::set<std::string>& paths)
+{
+   // forget what we knew of the files at (and beneath) these paths
+   std::vector<std::string> relativePaths;
+   for (const std::string& path : paths)
+   {
+      files_.erase(path);
+      files_.erase(files_.lower_bound(path + "/"), files_.lower_bound(path + "0"));
+      relativePaths.push_back(path.substr(rootPath_.size() + 1));
+   }
+   changed_.clear();
+
+   std::vector<FileWithStatus> files;
+   for (std::size_t i = 0; i < relativePaths.size(); i += kPathsPerStatus)
+   {
+      std::vector<std::string> batch(
+               relativePaths.begin() + i,
+               relativePaths.begin() + std::min(i + kPathsPerStatus, relativePaths.size()));
+
+      std::string output;
+      Error error = statusFunction_(batch, &output);
+      if (error)
+      {
+         valid_ = false;
+         return error;
+      }
+
+      std::vector<FileWithStatus> batchFiles = parseStatus(root_, output);
+      files.insert(files.end(), batchFiles.begin(), batchFiles.end());
+   }
+
+   for (FileWithStatus& file : files)
+   {
+      hasRenames_ = hasRenames_ || isRename(file);
+
+      // when asked about paths, git lists untracked files individually;
+      // when listing the whole tree it lists the outermost directory with
+      // no tracked files instead, so we do the same
+      if (file.status.status() == "??")
+      {
+         if (!trackedDirsValid_)
+         {
+            Error error = readTrackedDirs();
+            if (error)
+            {
+               valid_ = false;
+               return error;
+            }
+         }
+
+         std::string relativePath = file.path.getAbsolutePath().substr(rootPath_.size() + 1);
+         for (std::size_t pos = relativePath.find('/');
+              pos != std::string::npos;
+              pos = relativePath.find('/', pos + 1))
+         {
+            std::string dir = relativePath.substr(0, pos);
+            if (trackedDirs_.find(dir) == trackedDirs_.end())
+            {
+               file.path = root_.completeChildPath(dir);
+               break;
+            }
+         }
+      }
+
+      files_[file.path.getAbsolutePath()] = file;
+   }
+
+   return Success();
+}
+
+Error StatusCache::readTrackedDirs()
+{
+   trackedDirs_.clear();
+
+   std::string output;
+   Error error = listFilesFunction_(&output);
+   if (error)
+      return error;
+
+   for (const std::string& path : core::algorithm::split(output, "\0"))
+   {
+      // add each of the file's parents (stopping at any we've seen)
+      for (std::size_t pos = path.rfind('/');
+           pos != std::string::npos && pos > 0;
+           pos = path.rfind('/', pos - 1))
+      {
+         if (!trackedDirs_.insert(path.substr(0, pos)).second)
+            break;
+      }
+   }
+
+   trackedDirsValid_ = true;
+   return Success();
+}
+
+std::string StatusCache::fingerprint() const
+{
+   // the index is being written; we can't yet tell how it will end up
+   if (gitDir_.completeChildPath("index.lock").exists())
+      return std::string();
+
+   std::string result = fileFingerprint(gitDir_.completeChildPath("index")) +
+                        fileFingerprint(commonDir_.completeChildPath("packed-refs")) +
+                        fileFingerprint(commonDir_.completeChildPath("info/exclude"));
+
+   // HEAD, and the branch it refers to
+   std::string head;
+   Error error = readStringFromFile(gitDir_.completeChildPath("HEAD"), &head);
+   if (error)
+      return std::string();
+
+   boost::algorithm::trim(head);
+   result += head + ";";
+   if (boost::algorithm::starts_with(head, "ref: "))
+      result += fileFingerprint(commonDir_.completeChildPath(head.substr(5)));
+
+   return result;
+}
+
+std::string StatusCache::untrackedParent(const std::string& path) const
+{
+   for (std::string parent = path;
+        parent.size() > rootPath_.size();
+        parent = parent.substr(0, parent.rfind('/')))
+   {
+      auto it = files_.find(parent);
+      if (it != files_.end() && it->second.status.status() == "??")
+         return parent;
+   }
+
+   return std::string();
+}
+
+} // namespace git
+} // namespace modules
+} // namespace session
+} // namespace rstudio
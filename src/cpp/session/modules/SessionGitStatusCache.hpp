@@ -0,0 +1,123 @@
+/*
+ * SessionGitStatusCache.hpp
+ *
+ * Copyright (C) 2022 by RStudio, PBC
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef SESSION_GIT_STATUS_CACHE_HPP
+#define SESSION_GIT_STATUS_CACHE_HPP
+
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <shared_core/FilePath.hpp>
+
+#include "vcs/SessionVCSCore.hpp"
+
+namespace rstudio {
+namespace core {
+   class Error;
+}
+}
+
+namespace rstudio {
+namespace session {
+namespace modules {
+namespace git {
+
+// Parses the output of git status -z --porcelain, run in the given
+// repository root.
+std::vector<source_control::FileWithStatus> parseStatus(const core::FilePath& root,
+                                                        const std::string& output);
+
+// Keeps the status of a repository's working tree between refreshes. Paths
+// which have changed (as reported by a file monitor) are given to
+// invalidate(), and the next status() asks git about only those paths; the
+// whole tree is rescanned when the index, HEAD or ignore rules change.
+class StatusCache : boost::noncopyable
+{
+public:
+   // Runs git status -z --porcelain for the given paths (relative to the
+   // root), or for the whole tree if there are none.
+   typedef boost::function<core::Error(const std::vector<std::string>&, std::string*)>
+         StatusFunction;
+
+   // Runs git ls-files -z.
+   typedef boost::function<core::Error(std::string*)> ListFilesFunction;
+
+   // gitDir and commonDir are as reported by git rev-parse --git-dir and
+   // --git-common-dir (they differ only for linked worktrees).
+   StatusCache(const core::FilePath& root,
+               const core::FilePath& gitDir,
+               const core::FilePath& commonDir,
+               const StatusFunction& statusFunction,
+               const ListFilesFunction& listFilesFunction);
+
+   // Notes that the given files or directories have changed.
+   void invalidate(const std::vector<core::FilePath>& paths);
+
+   // Discards the cached status; the next status() rescans the whole tree.
+   void invalidate();
+
+   // Returns the status of the files within dir (which, like that from
+   // git status -- dir, includes dir itself).
+   core::Error status(const core::FilePath& dir, source_control::StatusResult* pResult);
+
+private:
+   core::Error update();
+   core::Error rescan(const std::string& fingerprint);
+   core::Error updatePaths(const std::set<std::string>& paths);
+   core::Error readTrackedDirs();
+
+   std::string fingerprint() const;
+   std::string untrackedParent(const std::string& path) const;
+
+   core::FilePath root_;
+   std::string rootPath_;
+   core::FilePath gitDir_;
+   core::FilePath commonDir_;
+   StatusFunction statusFunction_;
+   ListFilesFunction listFilesFunction_;
+
+   // the status of each file, by absolute path
+   std::map<std::string, source_control::FileWithStatus> files_;
+
+   // whether files_ is populated, and the state of the index, HEAD and
+   // ignore rules it was read with
+   bool valid_;
+   std::string fingerprint_;
+
+   // whether any files are renamed or copied in the index
+   bool hasRenames_;
+
+   // the paths (absolute) which have changed since files_ was updated
+   std::set<std::string> changed_;
+   bool rescanRequired_;
+
+   // the directories (relative to the root) which contain tracked files,
+   // read as needed to list untracked files as git does
+   std::unordered_set<std::string> trackedDirs_;
+   bool trackedDirsValid_;
+};
+
+} // namespace git
+} // namespace modules
+} // namespace session
+} // namespace rstudio
+
+#endif // SESSION_GIT_STATUS_CACHE_HPP
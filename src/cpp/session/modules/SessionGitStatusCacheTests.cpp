@@ -0,0 +1,315 @@
+/*
+ * SessionGitStatusCacheTests.cpp
+ *
+ * Copyright (C) 2022 by RStudio, PBC
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include "SessionGitStatusCache.hpp"
+
+#include <tests/TestThat.hpp>
+
+#include <chrono>
+#include <iostream>
+
+#include <boost/bind/bind.hpp>
+
+#include <shared_core/Error.hpp>
+
+#include <core/FileSerializer.hpp>
+#include <core/Log.hpp>
+#include <core/system/Process.hpp>
+#include <core/system/ShellUtils.hpp>
+
+using namespace rstudio::core;
+using namespace boost::placeholders;
+
+namespace rstudio {
+namespace session {
+namespace modules {
+namespace git {
+namespace tests {
+
+using namespace source_control;
+
+namespace {
+
+// a repository in a temporary directory, with a StatusCache for it
+class Repository
+{
+public:
+   Repository()
+   {
+      FilePath::tempFilePath(root_);
+      root_.ensureDirectory();
+      git("init -q");
+      git("config user.name test");
+      git("config user.email test@example.com");
+   }
+
+   ~Repository()
+   {
+      root_.removeIfExists();
+   }
+
+   const FilePath& root() const { return root_; }
+
+   FilePath path(const std::string& path) const
+   {
+      return root_.completeChildPath(path);
+   }
+
+   std::string git(const std::string& args) const
+   {
+      core::system::ProcessOptions options;
+      options.workingDir = root_;
+
+      core::system::ProcessResult result;
+      Error error = core::system::runCommand("git " + args, options, &result);
+      if (error)
+         LOG_ERROR(error);
+      return result.stdOut;
+   }
+
+   void write(const std::string& path, const std::string& contents = "contents")
+   {
+      FilePath filePath = root_.completeChildPath(path);
+      filePath.getParent().ensureDirectory();
+      writeStringToFile(filePath, contents);
+   }
+
+   void remove(const std::string& path)
+   {
+      root_.completeChildPath(path).removeIfExists();
+   }
+
+   void commitAll()
+   {
+      git("add -A");
+      git("commit -q -m commit");
+   }
+
+   boost::shared_ptr<StatusCache> createCache()
+   {
+      return boost::shared_ptr<StatusCache>(new StatusCache(
+         root_,
+         root_.completeChildPath(".git"),
+         root_.completeChildPath(".git"),
+         boost::bind(&Repository::status, this, _1, _2),
+         boost::bind(&Repository::listFiles, this, _1)));
+   }
+
+   // the status of every file, as reported by git
+   std::vector<std::string> fullStatus()
+   {
+      std::string output = git("--no-optional-locks status -z --porcelain");
+      return describe(StatusResult(parseStatus(root_, output)));
+   }
+
+   std::vector<std::string> describe(const StatusResult& result)
+   {
+      std::vector<std::string> files;
+      for (const FileWithStatus& file : result.files())
+         files.push_back(file.status.status() + " " + file.path.getRelativePath(root_));
+      std::sort(files.begin(), files.end());
+      return files;
+   }
+
+   int statusCount = 0;
+
+private:
+   Error status(const std::vector<std::string>& paths, std::string* pOutput)
+   {
+      statusCount++;
+
+      std::string args = "--no-optional-locks status -z --porcelain --";
+      for (const std::string& path : paths)
+         args += " " + shell_utils::escape(path);
+
+      *pOutput = git(args);
+      return Success();
+   }
+
+   Error listFiles(std::string* pOutput)
+   {
+      *pOutput = git("ls-files -z");
+      return Success();
+   }
+
+   FilePath root_;
+};
+
+std::vector<std::string> cachedStatus(Repository& repository,
+                                      StatusCache& cache,
+                                      const FilePath& dir)
+{
+   StatusResult result;
+   Error error = cache.status(dir, &result);
+   if (error)
+      LOG_ERROR(error);
+   return repository.describe(result);
+}
+
+} // anonymous namespace
+
+test_context("Git status cache")
+{
+   test_that("Changed paths are updated without rescanning")
+   {
+      Repository repository;
+      repository.write("a.R");
+      repository.write("dir/b.R");
+      repository.write("dir/sub/c.R");
+      repository.commitAll();
+
+      boost::shared_ptr<StatusCache> pCache = repository.createCache();
+      expect_true(cachedStatus(repository, *pCache, repository.root()).empty());
+      expect_true(repository.statusCount == 1);
+
+      repository.write("a.R", "changed");
+      repository.write("dir/new.R");
+      repository.remove("dir/sub/c.R");
+      pCache->invalidate({ repository.path("a.R"),
+                           repository.path("dir/new.R"),
+                           repository.path("dir/sub/c.R") });
+
+      std::vector<std::string> status = cachedStatus(repository, *pCache, repository.root());
+      expect_true(status == repository.fullStatus());
+      expect_true(status == std::vector<std::string>({ " D dir/sub/c.R", " M a.R", "?? dir/new.R" }));
+      expect_true(repository.statusCount == 2);
+
+      // nothing has changed
+      cachedStatus(repository, *pCache, repository.root());
+      expect_true(repository.statusCount == 2);
+   }
+
+   test_that("Untracked directories are listed as git does")
+   {
+      Repository repository;
+      repository.write("dir/a.R");
+      repository.commitAll();
+
+      boost::shared_ptr<StatusCache> pCache = repository.createCache();
+      cachedStatus(repository, *pCache, repository.root());
+
+      repository.write("new/sub/b.R");
+      repository.write("dir/new/c.R");
+      pCache->invalidate({ repository.path("new"),
+                           repository.path("new/sub"),
+                           repository.path("new/sub/b.R"),
+                           repository.path("dir/new/c.R") });
+
+      std::vector<std::string> status = cachedStatus(repository, *pCache, repository.root());
+      expect_true(status == repository.fullStatus());
+      expect_true(status == std::vector<std::string>({ "?? dir/new", "?? new" }));
+
+      // directories within untracked ones are themselves untracked
+      expect_true(cachedStatus(repository, *pCache, repository.path("new/sub")) ==
+                  std::vector<std::string>({ "?? new/sub" }));
+      expect_true(cachedStatus(repository, *pCache, repository.path("dir")) ==
+                  std::vector<std::string>({ "?? dir/new" }));
+
+      // removing the last file from an untracked directory removes it
+      repository.remove("dir/new/c.R");
+      pCache->invalidate({ repository.path("dir/new/c.R") });
+      expect_true(cachedStatus(repository, *pCache, repository.root()) == repository.fullStatus());
+   }
+
+   test_that("Changes to the index and ignore rules cause a rescan")
+   {
+      Repository repository;
+      repository.write("a.R");
+      repository.commitAll();
+
+      boost::shared_ptr<StatusCache> pCache = repository.createCache();
+      repository.write("b.R");
+      repository.write("c.log");
+      pCache->invalidate({ repository.path("b.R"), repository.path("c.log") });
+      cachedStatus(repository, *pCache, repository.root());
+      int statusCount = repository.statusCount;
+
+      // (without telling the cache of any changes)
+      repository.git("add b.R");
+      expect_true(cachedStatus(repository, *pCache, repository.root()) == repository.fullStatus());
+      expect_true(repository.statusCount == statusCount + 1);
+
+      repository.git("commit -q -m commit");
+      expect_true(cachedStatus(repository, *pCache, repository.root()) == repository.fullStatus());
+
+      repository.write(".gitignore", "*.log\n");
+      pCache->invalidate({ repository.path(".gitignore") });
+      std::vector<std::string> status = cachedStatus(repository, *pCache, repository.root());
+      expect_true(status == repository.fullStatus());
+      expect_true(status == std::vector<std::string>({ "?? .gitignore" }));
+   }
+
+   test_that("Changes that weren't reported are found by a rescan")
+   {
+      Repository repository;
+      repository.write("a.R");
+      repository.commitAll();
+
+      boost::shared_ptr<StatusCache> pCache = repository.createCache();
+      cachedStatus(repository, *pCache, repository.root());
+
+      // (the file monitor filters out most hidden files)
+      repository.write(".env");
+      repository.write(".vscode/settings.json");
+      expect_true(cachedStatus(repository, *pCache, repository.root()).empty());
+
+      pCache->invalidate();
+      std::vector<std::string> status = cachedStatus(repository, *pCache, repository.root());
+      expect_true(status == repository.fullStatus());
+      expect_true(status == std::vector<std::string>({ "?? .env", "?? .vscode" }));
+   }
+}
+
+TEST_CASE("Git status cache benchmark", "[.benchmark]")
+{
+   // a repository of 100k files, in 1000 directories
+   Repository repository;
+   for (int dir = 0; dir < 1000; dir++)
+      for (int file = 0; file < 100; file++)
+         repository.write("dir" + std::to_string(dir) + "/file" + std::to_string(file) + ".R");
+   repository.commitAll();
+
+   boost::shared_ptr<StatusCache> pCache = repository.createCache();
+
+   auto start = std::chrono::steady_clock::now();
+   cachedStatus(repository, *pCache, repository.root());
+   double fullSeconds = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start).count();
+
+   // a few files are edited
+   std::vector<FilePath> changed;
+   for (int dir = 0; dir < 10; dir++)
+   {
+      std::string path = "dir" + std::to_string(dir * 100) + "/file0.R";
+      repository.write(path, "changed");
+      changed.push_back(repository.path(path));
+   }
+   pCache->invalidate(changed);
+
+   start = std::chrono::steady_clock::now();
+   std::vector<std::string> status = cachedStatus(repository, *pCache, repository.root());
+   double incrementalSeconds = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start).count();
+
+   REQUIRE(status.size() == 10);
+   std::cout << "100000 files: " << fullSeconds << "s to scan, "
+             << incrementalSeconds << "s to update 10 files" << std::endl;
+}
+
+} // namespace tests
+} // namespace git
+} // namespace modules
+} // namespace session
+} // namespace rstudio
@@ -749,6 +749,10 @@ void onDetectChanges(module_context::ChangeSource source)
 void onBackgroundProcessing(bool isIdle)
 {
    using namespace rstudio::r::session;
+
+   // resize the graphics device once the plots pane has stopped resizing
+   graphics::device::resizeIfSettled();
+
    if (graphics::display().isActiveDevice() && graphics::display().hasChanges())
    {
       // verify that the last change is more than 50ms old. the reason
@@ -1548,6 +1548,384 @@ ParseResults parse(const FilePath &filePath, const ParseOptions &parseOptions)
             string_utils::utf8ToWide(contents),
             parseOptions);
 }
+
+namespace {
+
+// The symbols defined at the top level, and the functions (with their
+// formals) available at the top level, within a region of the code. These
+// are the only parts of the parse of a region consulted when parsing code
+// which follows it (besides the lint, which is independent).
+class TopLevelDefinitions
+{
+public:
+   
+   // definitions within the region starting at a position (and child
+   // index) and ending before another
+   TopLevelDefinitions(const ParseNode& root,
+                       const RTokens& rTokens,
+                       const Position& begin,
+                       std::size_t childBegin,
+                       const Position& end,
+                       std::size_t childEnd)
+   {
+      const ParseNode::SymbolPositions& symbols = root.getDefinedSymbols();
+      for (ParseNode::SymbolPositions::const_iterator it = symbols.begin();
+           it != symbols.end();
+           ++it)
+      {
+         for (const Position& position : it->second)
+         {
+            if (begin <= position && position < end)
+            {
+               symbols_.insert(it->first);
+               break;
+            }
+         }
+      }
+      
+      // the last definition of each function is the one that is found
+      // by subsequent lookups
+      std::map<std::string, const ParseNode*> functions;
+      const ParseNode::Children& children = root.getChildren();
+      for (std::size_t i = childBegin; i < childEnd && i < children.size(); ++i)
+         functions[children[i]->name()] = children[i].get();
+      
+      for (const std::pair<const std::string, const ParseNode*>& function : functions)
+         functions_[function.first] = functionSignature(rTokens, *function.second);
+   }
+   
+   // are the definitions the same, given the symbols defined before the
+   // regions (in 'root')
+   bool equals(const TopLevelDefinitions& other,
+               const ParseNode& root,
+               const Position& begin) const
+   {
+      if (functions_ != other.functions_)
+         return false;
+      
+      std::vector<std::string> difference;
+      std::set_symmetric_difference(symbols_.begin(), symbols_.end(),
+                                    other.symbols_.begin(), other.symbols_.end(),
+                                    std::back_inserter(difference));
+      
+      const ParseNode::SymbolPositions& symbols = root.getDefinedSymbols();
+      for (const std::string& symbol : difference)
+      {
+         ParseNode::SymbolPositions::const_iterator it = symbols.find(symbol);
+         if (it == symbols.end())
+            return false;
+         
+         bool definedBefore = false;
+         for (const Position& position : it->second)
+            definedBefore = definedBefore || position < begin;
+         
+         if (!definedBefore)
+            return false;
+      }
+      
+      return true;
+   }
+   
+private:
+   
+   // what is read from the definition of a function when it is called
+   static std::string functionSignature(const RTokens& rTokens,
+                                        const ParseNode& node)
+   {
+      RTokenCursor cursor(rTokens);
+      if (!cursor.moveToPosition(node.position()))
+         return std::string();
+      
+      std::string signature = maybePerformsNSE(cursor) ? "nse:" : ":";
+      
+      FunctionInformation info;
+      if (extractInfoFromFunctionDefinition(cursor, &info))
+      {
+         for (const FormalInformation& formal : info.formals())
+         {
+            signature += formal.name();
+            if (formal.defaultValue())
+               signature += "=" + *formal.defaultValue();
+            signature += ",";
+         }
+      }
+      
+      return signature;
+   }
+   
+   std::set<std::string> symbols_;
+   std::map<std::string, std::string> functions_;
+};
+
+void shiftRow(LintItem* pItem, std::ptrdiff_t rowDelta)
+{
+   pItem->startRow += gsl::narrow_cast<int>(rowDelta);
+   pItem->endRow += gsl::narrow_cast<int>(rowDelta);
+}
+
+} // anonymous namespace
+
+ParseResults IncrementalParser::parse(const FilePath& filePath,
+                                      const std::wstring& rCode,
+                                      const ParseOptions& parseOptions)
+{
+   if (rCode.empty() || rCode.find_first_not_of(L" \r\n\t\v") == std::string::npos)
+   {
+      clear();
+      return ParseResults();
+   }
+   
+   // find the changed region, and re-tokenize it
+   boost::scoped_ptr<RTokens> pPrevious;
+   pPrevious.swap(pTokens_);
+   
+   std::size_t prefixLength = 0;
+   std::size_t suffixLength = 0;
+   if (pPrevious)
+   {
+      const std::wstring& previousCode = pPrevious->code();
+      std::size_t n = std::min(rCode.size(), previousCode.size());
+      while (prefixLength < n && rCode[prefixLength] == previousCode[prefixLength])
+         ++prefixLength;
+      while (suffixLength < n - prefixLength &&
+             rCode[rCode.size() - suffixLength - 1] ==
+             previousCode[previousCode.size() - suffixLength - 1])
+      {
+         ++suffixLength;
+      }
+      
+      pTokens_.reset(new RTokens(rCode, *pPrevious, prefixLength, suffixLength,
+                                 RTokens::StripComments));
+   }
+   else
+   {
+      pTokens_.reset(new RTokens(rCode, RTokens::StripComments));
+   }
+   
+   if (pTokens_->empty())
+   {
+      clear();
+      return ParseResults();
+   }
+   
+   // the previous parse can only be reused if just the code has changed
+   bool reusable =
+         pPrevious &&
+         pRoot_ &&
+         filePath == filePath_ &&
+         parseOptions == parseOptions_;
+   
+   if (reusable &&
+       prefixLength == rCode.size() &&
+       prefixLength == pPrevious->code().size())
+   {
+      return results();
+   }
+   
+   // find where to resume the parse: tokens may be inspected a little ahead
+   // of where they are parsed, so back off by a couple of top-level
+   // expressions from the change
+   RTokenCursor cursor(*pTokens_);
+   bool resumed = false;
+   std::size_t resumeIndex = 0;
+   std::size_t unchanged = 0;
+   if (reusable)
+   {
+      while (unchanged < resumePoints_.size() &&
+             resumePoints_[unchanged].offset < prefixLength)
+      {
+         ++unchanged;
+      }
+   }
+   
+   if (unchanged > 0)
+   {
+      resumeIndex = unchanged > 2 ? unchanged - 3 : 0;
+      
+      std::size_t offset = resumePoints_[resumeIndex].offset;
+      RTokens::const_iterator it = std::lower_bound(
+               pTokens_->begin(),
+               pTokens_->end(),
+               offset,
+               [](const RToken& token, std::size_t offset) { return token.offset() < offset; });
+      
+      if (it != pTokens_->end() && it->offset() == offset)
+      {
+         cursor.setOffset(it - pTokens_->begin());
+         resumed = true;
+      }
+   }
+   
+   // set aside the previous parse of the code following the resume point
+   boost::shared_ptr<ParseNode> pTail = ParseNode::createRootNode();
+   std::vector<LintItem> tailLint;
+   std::vector<ResumePoint> tailPoints;
+   ResumePoint start = { 0, Position(), 0, 0 };
+   if (resumed)
+   {
+      start = resumePoints_[resumeIndex];
+      pRoot_->splitAt(start.position, start.childCount, pTail.get());
+      tailLint.assign(lint_.begin() + start.lintCount, lint_.end());
+      lint_.erase(start.lintCount);
+      tailPoints.assign(resumePoints_.begin() + resumeIndex, resumePoints_.end());
+      resumePoints_.resize(resumeIndex);
+   }
+   else
+   {
+      pRoot_ = ParseNode::createRootNode();
+      lint_ = LintItems(parseOptions);
+      endOfDocumentLint_.clear();
+      resumePoints_.clear();
+   }
+   
+   ParseStatus status(filePath, parseOptions, pRoot_, lint_);
+   
+   // record where the parse could be resumed next time; once in step with
+   // the previous parse after the change, check whether the rest of it can
+   // be reused instead
+   std::size_t suffixStart = rCode.size() - suffixLength;
+   std::size_t previousSuffixStart =
+         pPrevious ? pPrevious->code().size() - suffixLength : 0;
+   
+   std::size_t tailIndex = 0;
+   std::size_t inStep = 0;
+   bool compared = false;
+   bool spliced = false;
+   
+   status.setResumeHandler([&](const RTokenCursor& tokenCursor, ParseStatus& parseStatus)
+   {
+      const RToken& token = tokenCursor.currentToken();
+      ResumePoint point = {
+         token.offset(),
+         token.position(),
+         parseStatus.lint().size(),
+         pRoot_->getChildren().size()
+      };
+      resumePoints_.push_back(point);
+      
+      if (tailPoints.empty() || compared || point.offset < suffixStart)
+         return true;
+      
+      // the parse is in step with the previous parse if it also reached the
+      // same code (at the same column) at the top level
+      std::size_t offset = point.offset - suffixStart + previousSuffixStart;
+      while (tailIndex < tailPoints.size() && tailPoints[tailIndex].offset < offset)
+         ++tailIndex;
+      
+      if (tailIndex == tailPoints.size() ||
+          tailPoints[tailIndex].offset != offset ||
+          tailPoints[tailIndex].position.column != point.position.column)
+      {
+         inStep = 0;
+         return true;
+      }
+      
+      // as for resuming, leave a margin for lookahead
+      if (++inStep < 3)
+         return true;
+      
+      const ResumePoint& previous = tailPoints[tailIndex];
+      TopLevelDefinitions definitions(*pRoot_, *pTokens_,
+                                      start.position, start.childCount,
+                                      point.position, point.childCount);
+      TopLevelDefinitions previousDefinitions(*pTail, *pPrevious,
+                                              start.position, 0,
+                                              previous.position,
+                                              previous.childCount - start.childCount);
+      
+      // the definitions don't change once the parses are in step, so if
+      // they differ here the rest of the document must be parsed
+      compared = true;
+      spliced = definitions.equals(previousDefinitions, *pRoot_, start.position);
+      return !spliced;
+   });
+   
+   doParse(cursor, status);
+   
+   if (spliced)
+   {
+      // reuse the rest of the previous parse
+      const ResumePoint& previous = tailPoints[tailIndex];
+      ResumePoint current = resumePoints_.back();
+      std::ptrdiff_t rowDelta =
+            static_cast<std::ptrdiff_t>(current.position.row) -
+            static_cast<std::ptrdiff_t>(previous.position.row);
+      
+      pRoot_->append(pTail.get(),
+                     previous.position,
+                     previous.childCount - start.childCount,
+                     rowDelta);
+      
+      if (rowDelta != 0)
+         ParseNode::shiftSymbolRanges(previous.position, rowDelta);
+      
+      for (std::size_t i = previous.lintCount - start.lintCount; i < tailLint.size(); ++i)
+      {
+         const LintItem& item = tailLint[i];
+         status.lint().add(item.startRow + rowDelta,
+                           item.startColumn,
+                           item.endRow + rowDelta,
+                           item.endColumn,
+                           item.type,
+                           item.message);
+      }
+      
+      for (std::size_t i = tailIndex + 1; i < tailPoints.size(); ++i)
+      {
+         ResumePoint point = tailPoints[i];
+         point.offset = point.offset - previousSuffixStart + suffixStart;
+         point.position.row = point.position.row + rowDelta;
+         point.lintCount = point.lintCount - previous.lintCount + current.lintCount;
+         point.childCount = point.childCount - previous.childCount + current.childCount;
+         resumePoints_.push_back(point);
+      }
+      
+      for (LintItem& item : endOfDocumentLint_)
+         shiftRow(&item, rowDelta);
+   }
+   else
+   {
+      std::size_t lintCount = status.lint().size();
+      
+      if (status.node()->getParent() != nullptr)
+         status.lint().unexpectedEndOfDocument(cursor.currentToken());
+      status.addLintIfBracketStackNotEmpty();
+      
+      endOfDocumentLint_.assign(status.lint().begin() + lintCount, status.lint().end());
+      status.lint().erase(lintCount);
+   }
+   
+   lint_ = status.lint();
+   filePath_ = filePath;
+   parseOptions_ = parseOptions;
+   
+   return results();
+}
+
+ParseResults IncrementalParser::results() const
+{
+   LintItems lint = lint_;
+   for (const LintItem& item : endOfDocumentLint_)
+   {
+      lint.add(item.startRow,
+               item.startColumn,
+               item.endRow,
+               item.endColumn,
+               item.type,
+               item.message);
+   }
+   
+   return ParseResults(pRoot_, lint, parseOptions_.globals());
+}
+
+void IncrementalParser::clear()
+{
+   pTokens_.reset();
+   pRoot_.reset();
+   lint_ = LintItems();
+   endOfDocumentLint_.clear();
+   resumePoints_.clear();
+}
 namespace {
 
 bool closesArgumentList(const RTokenCursor& cursor,
@@ -2137,6 +2515,9 @@ START:
       
       DEBUG("== Current state: " << status.currentStateAsString());
       
+      if (!status.onExpressionStart(cursor))
+         return;
+      
       checkIncorrectComparison(cursor, status);
       
       // We want to skip over formulas if necessary.
@@ -40,6 +40,9 @@
 #include <r/RSexp.hpp>
 #include <r/RExec.hpp>
 
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/algorithm/string.hpp>
 #include <boost/bind/bind.hpp>
@@ -163,6 +166,17 @@ public:
    
    std::set<std::string>& globals() { return globals_; }
    const std::set<std::string>& globals() const { return globals_; }
+   
+   bool operator ==(const ParseOptions& other) const
+   {
+      return lintRFunctions_ == other.lintRFunctions_ &&
+             checkArgumentsToRFunctionCalls_ == other.checkArgumentsToRFunctionCalls_ &&
+             checkUnexpectedAssignmentInFunctionCall_ == other.checkUnexpectedAssignmentInFunctionCall_ &&
+             warnIfNoSuchVariableInScope_ == other.warnIfNoSuchVariableInScope_ &&
+             warnIfVariableIsDefinedButNotUsed_ == other.warnIfVariableIsDefinedButNotUsed_ &&
+             recordStyleLint_ == other.recordStyleLint_ &&
+             globals_ == other.globals_;
+   }
 
 private:
    bool lintRFunctions_;
@@ -512,6 +526,17 @@ public:
          lintItems_.push_back(items.get()[i]);
    }
    
+   // remove the items from an index onwards
+   void erase(std::size_t index)
+   {
+      if (index >= lintItems_.size())
+         return;
+      
+      for (std::size_t i = index, n = lintItems_.size(); i < n; ++i)
+         errorCount_ -= lintItems_[i].type == LintTypeError;
+      lintItems_.erase(lintItems_.begin() + index, lintItems_.end());
+   }
+   
    typedef std::vector<LintItem>::iterator iterator;
    typedef std::vector<LintItem>::const_iterator const_iterator;
    
@@ -980,6 +1005,70 @@ public:
             symbols.end());
    }
    
+   // Support for incremental parsing (see IncrementalParser). 'splitAt()'
+   // moves the symbols recorded at or after a position, and the children from
+   // an index onwards, to another node; 'append()' moves them back, shifted
+   // by a number of rows.
+   void splitAt(const Position& position,
+                std::size_t childIndex,
+                ParseNode* pTail)
+   {
+      splitSymbolsAt(position, &definedSymbols_, &pTail->definedSymbols_);
+      splitSymbolsAt(position, &referencedSymbols_, &pTail->referencedSymbols_);
+      splitSymbolsAt(position, &nseReferencedSymbols_, &pTail->nseReferencedSymbols_);
+      
+      for (std::size_t i = childIndex, n = children_.size(); i < n; ++i)
+      {
+         children_[i]->pParent_ = pTail;
+         pTail->children_.push_back(children_[i]);
+      }
+      if (childIndex < children_.size())
+         children_.erase(children_.begin() + childIndex, children_.end());
+   }
+   
+   void append(ParseNode* pTail,
+               const Position& position,
+               std::size_t childIndex,
+               std::ptrdiff_t rowDelta)
+   {
+      appendSymbolsFrom(pTail->definedSymbols_, position, rowDelta, &definedSymbols_);
+      appendSymbolsFrom(pTail->referencedSymbols_, position, rowDelta, &referencedSymbols_);
+      appendSymbolsFrom(pTail->nseReferencedSymbols_, position, rowDelta, &nseReferencedSymbols_);
+      
+      for (std::size_t i = childIndex, n = pTail->children_.size(); i < n; ++i)
+      {
+         boost::shared_ptr<ParseNode>& pChild = pTail->children_[i];
+         pChild->shiftRows(rowDelta);
+         pChild->pParent_ = this;
+         children_.push_back(pChild);
+      }
+   }
+   
+   // make the symbols available in ranges at or after a position available
+   // in the same ranges shifted by a number of rows
+   static void shiftSymbolRanges(const Position& position,
+                                 std::ptrdiff_t rowDelta)
+   {
+      std::vector<SymbolRanges::value_type> shifted;
+      for (SymbolRanges::const_iterator it = symbolRanges().begin();
+           it != symbolRanges().end();
+           ++it)
+      {
+         if (it->first.begin() >= position)
+         {
+            shifted.push_back(std::make_pair(
+                                 Range(shiftRow(it->first.begin(), rowDelta),
+                                       shiftRow(it->first.end(), rowDelta)),
+                                 it->second));
+         }
+      }
+      
+      for (const SymbolRanges::value_type& range : shifted)
+         core::algorithm::insert(symbolRanges()[range.first],
+                                 range.second.begin(),
+                                 range.second.end());
+   }
+   
 public:
    
    const std::string& name() const { return name_; }
@@ -987,6 +1076,77 @@ public:
    
 private:
    
+   static Position shiftRow(const Position& position, std::ptrdiff_t rowDelta)
+   {
+      return Position(position.row + rowDelta, position.column);
+   }
+   
+   static void splitSymbolsAt(const Position& position,
+                              SymbolPositions* pSymbols,
+                              SymbolPositions* pTail)
+   {
+      for (SymbolPositions::iterator it = pSymbols->begin();
+           it != pSymbols->end();)
+      {
+         Positions& positions = it->second;
+         Positions::iterator tail = std::stable_partition(
+                  positions.begin(),
+                  positions.end(),
+                  [&](const Position& symbolPosition) { return symbolPosition < position; });
+         
+         if (tail != positions.end())
+         {
+            Positions& tailPositions = (*pTail)[it->first];
+            tailPositions.insert(tailPositions.end(), tail, positions.end());
+            positions.erase(tail, positions.end());
+         }
+         
+         if (positions.empty())
+            it = pSymbols->erase(it);
+         else
+            ++it;
+      }
+   }
+   
+   static void appendSymbolsFrom(const SymbolPositions& tail,
+                                 const Position& position,
+                                 std::ptrdiff_t rowDelta,
+                                 SymbolPositions* pSymbols)
+   {
+      for (SymbolPositions::const_iterator it = tail.begin();
+           it != tail.end();
+           ++it)
+      {
+         for (const Position& symbolPosition : it->second)
+            if (symbolPosition >= position)
+               (*pSymbols)[it->first].push_back(shiftRow(symbolPosition, rowDelta));
+      }
+   }
+   
+   void shiftRows(std::ptrdiff_t rowDelta)
+   {
+      if (rowDelta == 0)
+         return;
+      
+      position_ = shiftRow(position_, rowDelta);
+      shiftSymbolRows(rowDelta, &definedSymbols_);
+      shiftSymbolRows(rowDelta, &referencedSymbols_);
+      shiftSymbolRows(rowDelta, &nseReferencedSymbols_);
+      for (const boost::shared_ptr<ParseNode>& pChild : children_)
+         pChild->shiftRows(rowDelta);
+   }
+   
+   static void shiftSymbolRows(std::ptrdiff_t rowDelta, SymbolPositions* pSymbols)
+   {
+      for (SymbolPositions::iterator it = pSymbols->begin();
+           it != pSymbols->end();
+           ++it)
+      {
+         for (Position& position : it->second)
+            position = shiftRow(position, rowDelta);
+      }
+   }
+   
    // tree reference -- children and parent
    ParseNode* pParent_;
    
@@ -1039,6 +1199,22 @@ public:
       functionNames_.push(std::wstring(L""));
    }
    
+   // resume a parse at the top level, with the parse tree and lint
+   // of the code up to that point
+   ParseStatus(const FilePath& filePath,
+               const ParseOptions& parseOptions,
+               boost::shared_ptr<ParseNode> pRoot,
+               const LintItems& lint)
+      : pRoot_(pRoot),
+        pNode_(pRoot_.get()),
+        lint_(lint),
+        parseOptions_(parseOptions),
+        filePath_(filePath)
+   {
+      parseStateStack_.push(ParseStateTopLevel);
+      functionNames_.push(std::wstring(L""));
+   }
+   
    ParseNode* node() { return pNode_; }
    LintItems& lint() { return lint_; }
    boost::shared_ptr<ParseNode> root() { return pRoot_; }
@@ -1406,6 +1582,36 @@ public:
    {
       return filePath_;
    }
+   
+   // Resume handler: invoked as each top-level expression is started at a
+   // position where the parse could be resumed (that is, where the state
+   // of the parse is entirely described by the parse tree and lint); the
+   // parse stops if it returns false.
+   typedef boost::function<bool(const core::r_util::token_cursor::RTokenCursor&,
+                                ParseStatus&)> ResumeHandler;
+   
+   void setResumeHandler(const ResumeHandler& handler)
+   {
+      resumeHandler_ = handler;
+   }
+   
+   bool onExpressionStart(const core::r_util::token_cursor::RTokenCursor& cursor)
+   {
+      if (!resumeHandler_)
+         return true;
+      
+      bool resumable =
+            parseStateStack_.size() == 1 &&
+            currentState() == ParseStateTopLevel &&
+            pNode_ == pRoot_.get() &&
+            bracketStack_.empty() &&
+            nseCallStack_.empty();
+      
+      if (!resumable)
+         return true;
+      
+      return resumeHandler_(cursor, *this);
+   }
 
 private:
    boost::shared_ptr<ParseNode> pRoot_;
@@ -1433,6 +1639,7 @@ private:
    SymbolRanges symbolRanges_;
    
    FilePath filePath_;
+   ResumeHandler resumeHandler_;
 };
 
 class ParseResults {
@@ -1491,6 +1698,50 @@ ParseResults parse(const std::string& rCode,
 ParseResults parse(const std::wstring& rCode,
                    const ParseOptions& parseOptions = ParseOptions());
 
+// Parses successive versions of a document (e.g. as it is edited), with the
+// same results as 'parse()'. The tokens and parse of the previous version
+// are reused: the code is re-tokenized only around the change, and parsing
+// is resumed at a top-level expression shortly before the change. Once the
+// parse is back in step with the previous parse after the change (and the
+// re-parsed code defines the same symbols and functions), the previous
+// parse of the rest of the document is reused, so typically only the
+// expressions around an edit are re-parsed.
+//
+// The parse tree is owned by the parser, and remains valid only until
+// the next call to 'parse()'.
+class IncrementalParser : boost::noncopyable
+{
+public:
+   
+   ParseResults parse(const core::FilePath& filePath,
+                      const std::wstring& rCode,
+                      const ParseOptions& parseOptions);
+   
+   void clear();
+   
+private:
+   
+   // a position at which the parse can be resumed
+   struct ResumePoint
+   {
+      std::size_t offset;
+      Position position;
+      std::size_t lintCount;
+      std::size_t childCount;
+   };
+   
+   ParseResults results() const;
+   
+   boost::scoped_ptr<RTokens> pTokens_;
+   core::FilePath filePath_;
+   ParseOptions parseOptions_;
+   
+   boost::shared_ptr<ParseNode> pRoot_;
+   LintItems lint_;
+   std::vector<LintItem> endOfDocumentLint_;
+   std::vector<ResumePoint> resumePoints_;
+};
+
 } // namespace rparser
 } // namespace modules
 } // namespace session
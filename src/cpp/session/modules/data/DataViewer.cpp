@@ -15,12 +15,14 @@
 
 #include "DataViewer.hpp"
 
+#include <numeric>
 #include <string>
 #include <vector>
 #include <sstream>
 #include <gsl/gsl>
 
 #include <boost/format.hpp>
+#include <boost/make_shared.hpp>
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/bind/bind.hpp>
 
@@ -47,6 +49,8 @@
 
 #include <session/prefs/UserPrefs.hpp>
 
+#include "DataViewerTransform.hpp"
+
 #define kGridResource "grid_resource"
 #define kViewerCacheDir "viewer-cache"
 #define kGridResourceLocation "/" kGridResource "/"
@@ -233,6 +237,7 @@ struct CachedFrame
    CachedFrame(const std::string& env, const std::string& obj, SEXP sexp):
       envName(env),
       objName(obj),
+      workingNRow(0),
       observedSEXP(sexp)
    {
       if (sexp == nullptr)
@@ -252,7 +257,12 @@ struct CachedFrame
       ncol = safeDim(sexp, DIM_COLS);
    };
 
-   CachedFrame() {};
+   CachedFrame() :
+      ncol(0),
+      workingNRow(0),
+      observedSEXP(nullptr)
+   {
+   };
 
    // The location of the frame (if we know it)
    std::string envName;
@@ -289,6 +299,15 @@ struct CachedFrame
    std::vector<int> workingOrderCols;
    std::vector<std::string> workingOrderDirs;
 
+   // The rows matching the current search and filter set, in the current
+   // order, when these were computed natively (see DataViewerTransform);
+   // workingNRow is the size of the frame they index
+   boost::shared_ptr<std::vector<int> > pWorkingRows;
+   int workingNRow;
+
+   // Keys used to order columns which can't be compared natively
+   SortKeys sortKeys;
+
    // NB: There's no protection on this SEXP and it may be a stale pointer!
    // Used only to test for changes.
    SEXP observedSEXP;
@@ -465,6 +484,72 @@ json::Value getCols(SEXP dataSEXP)
    return result;
 }
 
+// returns the rows of the frame (as 0-based indexes) which match the given
+// search and filters, in the given order. the result is saved with the cached
+// frame (if any) so that later requests for other pages, or for a subset of
+// these rows, needn't start from scratch.
+boost::shared_ptr<std::vector<int> > transformRows(
+      SEXP dataSEXP,
+      int nrow,
+      CachedFrame* pFrame,
+      const std::string& search,
+      const std::vector<std::string>& filters,
+      const std::vector<int>& ordercols,
+      const std::vector<std::string>& orderdirs)
+{
+   CachedFrame uncachedFrame;
+   if (pFrame == nullptr)
+      pFrame = &uncachedFrame;
+
+   boost::shared_ptr<std::vector<int> > pWorkingRows = pFrame->pWorkingRows;
+   if (pWorkingRows && pFrame->workingNRow != nrow)
+      pWorkingRows.reset();
+
+   bool sameOrder = pFrame->workingOrderDirs == orderdirs &&
+                    pFrame->workingOrderCols == ordercols;
+   if (pWorkingRows && sameOrder &&
+       pFrame->workingSearch == search &&
+       pFrame->workingFilters == filters)
+   {
+      // we have the rows for exactly the same parameters as requested
+      return pWorkingRows;
+   }
+
+   boost::shared_ptr<std::vector<int> > pRows = boost::make_shared<std::vector<int> >();
+   bool ordered;
+   if (pWorkingRows && pFrame->isSupersetOf(search, filters))
+   {
+      // narrow the rows we have rather than starting from scratch; filtering
+      // keeps them in order, so they only need sorting if the order changed
+      *pRows = *pWorkingRows;
+      ordered = sameOrder;
+   }
+   else
+   {
+      pRows->resize(nrow);
+      std::iota(pRows->begin(), pRows->end(), 0);
+      ordered = ordercols.empty();
+   }
+
+   filterRows(dataSEXP, filters, search, pRows.get());
+
+   if (!ordered)
+   {
+      if (ordercols.empty())
+         std::sort(pRows->begin(), pRows->end());
+      else
+         orderRows(dataSEXP, ordercols, orderdirs, &pFrame->sortKeys, pRows.get());
+   }
+
+   pFrame->workingSearch = search;
+   pFrame->workingFilters = filters;
+   pFrame->workingOrderDirs = orderdirs;
+   pFrame->workingOrderCols = ordercols;
+   pFrame->pWorkingRows = pRows;
+   pFrame->workingNRow = nrow;
+   return pRows;
+}
+
 // given an object from which to return data, and a description of the data to
 // return via URL-encoded parameters supplied by the DataTables API, returns the
 // data requested by the parameters. 
@@ -552,6 +637,22 @@ json::Value getData(SEXP dataSEXP, const http::Fields& fields)
 
    // check to see if we have an ordered/filtered view we can build from
    auto cachedFrame = s_cachedFrames.find(cacheKey);
+
+   // when we can, order and filter the rows by index rather than
+   // transforming (and so copying) the frame in R
+   boost::shared_ptr<std::vector<int> > pRows;
+   if (needsTransform && canTransformRows(dataSEXP, nrow))
+   {
+      pRows = transformRows(dataSEXP,
+                            nrow,
+                            cachedFrame != s_cachedFrames.end() ? &cachedFrame->second : nullptr,
+                            search,
+                            filters,
+                            ordercols,
+                            orderdirs);
+      needsTransform = false;
+   }
+
    if (needsTransform)
    {
       if (cachedFrame != s_cachedFrames.end())
@@ -619,9 +720,12 @@ json::Value getData(SEXP dataSEXP, const http::Fields& fields)
    }
 
    // apply new row count if we've transformed the data (or need to)
-   filteredNRow = needsTransform || hasTransform
-      ? safeDim(dataSEXP, DIM_ROWS)
-      : nrow;
+   if (pRows)
+      filteredNRow = gsl::narrow_cast<int>(pRows->size());
+   else if (needsTransform || hasTransform)
+      filteredNRow = safeDim(dataSEXP, DIM_ROWS);
+   else
+      filteredNRow = nrow;
 
    // return the lesser of the rows available and rows requested
    length = std::min(length, filteredNRow - start);
@@ -629,6 +733,27 @@ json::Value getData(SEXP dataSEXP, const http::Fields& fields)
    // DataTables uses 0-based indexing, but R uses 1-based indexing
    start++;
 
+   // the row of dataSEXP at which to start formatting
+   int formatStart = start;
+   if (pRows)
+   {
+      // extract the rows requested (and, as .rs.formatDataColumn formats
+      // it too, the row after them)
+      std::vector<int> sliceRows;
+      for (int i = start - 1;
+           i < std::min(filteredNRow, start + std::max(length, 0));
+           i++)
+      {
+         sliceRows.push_back((*pRows)[i] + 1);
+      }
+
+      error = r::exec::RFunction(".rs.sliceDataRows", dataSEXP, sliceRows)
+            .call(&dataSEXP, &protect);
+      if (error)
+         throw r::exec::RErrorException(error.getSummary());
+      formatStart = 1;
+   }
+
    // extract the portion of the column vector requested by the client
    int numFormattedColumns = ncol - columnOffset < maxColumns ? ncol - columnOffset : maxColumns;
    SEXP formattedDataSEXP = Rf_allocVector(VECSXP, numFormattedColumns);
@@ -656,7 +781,7 @@ json::Value getData(SEXP dataSEXP, const http::Fields& fields)
       SEXP formattedColumnSEXP = R_NilValue;
       r::exec::RFunction formatFx(".rs.formatDataColumn");
       formatFx.addParam(columnSEXP);
-      formatFx.addParam(gsl::narrow_cast<int>(start));
+      formatFx.addParam(gsl::narrow_cast<int>(formatStart));
       formatFx.addParam(gsl::narrow_cast<int>(length));
       error = formatFx.call(&formattedColumnSEXP, &protect);
       if (error)
@@ -667,7 +792,7 @@ json::Value getData(SEXP dataSEXP, const http::Fields& fields)
 
    // format the row names
    SEXP rownamesSEXP = R_NilValue;
-   r::exec::RFunction(".rs.formatRowNames", dataSEXP, start, length)
+   r::exec::RFunction(".rs.formatRowNames", dataSEXP, formatStart, length)
       .call(&rownamesSEXP, &protect);
    
    // create the result grid as JSON
@@ -0,0 +1,592 @@
+/*
+ * DataViewerTransform.cpp
+ *
+ * Copyright (C) 2022 by RStudio, PBC
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#define R_INTERNAL_FUNCTIONS
+#include "DataViewerTransform.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
+
+#include <boost/function.hpp>
+
+#include <shared_core/Error.hpp>
+#include <core/BoostThread.hpp>
+#include <core/Thread.hpp>
+
+#include <r/RInternal.hpp>
+#include <r/RExec.hpp>
+
+using namespace rstudio::core;
+
+namespace rstudio {
+namespace session {
+namespace modules {
+namespace data {
+namespace viewer {
+
+namespace {
+
+// sorts of more rows than this are split across threads
+const std::size_t kParallelSortThreshold = 1 << 18;
+const std::size_t kMaxSortThreads = 8;
+
+struct ColumnFilter
+{
+   std::string type;
+   std::string value;
+};
+
+// splits a filter of the form "type|value" (e.g. "numeric|12_25"); as with
+// the strsplit in .rs.applyTransform, anything after a second separator
+// is ignored
+bool parseFilter(const std::string& filter, ColumnFilter* pFilter)
+{
+   std::size_t pipe = filter.find('|');
+   if (pipe == std::string::npos || pipe + 1 == filter.size())
+      return false;
+
+   std::size_t end = filter.find('|', pipe + 1);
+   pFilter->type = filter.substr(0, pipe);
+   pFilter->value = filter.substr(pipe + 1,
+                                  end == std::string::npos ? end : end - pipe - 1);
+   return true;
+}
+
+// parses a number as as.numeric would, returning NaN if the text isn't one
+double parseNumber(const std::string& text)
+{
+   const char* begin = text.c_str();
+   char* end = nullptr;
+   double value = std::strtod(begin, &end);
+   if (end == begin)
+      return NAN;
+
+   while (*end == ' ' || *end == '\t')
+      end++;
+   return *end == '\0' ? value : NAN;
+}
+
+bool isPlainVector(SEXP columnSEXP, int type)
+{
+   return TYPEOF(columnSEXP) == type && !OBJECT(columnSEXP);
+}
+
+char asciiLower(char c)
+{
+   return (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c;
+}
+
+bool isAscii(const std::string& text)
+{
+   for (char c : text)
+   {
+      if (static_cast<unsigned char>(c) > 127)
+         return false;
+   }
+   return true;
+}
+
+// case-insensitive search for (ASCII) text, as grepl(ignore.case = TRUE)
+class TextMatcher
+{
+public:
+   explicit TextMatcher(const std::string& text)
+   {
+      for (char c : text)
+         text_.push_back(asciiLower(c));
+   }
+
+   bool matches(const char* str) const
+   {
+      const char* end = str + std::strlen(str);
+      return std::search(str, end, text_.begin(), text_.end(),
+                         [](char lhs, char rhs) { return asciiLower(lhs) == rhs; }) != end ||
+             text_.empty();
+   }
+
+   bool matches(SEXP charSEXP)
+   {
+      if (charSEXP == NA_STRING)
+         return false;
+
+      // strings are usually repeated, and share a CHARSXP when they are
+      std::unordered_map<SEXP, bool>::const_iterator it = cache_.find(charSEXP);
+      if (it != cache_.end())
+         return it->second;
+
+      bool result = matches(Rf_translateCharUTF8(charSEXP));
+      cache_[charSEXP] = result;
+      return result;
+   }
+
+private:
+   std::string text_;
+   std::unordered_map<SEXP, bool> cache_;
+};
+
+// evaluates the filter for the given rows of a column; returns false if the
+// column's type needs the filter to be evaluated in R
+bool matchColumnNative(SEXP columnSEXP,
+                       const ColumnFilter& filter,
+                       const std::vector<int>& rows,
+                       std::vector<char>* pMatches)
+{
+   std::vector<char>& matches = *pMatches;
+   matches.assign(rows.size(), 0);
+
+   if (filter.type == "factor")
+   {
+      if (!Rf_isFactor(columnSEXP))
+         return false;
+
+      double code = parseNumber(filter.value);
+      const int* pCodes = INTEGER(columnSEXP);
+      for (std::size_t i = 0; i < rows.size(); i++)
+      {
+         int value = pCodes[rows[i]];
+         matches[i] = value != NA_INTEGER && value == code;
+      }
+      return true;
+   }
+   else if (filter.type == "numeric")
+   {
+      bool isInteger = isPlainVector(columnSEXP, INTSXP);
+      if (!isInteger && !isPlainVector(columnSEXP, REALSXP))
+         return false;
+
+      // range ("2_32") or equality ("15"); like strsplit, ignore a
+      // trailing separator
+      double lower, upper;
+      std::size_t separator = filter.value.find('_');
+      if (separator == std::string::npos || separator + 1 == filter.value.size())
+      {
+         lower = upper = parseNumber(filter.value.substr(0, separator));
+      }
+      else
+      {
+         std::size_t end = filter.value.find('_', separator + 1);
+         lower = parseNumber(filter.value.substr(0, separator));
+         upper = parseNumber(filter.value.substr(separator + 1,
+            end == std::string::npos ? end : end - separator - 1));
+      }
+
+      for (std::size_t i = 0; i < rows.size(); i++)
+      {
+         double value;
+         if (isInteger)
+         {
+            int intValue = INTEGER(columnSEXP)[rows[i]];
+            if (intValue == NA_INTEGER)
+               continue;
+            value = intValue;
+         }
+         else
+         {
+            value = REAL(columnSEXP)[rows[i]];
+            if (!std::isfinite(value))
+               continue;
+         }
+         matches[i] = value >= lower && value <= upper;
+      }
+      return true;
+   }
+   else if (filter.type == "boolean")
+   {
+      if (!isPlainVector(columnSEXP, LGLSXP))
+         return false;
+
+      int expected = filter.value == "TRUE" ? 1 : 0;
+      const int* pValues = LOGICAL(columnSEXP);
+      for (std::size_t i = 0; i < rows.size(); i++)
+         matches[i] = pValues[rows[i]] == expected;
+      return true;
+   }
+   else if (filter.type == "character")
+   {
+      // non-ASCII text needs PCRE's case folding
+      if (!isAscii(filter.value))
+         return false;
+
+      TextMatcher matcher(filter.value);
+      if (isPlainVector(columnSEXP, STRSXP))
+      {
+         for (std::size_t i = 0; i < rows.size(); i++)
+            matches[i] = matcher.matches(STRING_ELT(columnSEXP, rows[i]));
+      }
+      else if (Rf_isFactor(columnSEXP))
+      {
+         // match each level once
+         SEXP levelsSEXP = Rf_getAttrib(columnSEXP, R_LevelsSymbol);
+         if (TYPEOF(levelsSEXP) != STRSXP)
+            return false;
+
+         int levels = Rf_length(levelsSEXP);
+         std::vector<char> levelMatches(levels);
+         for (int i = 0; i < levels; i++)
+            levelMatches[i] = matcher.matches(STRING_ELT(levelsSEXP, i));
+
+         const int* pCodes = INTEGER(columnSEXP);
+         for (std::size_t i = 0; i < rows.size(); i++)
+         {
+            int code = pCodes[rows[i]];
+            matches[i] = code != NA_INTEGER && code >= 1 && code <= levels &&
+                         levelMatches[code - 1];
+         }
+      }
+      else if (isPlainVector(columnSEXP, INTSXP))
+      {
+         for (std::size_t i = 0; i < rows.size(); i++)
+         {
+            int value = INTEGER(columnSEXP)[rows[i]];
+            matches[i] = value != NA_INTEGER &&
+                         matcher.matches(std::to_string(value).c_str());
+         }
+      }
+      else if (isPlainVector(columnSEXP, LGLSXP))
+      {
+         bool matchesTrue = matcher.matches("TRUE");
+         bool matchesFalse = matcher.matches("FALSE");
+         for (std::size_t i = 0; i < rows.size(); i++)
+         {
+            int value = LOGICAL(columnSEXP)[rows[i]];
+            matches[i] = value == NA_LOGICAL ? false : (value ? matchesTrue : matchesFalse);
+         }
+      }
+      else
+      {
+         // doubles (whose text depends on R's formatting), dates, lists, etc.
+         return false;
+      }
+      return true;
+   }
+
+   // unknown filter types match everything
+   matches.assign(rows.size(), 1);
+   return true;
+}
+
+void matchColumn(SEXP columnSEXP,
+                 const ColumnFilter& filter,
+                 const std::vector<int>& rows,
+                 std::vector<char>* pMatches)
+{
+   if (matchColumnNative(columnSEXP, filter, rows, pMatches))
+      return;
+
+   // evaluate the filter in R, on just the given rows
+   std::vector<int> rRows;
+   rRows.reserve(rows.size());
+   for (int row : rows)
+      rRows.push_back(row + 1);
+
+   r::sexp::Protect protect;
+   SEXP matchesSEXP = R_NilValue;
+   Error error = r::exec::RFunction(".rs.filterDataColumn")
+         .addParam("x", columnSEXP)
+         .addParam("type", filter.type)
+         .addParam("value", filter.value)
+         .addParam("rows", rRows)
+         .call(&matchesSEXP, &protect);
+   if (error)
+      throw r::exec::RErrorException(error.getSummary());
+
+   if (TYPEOF(matchesSEXP) != LGLSXP ||
+       Rf_xlength(matchesSEXP) != static_cast<R_xlen_t>(rows.size()))
+   {
+      throw r::exec::RErrorException("Failure to filter data");
+   }
+
+   const int* pValues = LOGICAL(matchesSEXP);
+   pMatches->assign(pValues, pValues + rows.size());
+}
+
+// removes the rows which don't match, keeping the others in order
+void keepMatches(const std::vector<char>& matches, std::vector<int>* pRows)
+{
+   std::size_t kept = 0;
+   for (std::size_t i = 0; i < pRows->size(); i++)
+   {
+      if (matches[i])
+         (*pRows)[kept++] = (*pRows)[i];
+   }
+   pRows->resize(kept);
+}
+
+struct SortColumn
+{
+   const int* pInts;
+   const double* pReals;
+   bool descending;
+};
+
+// compares rows by each column in turn, then by their position in the
+// frame; since no two rows are equal, any sort gives the same (stable) order
+class RowComparator
+{
+public:
+   explicit RowComparator(const std::vector<SortColumn>& columns)
+      : columns_(columns)
+   {
+   }
+
+   bool operator()(int lhs, int rhs) const
+   {
+      for (const SortColumn& column : columns_)
+      {
+         int result = column.pInts ?
+            compare(column.pInts[lhs], column.pInts[rhs], column.pInts[lhs] == NA_INTEGER,
+                    column.pInts[rhs] == NA_INTEGER, column.descending) :
+            compare(column.pReals[lhs], column.pReals[rhs], std::isnan(column.pReals[lhs]),
+                    std::isnan(column.pReals[rhs]), column.descending);
+         if (result != 0)
+            return result < 0;
+      }
+      return lhs < rhs;
+   }
+
+private:
+   template <typename T>
+   static int compare(T lhs, T rhs, bool lhsMissing, bool rhsMissing, bool descending)
+   {
+      // missing values are last in either direction
+      if (lhsMissing || rhsMissing)
+         return lhsMissing == rhsMissing ? 0 : (lhsMissing ? 1 : -1);
+      if (lhs == rhs)
+         return 0;
+      return ((lhs < rhs) != descending) ? -1 : 1;
+   }
+
+   std::vector<SortColumn> columns_;
+};
+
+// runs count tasks, each on its own thread (the first on this one)
+void runConcurrently(std::size_t count, const boost::function<void(std::size_t)>& task)
+{
+   std::vector<boost::shared_ptr<boost::thread> > threads;
+   for (std::size_t i = 1; i < count; i++)
+   {
+      boost::shared_ptr<boost::thread> pThread(new boost::thread());
+      core::thread::safeLaunchThread(boost::bind(task, i), pThread.get());
+      threads.push_back(pThread);
+   }
+
+   task(0);
+
+   for (const boost::shared_ptr<boost::thread>& pThread : threads)
+   {
+      if (pThread->joinable())
+         pThread->join();
+   }
+}
+
+// sorts large sets of rows in chunks on several threads, then merges
+// neighbouring chunks (also concurrently) until only one remains
+void parallelSort(std::vector<int>* pRows, const RowComparator& comparator)
+{
+   std::size_t count = pRows->size();
+   std::size_t threads = std::min<std::size_t>(boost::thread::hardware_concurrency(),
+                                                kMaxSortThreads);
+   if (count < kParallelSortThreshold || threads < 2)
+   {
+      std::sort(pRows->begin(), pRows->end(), comparator);
+      return;
+   }
+
+   std::vector<std::size_t> bounds;
+   for (std::size_t i = 0; i <= threads; i++)
+      bounds.push_back(count * i / threads);
+
+   std::vector<int>::iterator begin = pRows->begin();
+   runConcurrently(threads, [&](std::size_t i) {
+      std::sort(begin + bounds[i], begin + bounds[i + 1], comparator);
+   });
+
+   while (bounds.size() > 2)
+   {
+      runConcurrently((bounds.size() - 1) / 2, [&](std::size_t i) {
+         std::inplace_merge(begin + bounds[2 * i],
+                            begin + bounds[2 * i + 1],
+                            begin + bounds[2 * i + 2],
+                            comparator);
+      });
+
+      std::vector<std::size_t> merged;
+      for (std::size_t i = 0; i < bounds.size(); i += 2)
+         merged.push_back(bounds[i]);
+      if (merged.back() != bounds.back())
+         merged.push_back(bounds.back());
+      bounds = merged;
+   }
+}
+
+const std::vector<double>& sortKeys(SEXP columnSEXP, int col, SortKeys* pSortKeys)
+{
+   SortKeys::const_iterator it = pSortKeys->find(col);
+   if (it != pSortKeys->end())
+      return it->second;
+
+   r::sexp::Protect protect;
+   SEXP keysSEXP = R_NilValue;
+   Error error = r::exec::RFunction("xtfrm", columnSEXP).call(&keysSEXP, &protect);
+   if (error)
+      throw r::exec::RErrorException(error.getSummary());
+
+   R_xlen_t length = Rf_xlength(columnSEXP);
+   if (Rf_xlength(keysSEXP) != length ||
+       (TYPEOF(keysSEXP) != INTSXP && TYPEOF(keysSEXP) != REALSXP &&
+        TYPEOF(keysSEXP) != LGLSXP))
+   {
+      throw r::exec::RErrorException("Failure to sort data");
+   }
+
+   std::vector<double>& keys = (*pSortKeys)[col];
+   keys.reserve(length);
+   if (TYPEOF(keysSEXP) == REALSXP)
+   {
+      keys.assign(REAL(keysSEXP), REAL(keysSEXP) + length);
+   }
+   else
+   {
+      const int* pValues = TYPEOF(keysSEXP) == INTSXP ? INTEGER(keysSEXP) : LOGICAL(keysSEXP);
+      for (R_xlen_t i = 0; i < length; i++)
+         keys.push_back(pValues[i] == NA_INTEGER ? NA_REAL : pValues[i]);
+   }
+   return keys;
+}
+
+} // anonymous namespace
+
+bool canTransformRows(SEXP dataSEXP, int nrow)
+{
+   if (TYPEOF(dataSEXP) != VECSXP)
+      return false;
+
+   for (int i = 0, n = Rf_length(dataSEXP); i < n; i++)
+   {
+      SEXP columnSEXP = VECTOR_ELT(dataSEXP, i);
+      if (!Rf_isVector(columnSEXP) ||
+          Rf_xlength(columnSEXP) != nrow ||
+          Rf_getAttrib(columnSEXP, R_DimSymbol) != R_NilValue)
+      {
+         return false;
+      }
+   }
+
+   return true;
+}
+
+void filterRows(SEXP dataSEXP,
+                const std::vector<std::string>& filters,
+                const std::string& search,
+                std::vector<int>* pRows)
+{
+   int ncol = Rf_length(dataSEXP);
+
+   // apply columnwise filters, each narrowing the rows for the next
+   for (std::size_t i = 0; i < filters.size() && i < static_cast<std::size_t>(ncol); i++)
+   {
+      ColumnFilter filter;
+      SEXP columnSEXP = VECTOR_ELT(dataSEXP, i);
+      if (!parseFilter(filters[i], &filter) || Rf_xlength(columnSEXP) == 0)
+         continue;
+
+      std::vector<char> matches;
+      matchColumn(columnSEXP, filter, *pRows, &matches);
+      keepMatches(matches, pRows);
+   }
+
+   // apply global search; rows match if any column does, so each column
+   // need only be searched for the rows no earlier column matched
+   if (!search.empty())
+   {
+      ColumnFilter filter = { "character", search };
+      std::vector<char> matched(pRows->size(), 0);
+      std::vector<int> pending(*pRows);
+      std::vector<std::size_t> pendingIndexes(pRows->size());
+      for (std::size_t i = 0; i < pendingIndexes.size(); i++)
+         pendingIndexes[i] = i;
+
+      for (int i = 0; i < ncol && !pending.empty(); i++)
+      {
+         std::vector<char> matches;
+         matchColumn(VECTOR_ELT(dataSEXP, i), filter, pending, &matches);
+
+         std::size_t kept = 0;
+         for (std::size_t j = 0; j < pending.size(); j++)
+         {
+            if (matches[j])
+            {
+               matched[pendingIndexes[j]] = 1;
+            }
+            else
+            {
+               pending[kept] = pending[j];
+               pendingIndexes[kept] = pendingIndexes[j];
+               kept++;
+            }
+         }
+         pending.resize(kept);
+         pendingIndexes.resize(kept);
+      }
+
+      keepMatches(matched, pRows);
+   }
+}
+
+void orderRows(SEXP dataSEXP,
+               const std::vector<int>& cols,
+               const std::vector<std::string>& dirs,
+               SortKeys* pSortKeys,
+               std::vector<int>* pRows)
+{
+   std::vector<SortColumn> columns;
+   for (std::size_t i = 0; i < cols.size(); i++)
+   {
+      int col = cols[i];
+      if (col < 1 || col > Rf_length(dataSEXP))
+         continue;
+
+      SEXP columnSEXP = VECTOR_ELT(dataSEXP, col - 1);
+      if (Rf_xlength(columnSEXP) == 0)
+         continue;
+
+      SortColumn column = { nullptr, nullptr, i < dirs.size() && dirs[i] == "desc" };
+      if (isPlainVector(columnSEXP, INTSXP) || Rf_isFactor(columnSEXP))
+         column.pInts = INTEGER(columnSEXP);
+      else if (isPlainVector(columnSEXP, LGLSXP))
+         column.pInts = LOGICAL(columnSEXP);
+      else if (isPlainVector(columnSEXP, REALSXP))
+         column.pReals = REAL(columnSEXP);
+      else
+         column.pReals = sortKeys(columnSEXP, col, pSortKeys).data();
+      columns.push_back(column);
+   }
+
+   if (columns.empty())
+      return;
+
+   // (the comparator reads the column data directly, so makes no R calls
+   // and is safe to use off the main thread)
+   parallelSort(pRows, RowComparator(columns));
+}
+
+} // namespace viewer
+} // namespace data
+} // namespace modules
+} // namespace session
+} // namespace rstudio
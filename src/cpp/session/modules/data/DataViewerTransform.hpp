@@ -0,0 +1,75 @@
+/*
+ * DataViewerTransform.hpp
+ *
+ * Copyright (C) 2022 by RStudio, PBC
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef SESSION_DATA_VIEWER_TRANSFORM_HPP
+#define SESSION_DATA_VIEWER_TRANSFORM_HPP
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <r/RSexp.hpp>
+
+// Sorting, filtering and searching of the frames shown in the data viewer.
+//
+// Rather than reordering and subsetting a copy of the frame (as
+// .rs.applyTransform does), these work on a list of row indexes into the
+// frame, so only the rows actually displayed need be copied and formatted.
+// Plain integer, double, logical and character columns (and factors) are
+// handled natively; others defer to R column by column.
+//
+// NB: these may throw r::exec::RErrorException if R fails to filter or
+// order a column.
+
+namespace rstudio {
+namespace session {
+namespace modules {
+namespace data {
+namespace viewer {
+
+// keys (as computed by xtfrm) by which columns that can't be compared
+// natively are ordered, by column index; these are expensive to compute for
+// large frames, so are cached along with the frame
+typedef std::map<int, std::vector<double> > SortKeys;
+
+// returns true if the rows of the frame can be transformed by index; frames
+// with columns which aren't vectors of nrow elements need to be transformed
+// in R
+bool canTransformRows(SEXP dataSEXP, int nrow);
+
+// narrows the given rows (0-based indexes into the frame, in display order)
+// to those matching the given column filters (in the "type|value" format
+// understood by .rs.applyTransform) and global search
+void filterRows(SEXP dataSEXP,
+                const std::vector<std::string>& filters,
+                const std::string& search,
+                std::vector<int>* pRows);
+
+// orders the given rows by the values in the given (1-based) columns, in
+// the given directions ("asc" or "desc"); missing values are placed last, and
+// rows with equal values are kept in frame order
+void orderRows(SEXP dataSEXP,
+               const std::vector<int>& cols,
+               const std::vector<std::string>& dirs,
+               SortKeys* pSortKeys,
+               std::vector<int>* pRows);
+
+} // namespace viewer
+} // namespace data
+} // namespace modules
+} // namespace session
+} // namespace rstudio
+
+#endif // SESSION_DATA_VIEWER_TRANSFORM_HPP
@@ -0,0 +1,248 @@
+/*
+ * DataViewerTransformTests.cpp
+ *
+ * Copyright (C) 2022 by RStudio, PBC
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#define R_INTERNAL_FUNCTIONS
+#include "DataViewerTransform.hpp"
+
+#include <tests/TestThat.hpp>
+
+#include <chrono>
+#include <iostream>
+#include <numeric>
+
+#include <core/Log.hpp>
+
+#include <r/RInternal.hpp>
+#include <r/RExec.hpp>
+
+using namespace rstudio::core;
+
+namespace rstudio {
+namespace session {
+namespace modules {
+namespace data {
+namespace viewer {
+namespace tests {
+
+namespace {
+
+SEXP evaluate(const std::string& code, r::sexp::Protect* pProtect)
+{
+   SEXP resultSEXP = R_NilValue;
+   Error error = r::exec::evaluateString(code, &resultSEXP, pProtect);
+   if (error)
+      LOG_ERROR(error);
+   return resultSEXP;
+}
+
+std::vector<int> allRows(SEXP dataSEXP)
+{
+   std::vector<int> rows(Rf_xlength(VECTOR_ELT(dataSEXP, 0)));
+   std::iota(rows.begin(), rows.end(), 0);
+   return rows;
+}
+
+std::vector<int> transform(SEXP dataSEXP,
+                           const std::vector<std::string>& filters,
+                           const std::string& search,
+                           const std::vector<int>& cols,
+                           const std::vector<std::string>& dirs)
+{
+   std::vector<int> rows = allRows(dataSEXP);
+   SortKeys sortKeys;
+   filterRows(dataSEXP, filters, search, &rows);
+   orderRows(dataSEXP, cols, dirs, &sortKeys, &rows);
+   return rows;
+}
+
+// the rows (0-based) of the frame as transformed in R
+std::vector<int> transformInR(SEXP dataSEXP,
+                              const std::vector<std::string>& filters,
+                              const std::string& search,
+                              const std::vector<int>& cols,
+                              const std::vector<std::string>& dirs,
+                              r::sexp::Protect* pProtect)
+{
+   SEXP resultSEXP = R_NilValue;
+   Error error = r::exec::RFunction(".rs.applyTransform")
+         .addParam("x", dataSEXP)
+         .addParam("filtered", filters)
+         .addParam("search", search)
+         .addParam("cols", cols)
+         .addParam("dirs", dirs)
+         .call(&resultSEXP, pProtect);
+   if (error)
+      LOG_ERROR(error);
+
+   SEXP rowNamesSEXP = R_NilValue;
+   r::exec::RFunction("row.names", resultSEXP).call(&rowNamesSEXP, pProtect);
+
+   std::vector<std::string> rowNames;
+   r::sexp::extract(rowNamesSEXP, &rowNames);
+
+   std::vector<int> rows;
+   for (const std::string& rowName : rowNames)
+      rows.push_back(std::stoi(rowName) - 1);
+   return rows;
+}
+
+double secondsSince(const std::chrono::steady_clock::time_point& start)
+{
+   return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // anonymous namespace
+
+test_context("DataViewerTransform")
+{
+   r::sexp::Protect protect;
+   SEXP dataSEXP = evaluate(
+      "data.frame("
+      "   int = c(3L, 1L, NA, 2L, 1L),"
+      "   dbl = c(2.5, NaN, 1, -1, 2.5),"
+      "   chr = c('apple', 'Banana', NA, 'cherry', 'pineapple'),"
+      "   fct = factor(c('b', 'a', 'b', NA, 'c')),"
+      "   lgl = c(TRUE, FALSE, NA, TRUE, FALSE),"
+      "   date = as.Date('2022-01-01') + c(4, 2, 0, 3, 1),"
+      "   stringsAsFactors = FALSE)",
+      &protect);
+
+   test_that("Frames of plain columns can be transformed by index")
+   {
+      expect_true(canTransformRows(dataSEXP, 5));
+      expect_false(canTransformRows(dataSEXP, 6));
+   }
+
+   test_that("Rows are ordered with missing values last")
+   {
+      expect_true(transform(dataSEXP, {}, "", { 1 }, { "asc" }) ==
+                  std::vector<int>({ 1, 4, 3, 0, 2 }));
+      expect_true(transform(dataSEXP, {}, "", { 1 }, { "desc" }) ==
+                  std::vector<int>({ 0, 3, 1, 4, 2 }));
+      expect_true(transform(dataSEXP, {}, "", { 2 }, { "desc" }) ==
+                  std::vector<int>({ 0, 4, 2, 3, 1 }));
+   }
+
+   test_that("Rows are ordered by several columns")
+   {
+      expect_true(transform(dataSEXP, {}, "", { 1, 2 }, { "asc", "desc" }) ==
+                  std::vector<int>({ 4, 1, 3, 0, 2 }));
+   }
+
+   test_that("Rows are filtered by column")
+   {
+      expect_true(transform(dataSEXP, { "numeric|1_2.5" }, "", {}, {}) ==
+                  std::vector<int>({ 1, 3, 4 }));
+      expect_true(transform(dataSEXP, { "", "", "character|APPLE" }, "", {}, {}) ==
+                  std::vector<int>({ 0, 4 }));
+      expect_true(transform(dataSEXP, { "", "", "", "factor|2" }, "", {}, {}) ==
+                  std::vector<int>({ 0, 2 }));
+      expect_true(transform(dataSEXP, { "", "", "", "", "boolean|FALSE" }, "", {}, {}) ==
+                  std::vector<int>({ 1, 4 }));
+   }
+
+   test_that("Search matches rows with any matching column")
+   {
+      expect_true(transform(dataSEXP, {}, "an", {}, {}) ==
+                  std::vector<int>({ 1 }));
+      expect_true(transform(dataSEXP, {}, "2.5", {}, {}) ==
+                  std::vector<int>({ 0, 4 }));
+      expect_true(transform(dataSEXP, {}, "true", {}, {}) ==
+                  std::vector<int>({ 0, 3 }));
+   }
+
+   test_that("Transforms match those made in R")
+   {
+      SEXP randomSEXP = evaluate(
+         "local({"
+         "   set.seed(42); n <- 5000;"
+         "   data.frame("
+         "      int = sample(c(1:50, NA), n, TRUE),"
+         "      dbl = round(rnorm(n), 2),"
+         "      chr = sample(c(state.name, NA), n, TRUE),"
+         "      fct = factor(sample(letters, n, TRUE)),"
+         "      date = as.Date('2020-01-01') + sample(1:100, n, TRUE),"
+         "      stringsAsFactors = FALSE)"
+         "})",
+         &protect);
+
+      std::vector<std::string> filters = { "numeric|10_40", "", "character|new" };
+      for (int col = 1; col <= 5; col++)
+      {
+         for (const char* dir : { "asc", "desc" })
+         {
+            expect_true(transform(randomSEXP, {}, "", { col }, { dir }) ==
+                        transformInR(randomSEXP, {}, "", { col }, { dir }, &protect));
+            expect_true(transform(randomSEXP, filters, "a", { col }, { dir }) ==
+                        transformInR(randomSEXP, filters, "a", { col }, { dir }, &protect));
+         }
+      }
+   }
+}
+
+TEST_CASE("DataViewerTransform benchmark", "[.benchmark]")
+{
+   for (int size : { 1000000, 10000000 })
+   {
+      r::sexp::Protect protect;
+      SEXP dataSEXP = evaluate(
+         "local({"
+         "   n <- " + std::to_string(size) + ";"
+         "   data.frame("
+         "      int = sample.int(1000L, n, TRUE),"
+         "      dbl = runif(n),"
+         "      chr = sample(c(state.name, NA), n, TRUE),"
+         "      stringsAsFactors = FALSE)"
+         "})",
+         &protect);
+
+      struct Case { std::string name; std::vector<std::string> filters; std::string search; int col; };
+      std::vector<Case> cases = {
+         { "sort doubles", {}, "", 2 },
+         { "sort strings", {}, "", 3 },
+         { "filter and sort", { "numeric|100_500" }, "", 2 },
+         { "search", {}, "new", 0 }
+      };
+
+      for (const Case& benchmarkCase : cases)
+      {
+         std::vector<int> cols;
+         std::vector<std::string> dirs;
+         if (benchmarkCase.col > 0)
+         {
+            cols.push_back(benchmarkCase.col);
+            dirs.push_back("asc");
+         }
+
+         auto start = std::chrono::steady_clock::now();
+         transformInR(dataSEXP, benchmarkCase.filters, benchmarkCase.search, cols, dirs, &protect);
+         double rSeconds = secondsSince(start);
+
+         start = std::chrono::steady_clock::now();
+         transform(dataSEXP, benchmarkCase.filters, benchmarkCase.search, cols, dirs);
+         double nativeSeconds = secondsSince(start);
+
+         std::cout << size << " rows, " << benchmarkCase.name << ": "
+                   << rSeconds << "s in R, " << nativeSeconds << "s natively" << std::endl;
+      }
+   }
+}
+
+} // namespace tests
+} // namespace viewer
+} // namespace data
+} // namespace modules
+} // namespace session
+} // namespace rstudio
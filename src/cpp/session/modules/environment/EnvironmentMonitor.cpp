@@ -43,28 +43,21 @@ void enqueRefreshEvent()
    module_context::enqueClientEvent(refreshEvent);
 }
 
-// if the given variable is an unevaluated promise, add it to the given
-// list of variables
-void addUnevaledPromise(std::vector<r::sexp::Variable>* pEnv,
-                        const r::sexp::Variable& var)
+r::sexp::Variable toVariable(SEXP name, SEXP value)
 {
-   if (isUnevaluatedPromise(var.second))
-   {
-      pEnv->push_back(var);
-   }
+   return std::make_pair(r::sexp::asString(name), value);
 }
 
-// If the given variable exists in the given list, remove it. Compares on name
-// only.
-void removeVarFromList(std::vector<r::sexp::Variable>* pEnv,
-                       const r::sexp::Variable& var)
+// If a binding with the given name exists in the given list, remove it.
+void removeBindingFromList(std::vector<r::sexp::Binding>* pBindings,
+                           SEXP name)
 {
-   for (std::vector<r::sexp::Variable>::iterator iter = pEnv->begin();
-        iter != pEnv->end(); iter++)
+   for (std::vector<r::sexp::Binding>::iterator iter = pBindings->begin();
+        iter != pBindings->end(); iter++)
    {
-      if (iter->first == var.first)
+      if (iter->first == name)
       {
-         pEnv->erase(iter);
+         pBindings->erase(iter);
          break;
       }
    }
@@ -119,42 +112,25 @@ bool EnvironmentMonitor::hasEnvironment()
    return envir != nullptr && r::sexp::isPrimitiveEnvironment(envir);
 }
 
-void EnvironmentMonitor::listEnv(std::vector<r::sexp::Variable>* pEnv)
+void EnvironmentMonitor::listEnv(std::vector<r::sexp::Binding>* pEnv)
 {
    if (!hasEnvironment())
       return;
 
-   r::sexp::Protect rProtect;
-   r::sexp::listEnvironment(getMonitoredEnvironment(),
-                            false,
-                            prefs::userPrefs().showLastDotValue(),
-                            &rProtect,
-                            pEnv);
+   r::sexp::listEnvironmentBindings(getMonitoredEnvironment(),
+                                    false,
+                                    prefs::userPrefs().showLastDotValue(),
+                                    pEnv);
 }
 
 void EnvironmentMonitor::checkForChanges()
 {
-   // information about the current environment
-   std::vector<r::sexp::Variable> currentEnv;
-   std::vector<r::sexp::Variable> currentPromises;
-
-   // list of assigns/removes (includes both value changes and promise
-   // evaluations)
-   std::vector<r::sexp::Variable> addedVars;
-   std::vector<r::sexp::Variable> removedVars;
-
-   // get the set of variables and promises in the current environment
+   // the bindings in the current environment. names are CHARSXPs, which R
+   // caches, so bindings can be compared on their pointers alone and this
+   // check allocates nothing when the environment hasn't changed
+   std::vector<r::sexp::Binding> currentEnv;
    listEnv(&currentEnv);
 
-   // R returns an environment list sorted in dictionary order. Since the
-   // set difference algorithms below use simple string comparisons to
-   // establish order, we need to re-sort the list into canonical order
-   // to avoid the algorithms detecting superfluous insertions.
-   std::sort(currentEnv.begin(), currentEnv.end(), compareVarName);
-
-   std::for_each(currentEnv.begin(), currentEnv.end(),
-                 boost::bind(addUnevaledPromise, &currentPromises, _1));
-
    bool refreshEnqueued = false;
    if (!initialized_)
    {
@@ -166,80 +142,123 @@ void EnvironmentMonitor::checkForChanges()
       }
       initialized_ = true;
       refreshOnInit_ = false;
+
+      lastEnv_.clear();
+      lastEnv_.insert(currentEnv.begin(), currentEnv.end());
+      unevaledPromises_.clear();
+      for (const r::sexp::Binding& binding : currentEnv)
+      {
+         if (isUnevaluatedPromise(binding.second))
+            unevaledPromises_.push_back(binding);
+      }
+      return;
+   }
+
+   // find adds & assigns (name/value combinations which weren't in the
+   // previous environment); if every other binding is unchanged then
+   // nothing was removed either
+   std::vector<r::sexp::Binding> assigned;
+   std::size_t matched = 0;
+   for (const r::sexp::Binding& binding : currentEnv)
+   {
+      std::unordered_map<SEXP, SEXP>::const_iterator it = lastEnv_.find(binding.first);
+      if (it != lastEnv_.end())
+      {
+         ++matched;
+         if (it->second == binding.second)
+            continue;
+      }
+      assigned.push_back(binding);
+   }
+
+   std::vector<r::sexp::Binding> removed;
+   if (matched < lastEnv_.size())
+   {
+      std::unordered_map<SEXP, SEXP> current(currentEnv.begin(), currentEnv.end());
+      for (const std::pair<const SEXP, SEXP>& binding : lastEnv_)
+      {
+         if (current.find(binding.first) == current.end())
+            removed.push_back(binding);
+      }
    }
-   else
+
+   // list of assigns/removes (includes both value changes and promise
+   // evaluations)
+   std::vector<r::sexp::Variable> addedVars;
+   std::vector<r::sexp::Variable> removedVars;
+
+   if (!assigned.empty() || !removed.empty())
    {
-      if (currentEnv != lastEnv_)
+      // optimize for empty currentEnv (user reset workspace) or empty
+      // lastEnv_ (startup) by just sending a single refresh event
+      // only do this for the global environment--while debugging local
+      // environments, the environment object list is sent down as part of
+      // the context depth event.
+      if ((currentEnv.empty() || lastEnv_.empty())
+          && getMonitoredEnvironment() == R_GlobalEnv)
+      {
+         enqueRefreshEvent();
+         refreshEnqueued = true;
+      }
+      else
+      {
+         // fire removed event for deletes
+         for (const r::sexp::Binding& binding : removed)
+            removedVars.push_back(toVariable(binding.first, binding.second));
+         std::sort(removedVars.begin(), removedVars.end(), compareVarName);
+         std::for_each(removedVars.begin(),
+                       removedVars.end(),
+                       boost::bind(&EnvironmentMonitor::enqueRemovedEvent,
+                                   this, _1));
+
+         for (const r::sexp::Binding& binding : assigned)
+            addedVars.push_back(toVariable(binding.first, binding.second));
+      }
+
+      // remove deleted and assigned objects from the list of uneval'ed
+      // promises, so we'll stop monitoring them for evaluation (otherwise,
+      // we double-assign in the case where a promise SEXP is simultaneously
+      // forced/evaluated and assigned a new value)
+      for (const r::sexp::Binding& binding : removed)
       {
-         // optimize for empty currentEnv (user reset workspace) or empty
-         // lastEnv_ (startup) by just sending a single refresh event
-         // only do this for the global environment--while debugging local
-         // environments, the environment object list is sent down as part of
-         // the context depth event.
-         if ((currentEnv.empty() || lastEnv_.empty())
-             && getMonitoredEnvironment() == R_GlobalEnv)
-         {
-            enqueRefreshEvent();
-            refreshEnqueued = true;
-         }
-         else
-         {
-            std::set_difference(lastEnv_.begin(), lastEnv_.end(),
-                                currentEnv.begin(), currentEnv.end(),
-                                std::back_inserter(removedVars),
-                                compareVarName);
-
-            // fire removed event for deletes
-            std::for_each(removedVars.begin(),
-                          removedVars.end(),
-                          boost::bind(&EnvironmentMonitor::enqueRemovedEvent,
-                                      this, _1));
-
-            // remove deleted objects from the list of uneval'ed promises
-            // so we'll stop monitoring them for evaluation
-            std::for_each(removedVars.begin(),
-                          removedVars.end(),
-                          boost::bind(removeVarFromList, &unevaledPromises_, _1));
-
-            // find adds & assigns (all variable name/value combinations in the
-            // current environment but NOT in the previous environment)
-            std::set_difference(currentEnv.begin(), currentEnv.end(),
-                                lastEnv_.begin(), lastEnv_.end(),
-                                std::back_inserter(addedVars));
-
-            // remove assigned objects from the list of uneval'ed promises
-            // (otherwise, we double-assign in the case where a promise SEXP
-            // is simultaneously forced/evaluated and assigned a new value)
-            std::for_each(addedVars.begin(),
-                          addedVars.end(),
-                          boost::bind(removeVarFromList, &unevaledPromises_, _1));
-
-         }
+         removeBindingFromList(&unevaledPromises_, binding.first);
+         lastEnv_.erase(binding.first);
       }
-      // if a refresh is scheduled there's no need to emit add events one by one
-      if (!refreshEnqueued)
+      for (const r::sexp::Binding& binding : assigned)
       {
-         // have any promises been evaluated since we last checked?
-         if (currentPromises != unevaledPromises_)
-         {
-            // for each promise that is in the set of promises we are monitoring
-            // for evaluation but not in the set of currently tracked promises,
-            // we assume this to be an eval--process as an assign
-            std::set_difference(unevaledPromises_.begin(), unevaledPromises_.end(),
-                                currentPromises.begin(), currentPromises.end(),
-                                std::back_inserter(addedVars));
-         }
-
-         // fire assigned event for adds, assigns, and promise evaluations
-         std::for_each(addedVars.begin(),
-                       addedVars.end(),
-                       boost::bind(&EnvironmentMonitor::enqueAssignedEvent,
-                                    this, _1));
+         removeBindingFromList(&unevaledPromises_, binding.first);
+         lastEnv_[binding.first] = binding.second;
       }
    }
 
+   // have any promises been evaluated since we last checked? the promises
+   // remaining in the list are still bound, so any which are no longer
+   // unevaluated have been forced--process these as assigns
+   std::vector<r::sexp::Binding> currentPromises;
+   for (const r::sexp::Binding& binding : unevaledPromises_)
+   {
+      if (isUnevaluatedPromise(binding.second))
+         currentPromises.push_back(binding);
+      else
+         addedVars.push_back(toVariable(binding.first, binding.second));
+   }
+   for (const r::sexp::Binding& binding : assigned)
+   {
+      if (isUnevaluatedPromise(binding.second))
+         currentPromises.push_back(binding);
+   }
    unevaledPromises_ = currentPromises;
-   lastEnv_ = currentEnv;
+
+   // if a refresh is scheduled there's no need to emit add events one by one
+   if (!refreshEnqueued)
+   {
+      // fire assigned event for adds, assigns, and promise evaluations
+      std::sort(addedVars.begin(), addedVars.end(), compareVarName);
+      std::for_each(addedVars.begin(),
+                    addedVars.end(),
+                    boost::bind(&EnvironmentMonitor::enqueAssignedEvent,
+                                 this, _1));
+   }
 }
 
 } // namespace environment
@@ -13,6 +13,8 @@
  *
  */
 
+#include <unordered_map>
+
 #include <r/RSexp.hpp>
 #include <r/RInterface.hpp>
 
@@ -35,12 +37,13 @@ public:
    bool hasEnvironment();
    void checkForChanges();
 private:
-   void listEnv(std::vector<r::sexp::Variable>* pEnvironment);
+   void listEnv(std::vector<r::sexp::Binding>* pEnvironment);
    void enqueRemovedEvent(const r::sexp::Variable& variable);
    void enqueAssignedEvent(const r::sexp::Variable& variable);
 
-   std::vector<r::sexp::Variable> lastEnv_;
-   std::vector<r::sexp::Variable> unevaledPromises_;
+   // the value bound to each name (a CHARSXP) when we last checked
+   std::unordered_map<SEXP, SEXP> lastEnv_;
+   std::vector<r::sexp::Binding> unevaledPromises_;
    r::sexp::PreservedSEXP environment_;
    bool initialized_;
    bool refreshOnInit_;
@@ -0,0 +1,129 @@
+/*
+ * EnvironmentMonitorTests.cpp
+ *
+ * Copyright (C) 2022 by RStudio, PBC
+ *
+ * Unless you have received this program directly from RStudio pursuant
+ * to the terms of a commercial license agreement with RStudio, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <tests/TestThat.hpp>
+
+#include <chrono>
+#include <iostream>
+
+#include <core/Log.hpp>
+
+#define R_INTERNAL_FUNCTIONS
+#include <r/RInternal.hpp>
+#include <r/RExec.hpp>
+#include <r/RSexp.hpp>
+
+#include "EnvironmentMonitor.hpp"
+
+using namespace rstudio::core;
+
+namespace rstudio {
+namespace session {
+namespace modules {
+namespace environment {
+namespace tests {
+
+namespace {
+
+SEXP createEnvironment(std::size_t size, r::sexp::Protect* pProtect)
+{
+   SEXP envSEXP = R_NilValue;
+   Error error = r::exec::RFunction("new.env").call(&envSEXP, pProtect);
+   if (error)
+      LOG_ERROR(error);
+
+   for (std::size_t i = 0; i < size; ++i)
+   {
+      std::string name = "var" + std::to_string(i);
+      Rf_defineVar(Rf_install(name.c_str()), Rf_ScalarInteger(static_cast<int>(i)), envSEXP);
+   }
+
+   return envSEXP;
+}
+
+double secondsSince(const std::chrono::steady_clock::time_point& start)
+{
+   return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // anonymous namespace
+
+test_context("EnvironmentMonitor")
+{
+   test_that("Environment bindings are listed by name")
+   {
+      r::sexp::Protect protect;
+      SEXP envSEXP = createEnvironment(10, &protect);
+
+      std::vector<r::sexp::Binding> bindings;
+      r::sexp::listEnvironmentBindings(envSEXP, false, false, &bindings);
+      expect_true(bindings.size() == 10);
+
+      // names share the address of the symbol's name
+      SEXP nameSEXP = PRINTNAME(Rf_install("var3"));
+      bool found = false;
+      for (const r::sexp::Binding& binding : bindings)
+      {
+         if (binding.first == nameSEXP)
+         {
+            found = true;
+            expect_true(r::sexp::asInteger(binding.second) == 3);
+         }
+      }
+      expect_true(found);
+
+      // reassignments are seen as new values
+      Rf_defineVar(Rf_install("var3"), Rf_ScalarInteger(42), envSEXP);
+      std::vector<r::sexp::Binding> updated;
+      r::sexp::listEnvironmentBindings(envSEXP, false, false, &updated);
+      expect_true(updated.size() == 10);
+      expect_false(updated == bindings);
+   }
+}
+
+TEST_CASE("EnvironmentMonitor benchmark", "[.benchmark]")
+{
+   for (std::size_t size : { 1000, 10000, 100000 })
+   {
+      r::sexp::Protect protect;
+      SEXP envSEXP = createEnvironment(size, &protect);
+
+      EnvironmentMonitor monitor;
+      monitor.setMonitoredEnvironment(envSEXP);
+
+      const int iterations = 100;
+      auto start = std::chrono::steady_clock::now();
+      for (int i = 0; i < iterations; ++i)
+         monitor.checkForChanges();
+      double unchanged = secondsSince(start) / iterations;
+
+      start = std::chrono::steady_clock::now();
+      for (int i = 0; i < iterations; ++i)
+      {
+         Rf_defineVar(Rf_install("var0"), Rf_ScalarInteger(i), envSEXP);
+         monitor.checkForChanges();
+      }
+      double changed = secondsSince(start) / iterations;
+
+      std::cout << size << " bindings: " << unchanged * 1000 << "ms unchanged, "
+                << changed * 1000 << "ms with one assignment" << std::endl;
+   }
+}
+
+} // namespace tests
+} // namespace environment
+} // namespace modules
+} // namespace session
+} // namespace rstudio
@@ -600,14 +600,15 @@ void ProjectContext::fileMonitorRegistered(
 void ProjectContext::fileMonitorFilesChanged(
                    const std::vector<core::system::FileChangeEvent>& events)
 {
+   // notify subscribers (first, so that state they keep about the files,
+   // e.g. their git status, is current when the client is told of them)
+   onFilesChanged_(events);
+
    // notify client (gwt)
    module_context::enqueFileChangedEvents(directory(), events);
 
    // own handler
    onProjectFilesChanged(events);
-
-   // notify subscribers
-   onFilesChanged_(events);
 }
 
 void ProjectContext::fileMonitorTermination(const Error& error)
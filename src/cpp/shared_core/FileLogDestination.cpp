@@ -26,6 +26,9 @@
 #include <boost/algorithm/string.hpp>
 #include <boost/thread.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <memory>
 #include <vector>
 
 #include <shared_core/DateTime.hpp>
@@ -34,6 +37,12 @@
 #include <shared_core/SafeConvert.hpp>
 
 #ifndef _WIN32
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
 #include <shared_core/system/PosixSystem.hpp>
 #include <shared_core/system/SyslogDestination.hpp>
 #endif
@@ -55,7 +64,8 @@ FileLogOptions::FileLogOptions(FilePath in_directory) :
    m_doRotation(s_defaultDoRotation),
    m_includePid(s_defaultIncludePid),
    m_warnSyslog(s_defaultWarnSyslog),
-   m_forceDirectory(s_defaultForceDirectory)
+   m_forceDirectory(s_defaultForceDirectory),
+   m_asyncWrite(s_defaultAsyncWrite)
 {
 }
 
@@ -70,7 +80,8 @@ FileLogOptions::FileLogOptions(FilePath in_directory,
    m_doRotation(s_defaultDoRotation),
    m_includePid(s_defaultIncludePid),
    m_warnSyslog(in_warnSyslog),
-   m_forceDirectory(s_defaultForceDirectory)
+   m_forceDirectory(s_defaultForceDirectory),
+   m_asyncWrite(s_defaultAsyncWrite)
 {
 }
 
@@ -84,7 +95,8 @@ FileLogOptions::FileLogOptions(
    bool in_doRotation,
    bool in_includePid,
    bool in_warnSyslog,
-   bool in_forceDirectory) :
+   bool in_forceDirectory,
+   bool in_asyncWrite) :
       m_directory(std::move(in_directory)),
       m_fileMode(std::move(in_fileMode)),
       m_maxSizeMb(in_maxSizeMb),
@@ -94,7 +106,8 @@ FileLogOptions::FileLogOptions(
       m_doRotation(in_doRotation),
       m_includePid(in_includePid),
       m_warnSyslog(in_warnSyslog),
-      m_forceDirectory(in_forceDirectory)
+      m_forceDirectory(in_forceDirectory),
+      m_asyncWrite(in_asyncWrite)
 {
 }
 
@@ -133,6 +146,11 @@ int FileLogOptions::getRotationDays() const
    return m_rotationDays;
 }
 
+bool FileLogOptions::asyncWrite() const
+{
+   return m_asyncWrite;
+}
+
 bool FileLogOptions::doRotation() const
 {
    return m_doRotation;
@@ -148,6 +166,11 @@ bool FileLogOptions::includePid() const
    return m_includePid;
 }
 
+void FileLogOptions::setAsyncWrite(bool in_asyncWrite)
+{
+   m_asyncWrite = in_asyncWrite;
+}
+
 void FileLogOptions::setDeletionDays(int in_deletionDays)
 {
    m_deletionDays = in_deletionDays;
@@ -193,6 +216,100 @@ void FileLogOptions::setWarnSyslog(bool in_warnSyslog)
    m_warnSyslog = in_warnSyslog;
 }
 
+// MessageQueue ========================================================================================================
+namespace {
+
+/**
+ * @brief Bounded lock-free queue of log messages, to which any number of threads may write and from which a single
+ *        thread reads.
+ *
+ * Each slot has a sequence number which tells writers and the reader whose turn it is to use the slot.
+ */
+class MessageQueue
+{
+public:
+   explicit MessageQueue(std::size_t in_capacity) :
+      m_slots(new Slot[in_capacity]),
+      m_mask(in_capacity - 1),
+      m_writePos(0),
+      m_readPos(0)
+   {
+      // The capacity must be a power of two.
+      for (std::size_t i = 0; i < in_capacity; ++i)
+         m_slots[i].Sequence.store(i, std::memory_order_relaxed);
+   }
+
+   // Returns false if the queue is full; the message is moved from on success.
+   bool tryPush(std::string& io_message)
+   {
+      std::size_t pos = m_writePos.load(std::memory_order_relaxed);
+      Slot* slot;
+      for (;;)
+      {
+         slot = &m_slots[pos & m_mask];
+         std::size_t sequence = slot->Sequence.load(std::memory_order_acquire);
+         std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos);
+         if (diff == 0)
+         {
+            // The slot is free - claim it (unless another writer beat us to it).
+            if (m_writePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+               break;
+         }
+         else if (diff < 0)
+         {
+            // The reader has not yet taken the message from the slot.
+            return false;
+         }
+         else
+         {
+            pos = m_writePos.load(std::memory_order_relaxed);
+         }
+      }
+
+      slot->Message = std::move(io_message);
+      slot->Sequence.store(pos + 1, std::memory_order_release);
+      return true;
+   }
+
+   // Returns false if the queue is empty. Must only be called by one thread.
+   bool tryPop(std::string& out_message)
+   {
+      std::size_t pos = m_readPos.load(std::memory_order_relaxed);
+      Slot& slot = m_slots[pos & m_mask];
+      if (slot.Sequence.load(std::memory_order_acquire) != pos + 1)
+         return false;
+
+      out_message = std::move(slot.Message);
+      slot.Message.clear();
+      slot.Sequence.store(pos + m_mask + 1, std::memory_order_release);
+      m_readPos.store(pos + 1, std::memory_order_relaxed);
+      return true;
+   }
+
+private:
+   struct Slot
+   {
+      std::atomic<std::size_t> Sequence;
+      std::string Message;
+   };
+
+   std::unique_ptr<Slot[]> m_slots;
+   const std::size_t m_mask;
+   std::atomic<std::size_t> m_writePos;
+   std::atomic<std::size_t> m_readPos;
+};
+
+// The number of messages which may be queued before logging threads must wait for the writer.
+constexpr std::size_t s_queueCapacity = 8192;
+
+// The most messages written to the file at once.
+constexpr std::size_t s_maxBatchSize = 1024;
+
+// How often queued messages are written, unless an error is logged (which is written immediately).
+constexpr int s_writeIntervalMs = 100;
+
+} // anonymous namespace
+
 // FileLogDestination ==================================================================================================
 struct FileLogDestination::Impl
 {
@@ -259,6 +376,7 @@ struct FileLogDestination::Impl
 
    ~Impl()
    {
+      stopWriter();
       closeLogFile();
    }
 
@@ -535,6 +653,187 @@ struct FileLogDestination::Impl
       }
    }
 
+   void startWriter()
+   {
+      Queue.reset(new MessageQueue(s_queueCapacity));
+      Stopping = false;
+      WakeRequested = false;
+#ifndef _WIN32
+      WriterPid = ::getpid();
+#endif
+      Writer.reset(new boost::thread(&Impl::runWriter, this));
+   }
+
+   void stopWriter()
+   {
+      if (!Writer)
+         return;
+
+#ifndef _WIN32
+      // If we have forked, the writer thread belongs to the parent process, so it cannot be joined (and its queued
+      // messages will be written by the parent).
+      if (WriterPid != ::getpid())
+      {
+         Writer.release();
+         Queue.reset();
+         return;
+      }
+#endif
+
+      {
+         boost::lock_guard<boost::mutex> lock(WakeMutex);
+         Stopping = true;
+      }
+      WakeCondition.notify_one();
+      Writer->join();
+      Writer.reset();
+      Queue.reset();
+   }
+
+   // Whether there's a writer thread in this process (a forked child has none until it is refreshed).
+   bool hasWriter() const
+   {
+      if (!Writer)
+         return false;
+
+#ifndef _WIN32
+      return WriterPid == ::getpid();
+#else
+      return true;
+#endif
+   }
+
+   void wakeWriter()
+   {
+      // Request the wakeup under the mutex so that it can't be missed by a writer just about to wait.
+      {
+         boost::lock_guard<boost::mutex> lock(WakeMutex);
+         WakeRequested = true;
+      }
+      WakeCondition.notify_one();
+   }
+
+   void enqueue(LogLevel in_logLevel, const std::string& in_message)
+   {
+      std::string message = in_message;
+      while (!Queue->tryPush(message))
+      {
+         // The queue is full, so wait for the writer to make room.
+         wakeWriter();
+         boost::this_thread::yield();
+      }
+
+      if (in_logLevel == LogLevel::ERR)
+         wakeWriter();
+   }
+
+   void runWriter()
+   {
+#ifndef _WIN32
+      // Leave signals to the threads which are meant to handle them.
+      sigset_t signals;
+      ::sigfillset(&signals);
+      ::pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+#endif
+
+      std::vector<std::string> batch;
+      for (;;)
+      {
+         bool stopping;
+         {
+            boost::unique_lock<boost::mutex> lock(WakeMutex);
+            if (!WakeRequested && !Stopping)
+               WakeCondition.timed_wait(lock, boost::posix_time::milliseconds(s_writeIntervalMs));
+            WakeRequested = false;
+            stopping = Stopping;
+         }
+
+         std::string message;
+         while (Queue->tryPop(message))
+         {
+            batch.push_back(std::move(message));
+            if (batch.size() == s_maxBatchSize)
+               writeBatch(batch);
+         }
+
+         if (!batch.empty())
+            writeBatch(batch);
+
+         if (stopping)
+            break;
+      }
+   }
+
+   // Writes (and clears) a batch of messages.
+   void writeBatch(std::vector<std::string>& io_batch)
+   {
+      try
+      {
+         boost::lock_guard<boost::mutex> lock(Mutex);
+
+         if (verifyLogFilePath() && rotateLogFile())
+         {
+#ifndef _WIN32
+            if (!LogFile.ensureFile())
+            {
+               LogFile.changeFileMode(LogOptions.getFileMode());
+
+               int fd = ::open(LogFile.getAbsolutePath().c_str(), O_WRONLY | O_APPEND | O_CLOEXEC);
+               if (fd != -1)
+               {
+                  std::vector<iovec> buffers;
+                  buffers.reserve(io_batch.size());
+                  for (const std::string& message : io_batch)
+                  {
+                     iovec buffer = { const_cast<char*>(message.data()), message.size() };
+                     buffers.push_back(buffer);
+                  }
+
+                  std::size_t index = 0;
+                  while (index < buffers.size())
+                  {
+                     int count = static_cast<int>(std::min<std::size_t>(buffers.size() - index, IOV_MAX));
+                     ssize_t written = ::writev(fd, &buffers[index], count);
+                     if (written < 0)
+                     {
+                        if (errno == EINTR)
+                           continue;
+                        break;
+                     }
+
+                     // Skip past what was written (which may end part way through a message).
+                     std::size_t remaining = static_cast<std::size_t>(written);
+                     while (index < buffers.size() && remaining >= buffers[index].iov_len)
+                        remaining -= buffers[index++].iov_len;
+
+                     if (remaining > 0)
+                     {
+                        buffers[index].iov_base = static_cast<char*>(buffers[index].iov_base) + remaining;
+                        buffers[index].iov_len -= remaining;
+                     }
+                  }
+
+                  ::close(fd);
+               }
+            }
+#else
+            if (openLogFile())
+            {
+               for (const std::string& message : io_batch)
+                  (*LogOutputStream) << message;
+            }
+            closeLogFile();
+#endif
+         }
+      }
+      catch (...)
+      {
+         // Swallow exceptions because we'd trigger recursive logging otherwise.
+      }
+
+      io_batch.clear();
+   }
+
    FileLogOptions LogOptions;
    FilePath LogFile;
    std::string LogName;
@@ -542,6 +841,17 @@ struct FileLogDestination::Impl
    std::shared_ptr<std::ostream> LogOutputStream;
    boost::optional<boost::posix_time::ptime> FirstLogLineTime;
 
+   // Asynchronous writes.
+   std::unique_ptr<MessageQueue> Queue;
+   std::unique_ptr<boost::thread> Writer;
+   boost::mutex WakeMutex;
+   boost::condition_variable WakeCondition;
+   std::atomic<bool> WakeRequested;
+   std::atomic<bool> Stopping;
+#ifndef _WIN32
+   pid_t WriterPid = 0;
+#endif
+
 #ifndef _WIN32
    std::shared_ptr<core::system::SyslogDestination> SyslogDest;
 #endif
@@ -567,10 +877,16 @@ FileLogDestination::FileLogDestination(
                in_id, log::LogLevel::WARN, in_formatType, in_programId);
    }
 #endif
+
+   if (m_impl->LogOptions.asyncWrite())
+      m_impl->startWriter();
 }
 
 FileLogDestination::~FileLogDestination()
 {
+   // Write any queued messages.
+   m_impl->stopWriter();
+
    if (m_impl->LogOutputStream.get())
       m_impl->LogOutputStream->flush();
 }
@@ -598,6 +914,13 @@ void FileLogDestination::refresh(const RefreshParams& in_refreshParams)
 
    if (m_impl->SyslogDest)
       m_impl->SyslogDest->refresh();
+
+   // If we have forked, start a writer for this process.
+   if (m_impl->Writer && m_impl->WriterPid != ::getpid())
+   {
+      m_impl->stopWriter();
+      m_impl->startWriter();
+   }
 #endif
 }
 
@@ -607,6 +930,29 @@ void FileLogDestination::writeLog(LogLevel in_logLevel, const std::string& in_me
    if (in_logLevel > m_logLevel)
       return;
 
+   // Leave the write to the writer thread if there is one. (If we have forked and not yet been refreshed, the writer
+   // thread belongs to the parent, so write synchronously instead.)
+   if (m_impl->hasWriter())
+   {
+      try
+      {
+#ifndef _WIN32
+         if (in_logLevel <= LogLevel::WARN && m_impl->SyslogDest)
+         {
+            boost::lock_guard<boost::mutex> lock(m_impl->Mutex);
+            m_impl->SyslogDest->writeLog(in_logLevel, in_message);
+         }
+#endif
+
+         m_impl->enqueue(in_logLevel, in_message);
+      }
+      catch (...)
+      {
+         // Swallow exceptions because we'd trigger recursive logging otherwise.
+      }
+      return;
+   }
+
    // Lock the mutex before attempting to write.
    try
    {
@@ -74,6 +74,7 @@ public:
     * @param in_includePid        Whether to include the PID of the process in the log filename.
     * @param in_warnSyslog        Whether or not to also send warn/error logs to syslog for admin visibility.
     * @param in_forceLogDirectory Whether or not the log directory is forced, preventing user override.
+    * @param in_asyncWrite        Whether log messages should be written to the file by a background thread.
     */
    FileLogOptions(
       FilePath in_directory,
@@ -85,7 +86,8 @@ public:
       bool in_doRotation,
       bool in_includePid,
       bool in_warnSyslog,
-      bool in_forceLogDirectory);
+      bool in_forceLogDirectory,
+      bool in_asyncWrite = false);
 
    /**
     * @brief Gets the number of days a rotated log file should persist before being deleted.
@@ -136,6 +138,14 @@ public:
     */
    int getRotationDays() const;
 
+   /**
+    * @brief Returns whether log messages should be queued and written to the file in batches by a background thread,
+    *        rather than written (and flushed) by the logging thread.
+    *
+    * @return True if log messages should be written by a background thread; false otherwise.
+    */
+   bool asyncWrite() const;
+
    /**
     * @brief Returns whether or not to rotate log files before overwriting them.
     *
@@ -157,6 +167,13 @@ public:
     */
    bool warnSyslog() const;
 
+   /**
+    * @brief Sets whether log messages should be written to the file by a background thread.
+    *
+    * @param in_asyncWrite     Whether log messages should be written to the file by a background thread.
+    */
+   void setAsyncWrite(bool in_asyncWrite);
+
    /**
     * @brief Sets the number of days a rotated log file should persist before being deleted.
     *
@@ -242,6 +259,7 @@ private:
    static constexpr bool s_defaultIncludePid = false;
    static constexpr bool s_defaultWarnSyslog = true;
    static constexpr bool s_defaultForceDirectory = false;
+   static constexpr bool s_defaultAsyncWrite = false;
 
    // The directory where log files should be written.
    FilePath m_directory;
@@ -272,6 +290,9 @@ private:
 
    // Whether or not to force the directory to prevent user override.
    bool m_forceDirectory;
+
+   // Whether to write log messages from a background thread.
+   bool m_asyncWrite;
 };
 
 /**
@@ -294,6 +315,10 @@ public:
     *
     * If the log file cannot be opened, no logs will be written to the file. If there are other log destinations
     * registered an error will be logged regarding the failure.
+    *
+    * If asynchronous writes are enabled in the log options, messages are queued and written to the file in batches
+    * by a background thread, which is woken immediately for errors and otherwise writes at a short interval. After a
+    * fork, refresh must be called in the child process to start its own background thread.
     */
    FileLogDestination(
       const std::string& in_id,
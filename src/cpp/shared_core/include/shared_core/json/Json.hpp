@@ -86,6 +86,8 @@ protected:
    typedef std::shared_ptr<Impl> ValueImplPtr;
 
    friend class Array;
+   friend class Object;
+   friend class StreamWriter;
 
 public:
    /**
@@ -1040,6 +1042,15 @@ public:
     */
    void insert(const std::string& in_name, const Value& in_value);
 
+   /**
+    * @brief Inserts the specified member into this JSON object by moving the value rather than copying it. If an object
+    *        with the same name already exists, it will be overridden.
+    *
+    * @param in_name        The name of the JSON value to insert.
+    * @param in_value       The value to insert. It will be null after the insertion.
+    */
+   void insert(const std::string& in_name, Value&& in_value);
+
    /**
     * @brief Inserts the specified member into this JSON object. If an object with the same name already exists, it will be
     *        overridden.
@@ -1130,6 +1141,15 @@ public:
     */
    void insert(const std::string& in_name, const Array& in_value);
 
+   /**
+    * @brief Inserts the specified member into this JSON object by moving the value rather than copying it. If an object
+    *        with the same name already exists, it will be overridden.
+    *
+    * @param in_name        The name of the JSON value to insert.
+    * @param in_value       The value to insert. It will be null after the insertion.
+    */
+   void insert(const std::string& in_name, Array&& in_value);
+
    /**
     * @brief Inserts the specified member into this JSON object. If an object with the same name already exists, it will be
     *        overridden.
@@ -1139,6 +1159,15 @@ public:
     */
    void insert(const std::string& in_name, const Object& in_value);
 
+   /**
+    * @brief Inserts the specified member into this JSON object by moving the value rather than copying it. If an object
+    *        with the same name already exists, it will be overridden.
+    *
+    * @param in_name        The name of the JSON value to insert.
+    * @param in_value       The value to insert. It will be null after the insertion.
+    */
+   void insert(const std::string& in_name, Object&& in_value);
+
    /**
     * @brief Inserts the specified member into this JSON object. If an object with the same name already exists, it will be
     *        overridden.
@@ -1494,6 +1523,16 @@ public:
     */
    void push_back(const Value& in_value);
 
+   /**
+    * @brief Pushes the value onto the end of the JSON array by moving it rather than copying it.
+    *
+    * MAINTENANCE NOTE: This method must be named in the STL style to work with STL functions and types such as
+    * std::back_inserter.
+    *
+    * @param in_value   The value to push onto the end of the JSON array. It will be null after the push.
+    */
+   void push_back(Value&& in_value);
+
    /**
     * @brief Pushes the value onto the end of the JSON array.
     *
@@ -1594,6 +1633,16 @@ public:
     */
    void push_back(const Array& in_value);
 
+   /**
+    * @brief Pushes the value onto the end of the JSON array by moving it rather than copying it.
+    *
+    * MAINTENANCE NOTE: This method must be named in the STL style to work with STL functions and types such as
+    * std::back_inserter.
+    *
+    * @param in_value   The value to push onto the end of the JSON array. It will be null after the push.
+    */
+   void push_back(Array&& in_value);
+
    /**
     * @brief Pushes the value onto the end of the JSON array.
     *
@@ -1604,6 +1653,16 @@ public:
     */
    void push_back(const Object& in_value);
 
+   /**
+    * @brief Pushes the value onto the end of the JSON array by moving it rather than copying it.
+    *
+    * MAINTENANCE NOTE: This method must be named in the STL style to work with STL functions and types such as
+    * std::back_inserter.
+    *
+    * @param in_value   The value to push onto the end of the JSON array. It will be null after the push.
+    */
+   void push_back(Object&& in_value);
+
    /**
     * @brief Converts this JSON array to a set of strings.
     *
@@ -1651,6 +1710,130 @@ private:
    friend class Value;
 };
 
+/**
+ * @brief SAX-style writer which serializes JSON directly into a string, without first building a json::Value tree or
+ *        an intermediate serialized copy. Complete json::Values may be interleaved with the streamed tokens.
+ *
+ * The caller is responsible for producing well-formed JSON (e.g. every startObject must be matched by an endObject, and
+ * every object member must be preceded by a call to key).
+ */
+class StreamWriter
+{
+public:
+   /**
+    * @brief Constructor.
+    *
+    * @param io_pOutput     The string to which serialized JSON will be appended. It must outlive this writer.
+    */
+   explicit StreamWriter(std::string* io_pOutput);
+
+   /**
+    * @brief Begins a JSON object.
+    */
+   void startObject();
+
+   /**
+    * @brief Ends the current JSON object.
+    */
+   void endObject();
+
+   /**
+    * @brief Begins a JSON array.
+    */
+   void startArray();
+
+   /**
+    * @brief Ends the current JSON array.
+    */
+   void endArray();
+
+   /**
+    * @brief Writes the name of the next member of the current JSON object.
+    *
+    * @param in_name        The name of the member.
+    */
+   void key(const std::string& in_name);
+
+   /**
+    * @brief Writes a JSON null value.
+    */
+   void writeNull();
+
+   /**
+    * @brief Writes a JSON value.
+    *
+    * @param in_value       The value to write.
+    */
+   void write(bool in_value);
+
+   /**
+    * @brief Writes a JSON value.
+    *
+    * @param in_value       The value to write.
+    */
+   void write(double in_value);
+
+   /**
+    * @brief Writes a JSON value.
+    *
+    * @param in_value       The value to write.
+    */
+   void write(int in_value);
+
+   /**
+    * @brief Writes a JSON value.
+    *
+    * @param in_value       The value to write.
+    */
+   void write(int64_t in_value);
+
+   /**
+    * @brief Writes a JSON value.
+    *
+    * @param in_value       The value to write.
+    */
+   void write(unsigned int in_value);
+
+   /**
+    * @brief Writes a JSON value.
+    *
+    * @param in_value       The value to write.
+    */
+   void write(uint64_t in_value);
+
+   /**
+    * @brief Writes a JSON value.
+    *
+    * @param in_value       The value to write.
+    */
+   void write(const char* in_value);
+
+   /**
+    * @brief Writes a JSON value.
+    *
+    * @param in_value       The value to write.
+    */
+   void write(const std::string& in_value);
+
+   /**
+    * @brief Writes a complete JSON value (including all of its children).
+    *
+    * @param in_value       The value to write.
+    */
+   void write(const Value& in_value);
+
+   /**
+    * @brief Checks whether a complete JSON value has been written.
+    *
+    * @return True if the written JSON is a complete value; false otherwise.
+    */
+   bool isComplete() const;
+
+private:
+   // The writer's private implementation.
+   PRIVATE_IMPL(m_impl);
+};
+
 /**
  * @brief Checks whether the specified JSON value is of the type specified in the template parameter.
  *
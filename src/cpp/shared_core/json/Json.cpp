@@ -148,6 +148,32 @@ namespace {
 
 rapidjson::CrtAllocator s_allocator;
 
+// containers built up member by member keep rapidjson's growth slack (at least
+// 16 slots); when such a value is moved into a parent its top level is
+// repacked so large documents don't retain that slack. the members themselves
+// are moved, not copied
+JsonValue& compact(JsonValue& io_value)
+{
+   if (io_value.IsObject() && io_value.MemberCapacity() > io_value.MemberCount())
+   {
+      JsonValue packed(rapidjson::kObjectType);
+      packed.MemberReserve(io_value.MemberCount(), s_allocator);
+      for (auto itr = io_value.MemberBegin(); itr != io_value.MemberEnd(); ++itr)
+         packed.AddMember(itr->name, itr->value, s_allocator);
+      io_value = packed;
+   }
+   else if (io_value.IsArray() && io_value.Capacity() > io_value.Size())
+   {
+      JsonValue packed(rapidjson::kArrayType);
+      packed.Reserve(io_value.Size(), s_allocator);
+      for (auto itr = io_value.Begin(); itr != io_value.End(); ++itr)
+         packed.PushBack(*itr, s_allocator);
+      io_value = packed;
+   }
+
+   return io_value;
+}
+
 Object getSchemaDefaults(const Object& schema)
 {
    Object result;
@@ -204,12 +230,15 @@ Object getSchemaDefaults(const Object& schema)
 struct Value::Impl
 {
    Impl() :
-      Document(new JsonDocument(&s_allocator))
+      Document(std::make_shared<JsonDocument>(&s_allocator)),
+      OwnsDocument(true)
    {
    }
 
+   // (refers to a value within another value's document)
    explicit Impl(const std::shared_ptr<JsonDocument>& in_jsonDocument) :
-      Document(in_jsonDocument)
+      Document(in_jsonDocument),
+      OwnsDocument(false)
    {
    }
 
@@ -218,11 +247,23 @@ struct Value::Impl
       Document->CopyFrom(*in_other.Document, s_allocator);
    }
 
+   // a value can only be moved from if nothing else refers to it: values
+   // within a parent document (e.g. from Member::getValue() or
+   // Array::operator[]) and those sharing another value's implementation
+   // (e.g. from Value::getObject()) must be copied instead
+   static bool canMoveFrom(const std::shared_ptr<Impl>& in_impl)
+   {
+      return in_impl.use_count() == 1 &&
+             in_impl->OwnsDocument &&
+             in_impl->Document.use_count() == 1;
+   }
+
    std::shared_ptr<JsonDocument> Document;
+   bool OwnsDocument;
 };
 
 Value::Value() :
-   m_impl(new Impl())
+   m_impl(std::make_shared<Impl>())
 {
 }
 
@@ -819,6 +860,12 @@ void Value::writeFormatted(std::ostream& os) const
 
 void Value::move(Value&& in_other)
 {
+   if (!Impl::canMoveFrom(in_other.m_impl))
+   {
+      m_impl->copy(*in_other.m_impl);
+      return;
+   }
+
    // rapidjson copy is a move operation
    // only move the underlying value (and none of the document members)
    // because we do not want to move the allocators (as they are the same and rapidjson cannot
@@ -851,7 +898,7 @@ const std::string& Object::Member::getName() const
 
 Value Object::Member::getValue() const
 {
-   return Value(ValueImplPtr(new Value::Impl(m_impl->Document)));
+   return Value(std::make_shared<Value::Impl>(m_impl->Document));
 }
 
 // Object Iterator =====================================================================================================
@@ -944,7 +991,7 @@ Object::Object(const Object& in_other) :
 }
 
 Object::Object(Object&& in_other) noexcept :
-   Value(in_other)
+   Value(std::move(in_other))
 {
 }
 
@@ -1023,12 +1070,12 @@ Value Object::operator[](const char* in_name)
    JsonDocument& doc = *m_impl->Document;
    if (!doc.HasMember(in_name))
    {
-      doc.AddMember(JsonValue(in_name, s_allocator), JsonDocument(), s_allocator);
+      doc.AddMember(JsonValue(in_name, s_allocator), JsonValue(), s_allocator);
    }
 
    JsonDocument& docRef = static_cast<JsonDocument&>(doc.FindMember(in_name)->value);
    std::shared_ptr<JsonDocument> docPtr(m_impl->Document, &docRef);
-   return Value(ValueImplPtr(new Impl(docPtr)));
+   return Value(std::make_shared<Impl>(docPtr));
 }
 
 Value Object::operator[](const std::string& in_name)
@@ -1112,6 +1159,26 @@ void Object::insert(const std::string& in_name, const Value& in_value)
    (*this)[in_name] = in_value;
 }
 
+void Object::insert(const std::string& in_name, Value&& in_value)
+{
+   if (!Impl::canMoveFrom(in_value.m_impl))
+   {
+      insert(in_name, static_cast<const Value&>(in_value));
+      return;
+   }
+
+   // all documents share s_allocator so the underlying value can be moved
+   // into this object rather than deep copied
+   JsonDocument& doc = *m_impl->Document;
+   JsonValue& value = compact(*in_value.m_impl->Document);
+
+   auto itr = doc.FindMember(in_name.c_str());
+   if (itr == doc.MemberEnd())
+      doc.AddMember(JsonValue(in_name.c_str(), s_allocator), value, s_allocator);
+   else
+      itr->value = value;
+}
+
 void Object::insert(const std::string& in_name, bool in_value)
 {
    insert(in_name, json::Value(in_value));
@@ -1159,12 +1226,22 @@ void Object::insert(const std::string& in_name, uint64_t in_value)
 
 void Object::insert(const std::string& in_name, const Array& in_value)
 {
-   insert(in_name, json::Value(in_value));
+   insert(in_name, static_cast<const Value&>(in_value));
+}
+
+void Object::insert(const std::string& in_name, Array&& in_value)
+{
+   insert(in_name, static_cast<Value&&>(in_value));
 }
 
 void Object::insert(const std::string& in_name, const Object& in_value)
 {
-   insert(in_name, json::Value(in_value));
+   insert(in_name, static_cast<const Value&>(in_value));
+}
+
+void Object::insert(const std::string& in_name, Object&& in_value)
+{
+   insert(in_name, static_cast<Value&&>(in_value));
 }
 
 void Object::insert(const Member& in_member)
@@ -1296,7 +1373,7 @@ Array::Iterator::reference Array::Iterator::operator*() const
    JsonDocument& docRef = static_cast<JsonDocument&>(*internalItr);
    std::shared_ptr<JsonDocument> docPtr(m_parent->m_impl->Document, &docRef);
 
-   return Value(ValueImplPtr(new Impl(docPtr)));
+   return Value(std::make_shared<Impl>(docPtr));
 }
 
 // Array ===============================================================================================================
@@ -1333,7 +1410,7 @@ Array::Array(const Array& in_other) :
 }
 
 Array::Array(Array&& in_other) noexcept :
-   Value(in_other)
+   Value(std::move(in_other))
 {
 }
 
@@ -1354,7 +1431,7 @@ Value Array::operator[](size_t in_index) const
    JsonDocument& docRef = static_cast<JsonDocument&>((*m_impl->Document)[in_index]);
    std::shared_ptr<JsonDocument> docPtr(m_impl->Document, &docRef);
 
-   return Value(ValueImplPtr(new Impl(docPtr)));
+   return Value(std::make_shared<Impl>(docPtr));
 }
 
 Array::Iterator Array::begin() const
@@ -1446,64 +1523,88 @@ Error Array::parse(const std::string& in_jsonStr)
 
 void Array::push_back(const Value& in_value)
 {
-   JsonDocument doc;
-   doc.CopyFrom(*in_value.m_impl->Document, s_allocator);
-   m_impl->Document->PushBack(doc, s_allocator);
+   JsonValue value(*in_value.m_impl->Document, s_allocator);
+   m_impl->Document->PushBack(value, s_allocator);
+}
+
+void Array::push_back(Value&& in_value)
+{
+   if (!Impl::canMoveFrom(in_value.m_impl))
+   {
+      push_back(static_cast<const Value&>(in_value));
+      return;
+   }
+
+   // all documents share s_allocator so the underlying value can be moved
+   // into this array rather than deep copied
+   m_impl->Document->PushBack(compact(*in_value.m_impl->Document), s_allocator);
 }
 
+// scalars are pushed directly rather than through a temporary json::Value,
+// which would cost a document allocation per element
 void Array::push_back(bool in_value)
 {
-   push_back(json::Value(in_value));
+   m_impl->Document->PushBack(JsonValue(in_value), s_allocator);
 }
 
 void Array::push_back(double in_value)
 {
-   push_back(json::Value(in_value));
+   m_impl->Document->PushBack(JsonValue(in_value), s_allocator);
 }
 
 void Array::push_back(float in_value)
 {
-   push_back(json::Value(in_value));
+   m_impl->Document->PushBack(JsonValue(in_value), s_allocator);
 }
 
 void Array::push_back(int in_value)
 {
-   push_back(json::Value(in_value));
+   m_impl->Document->PushBack(JsonValue(in_value), s_allocator);
 }
 
 void Array::push_back(int64_t in_value)
 {
-   push_back(json::Value(in_value));
+   m_impl->Document->PushBack(JsonValue(in_value), s_allocator);
 }
 
 void Array::push_back(const char* in_value)
 {
-   push_back(json::Value(in_value));
+   m_impl->Document->PushBack(JsonValue(in_value, s_allocator), s_allocator);
 }
 
 void Array::push_back(const std::string& in_value)
 {
-   push_back(json::Value(in_value));
+   m_impl->Document->PushBack(JsonValue(in_value.c_str(), s_allocator), s_allocator);
 }
 
 void Array::push_back(unsigned int in_value)
 {
-   push_back(json::Value(in_value));
+   m_impl->Document->PushBack(JsonValue(in_value), s_allocator);
 }
 
 void Array::push_back(uint64_t in_value)
 {
-   push_back(json::Value(in_value));
+   m_impl->Document->PushBack(JsonValue(in_value), s_allocator);
 }
 
 void Array::push_back(const json::Array& in_value)
 {
-   push_back(json::Value(in_value));
+   push_back(static_cast<const Value&>(in_value));
+}
+
+void Array::push_back(json::Array&& in_value)
+{
+   push_back(static_cast<Value&&>(in_value));
 }
 
 void Array::push_back(const json::Object& in_value)
 {
-   push_back(json::Value(in_value));
+   push_back(static_cast<const Value&>(in_value));
+}
+
+void Array::push_back(json::Object&& in_value)
+{
+   push_back(static_cast<Value&&>(in_value));
 }
 
 bool Array::toSetString(std::set<std::string>& out_set) const
@@ -1591,6 +1692,134 @@ Array::Array(ValueImplPtr in_value)
    assert(m_impl->Document->IsArray());
 }
 
+// Stream Writer =======================================================================================================
+namespace {
+
+// rapidjson output stream which appends to a caller-owned string
+class StringOutputStream
+{
+public:
+   typedef char Ch;
+
+   explicit StringOutputStream(std::string* io_pOutput) :
+      m_pOutput(io_pOutput)
+   {
+   }
+
+   void Put(char in_ch)
+   {
+      m_pOutput->push_back(in_ch);
+   }
+
+   void Flush()
+   {
+   }
+
+private:
+   std::string* m_pOutput;
+};
+
+} // anonymous namespace
+
+struct StreamWriter::Impl
+{
+   explicit Impl(std::string* io_pOutput) :
+      Stream(io_pOutput),
+      Writer(Stream)
+   {
+   }
+
+   StringOutputStream Stream;
+   rapidjson::Writer<StringOutputStream> Writer;
+};
+
+PRIVATE_IMPL_DELETER_IMPL(StreamWriter)
+
+StreamWriter::StreamWriter(std::string* io_pOutput) :
+   m_impl(new Impl(io_pOutput))
+{
+}
+
+void StreamWriter::startObject()
+{
+   m_impl->Writer.StartObject();
+}
+
+void StreamWriter::endObject()
+{
+   m_impl->Writer.EndObject();
+}
+
+void StreamWriter::startArray()
+{
+   m_impl->Writer.StartArray();
+}
+
+void StreamWriter::endArray()
+{
+   m_impl->Writer.EndArray();
+}
+
+void StreamWriter::key(const std::string& in_name)
+{
+   m_impl->Writer.Key(in_name.c_str(), static_cast<rapidjson::SizeType>(in_name.size()));
+}
+
+void StreamWriter::writeNull()
+{
+   m_impl->Writer.Null();
+}
+
+void StreamWriter::write(bool in_value)
+{
+   m_impl->Writer.Bool(in_value);
+}
+
+void StreamWriter::write(double in_value)
+{
+   m_impl->Writer.Double(in_value);
+}
+
+void StreamWriter::write(int in_value)
+{
+   m_impl->Writer.Int(in_value);
+}
+
+void StreamWriter::write(int64_t in_value)
+{
+   m_impl->Writer.Int64(in_value);
+}
+
+void StreamWriter::write(unsigned int in_value)
+{
+   m_impl->Writer.Uint(in_value);
+}
+
+void StreamWriter::write(uint64_t in_value)
+{
+   m_impl->Writer.Uint64(in_value);
+}
+
+void StreamWriter::write(const char* in_value)
+{
+   m_impl->Writer.String(in_value);
+}
+
+void StreamWriter::write(const std::string& in_value)
+{
+   m_impl->Writer.String(in_value.c_str(), static_cast<rapidjson::SizeType>(in_value.size()));
+}
+
+void StreamWriter::write(const Value& in_value)
+{
+   in_value.m_impl->Document->Accept(m_impl->Writer);
+}
+
+bool StreamWriter::isComplete() const
+{
+   return m_impl->Writer.IsComplete();
+}
+
 // Free functions ======================================================================================================
 std::string typeAsString(Type in_type)
 {
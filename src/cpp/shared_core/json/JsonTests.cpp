@@ -15,14 +15,25 @@
 
 #include <tests/TestThat.hpp>
 
+#include <chrono>
+#include <functional>
 #include <iostream>
+#include <iterator>
 #include <set>
 
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
 #include <boost/optional/optional_io.hpp>
 
 #include <shared_core/Error.hpp>
 #include <shared_core/json/Json.hpp>
 
+#include "shared_core/json/rapidjson/document.h"
+#include "shared_core/json/rapidjson/stringbuffer.h"
+#include "shared_core/json/rapidjson/writer.h"
+
 namespace rstudio {
 namespace core {
 namespace tests {
@@ -1081,6 +1092,221 @@ TEST_CASE("Json")
       CHECK((json::readObject(obj, "intArr", badIntSet) && badIntSet.empty()));
       CHECK((json::readObject(obj, "intArr", badOptIntSet) && !!(badOptIntSet == boost::none)));
    }
+
+   SECTION("Inserting rvalues moves them into the container")
+   {
+      json::Object inner;
+      inner["x"] = 1;
+      inner["y"] = "two";
+
+      json::Array arr;
+      arr.push_back(std::move(inner));
+      arr.push_back(json::Value("three"));
+      arr.push_back(4);
+
+      REQUIRE(arr.getSize() == 3);
+      CHECK(arr[0].getObject()["x"].getInt() == 1);
+      CHECK(arr[0].getObject()["y"].getString() == "two");
+      CHECK(arr[1].getString() == "three");
+      CHECK(arr[2].getInt() == 4);
+
+      json::Array copied;
+      copied.push_back(1);
+      json::Object outer;
+      outer.insert("arr", std::move(arr));
+      outer.insert("copied", copied);
+      outer.insert("arr2", json::Value(5));
+      outer.insert("arr2", json::Value(6));
+
+      CHECK(outer["arr"].getArray().getSize() == 3);
+      CHECK(outer["arr2"].getInt() == 6);
+      CHECK(outer.getSize() == 3);
+
+      // the copied array must remain independent of the inserted one
+      copied.push_back(2);
+      CHECK(copied.getSize() == 2);
+      CHECK(outer["copied"].getArray().getSize() == 1);
+
+      CHECK(outer.write() == "{\"arr\":[{\"x\":1,\"y\":\"two\"},\"three\",4],\"copied\":[1],\"arr2\":6}");
+   }
+
+   SECTION("Values within other documents are copied rather than moved")
+   {
+      json::Object source;
+      source["name"] = "value";
+      json::Array list;
+      list.push_back(1);
+      list.push_back(2);
+      source["list"] = list;
+
+      // inserting a member (whose value refers into the source)
+      json::Object dest;
+      for (const json::Object::Member& member : source)
+         dest.insert(member);
+
+      CHECK(dest.write() == source.write());
+      CHECK(source["name"].getString() == "value");
+      CHECK(source["list"].getArray().getSize() == 2);
+
+      // copying elements through back_inserter
+      const json::Array constSource = source["list"].getArray();
+      json::Array copied;
+      std::copy(constSource.begin(), constSource.end(), std::back_inserter(copied));
+
+      CHECK(copied.write() == "[1,2]");
+      CHECK(constSource.write() == "[1,2]");
+      CHECK(source["list"].getArray().write() == "[1,2]");
+
+      // values sharing another's implementation
+      json::Value value = source;
+      json::Array holder;
+      holder.push_back(value.getObject());
+      CHECK(value.getObject()["name"].getString() == "value");
+      CHECK(holder[0].write() == source.write());
+   }
+
+   SECTION("StreamWriter output matches write()")
+   {
+      json::Object nested;
+      nested["a"] = "quoted \"text\"";
+      nested["b"] = json::Value();
+
+      json::Object expected;
+      expected["id"] = 42;
+      expected["ok"] = true;
+      expected["ratio"] = 0.25;
+      expected["nested"] = nested;
+
+      std::string output;
+      json::StreamWriter writer(&output);
+      CHECK_FALSE(writer.isComplete());
+
+      writer.startObject();
+      writer.key("id");
+      writer.write(42);
+      writer.key("ok");
+      writer.write(true);
+      writer.key("ratio");
+      writer.write(0.25);
+      writer.key("nested");
+      writer.write(nested);
+      writer.endObject();
+
+      CHECK(writer.isComplete());
+      CHECK(output == expected.write());
+
+      std::string arrayOutput;
+      json::StreamWriter arrayWriter(&arrayOutput);
+      arrayWriter.startArray();
+      arrayWriter.write("one");
+      arrayWriter.writeNull();
+      arrayWriter.write(static_cast<uint64_t>(18446744073709550615U));
+      arrayWriter.endArray();
+      CHECK(arrayOutput == "[\"one\",null,18446744073709550615]");
+   }
+}
+
+namespace {
+
+const int kBenchmarkElements = 100000;
+
+json::Object makeRow(int i)
+{
+   json::Object row;
+   row["id"] = i;
+   row["name"] = "element";
+   row["value"] = i * 0.5;
+   row["visible"] = (i % 2) == 0;
+   return row;
+}
+
+// the same array built directly with rapidjson, with children allocated by
+// the given allocator (e.g. in a memory pool belonging to the document)
+template <typename Allocator>
+std::size_t buildAndWriteRapidJson()
+{
+   typedef rapidjson::GenericDocument<rapidjson::UTF8<>, Allocator> Document;
+   typedef rapidjson::GenericValue<rapidjson::UTF8<>, Allocator> Value;
+
+   Document document;
+   document.SetArray();
+   Allocator& allocator = document.GetAllocator();
+   for (int i = 0; i < kBenchmarkElements; ++i)
+   {
+      Value row(rapidjson::kObjectType);
+      row.AddMember("id", i, allocator);
+      row.AddMember("name", Value("element", allocator), allocator);
+      row.AddMember("value", i * 0.5, allocator);
+      row.AddMember("visible", (i % 2) == 0, allocator);
+      document.PushBack(row, allocator);
+   }
+
+   rapidjson::StringBuffer buffer;
+   rapidjson::Writer<rapidjson::StringBuffer, rapidjson::UTF8<>, rapidjson::UTF8<>, Allocator> writer(buffer);
+   document.Accept(writer);
+   return buffer.GetSize();
+}
+
+long peakRssKb()
+{
+   struct rusage usage;
+   ::getrusage(RUSAGE_SELF, &usage);
+   return usage.ru_maxrss;
+}
+
+// runs a variant in a child process (as peak RSS can only grow), reporting
+// its time and how much it raised peak RSS
+void benchmark(const std::string& label, const std::function<std::size_t()>& buildAndWrite)
+{
+   std::cout.flush();
+   pid_t pid = ::fork();
+   if (pid == 0)
+   {
+      long rssBefore = peakRssKb();
+      auto start = std::chrono::steady_clock::now();
+      std::size_t size = buildAndWrite();
+      auto elapsed = std::chrono::steady_clock::now() - start;
+
+      std::cout << label << ": "
+                << std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() << "ms, "
+                << "peak rss +" << (peakRssKb() - rssBefore) << "kb "
+                << "(" << size << " bytes)" << std::endl;
+      ::_exit(0);
+   }
+
+   int status = 0;
+   ::waitpid(pid, &status, 0);
+}
+
+} // anonymous namespace
+
+TEST_CASE("Json build and serialize benchmark", "[.benchmark]")
+{
+   std::cout << "array of " << kBenchmarkElements << " objects" << std::endl;
+
+   benchmark("json, move insert", []() {
+      json::Array arr;
+      for (int i = 0; i < kBenchmarkElements; ++i)
+         arr.push_back(makeRow(i));
+      return arr.write().size();
+   });
+
+   benchmark("json, copy insert", []() {
+      json::Array arr;
+      for (int i = 0; i < kBenchmarkElements; ++i)
+      {
+         const json::Object row = makeRow(i);
+         arr.push_back(row);
+      }
+      return arr.write().size();
+   });
+
+   // what an arena for the children of a document would gain (json::Value
+   // uses the CrtAllocator)
+   benchmark("rapidjson, memory pool allocator",
+             buildAndWriteRapidJson<rapidjson::MemoryPoolAllocator<rapidjson::CrtAllocator> >);
+   benchmark("rapidjson, crt allocator",
+             buildAndWriteRapidJson<rapidjson::CrtAllocator>);
 }
 
 } // end namespace tests
@@ -43,6 +43,9 @@ public class ImageFrame extends Frame
             }
             else
             {
+               // the image fills the frame; while the frame is being resized
+               // (before an image of the new size arrives) the current image
+               // is scaled to fit, keeping its aspect ratio
                String sizing = "width=\"100%\" height=\"100%\"";
                setupContent(getElement(), sizing);
                replaceLocation(getElement(), url_);
@@ -105,7 +108,7 @@ public class ImageFrame extends Frame
       doc.write(
          '<html><head></head>' +
          '<body style="margin: 0; padding: 0; overflow: hidden; border: none">' +
-         '<img id="img" ' + sizing + ' style="display: none" src="data:image/gif;base64,R0lGODlhAQABAAD/ACwAAAAAAQABAAACADs%3D">' +
+         '<img id="img" ' + sizing + ' style="display: none; object-fit: contain" src="data:image/gif;base64,R0lGODlhAQABAAD/ACwAAAAAAQABAAACADs%3D">' +
          '</body></html>');
       doc.close();
    }-*/;